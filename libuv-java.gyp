@@ -81,27 +81,36 @@
                 ['OS == "linux"', {
                     'sources': [
                         'async.cpp',
+                        'buffer_pool.cpp',
                         'check.cpp',
                         'child_process.cpp',
                         'constants.cpp',
                         'context.cpp',
+                        'dns.cpp',
+                        'encoding.cpp',
                         'exception.cpp',
                         'file.cpp',
                         'file_event.cpp',
                         'file_poll.cpp',
+                        'file_poll_group.cpp',
+                        'freelist.cpp',
                         'handle.cpp',
                         'idle.cpp',
                         'loop.cpp',
+                        'metrics.cpp',
                         'misc.cpp',
                         'os.cpp',
                         'pipe.cpp',
                         'poll.cpp',
                         'process.cpp',
+                        'ring.cpp',
+                        'shared_memory.cpp',
                         'signal.cpp',
                         'stats.cpp',
                         'stream.cpp',
                         'timer.cpp',
                         'tcp.cpp',
+                        'timer_wheel.cpp',
                         'tty.cpp',
                         'udp.cpp',
                     ],
@@ -122,27 +131,36 @@
                 ['OS == "solaris"', {
                     'sources': [
                         'async.cpp',
+                        'buffer_pool.cpp',
                         'check.cpp',
                         'child_process.cpp',
                         'constants.cpp',
                         'context.cpp',
+                        'dns.cpp',
+                        'encoding.cpp',
                         'exception.cpp',
                         'file.cpp',
                         'file_event.cpp',
                         'file_poll.cpp',
+                        'file_poll_group.cpp',
+                        'freelist.cpp',
                         'handle.cpp',
                         'idle.cpp',
                         'loop.cpp',
+                        'metrics.cpp',
                         'misc.cpp',
                         'os.cpp',
                         'pipe.cpp',
                         'poll.cpp',
                         'process.cpp',
+                        'ring.cpp',
+                        'shared_memory.cpp',
                         'signal.cpp',
                         'stats.cpp',
                         'stream.cpp',
                         'timer.cpp',
                         'tcp.cpp',
+                        'timer_wheel.cpp',
                         'tty.cpp',
                         'udp.cpp',
                     ],
@@ -177,27 +195,36 @@
                 ['OS == "mac"', {
                     'sources': [
                         '<(SRC)/libuv-java/async.cpp',
+                        '<(SRC)/libuv-java/buffer_pool.cpp',
                         '<(SRC)/libuv-java/check.cpp',
                         '<(SRC)/libuv-java/child_process.cpp',
                         '<(SRC)/libuv-java/constants.cpp',
                         '<(SRC)/libuv-java/context.cpp',
+                        '<(SRC)/libuv-java/dns.cpp',
+                        '<(SRC)/libuv-java/encoding.cpp',
                         '<(SRC)/libuv-java/exception.cpp',
                         '<(SRC)/libuv-java/file.cpp',
                         '<(SRC)/libuv-java/file_event.cpp',
                         '<(SRC)/libuv-java/file_poll.cpp',
+                        '<(SRC)/libuv-java/file_poll_group.cpp',
+                        '<(SRC)/libuv-java/freelist.cpp',
                         '<(SRC)/libuv-java/handle.cpp',
                         '<(SRC)/libuv-java/idle.cpp',
                         '<(SRC)/libuv-java/loop.cpp',
+                        '<(SRC)/libuv-java/metrics.cpp',
                         '<(SRC)/libuv-java/misc.cpp',
                         '<(SRC)/libuv-java/os.cpp',
                         '<(SRC)/libuv-java/pipe.cpp',
                         '<(SRC)/libuv-java/poll.cpp',
                         '<(SRC)/libuv-java/process.cpp',
+                        '<(SRC)/libuv-java/ring.cpp',
+                        '<(SRC)/libuv-java/shared_memory.cpp',
                         '<(SRC)/libuv-java/signal.cpp',
                         '<(SRC)/libuv-java/stats.cpp',
                         '<(SRC)/libuv-java/stream.cpp',
                         '<(SRC)/libuv-java/timer.cpp',
                         '<(SRC)/libuv-java/tcp.cpp',
+                        '<(SRC)/libuv-java/timer_wheel.cpp',
                         '<(SRC)/libuv-java/tty.cpp',
                         '<(SRC)/libuv-java/udp.cpp',
                     ],
@@ -221,27 +248,36 @@
                     ],
                     'sources': [
                         '<(SRC)/libuv-java/async.cpp',
+                        '<(SRC)/libuv-java/buffer_pool.cpp',
                         '<(SRC)/libuv-java/check.cpp',
                         '<(SRC)/libuv-java/child_process.cpp',
                         '<(SRC)/libuv-java/constants.cpp',
                         '<(SRC)/libuv-java/context.cpp',
+                        '<(SRC)/libuv-java/dns.cpp',
+                        '<(SRC)/libuv-java/encoding.cpp',
                         '<(SRC)/libuv-java/exception.cpp',
                         '<(SRC)/libuv-java/file.cpp',
                         '<(SRC)/libuv-java/file_event.cpp',
                         '<(SRC)/libuv-java/file_poll.cpp',
+                        '<(SRC)/libuv-java/file_poll_group.cpp',
+                        '<(SRC)/libuv-java/freelist.cpp',
                         '<(SRC)/libuv-java/handle.cpp',
                         '<(SRC)/libuv-java/idle.cpp',
                         '<(SRC)/libuv-java/loop.cpp',
+                        '<(SRC)/libuv-java/metrics.cpp',
                         '<(SRC)/libuv-java/misc.cpp',
                         '<(SRC)/libuv-java/os.cpp',
                         '<(SRC)/libuv-java/pipe.cpp',
                         '<(SRC)/libuv-java/poll.cpp',
                         '<(SRC)/libuv-java/process.cpp',
+                        '<(SRC)/libuv-java/ring.cpp',
+                        '<(SRC)/libuv-java/shared_memory.cpp',
                         '<(SRC)/libuv-java/signal.cpp',
                         '<(SRC)/libuv-java/stats.cpp',
                         '<(SRC)/libuv-java/stream.cpp',
                         '<(SRC)/libuv-java/timer.cpp',
                         '<(SRC)/libuv-java/tcp.cpp',
+                        '<(SRC)/libuv-java/timer_wheel.cpp',
                         '<(SRC)/libuv-java/tty.cpp',
                         '<(SRC)/libuv-java/udp.cpp',
                     ],
@@ -127,6 +127,9 @@ public final class Constants {
     public static final int SIGSYS          = FIELD_VALUES[65];
     public static final int SIGUNUSED       = FIELD_VALUES[66];
 
+    // libuv error codes raised from java
+    public static final int UV_ECANCELED    = FIELD_VALUES[67];
+
     private static native void _get_field_values(int[] values);
 
     static {
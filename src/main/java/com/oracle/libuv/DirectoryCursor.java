@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+package com.oracle.libuv;
+
+import java.nio.ByteBuffer;
+import java.nio.charset.StandardCharsets;
+
+/**
+ * Reads a directory in bounded batches. Each {@link #next()} packs up to
+ * {@link #capacity()} entries into a direct buffer, names as UTF-8 bytes at
+ * {@link #offset(int)} with {@link #length(int)}, along with their type so
+ * that walkers do not have to stat every entry. "." and ".." are skipped.
+ */
+public final class DirectoryCursor implements AutoCloseable {
+
+    // must be equal to DirentType in file.cpp
+    public static final int TYPE_UNKNOWN = 0;
+    public static final int TYPE_FILE    = 1;
+    public static final int TYPE_DIR     = 2;
+    public static final int TYPE_LINK    = 3;
+    public static final int TYPE_FIFO    = 4;
+    public static final int TYPE_SOCKET  = 5;
+    public static final int TYPE_CHAR    = 6;
+    public static final int TYPE_BLOCK   = 7;
+
+    static final int DEFAULT_BUFFER_SIZE = 64 * 1024;
+    static final int DEFAULT_BATCH_SIZE = 1024;
+
+    private final Files files;
+    private final String path;
+    final ByteBuffer names;
+    final int[] offsets;
+    final int[] lengths;
+    final int[] types;
+    long pointer;
+    int count;
+    private boolean done;
+
+    DirectoryCursor(final Files files, final String path, final long pointer, final int bufferSize, final int batchSize) {
+        this.files = files;
+        this.path = path;
+        this.pointer = pointer;
+        this.names = ByteBuffer.allocateDirect(bufferSize);
+        this.offsets = new int[batchSize];
+        this.lengths = new int[batchSize];
+        this.types = new int[batchSize];
+    }
+
+    public String getPath() {
+        return path;
+    }
+
+    public int capacity() {
+        return types.length;
+    }
+
+    /**
+     * Reads the next batch, replacing the previous one. Returns the number
+     * of entries read, 0 once the directory is exhausted.
+     */
+    public int next() {
+        if (done || pointer == 0) {
+            count = 0;
+            return 0;
+        }
+        count = files.readdirNext(this);
+        done = count == 0;
+        return count;
+    }
+
+    public boolean isDone() {
+        return done;
+    }
+
+    public int size() {
+        return count;
+    }
+
+    public int type(final int index) {
+        checkIndex(index);
+        return types[index];
+    }
+
+    public int offset(final int index) {
+        checkIndex(index);
+        return offsets[index];
+    }
+
+    public int length(final int index) {
+        checkIndex(index);
+        return lengths[index];
+    }
+
+    /**
+     * The buffer holding the names of the current batch, valid until the
+     * next call to {@link #next()}.
+     */
+    public ByteBuffer names() {
+        return names.duplicate();
+    }
+
+    public String name(final int index) {
+        checkIndex(index);
+        final byte[] bytes = new byte[lengths[index]];
+        final ByteBuffer buffer = names.duplicate();
+        buffer.position(offsets[index]);
+        buffer.get(bytes);
+        return new String(bytes, StandardCharsets.UTF_8);
+    }
+
+    @Override
+    public void close() {
+        if (pointer != 0) {
+            files.closedir(this);
+            pointer = 0;
+            count = 0;
+        }
+    }
+
+    private void checkIndex(final int index) {
+        if (index < 0 || index >= count) {
+            throw new IndexOutOfBoundsException(Integer.toString(index));
+        }
+    }
+}
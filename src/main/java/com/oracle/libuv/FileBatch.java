@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+package com.oracle.libuv;
+
+import java.nio.ByteBuffer;
+import java.util.Arrays;
+import java.util.Objects;
+
+/**
+ * A list of positional reads and writes on direct buffers submitted to
+ * {@link Files#submit(FileBatch, Object)} with one native call. The
+ * operations run in order on the libuv thread pool and complete with a
+ * single {@link com.oracle.libuv.cb.FileBatchCallback}, after which
+ * {@link #result(int)} holds the bytes transferred by each of them.
+ */
+public final class FileBatch {
+
+    private static final int INITIAL_CAPACITY = 16;
+
+    // must be equal to values in uv.h
+    static final int READ = 3;
+    static final int WRITE = 4;
+
+    int count;
+    int[] types;
+    int[] fds;
+    ByteBuffer[] buffers;
+    int[] offsets;
+    int[] lengths;
+    long[] positions;
+    int[] results;
+    Exception[] errors;
+
+    public FileBatch() {
+        this(INITIAL_CAPACITY);
+    }
+
+    public FileBatch(final int capacity) {
+        if (capacity <= 0) {
+            throw new IllegalArgumentException("capacity must be positive");
+        }
+        types = new int[capacity];
+        fds = new int[capacity];
+        buffers = new ByteBuffer[capacity];
+        offsets = new int[capacity];
+        lengths = new int[capacity];
+        positions = new long[capacity];
+    }
+
+    /**
+     * Queues a read into buffer, from its position to its limit, at the
+     * given file position (-1 for the current file position).
+     */
+    public FileBatch read(final int fd, final ByteBuffer buffer, final long position) {
+        return add(READ, fd, buffer, position);
+    }
+
+    /**
+     * Queues a write of buffer, from its position to its limit.
+     */
+    public FileBatch write(final int fd, final ByteBuffer buffer, final long position) {
+        return add(WRITE, fd, buffer, position);
+    }
+
+    public int size() {
+        return count;
+    }
+
+    public int type(final int index) {
+        checkIndex(index);
+        return types[index];
+    }
+
+    public int fd(final int index) {
+        checkIndex(index);
+        return fds[index];
+    }
+
+    public ByteBuffer buffer(final int index) {
+        checkIndex(index);
+        return buffers[index];
+    }
+
+    /**
+     * Bytes read or written by the operation at index, -1 if it failed.
+     */
+    public int result(final int index) {
+        checkIndex(index);
+        return results == null ? 0 : results[index];
+    }
+
+    public Exception error(final int index) {
+        checkIndex(index);
+        return errors == null ? null : errors[index];
+    }
+
+    public void clear() {
+        Arrays.fill(buffers, 0, count, null);
+        count = 0;
+        results = null;
+        errors = null;
+    }
+
+    // called by Files before the batch is handed to native code
+    void prepare() {
+        results = new int[count];
+        errors = new Exception[count];
+    }
+
+    private FileBatch add(final int type, final int fd, final ByteBuffer buffer, final long position) {
+        Objects.requireNonNull(buffer);
+        if (!buffer.isDirect()) {
+            throw new IllegalArgumentException("direct buffer required");
+        }
+        if (count == types.length) {
+            grow();
+        }
+        types[count] = type;
+        fds[count] = fd;
+        buffers[count] = buffer;
+        offsets[count] = buffer.position();
+        lengths[count] = buffer.remaining();
+        positions[count] = position;
+        count++;
+        return this;
+    }
+
+    private void grow() {
+        final int capacity = types.length * 2;
+        types = Arrays.copyOf(types, capacity);
+        fds = Arrays.copyOf(fds, capacity);
+        buffers = Arrays.copyOf(buffers, capacity);
+        offsets = Arrays.copyOf(offsets, capacity);
+        lengths = Arrays.copyOf(lengths, capacity);
+        positions = Arrays.copyOf(positions, capacity);
+    }
+
+    private void checkIndex(final int index) {
+        if (index < 0 || index >= count) {
+            throw new IndexOutOfBoundsException(Integer.toString(index));
+        }
+    }
+}
@@ -30,14 +30,17 @@ import java.util.HashMap;
 import java.util.Map;
 import java.util.Objects;
 
+import com.oracle.libuv.cb.FileBatchCallback;
 import com.oracle.libuv.cb.FileCallback;
 import com.oracle.libuv.cb.FileCloseCallback;
 import com.oracle.libuv.cb.FileOpenCallback;
 import com.oracle.libuv.cb.FileReadCallback;
 import com.oracle.libuv.cb.FileReadDirCallback;
 import com.oracle.libuv.cb.FileReadLinkCallback;
+import com.oracle.libuv.cb.FileStatManyCallback;
 import com.oracle.libuv.cb.FileStatsCallback;
 import com.oracle.libuv.cb.FileUTimeCallback;
+import com.oracle.libuv.cb.FileVectorCallback;
 import com.oracle.libuv.cb.FileWriteCallback;
 import com.oracle.libuv.handles.LoopHandle;
 
@@ -78,6 +81,20 @@ public class Files {
     private static final int UV_FS_CHOWN     = 24;
     private static final int UV_FS_FCHOWN    = 25;
 
+    // protection and advice for mmap and madvise, mapped to the platform values natively
+    public static final int PROT_READ       = 1;
+    public static final int PROT_WRITE      = 2;
+
+    public static final int MADV_NORMAL     = 0;
+    public static final int MADV_SEQUENTIAL = 1;
+    public static final int MADV_RANDOM     = 2;
+    public static final int MADV_WILLNEED   = 3;
+    public static final int MADV_DONTNEED   = 4;
+
+    // statMany fills STAT_ROW longs per path: the error code, 0 on success,
+    // followed by the Stats.FIELDS values
+    public static final int STAT_ROW        = Stats.FIELDS + 1;
+
     private FileCallback onCustom = null;
     private FileOpenCallback onOpen = null;
     private FileCloseCallback onClose = null;
@@ -104,6 +121,10 @@ public class Files {
     private FileReadLinkCallback onReadLink = null;
     private FileCallback onChown = null;
     private FileCallback onFChown = null;
+    private FileVectorCallback onReadv = null;
+    private FileVectorCallback onWritev = null;
+    private FileBatchCallback onBatch = null;
+    private FileStatManyCallback onStatMany = null;
 
     private final long pointer;
     private final LoopHandle loop;
@@ -239,6 +260,22 @@ public class Files {
         onFChown = callback;
     }
 
+    public void setReadvCallback(final FileVectorCallback callback) {
+        onReadv = callback;
+    }
+
+    public void setWritevCallback(final FileVectorCallback callback) {
+        onWritev = callback;
+    }
+
+    public void setBatchCallback(final FileBatchCallback callback) {
+        onBatch = callback;
+    }
+
+    public void setStatManyCallback(final FileStatManyCallback callback) {
+        onStatMany = callback;
+    }
+
     public void close() {
         if (!closed) {
             openedFiles.clear();
@@ -359,6 +396,94 @@ public class Files {
                 _write(pointer, fd, buffer, null, length, offset, position, context, loop.getContext());
     }
 
+    /**
+     * Reads into the direct buffers, each from its position to its limit,
+     * with a single preadv (or readv when position is -1). The buffer
+     * positions are not updated.
+     */
+    public long readv(final int fd, final ByteBuffer[] buffers, final long position) {
+        final OpenedFile file = getOpenedFileAssertNonNull(fd, "readvSync");
+        LibUVPermission.checkReadFile(fd, file.getPath());
+        return vectorIO(UV_FS_READ, fd, buffers, position, SYNC_MODE);
+    }
+
+    public long readv(final int fd, final ByteBuffer[] buffers, final long position, final Object context) {
+        final OpenedFile file = getOpenedFile(fd);
+        if (file == null) {
+            callVector(UV_FS_READ, context, -1, buffers, newEBADF("readv", fd), loop.getContext());
+            return -1;
+        }
+        LibUVPermission.checkReadFile(fd, file.getPath());
+        return vectorIO(UV_FS_READ, fd, buffers, position, context);
+    }
+
+    public long writev(final int fd, final ByteBuffer[] buffers, final long position) {
+        final OpenedFile file = getOpenedFileAssertNonNull(fd, "writevSync");
+        LibUVPermission.checkWriteFile(fd, file.getPath());
+        return vectorIO(UV_FS_WRITE, fd, buffers, position, SYNC_MODE);
+    }
+
+    public long writev(final int fd, final ByteBuffer[] buffers, final long position, final Object context) {
+        final OpenedFile file = getOpenedFile(fd);
+        if (file == null) {
+            callVector(UV_FS_WRITE, context, -1, buffers, newEBADF("writev", fd), loop.getContext());
+            return -1;
+        }
+        LibUVPermission.checkWriteFile(fd, file.getPath());
+        return vectorIO(UV_FS_WRITE, fd, buffers, position, context);
+    }
+
+    /**
+     * Runs every operation of the batch on the calling thread, the results
+     * are available from the batch on return.
+     */
+    public int submit(final FileBatch batch) {
+        return submit(batch, SYNC_MODE);
+    }
+
+    /**
+     * Queues the whole batch with one native call, completed through the
+     * batch callback. Unknown fds are rejected with EBADF before anything
+     * is queued.
+     */
+    public int submit(final FileBatch batch, final Object context) {
+        Objects.requireNonNull(batch);
+        if (batch.count == 0) {
+            return 0;
+        }
+        for (int i = 0; i < batch.count; i++) {
+            final int fd = batch.fds[i];
+            final OpenedFile file = getOpenedFileAssertNonNull(fd, "submit");
+            if (batch.types[i] == FileBatch.READ) {
+                LibUVPermission.checkReadFile(fd, file.getPath());
+            } else {
+                LibUVPermission.checkWriteFile(fd, file.getPath());
+            }
+        }
+        batch.prepare();
+        return _submit(pointer, batch.count, batch.types, batch.fds, batch.buffers, batch.offsets, batch.lengths,
+                batch.positions, batch.results, batch.errors, batch, context, loop.getContext());
+    }
+
+    private long vectorIO(final int type, final int fd, final ByteBuffer[] buffers, final long position, final Object context) {
+        Objects.requireNonNull(buffers);
+        if (buffers.length == 0) {
+            throw new IllegalArgumentException("no buffers");
+        }
+        final int[] offsets = new int[buffers.length];
+        final int[] lengths = new int[buffers.length];
+        for (int i = 0; i < buffers.length; i++) {
+            final ByteBuffer buffer = buffers[i];
+            Objects.requireNonNull(buffer);
+            if (!buffer.isDirect()) {
+                throw new IllegalArgumentException("direct buffer required");
+            }
+            offsets[i] = buffer.position();
+            lengths[i] = buffer.remaining();
+        }
+        return _vector_io(pointer, type, fd, buffers, offsets, lengths, position, context, loop.getContext());
+    }
+
     public int mkdir(final String path, final int mode) {
         Objects.requireNonNull(path);
         LibUVPermission.checkWriteFile(path);
@@ -395,6 +520,32 @@ public class Files {
         return _readdir(pointer, path, flags, context, loop.getContext());
     }
 
+    public DirectoryCursor opendir(final String path) {
+        return opendir(path, DirectoryCursor.DEFAULT_BUFFER_SIZE, DirectoryCursor.DEFAULT_BATCH_SIZE);
+    }
+
+    /**
+     * Opens a cursor reading at most batchSize entries, whose names take
+     * at most bufferSize bytes, per call to next.
+     */
+    public DirectoryCursor opendir(final String path, final int bufferSize, final int batchSize) {
+        Objects.requireNonNull(path);
+        if (bufferSize <= 0 || batchSize <= 0) {
+            throw new IllegalArgumentException("buffer and batch sizes must be positive");
+        }
+        LibUVPermission.checkReadFile(path);
+        return new DirectoryCursor(this, path, _opendir(pointer, path), bufferSize, batchSize);
+    }
+
+    int readdirNext(final DirectoryCursor cursor) {
+        return _readdir_next(pointer, cursor.pointer, cursor.names, cursor.names.capacity(),
+                cursor.offsets, cursor.lengths, cursor.types);
+    }
+
+    void closedir(final DirectoryCursor cursor) {
+        _closedir(pointer, cursor.pointer);
+    }
+
     public Stats stat(final String path) {
         Objects.requireNonNull(path);
         LibUVPermission.checkReadFile(path);
@@ -425,6 +576,73 @@ public class Files {
         return _fstat(pointer, fd, context, loop.getContext());
     }
 
+    /**
+     * Stats into an existing instance instead of allocating a new one. Not
+     * an overload of stat, which takes an asynchronous context.
+     */
+    public Stats statInto(final String path, final Stats reuse) {
+        Objects.requireNonNull(path);
+        Objects.requireNonNull(reuse);
+        LibUVPermission.checkReadFile(path);
+        _stat_into(pointer, path, reuse);
+        return reuse;
+    }
+
+    public Stats fstatInto(final int fd, final Stats reuse) {
+        final OpenedFile file = getOpenedFileAssertNonNull(fd, "fstatSync");
+        Objects.requireNonNull(reuse);
+        LibUVPermission.checkReadFile(fd, file.getPath());
+        _fstat_into(pointer, fd, reuse);
+        return reuse;
+    }
+
+    /**
+     * Stats every path on the calling thread into out, STAT_ROW values per
+     * path. Failures are reported per path through the error code rather
+     * than thrown. Returns the number of paths that were stat'ed.
+     */
+    public int statMany(final String[] paths, final long[] out) {
+        return statMany(paths, out, SYNC_MODE);
+    }
+
+    /**
+     * Stats every path as a single work item on the thread pool, out is
+     * filled when the stat many callback runs.
+     */
+    public int statMany(final String[] paths, final long[] out, final Object context) {
+        Objects.requireNonNull(paths);
+        Objects.requireNonNull(out);
+        if (out.length < paths.length * STAT_ROW) {
+            throw new IllegalArgumentException("out too small for " + paths.length + " paths");
+        }
+        if (paths.length == 0) {
+            return 0;
+        }
+        for (final String path : paths) {
+            Objects.requireNonNull(path);
+            LibUVPermission.checkReadFile(path);
+        }
+        return _stat_many(pointer, paths, out, context, loop.getContext());
+    }
+
+    /**
+     * The error code of the index'th path of a statMany, 0 on success.
+     */
+    public static int statError(final long[] out, final int index) {
+        return (int) out[index * STAT_ROW];
+    }
+
+    /**
+     * Copies the index'th result of a statMany into reuse, null when that
+     * path failed.
+     */
+    public static Stats statAt(final long[] out, final int index, final Stats reuse) {
+        if (statError(out, index) != 0) {
+            return null;
+        }
+        return reuse.set(out, index * STAT_ROW + 1);
+    }
+
     public int rename(final String path, final String newPath) {
         Objects.requireNonNull(path);
         Objects.requireNonNull(newPath);
@@ -509,6 +727,44 @@ public class Files {
         return _sendfile(pointer, outFd, inFd, offset, length, context, loop.getContext());
     }
 
+    /**
+     * Maps length bytes of the file at offset, which need not be page aligned,
+     * as a shared mapping. The returned direct buffer reads and writes the
+     * page cache without copies. It is valid until {@link #munmap(ByteBuffer)},
+     * and only that buffer (not a slice) may be passed to munmap, madvise
+     * and msync, which fail with EINVAL for any other buffer.
+     */
+    public ByteBuffer mmap(final int fd, final long offset, final long length, final int prot) {
+        final OpenedFile file = getOpenedFileAssertNonNull(fd, "mmap");
+        if (offset < 0 || length <= 0 || length > Integer.MAX_VALUE) {
+            throw new IllegalArgumentException("invalid mapping range " + offset + "+" + length);
+        }
+        LibUVPermission.checkReadFile(fd, file.getPath());
+        if ((prot & PROT_WRITE) != 0) {
+            LibUVPermission.checkWriteFile(fd, file.getPath());
+        }
+        return _mmap(pointer, fd, offset, length, prot);
+    }
+
+    public int munmap(final ByteBuffer mapping) {
+        Objects.requireNonNull(mapping);
+        return _munmap(pointer, mapping);
+    }
+
+    public int madvise(final ByteBuffer mapping, final int advice) {
+        Objects.requireNonNull(mapping);
+        return _madvise(pointer, mapping, advice);
+    }
+
+    /**
+     * Writes dirty pages of the mapping back to the file, waiting for
+     * completion when sync is true.
+     */
+    public int msync(final ByteBuffer mapping, final boolean sync) {
+        Objects.requireNonNull(mapping);
+        return _msync(pointer, mapping, sync);
+    }
+
     public int chmod(final String path, final int mode) {
         Objects.requireNonNull(path);
         LibUVPermission.checkWriteFile(path);
@@ -827,6 +1083,34 @@ public class Files {
         }
     }
 
+    private void callVector(final int type, final Object callback, final long bytes, final ByteBuffer[] buffers, final Exception error, final Object context) {
+        switch(type) {
+            case UV_FS_READ:
+                if (onReadv != null) {
+                    loop.getCallbackHandler(context).handleFileVectorCallback(onReadv, callback, bytes, buffers, error);
+                }
+                break;
+            case UV_FS_WRITE:
+                if (onWritev != null) {
+                    loop.getCallbackHandler(context).handleFileVectorCallback(onWritev, callback, bytes, buffers, error);
+                }
+                break;
+            default: assert false : "unsupported callback type " + type;
+        }
+    }
+
+    private void callBatch(final Object callback, final Object batch, final Object context) {
+        if (onBatch != null) {
+            loop.getCallbackHandler(context).handleFileBatchCallback(onBatch, callback, (FileBatch) batch);
+        }
+    }
+
+    private void callStatMany(final Object callback, final int count, final long[] out, final Object context) {
+        if (onStatMany != null) {
+            loop.getCallbackHandler(context).handleFileStatManyCallback(onStatMany, callback, count, out);
+        }
+    }
+
     private static native void _static_initialize();
 
     private static native long _new();
@@ -851,10 +1135,22 @@ public class Files {
 
     private native String[] _readdir(final long ptr, final String path, final int flags, final Object callback, final Object context);
 
+    private native long _opendir(final long ptr, final String path);
+
+    private native int _readdir_next(final long ptr, final long dir, final ByteBuffer names, final int capacity, final int[] offsets, final int[] lengths, final int[] types);
+
+    private native int _closedir(final long ptr, final long dir);
+
     private native Stats _stat(final long ptr, final String path, final Object callback, final Object context);
 
     private native Stats _fstat(final long ptr, final int fd, final Object callback, final Object context);
 
+    private native int _stat_into(final long ptr, final String path, final Stats stats);
+
+    private native int _fstat_into(final long ptr, final int fd, final Stats stats);
+
+    private native int _stat_many(final long ptr, final String[] paths, final long[] out, final Object callback, final Object context);
+
     private native int _rename(final long ptr, final String path, final String newPath, final Object callback, final Object context);
 
     private native int _fsync(final long ptr, final int fd, final Object callback, final Object context);
@@ -885,4 +1181,15 @@ public class Files {
 
     private native int _fchown(final long ptr, final int fd, final int uid, final int gid, final Object callback, final Object context);
 
+    private native long _vector_io(final long ptr, final int type, final int fd, final ByteBuffer[] buffers, final int[] offsets, final int[] lengths, final long position, final Object callback, final Object context);
+
+    private native int _submit(final long ptr, final int count, final int[] types, final int[] fds, final ByteBuffer[] buffers, final int[] offsets, final int[] lengths, final long[] positions, final int[] results, final Exception[] errors, final Object batch, final Object callback, final Object context);
+
+    private native ByteBuffer _mmap(final long ptr, final int fd, final long offset, final long length, final int prot);
+
+    private native int _munmap(final long ptr, final ByteBuffer mapping);
+
+    private native int _madvise(final long ptr, final ByteBuffer mapping, final int advice);
+
+    private native int _msync(final long ptr, final ByteBuffer mapping, final boolean sync);
 }
@@ -28,11 +28,21 @@ package com.oracle.libuv;
 @SuppressWarnings("serial")
 public final class NativeException extends RuntimeException {
 
+    // error names and messages by uv_err_code, filled in on first use
+    private static final int CACHED_CODES = 256;
+    private static final String[] ERRNO_STRINGS = new String[CACHED_CODES];
+    private static final String[] ERRNO_MESSAGES = new String[CACHED_CODES];
+
+    private static volatile boolean lightweight = false;
+
     private final int errno;
-    private final String errnoString;
-    private final String errnoMessage;
+    private String errnoString;
+    private String errnoMessage;
     private final String syscall;
+    private final String detail;
     private final String path;
+    private final boolean lazy;
+    private String message;
 
     public NativeException(final int errno,
                            final String errnoString,
@@ -45,7 +55,10 @@ public final class NativeException extends RuntimeException {
         this.errnoString = errnoString;
         this.errnoMessage = errnoMessage;
         this.syscall = syscall;
+        this.detail = null;
         this.path = path;
+        this.lazy = false;
+        this.message = message;
     }
 
     public NativeException(final String message) {
@@ -54,7 +67,47 @@ public final class NativeException extends RuntimeException {
         this.errnoString = null;
         this.errnoMessage = null;
         this.syscall = null;
+        this.detail = null;
         this.path = null;
+        this.lazy = false;
+        this.message = message;
+    }
+
+    // called from native, everything derived from errno is formatted on demand
+    private NativeException(final int errno,
+                            final String syscall,
+                            final String detail,
+                            final String path) {
+        super(null, null, !lightweight, !lightweight);
+        this.errno = errno;
+        this.syscall = syscall;
+        this.detail = detail;
+        this.path = path;
+        this.lazy = true;
+    }
+
+    /**
+     * In lightweight mode exceptions raised by native code carry no stack
+     * trace and ignore suppressed exceptions, and code only errors (such as
+     * those passed to stream callbacks) share one pre-built instance per
+     * code. Safe to toggle while loops run, the shared instances are built
+     * on the first enable and kept from then on.
+     */
+    public static synchronized void setLightweight(final boolean enabled) {
+        lightweight = enabled;
+        _set_lightweight(enabled);
+    }
+
+    /**
+     * The exception native code raises for a libuv error code, for errors
+     * detected on the java side.
+     */
+    public static NativeException of(final int errno, final String syscall) {
+        return new NativeException(errno, syscall, null, null);
+    }
+
+    public static boolean isLightweight() {
+        return lightweight;
     }
 
     public int errno() {
@@ -62,10 +115,16 @@ public final class NativeException extends RuntimeException {
     }
 
     public String errnoString() {
+        if (errnoString == null && lazy) {
+            errnoString = errnoString(errno);
+        }
         return errnoString;
     }
 
     public String getErrnoMessage() {
+        if (errnoMessage == null && lazy) {
+            errnoMessage = errnoMessage(errno);
+        }
         return errnoMessage;
     }
 
@@ -77,15 +136,32 @@ public final class NativeException extends RuntimeException {
         return path;
     }
 
+    @Override
+    public String getMessage() {
+        if (message == null && lazy) {
+            final StringBuilder sb = new StringBuilder(64);
+            sb.append(errnoString());
+            sb.append(", ");
+            sb.append(detail != null ? detail : getErrnoMessage());
+            if (path != null) {
+                sb.append(" '");
+                sb.append(path);
+                sb.append('\'');
+            }
+            message = sb.toString();
+        }
+        return message;
+    }
+
     @Override
     public String toString() {
         final StringBuilder sb = new StringBuilder(4096);
         sb.append("errno: ");
         sb.append(errno);
         sb.append(", errnoString: ");
-        sb.append(errnoString);
+        sb.append(errnoString());
         sb.append(", errnoMessage: ");
-        sb.append(errnoMessage);
+        sb.append(getErrnoMessage());
         if (syscall != null && syscall.length() > 0) {
             sb.append(", syscall: ");
             sb.append(syscall);
@@ -95,13 +171,41 @@ public final class NativeException extends RuntimeException {
             sb.append(path);
         }
         sb.append(", message: ");
-        sb.append(super.getMessage());
+        sb.append(getMessage());
         return sb.toString();
     }
 
+    private static String errnoString(final int errno) {
+        if (errno < 0 || errno >= CACHED_CODES) {
+            return _err_name(errno);
+        }
+        String s = ERRNO_STRINGS[errno];
+        if (s == null) {
+            s = ERRNO_STRINGS[errno] = _err_name(errno);
+        }
+        return s;
+    }
+
+    private static String errnoMessage(final int errno) {
+        if (errno < 0 || errno >= CACHED_CODES) {
+            return _strerror(errno);
+        }
+        String s = ERRNO_MESSAGES[errno];
+        if (s == null) {
+            s = ERRNO_MESSAGES[errno] = _strerror(errno);
+        }
+        return s;
+    }
+
     public static void static_initialize() {
         _static_initialize();
     }
 
     private static native void _static_initialize();
+
+    private static native void _set_lightweight(final boolean enabled);
+
+    private static native String _err_name(final int errno);
+
+    private static native String _strerror(final int errno);
 }
@@ -27,6 +27,9 @@ package com.oracle.libuv;
 
 public class Stats {
 
+    // number of values per entry in the flat arrays filled by Files.statMany
+    public static final int FIELDS = 13;
+
     private int dev;
     private int ino;
     private int mode;
@@ -72,6 +75,18 @@ public class Stats {
         this.ctime = ctime;
     }
 
+    /**
+     * Reads FIELDS values starting at offset, in the order of the other set.
+     */
+    public Stats set(final long[] values, final int offset) {
+        set((int) values[offset], (int) values[offset + 1], (int) values[offset + 2],
+                (int) values[offset + 3], (int) values[offset + 4], (int) values[offset + 5],
+                (int) values[offset + 6], values[offset + 7], (int) values[offset + 8],
+                values[offset + 9], values[offset + 10], values[offset + 11],
+                values[offset + 12]);
+        return this;
+    }
+
     public int getDev() {
         return dev;
     }
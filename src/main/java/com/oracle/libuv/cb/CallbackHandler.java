@@ -28,10 +28,12 @@ package com.oracle.libuv.cb;
 import java.nio.ByteBuffer;
 
 import com.oracle.libuv.Address;
+import com.oracle.libuv.FileBatch;
 import com.oracle.libuv.Stats;
 
 public interface CallbackHandler {
     public void handleAsyncCallback(AsyncCallback cb, int status);
+    public void handleAsyncQueueCallback(AsyncQueueCallback cb, int count, long[] values, int[] offsets, int[] lengths, ByteBuffer payload);
     public void handleCheckCallback(CheckCallback cb, int status);
     public void handleIdleCallback(IdleCallback cb, int status);
     public void handlePollCallback(PollCallback cb, int status, int events);
@@ -39,10 +41,13 @@ public interface CallbackHandler {
     public void handleStreamReadCallback(StreamReadCallback cb, ByteBuffer data);
     public void handleStreamRead2Callback(StreamRead2Callback cb, ByteBuffer data, long handle, int type);
     public void handleStreamWriteCallback(StreamWriteCallback cb, int status, Exception error);
+    public void handleStreamDrainCallback(StreamDrainCallback cb);
+    public void handleStreamSendFileCallback(StreamSendFileCallback cb, long bytesSent, Exception error);
     public void handleFileCallback(FileCallback cb, Object context, Exception error);
     public void handleFileCloseCallback(FileCloseCallback cb, Object context, int fd, Exception error);
     public void handleFileOpenCallback(FileOpenCallback cb, Object context, int fd, Exception error);
     public void handleStreamConnectCallback(StreamConnectCallback cb, int status, Exception error);
+    public void handleStreamConnectionBatchCallback(StreamConnectionBatchCallback cb, int count, long[] clients);
     public void handleStreamConnectionCallback(StreamConnectionCallback cb, int status, Exception error);
     public void handleStreamCloseCallback(StreamCloseCallback cb);
     public void handleStreamShutdownCallback(StreamShutdownCallback cb, int status, Exception error);
@@ -52,13 +57,23 @@ public interface CallbackHandler {
     public void handleFileStatsCallback(FileStatsCallback cb, Object context, Stats stats, Exception error);
     public void handleFileUTimeCallback(FileUTimeCallback cb, Object context, long time, Exception error);
     public void handleFileWriteCallback(FileWriteCallback cb, Object context, int bytesWritten, Exception error);
+    public void handleFileVectorCallback(FileVectorCallback cb, Object context, long bytes, ByteBuffer[] buffers, Exception error);
+    public void handleFileBatchCallback(FileBatchCallback cb, Object context, FileBatch batch);
+    public void handleFileStatManyCallback(FileStatManyCallback cb, Object context, int count, long[] values);
     public void handleFileEventCallback(FileEventCallback cb, int status, String event, String filename);
+    public void handleFileEventBatchCallback(FileEventBatchCallback cb, int count, String[] filenames, int[] events);
     public void handleFilePollCallback(FilePollCallback cb, int status, Stats previous, Stats current);
     public void handleFilePollStopCallback(FilePollStopCallback cb);
+    public void handleFilePollGroupCallback(FilePollGroupCallback cb, int count, String[] paths, int[] statuses);
     public void handleProcessCloseCallback(ProcessCloseCallback cb);
     public void handleProcessExitCallback(ProcessExitCallback cb, int status, int signal, Exception error);
     public void handleTimerCallback(TimerCallback cb, int status);
+    public void handleTimerWheelCallback(TimerWheelCallback cb, int count, long[] tokens);
+    public void handleResolveCallback(ResolveCallback cb, String[] addresses, Exception error);
+    public void handleSharedMemoryRingCallback(SharedMemoryRingCallback cb, ByteBuffer message);
     public void handleUDPRecvCallback(UDPRecvCallback cb, int nread, ByteBuffer data, Address address);
+    public void handleUDPRecvBatchCallback(UDPRecvBatchCallback cb, int count, ByteBuffer ring, int[] offsets, int[] lengths, Address[] addresses);
+    public void handleUDPRecvRingCallback(UDPRecvRingCallback cb, int nread, ByteBuffer ring, int offset, Address address);
     public void handleUDPSendCallback(UDPSendCallback cb, int status, Exception error);
     public void handleUDPCloseCallback(UDPCloseCallback cb);
 }
@@ -25,15 +25,26 @@
 
 package com.oracle.libuv.handles;
 
+import java.nio.ByteBuffer;
+import java.util.Objects;
 import java.util.concurrent.atomic.AtomicBoolean;
 
 import com.oracle.libuv.cb.AsyncCallback;
+import com.oracle.libuv.cb.AsyncQueueCallback;
 
 public class AsyncHandle extends Handle {
 
     private final AtomicBoolean closed = new AtomicBoolean(false);
 
     private AsyncCallback onSend = null;
+    private AsyncQueueCallback onDrain = null;
+
+    private volatile boolean queueEnabled = false;
+    private int queueSlotSize;
+    private long[] queueValues;
+    private int[] queueOffsets;
+    private int[] queueLengths;
+    private ByteBuffer queuePayload;
 
     static {
         _static_initialize();
@@ -43,6 +54,10 @@ public class AsyncHandle extends Handle {
         onSend = callback;
     }
 
+    public void setQueueCallback(final AsyncQueueCallback callback) {
+        onDrain = callback;
+    }
+
     protected AsyncHandle(final LoopHandle loop) {
         super(_new(loop.pointer()), loop);
         _initialize(pointer);
@@ -52,6 +67,65 @@ public class AsyncHandle extends Handle {
         return closed.get() ? -1 : _send(pointer);
     }
 
+    /**
+     * Attaches a lock free queue of {@code capacity} (rounded up to a power
+     * of two) entries, each a long plus up to {@code slotSize} bytes copied
+     * from a direct buffer. Any thread may then {@link #offer(long)}, the
+     * loop is woken once per batch and drains the whole batch with a single
+     * {@link AsyncQueueCallback} call instead of {@link AsyncCallback}.
+     * Must be called on the loop thread before any producer offers.
+     */
+    public void enableQueue(final int capacity, final int slotSize) {
+        if (capacity <= 0 || capacity > 1 << 30) {
+            throw new IllegalArgumentException("capacity must be between 1 and 2^30");
+        }
+        if (slotSize < 0) {
+            throw new IllegalArgumentException("slotSize must not be negative");
+        }
+        if (queueEnabled) {
+            throw new IllegalStateException("queue already enabled");
+        }
+        final int size = capacity == 1 ? 1 : Integer.highestOneBit(capacity - 1) << 1;
+        // the payload is handed out as a single ByteBuffer, offsets are ints
+        if ((long) size * slotSize > Integer.MAX_VALUE) {
+            throw new IllegalArgumentException("capacity " + size + " times slotSize " + slotSize + " exceeds 2^31 - 1 bytes");
+        }
+        queueSlotSize = slotSize;
+        queueValues = new long[size];
+        queueOffsets = new int[slotSize == 0 ? 0 : size];
+        queueLengths = new int[slotSize == 0 ? 0 : size];
+        queuePayload = _enable_queue(pointer, size, slotSize, queueValues, queueOffsets, queueLengths);
+        queueEnabled = true;
+    }
+
+    /**
+     * Queues {@code value} from any thread.
+     *
+     * @return false if the queue is full or the handle closed
+     */
+    public boolean offer(final long value) {
+        checkQueue();
+        return !closed.get() && _offer(pointer, value);
+    }
+
+    /**
+     * Queues {@code value} with a copy of the remaining bytes of the direct
+     * buffer {@code slice}, whose position is left unchanged.
+     *
+     * @return false if the queue is full or the handle closed
+     */
+    public boolean offer(final long value, final ByteBuffer slice) {
+        Objects.requireNonNull(slice);
+        checkQueue();
+        if (!slice.isDirect()) {
+            throw new IllegalArgumentException("slice must be a direct buffer");
+        }
+        if (slice.remaining() > queueSlotSize) {
+            throw new IllegalArgumentException("slice larger than the slot size " + queueSlotSize);
+        }
+        return !closed.get() && _offer_buffer(pointer, value, slice, slice.position(), slice.remaining());
+    }
+
     public void close() {
         if (closed.compareAndSet(false, true)) {
             _close(pointer);
@@ -68,6 +142,18 @@ public class AsyncHandle extends Handle {
         if (onSend != null) {loop.getCallbackHandler().handleAsyncCallback(onSend, status);}
     }
 
+    private void callDrain(final int count) {
+        if (onDrain != null) {
+            loop.getCallbackHandler().handleAsyncQueueCallback(onDrain, count, queueValues, queueOffsets, queueLengths, queuePayload);
+        }
+    }
+
+    private void checkQueue() {
+        if (!queueEnabled) {
+            throw new IllegalStateException("queue not enabled");
+        }
+    }
+
     private static native long _new(final long loop);
 
     private static native void _static_initialize();
@@ -78,4 +164,11 @@ public class AsyncHandle extends Handle {
 
     private native void _close(final long ptr);
 
+    private native ByteBuffer _enable_queue(final long ptr, final int capacity, final int slotSize,
+                                            final long[] values, final int[] offsets, final int[] lengths);
+
+    private native boolean _offer(final long ptr, final long value);
+
+    private native boolean _offer_buffer(final long ptr, final long value, final ByteBuffer slice, final int offset, final int length);
+
 }
@@ -126,6 +126,12 @@ public class DefaultHandleFactory implements HandleFactory {
         return new TimerHandle(loop);
     }
 
+    @Override
+    public TimerWheel newTimerWheel(final long resolution) {
+        assert loop != null;
+        return new TimerWheel(loop, resolution);
+    }
+
     @Override
     public TTYHandle newTTYHandle(final int fd,
                                   final boolean readable) {
@@ -163,6 +169,12 @@ public class DefaultHandleFactory implements HandleFactory {
         return new FilePollHandle(loop);
     }
 
+    @Override
+    public FilePollGroup newFilePollGroup(final int interval, final int batchSize) {
+        assert loop != null;
+        return new FilePollGroup(loop, interval, batchSize);
+    }
+
     @Override
     public Files newFiles() {
         assert loop != null;
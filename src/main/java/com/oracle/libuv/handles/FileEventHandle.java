@@ -25,12 +25,18 @@
 
 package com.oracle.libuv.handles;
 
+import java.util.Arrays;
 import java.util.Objects;
 
+import com.oracle.libuv.cb.FileEventBatchCallback;
 import com.oracle.libuv.cb.FileEventCallback;
 
 public class FileEventHandle extends Handle {
 
+    // event bits reported to a FileEventBatchCallback
+    public static final int RENAME = 1;
+    public static final int CHANGE = 2;
+
     // must be equal to values in uv.h
     private enum EventType {
         UKNOWN(0, ""),
@@ -49,6 +55,10 @@ public class FileEventHandle extends Handle {
 
     private FileEventCallback onEvent = null;
     private FileEventCallback onClose = null;
+    private FileEventBatchCallback onBatch = null;
+
+    private String[] batchNames;
+    private int[] batchEvents;
 
     static {
         _static_initialize();
@@ -62,6 +72,10 @@ public class FileEventHandle extends Handle {
         onClose = callback;
     }
 
+    public void setFileEventBatchCallback(final FileEventBatchCallback callback) {
+        onBatch = callback;
+    }
+
     protected FileEventHandle(final LoopHandle loop) {
         super(_new(), loop);
         _initialize(pointer);
@@ -72,6 +86,28 @@ public class FileEventHandle extends Handle {
         return _start(loop.pointer(), pointer, path, persistent);
     }
 
+    /**
+     * Merges events natively for windowMillis, or until maxFiles distinct
+     * filenames are pending, and delivers them to the batch callback with
+     * the events of each filename or'ed together. A window of 0 delivers
+     * every event to the file event callback again. Events pending when this
+     * is called, or when the handle is closed, are delivered later from the
+     * loop and never from within the call.
+     */
+    public void setCoalescing(final long windowMillis, final int maxFiles) {
+        if (windowMillis < 0) {
+            throw new IllegalArgumentException("windowMillis must not be negative");
+        }
+        if (windowMillis > 0 && maxFiles <= 0) {
+            throw new IllegalArgumentException("maxFiles must be positive");
+        }
+        if (windowMillis > 0 && (batchNames == null || batchNames.length < maxFiles)) {
+            batchNames = new String[maxFiles];
+            batchEvents = new int[maxFiles];
+        }
+        _set_coalescing(loop.pointer(), pointer, windowMillis, maxFiles, batchNames, batchEvents);
+    }
+
     public void stop() {
         _close(pointer);
         closed = true;
@@ -107,6 +143,13 @@ public class FileEventHandle extends Handle {
         }
     }
 
+    private void callBatch(final int count) {
+        if (onBatch != null) {
+            loop.getCallbackHandler().handleFileEventBatchCallback(onBatch, count, batchNames, batchEvents);
+        }
+        Arrays.fill(batchNames, 0, count, null);
+    }
+
     private static native long _new();
 
     private static native void _static_initialize();
@@ -117,4 +160,6 @@ public class FileEventHandle extends Handle {
 
     private native void _close(final long ptr);
 
+    private native void _set_coalescing(final long loopPtr, final long ptr, final long windowMillis, final int maxFiles, final String[] names, final int[] events);
+
 }
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+package com.oracle.libuv.handles;
+
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.HashMap;
+import java.util.Map;
+import java.util.Objects;
+
+import com.oracle.libuv.cb.FilePollGroupCallback;
+
+/**
+ * Polls many paths on one schedule, a cheaper alternative to one
+ * FilePollHandle per path. Every {@code interval} milliseconds the paths
+ * are stated on the thread pool in jobs of {@code batchSize} paths, and
+ * the paths whose stats changed since the previous round are delivered
+ * together to the group's {@link FilePollGroupCallback}.
+ */
+public final class FilePollGroup extends Handle {
+
+    // changes per upcall, a larger round takes several calls
+    private static final int BATCH_SIZE = 1024;
+
+    private final int interval;
+    private final int[] batchIds = new int[BATCH_SIZE];
+    private final int[] batchStatuses = new int[BATCH_SIZE];
+    private final String[] batchPaths = new String[BATCH_SIZE];
+    private final ArrayList<String> paths = new ArrayList<>();
+    private final Map<String, Integer> ids = new HashMap<>();
+    private boolean started;
+    private boolean closed;
+
+    private FilePollGroupCallback onChanges = null;
+
+    static {
+        _static_initialize();
+    }
+
+    protected FilePollGroup(final LoopHandle loop, final int interval, final int batchSize) {
+        super(_new(loop.pointer(), checkPositive(interval, "interval"), checkPositive(batchSize, "batchSize")), loop);
+        this.interval = interval;
+        _initialize(pointer, batchIds, batchStatuses);
+    }
+
+    public void setChangesCallback(final FilePollGroupCallback callback) {
+        onChanges = callback;
+    }
+
+    public int getInterval() {
+        return interval;
+    }
+
+    /**
+     * Starts watching {@code path}, the first round after this only takes
+     * its snapshot. Adding a watched path again returns its id.
+     *
+     * @return the id to remove the path with
+     */
+    public int add(final String path) {
+        Objects.requireNonNull(path);
+        if (closed) {
+            throw new IllegalStateException("file poll group closed");
+        }
+        final Integer existing = ids.get(path);
+        if (existing != null) {
+            return existing;
+        }
+        final int id = _add(pointer, path);
+        while (paths.size() <= id) {
+            paths.add(null);
+        }
+        paths.set(id, path);
+        ids.put(path, id);
+        return id;
+    }
+
+    /**
+     * @return false if the id is not watched
+     */
+    public boolean remove(final int id) {
+        if (closed || !_remove(pointer, id)) {
+            return false;
+        }
+        ids.remove(paths.set(id, null));
+        return true;
+    }
+
+    public boolean remove(final String path) {
+        final Integer id = ids.get(path);
+        return id != null && remove(id);
+    }
+
+    public String getPath(final int id) {
+        return id >= 0 && id < paths.size() ? paths.get(id) : null;
+    }
+
+    /**
+     * The number of watched paths.
+     */
+    public int size() {
+        return closed ? 0 : _size(pointer);
+    }
+
+    public void start() {
+        if (closed) {
+            throw new IllegalStateException("file poll group closed");
+        }
+        if (!started) {
+            started = true;
+            _start(pointer);
+        }
+    }
+
+    /**
+     * Stops polling, changes of a round still being stated are dropped.
+     * The snapshots are kept, so a later start reports what changed since.
+     */
+    public void stop() {
+        if (started && !closed) {
+            started = false;
+            _stop(pointer);
+        }
+    }
+
+    @Override
+    public void close() {
+        if (!closed) {
+            _close(pointer);
+        }
+        closed = true;
+    }
+
+    @Override
+    protected void finalize() throws Throwable {
+        close();
+        super.finalize();
+    }
+
+    private void callChanges(final int count) {
+        if (onChanges != null) {
+            for (int i = 0; i < count; i++) {
+                batchPaths[i] = paths.get(batchIds[i]);
+            }
+            loop.getCallbackHandler().handleFilePollGroupCallback(onChanges, count, batchPaths, batchStatuses);
+            Arrays.fill(batchPaths, 0, count, null);
+        }
+    }
+
+    private static int checkPositive(final int value, final String name) {
+        if (value <= 0) {
+            throw new IllegalArgumentException(name + " must be positive");
+        }
+        return value;
+    }
+
+    private static native long _new(final long loop, final long interval, final int batchSize);
+
+    private static native void _static_initialize();
+
+    private native void _initialize(final long ptr, final int[] ids, final int[] statuses);
+
+    private native int _add(final long ptr, final String path);
+
+    private native boolean _remove(final long ptr, final int id);
+
+    private native void _start(final long ptr);
+
+    private native void _stop(final long ptr);
+
+    private native int _size(final long ptr);
+
+    private native void _close(final long ptr);
+
+}
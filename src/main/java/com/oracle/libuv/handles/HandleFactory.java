@@ -60,6 +60,8 @@ public interface HandleFactory {
 
     TimerHandle newTimerHandle();
 
+    TimerWheel newTimerWheel(long resolution);
+
     TTYHandle newTTYHandle(int fd, boolean readable);
 
     UDPHandle newUDPHandle();
@@ -72,5 +74,7 @@ public interface HandleFactory {
 
     FilePollHandle newFilePollHandle();
 
+    FilePollGroup newFilePollGroup(int interval, int batchSize);
+
     Files newFiles();
 }
@@ -28,38 +28,53 @@ package com.oracle.libuv.handles;
 import java.nio.ByteBuffer;
 
 import com.oracle.libuv.Address;
+import com.oracle.libuv.FileBatch;
 import com.oracle.libuv.Stats;
 import com.oracle.libuv.cb.AsyncCallback;
+import com.oracle.libuv.cb.AsyncQueueCallback;
 import com.oracle.libuv.cb.CallbackExceptionHandler;
 import com.oracle.libuv.cb.CallbackHandler;
 import com.oracle.libuv.cb.CheckCallback;
+import com.oracle.libuv.cb.FileBatchCallback;
 import com.oracle.libuv.cb.FileCallback;
 import com.oracle.libuv.cb.FileCloseCallback;
+import com.oracle.libuv.cb.FileEventBatchCallback;
 import com.oracle.libuv.cb.FileEventCallback;
 import com.oracle.libuv.cb.FileOpenCallback;
 import com.oracle.libuv.cb.FilePollCallback;
+import com.oracle.libuv.cb.FilePollGroupCallback;
 import com.oracle.libuv.cb.FilePollStopCallback;
 import com.oracle.libuv.cb.FileReadCallback;
 import com.oracle.libuv.cb.FileReadDirCallback;
 import com.oracle.libuv.cb.FileReadLinkCallback;
+import com.oracle.libuv.cb.FileStatManyCallback;
 import com.oracle.libuv.cb.FileStatsCallback;
 import com.oracle.libuv.cb.FileUTimeCallback;
+import com.oracle.libuv.cb.FileVectorCallback;
 import com.oracle.libuv.cb.FileWriteCallback;
 import com.oracle.libuv.cb.IdleCallback;
 import com.oracle.libuv.cb.PollCallback;
 import com.oracle.libuv.cb.ProcessCloseCallback;
 import com.oracle.libuv.cb.ProcessExitCallback;
+import com.oracle.libuv.cb.ResolveCallback;
+import com.oracle.libuv.cb.SharedMemoryRingCallback;
 import com.oracle.libuv.cb.SignalCallback;
 import com.oracle.libuv.cb.StreamCloseCallback;
 import com.oracle.libuv.cb.StreamConnectCallback;
+import com.oracle.libuv.cb.StreamConnectionBatchCallback;
 import com.oracle.libuv.cb.StreamConnectionCallback;
+import com.oracle.libuv.cb.StreamDrainCallback;
 import com.oracle.libuv.cb.StreamRead2Callback;
 import com.oracle.libuv.cb.StreamReadCallback;
+import com.oracle.libuv.cb.StreamSendFileCallback;
 import com.oracle.libuv.cb.StreamShutdownCallback;
 import com.oracle.libuv.cb.StreamWriteCallback;
 import com.oracle.libuv.cb.TimerCallback;
+import com.oracle.libuv.cb.TimerWheelCallback;
 import com.oracle.libuv.cb.UDPCloseCallback;
+import com.oracle.libuv.cb.UDPRecvBatchCallback;
 import com.oracle.libuv.cb.UDPRecvCallback;
+import com.oracle.libuv.cb.UDPRecvRingCallback;
 import com.oracle.libuv.cb.UDPSendCallback;
 
 public final class LoopCallbackHandler implements CallbackHandler {
@@ -70,6 +85,11 @@ public final class LoopCallbackHandler implements CallbackHandler {
         this.exceptionHandler = exceptionHandler;
     }
 
+    // used by handles that dispatch their hot callbacks without a handler
+    CallbackExceptionHandler exceptionHandler() {
+        return exceptionHandler;
+    }
+
     @Override
     public void handleAsyncCallback(final AsyncCallback cb, final int status) {
         try {
@@ -79,6 +99,16 @@ public final class LoopCallbackHandler implements CallbackHandler {
         }
     }
 
+    @Override
+    public void handleAsyncQueueCallback(final AsyncQueueCallback cb, final int count, final long[] values,
+                                         final int[] offsets, final int[] lengths, final ByteBuffer payload) {
+        try {
+            cb.onDrain(count, values, offsets, lengths, payload);
+        } catch (final Exception ex) {
+            exceptionHandler.handle(ex);
+        }
+    }
+
     @Override
     public void handleCheckCallback(final CheckCallback cb, final int status) {
         try {
@@ -133,6 +163,24 @@ public final class LoopCallbackHandler implements CallbackHandler {
         }
     }
 
+    @Override
+    public void handleStreamDrainCallback(final StreamDrainCallback cb) {
+        try {
+            cb.onDrain();
+        } catch (final Exception ex) {
+            exceptionHandler.handle(ex);
+        }
+    }
+
+    @Override
+    public void handleStreamSendFileCallback(final StreamSendFileCallback cb, final long bytesSent, final Exception error) {
+        try {
+            cb.onSendFile(bytesSent, error);
+        } catch (final Exception ex) {
+            exceptionHandler.handle(ex);
+        }
+    }
+
     @Override
     public void handleStreamConnectCallback(final StreamConnectCallback cb, final int status, final Exception error) {
         try {
@@ -142,6 +190,15 @@ public final class LoopCallbackHandler implements CallbackHandler {
         }
     }
 
+    @Override
+    public void handleStreamConnectionBatchCallback(final StreamConnectionBatchCallback cb, final int count, final long[] clients) {
+        try {
+            cb.onConnections(count, clients);
+        } catch (final Exception ex) {
+            exceptionHandler.handle(ex);
+        }
+    }
+
     @Override
     public void handleStreamConnectionCallback(final StreamConnectionCallback cb, final int status, final Exception error) {
         try {
@@ -250,6 +307,33 @@ public final class LoopCallbackHandler implements CallbackHandler {
         }
     }
 
+    @Override
+    public void handleFileVectorCallback(final FileVectorCallback cb, final Object context, final long bytes, final ByteBuffer[] buffers, final Exception error) {
+        try {
+            cb.onComplete(context, bytes, buffers, error);
+        } catch (final Exception ex) {
+            exceptionHandler.handle(ex);
+        }
+    }
+
+    @Override
+    public void handleFileBatchCallback(final FileBatchCallback cb, final Object context, final FileBatch batch) {
+        try {
+            cb.onComplete(context, batch);
+        } catch (final Exception ex) {
+            exceptionHandler.handle(ex);
+        }
+    }
+
+    @Override
+    public void handleFileStatManyCallback(final FileStatManyCallback cb, final Object context, final int count, final long[] values) {
+        try {
+            cb.onStats(context, count, values);
+        } catch (final Exception ex) {
+            exceptionHandler.handle(ex);
+        }
+    }
+
     @Override
     public void handleFileEventCallback(final FileEventCallback cb, final int status, final String event, final String filename) {
         try {
@@ -259,6 +343,15 @@ public final class LoopCallbackHandler implements CallbackHandler {
         }
     }
 
+    @Override
+    public void handleFileEventBatchCallback(final FileEventBatchCallback cb, final int count, final String[] filenames, final int[] events) {
+        try {
+            cb.onEvents(count, filenames, events);
+        } catch (final Exception ex) {
+            exceptionHandler.handle(ex);
+        }
+    }
+
     @Override
     public void handleFilePollCallback(FilePollCallback cb, int status, Stats previous, Stats current) {
         try {
@@ -268,6 +361,15 @@ public final class LoopCallbackHandler implements CallbackHandler {
         }
     }
 
+    @Override
+    public void handleFilePollGroupCallback(final FilePollGroupCallback cb, final int count, final String[] paths, final int[] statuses) {
+        try {
+            cb.onChanges(count, paths, statuses);
+        } catch (final Exception ex) {
+            exceptionHandler.handle(ex);
+        }
+    }
+
     @Override
     public void handleFilePollStopCallback(FilePollStopCallback cb) {
         try {
@@ -304,6 +406,33 @@ public final class LoopCallbackHandler implements CallbackHandler {
         }
     }
 
+    @Override
+    public void handleTimerWheelCallback(final TimerWheelCallback cb, final int count, final long[] tokens) {
+        try {
+            cb.onExpired(count, tokens);
+        } catch (final Exception ex) {
+            exceptionHandler.handle(ex);
+        }
+    }
+
+    @Override
+    public void handleResolveCallback(final ResolveCallback cb, final String[] addresses, final Exception error) {
+        try {
+            cb.onResolve(addresses, error);
+        } catch (final Exception ex) {
+            exceptionHandler.handle(ex);
+        }
+    }
+
+    @Override
+    public void handleSharedMemoryRingCallback(final SharedMemoryRingCallback cb, final ByteBuffer message) {
+        try {
+            cb.onMessage(message);
+        } catch (final Exception ex) {
+            exceptionHandler.handle(ex);
+        }
+    }
+
     @Override
     public void handleUDPRecvCallback(final UDPRecvCallback cb, final int nread, final ByteBuffer data, final Address address) {
         try {
@@ -313,6 +442,25 @@ public final class LoopCallbackHandler implements CallbackHandler {
         }
     }
 
+    @Override
+    public void handleUDPRecvBatchCallback(final UDPRecvBatchCallback cb, final int count, final ByteBuffer ring,
+                                           final int[] offsets, final int[] lengths, final Address[] addresses) {
+        try {
+            cb.onRecv(count, ring, offsets, lengths, addresses);
+        } catch (final Exception ex) {
+            exceptionHandler.handle(ex);
+        }
+    }
+
+    @Override
+    public void handleUDPRecvRingCallback(final UDPRecvRingCallback cb, final int nread, final ByteBuffer ring, final int offset, final Address address) {
+        try {
+            cb.onRecv(nread, ring, offset, address);
+        } catch (final Exception ex) {
+            exceptionHandler.handle(ex);
+        }
+    }
+
     @Override
     public void handleUDPSendCallback(final UDPSendCallback cb, final int status, final Exception error) {
         try {
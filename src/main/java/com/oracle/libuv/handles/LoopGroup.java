@@ -0,0 +1,352 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+package com.oracle.libuv.handles;
+
+import java.io.Closeable;
+import java.util.Objects;
+import java.util.concurrent.ConcurrentLinkedQueue;
+import java.util.concurrent.CountDownLatch;
+import java.util.concurrent.atomic.AtomicBoolean;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.atomic.AtomicReference;
+
+import com.oracle.libuv.cb.AsyncCallback;
+import com.oracle.libuv.cb.CallbackExceptionHandler;
+import com.oracle.libuv.cb.StreamConnectionCallback;
+
+/**
+ * A fixed number of loops, each run by its own thread. Handles belong to
+ * the loop that created them and must only be used from its thread, so
+ * work is handed to a loop with {@link #execute(int, Runnable)} and
+ * created there through {@link #factory(int)}.
+ */
+public final class LoopGroup implements Closeable {
+
+    /**
+     * Called on the loop thread owning {@code server} for each connection
+     * it receives, {@code factory} creates the client handle to accept into.
+     */
+    public interface ConnectionHandler {
+
+        public void onConnection(HandleFactory factory, TCPHandle server, int status, Exception error) throws Exception;
+
+    }
+
+    private final Worker[] workers;
+    private final CallbackExceptionHandler exceptionHandler;
+    private final AtomicInteger next = new AtomicInteger(0);
+    private final AtomicReference<Throwable> pendingException = new AtomicReference<>();
+    private volatile boolean closed = false;
+
+    /**
+     * Exceptions thrown by callbacks and tasks are kept for
+     * {@link #takePendingException()}.
+     */
+    public LoopGroup(final int size) {
+        this(size, null);
+    }
+
+    public LoopGroup(final int size, final CallbackExceptionHandler exceptionHandler) {
+        if (size <= 0) {
+            throw new IllegalArgumentException("size must be positive");
+        }
+        this.exceptionHandler = exceptionHandler != null ? exceptionHandler : new CallbackExceptionHandler() {
+            @Override
+            public void handle(final Throwable ex) {
+                // takePendingException may clear the first one at any time
+                for (;;) {
+                    final Throwable first = pendingException.get();
+                    if (first != null) {
+                        first.addSuppressed(ex);
+                        return;
+                    }
+                    if (pendingException.compareAndSet(null, ex)) {
+                        return;
+                    }
+                }
+            }
+        };
+        workers = new Worker[size];
+        for (int i = 0; i < size; i++) {
+            workers[i] = new Worker(i);
+        }
+        for (final Worker worker : workers) {
+            worker.thread.start();
+        }
+    }
+
+    public int size() {
+        return workers.length;
+    }
+
+    /**
+     * The factory of loop {@code index}, only to be used on its thread.
+     */
+    public HandleFactory factory(final int index) {
+        return worker(index).factory;
+    }
+
+    /**
+     * The index of the loop run by the calling thread, -1 for other threads.
+     */
+    public int current() {
+        final Thread thread = Thread.currentThread();
+        for (final Worker worker : workers) {
+            if (worker.thread == thread) {
+                return worker.index;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * Runs {@code task} on the thread of loop {@code index}. Tasks posted
+     * before the loop wakes up are run together by a single async wakeup.
+     *
+     * @throws IllegalStateException once {@link #close()} has begun
+     */
+    public void execute(final int index, final Runnable task) {
+        Objects.requireNonNull(task);
+        worker(index).post(task);
+    }
+
+    /**
+     * Runs {@code task} on the next loop in round robin order.
+     *
+     * @return the index of the loop the task was given to
+     */
+    public int execute(final Runnable task) {
+        final int index = (next.getAndIncrement() & Integer.MAX_VALUE) % workers.length;
+        execute(index, task);
+        return index;
+    }
+
+    /**
+     * Starts a listener on every loop, bound to the same port with
+     * SO_REUSEPORT so that the kernel spreads connections across the loops.
+     * Returns once all listeners are bound, the first failure is rethrown.
+     * Called from a loop thread of the group, that loop binds inline while
+     * the thread waits for the others.
+     */
+    public TCPHandle[] listen(final String address, final int port, final int backlog,
+                              final ConnectionHandler handler) throws InterruptedException {
+        Objects.requireNonNull(address);
+        Objects.requireNonNull(handler);
+        final TCPHandle[] servers = new TCPHandle[workers.length];
+        final CountDownLatch latch = new CountDownLatch(workers.length);
+        final AtomicReference<RuntimeException> failure = new AtomicReference<>();
+        final int self = current();
+        for (final Worker worker : workers) {
+            final Runnable bind = new Runnable() {
+                @Override
+                public void run() {
+                    final HandleFactory factory = worker.factory;
+                    final TCPHandle server = factory.newTCPHandle();
+                    try {
+                        server.bindShared(address, port);
+                        server.setConnectionCallback(new StreamConnectionCallback() {
+                            @Override
+                            public void onConnection(final int status, final Exception error) throws Exception {
+                                handler.onConnection(factory, server, status, error);
+                            }
+                        });
+                        server.listen(backlog);
+                        servers[worker.index] = server;
+                    } catch (final RuntimeException ex) {
+                        server.close();
+                        failure.compareAndSet(null, ex);
+                    } finally {
+                        latch.countDown();
+                    }
+                }
+            };
+            if (worker.index == self) {
+                // a task posted to this thread would only run after the wait
+                bind.run();
+            } else {
+                execute(worker.index, bind);
+            }
+        }
+        latch.await();
+        if (failure.get() != null) {
+            for (final Worker worker : workers) {
+                final TCPHandle server = servers[worker.index];
+                if (server != null) {
+                    try {
+                        execute(worker.index, new Runnable() {
+                            @Override
+                            public void run() {
+                                server.close();
+                            }
+                        });
+                    } catch (final IllegalStateException closing) {
+                        // closed along with its loop
+                    }
+                }
+            }
+            throw failure.get();
+        }
+        return servers;
+    }
+
+    /**
+     * Returns and clears the exceptions collected by the default exception
+     * handler, later ones are suppressed by the first.
+     */
+    public Throwable takePendingException() {
+        return pendingException.getAndSet(null);
+    }
+
+    /**
+     * Closes every handle of every loop and waits for the loop threads to
+     * finish, unless called from one of them.
+     */
+    @Override
+    public void close() {
+        if (closed) {
+            return;
+        }
+        closed = true;
+        for (final Worker worker : workers) {
+            worker.shutdown();
+        }
+        final Thread self = Thread.currentThread();
+        boolean interrupted = false;
+        for (final Worker worker : workers) {
+            while (worker.thread != self && worker.thread.isAlive()) {
+                try {
+                    worker.thread.join();
+                } catch (final InterruptedException ex) {
+                    interrupted = true;
+                }
+            }
+        }
+        if (interrupted) {
+            self.interrupt();
+        }
+    }
+
+    private Worker worker(final int index) {
+        if (index < 0 || index >= workers.length) {
+            throw new IndexOutOfBoundsException("loop " + index);
+        }
+        return workers[index];
+    }
+
+    private final class Worker implements Runnable {
+
+        private final int index;
+        private final LoopHandle loop;
+        private final HandleFactory factory;
+        private final AsyncHandle wakeup;
+        private final Thread thread;
+        private final ConcurrentLinkedQueue<Runnable> tasks = new ConcurrentLinkedQueue<>();
+        private final AtomicBoolean signalled = new AtomicBoolean(false);
+        // guards closing and every send to wakeup, so that no task is queued
+        // behind the final one and nothing is sent once wakeup may be closed
+        private final Object lock = new Object();
+        private boolean closing = false;
+
+        private Worker(final int index) {
+            this.index = index;
+            // no context provider, writes then skip capturing a context
+            loop = new LoopHandle(exceptionHandler,
+                                  new LoopCallbackHandlerFactory(exceptionHandler),
+                                  null);
+            factory = new DefaultHandleFactory().initialize(loop);
+            // created before the thread starts, afterwards only sent to
+            wakeup = factory.newAsyncHandle();
+            wakeup.setAsyncCallback(new AsyncCallback() {
+                @Override
+                public void onSend(final int status) throws Exception {
+                    drain();
+                }
+            });
+            thread = new Thread(this, "libuv-loop-" + index);
+            thread.setDaemon(true);
+        }
+
+        private void post(final Runnable task) {
+            synchronized (lock) {
+                if (closing) {
+                    throw new IllegalStateException("loop group closed");
+                }
+                enqueue(task);
+            }
+        }
+
+        private void shutdown() {
+            synchronized (lock) {
+                if (closing) {
+                    return;
+                }
+                closing = true;
+                enqueue(new Runnable() {
+                    @Override
+                    public void run() {
+                        wakeup.close();
+                        loop.close();
+                    }
+                });
+            }
+        }
+
+        private void enqueue(final Runnable task) {
+            tasks.add(task);
+            // one wakeup per burst of tasks
+            if (signalled.compareAndSet(false, true)) {
+                wakeup.send();
+            }
+        }
+
+        private void drain() {
+            signalled.set(false);
+            Runnable task;
+            while ((task = tasks.poll()) != null) {
+                try {
+                    task.run();
+                } catch (final Throwable ex) {
+                    exceptionHandler.handle(ex);
+                }
+            }
+        }
+
+        @Override
+        public void run() {
+            try {
+                // the wakeup handle keeps the loop alive until close
+                while (!closed) {
+                    loop.run();
+                }
+                // the close callbacks of the handles closed by loop.close()
+                loop.run();
+                loop.destroy();
+            } catch (final Throwable ex) {
+                exceptionHandler.handle(ex);
+            }
+        }
+    }
+}
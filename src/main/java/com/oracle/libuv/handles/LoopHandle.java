@@ -26,6 +26,9 @@
 package com.oracle.libuv.handles;
 
 import java.io.Closeable;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.Objects;
 
 import com.oracle.libuv.LibUVPermission;
 import com.oracle.libuv.NativeException;
@@ -46,10 +49,23 @@ public class LoopHandle implements Closeable {
     private static int createdLoopCount = 0;
 
     protected final CallbackExceptionHandler exceptionHandler;
+    // used when no context provider is given, getContext() then skips the call
+    private static final ContextProvider NULL_CONTEXT_PROVIDER = new ContextProvider() {
+        @Override
+        public Object getContext() {
+            return null;
+        }
+    };
+
     protected final CallbackHandlerFactory callbackHandlerFactory;
     protected final ContextProvider contextProvider;
+    // the one handler of a LoopCallbackHandlerFactory, which ignores contexts,
+    // handed out without going through the factory
+    private final CallbackHandler defaultCallbackHandler;
     private final long pointer;
+    private Resolver resolver;
     private Throwable pendingException;
+    private boolean busyPolling;
     private boolean closed;
 
     private enum RunMode {
@@ -66,6 +82,48 @@ public class LoopHandle implements Closeable {
         }
     }
 
+    /**
+     * Kinds of native request objects recycled through per loop freelists.
+     */
+    public enum RequestType {
+
+        // must be in the order of LoopData::RequestType in loop.h
+        WRITE,
+        SHUTDOWN,
+        CONNECT,
+        UDP_SEND,
+        FS,
+        CONTEXT,
+        FILE_REQUEST
+    }
+
+    // indices into the array filled by getFreeListStats
+    public static final int FREELIST_IN_USE = 0;
+    public static final int FREELIST_CACHED = 1;
+    public static final int FREELIST_HIGH_WATER = 2;
+    public static final int FREELIST_ALLOCATED = 3;
+    public static final int FREELIST_LIMIT = 4;
+    public static final int FREELIST_STATS_LENGTH = 5;
+
+    // byte offsets into each census record, must be equal to CensusLayout in loop.cpp
+    public static final int CENSUS_TYPE = 0;
+    public static final int CENSUS_POINTER = 8;
+    public static final int CENSUS_FLAGS = 16;
+    public static final int CENSUS_BYTES_READ = 24;
+    public static final int CENSUS_READS = 32;
+    public static final int CENSUS_BYTES_WRITTEN = 40;
+    public static final int CENSUS_WRITES = 48;
+    public static final int CENSUS_WRITE_QUEUE_PEAK = 56;
+    public static final int CENSUS_WRITE_QUEUE_SIZE = 64;
+    public static final int CENSUS_IDLE_TIME = 72;
+    public static final int CENSUS_RECORD_SIZE = 80;
+
+    // bits of the CENSUS_FLAGS field
+    public static final long CENSUS_ACTIVE = 1;
+    public static final long CENSUS_REFED = 2;
+    public static final long CENSUS_CLOSING = 4;
+    public static final long CENSUS_COUNTED = 8;
+
     private static synchronized void newLoop() {
         LibUVPermission.checkHandle();
         createdLoopCount += 1;
@@ -81,7 +139,9 @@ public class LoopHandle implements Closeable {
         assert exceptionHandler != null;
         this.exceptionHandler = exceptionHandler;
         this.callbackHandlerFactory = callbackHandler;
-        this.contextProvider = contextProvider;
+        this.contextProvider = contextProvider != null ? contextProvider : NULL_CONTEXT_PROVIDER;
+        this.defaultCallbackHandler = callbackHandler instanceof LoopCallbackHandlerFactory ?
+                callbackHandler.newCallbackHandler() : null;
         closed = false;
     }
 
@@ -98,29 +158,57 @@ public class LoopHandle implements Closeable {
                 } else {
                     pendingException.addSuppressed(ex);
                 }
+                if (busyPolling) {
+                    // busy polling never returns by itself while work remains
+                    stop();
+                }
             }
         };
 
         this.callbackHandlerFactory = new LoopCallbackHandlerFactory(this.exceptionHandler);
+        this.contextProvider = NULL_CONTEXT_PROVIDER;
+        this.defaultCallbackHandler = callbackHandlerFactory.newCallbackHandler();
+    }
 
-        this.contextProvider = new ContextProvider() {
-            @Override
-            public Object getContext() {
-                return null;
-            }
-        };
+    /**
+     * True when callbacks are dispatched through the cached handler of a
+     * LoopCallbackHandlerFactory instead of asking the factory every time.
+     * Stream reads and writes on such a loop are called by native code on
+     * the handle directly, without going through a handler at all.
+     */
+    public boolean isFastDispatch() {
+        return defaultCallbackHandler != null;
+    }
+
+    // the exception handler of the cached handler, handles on a fast dispatch
+    // loop have native code call their callbacks directly and report here
+    CallbackExceptionHandler getDispatchExceptionHandler() {
+        assert isFastDispatch();
+        return ((LoopCallbackHandler) defaultCallbackHandler).exceptionHandler();
     }
 
     public CallbackHandler getCallbackHandler(final Object context) {
-        return callbackHandlerFactory.newCallbackHandler(context);
+        final CallbackHandler handler = defaultCallbackHandler;
+        return handler != null ? handler : callbackHandlerFactory.newCallbackHandler(context);
     }
 
     public CallbackHandler getCallbackHandler() {
-        return callbackHandlerFactory.newCallbackHandler();
+        final CallbackHandler handler = defaultCallbackHandler;
+        return handler != null ? handler : callbackHandlerFactory.newCallbackHandler();
     }
 
     public Object getContext() {
-        return contextProvider.getContext();
+        return contextProvider == NULL_CONTEXT_PROVIDER ? null : contextProvider.getContext();
+    }
+
+    /**
+     * The loop's hostname resolver, created on first use.
+     */
+    public Resolver getResolver() {
+        if (resolver == null) {
+            resolver = new Resolver(this);
+        }
+        return resolver;
     }
 
     public CallbackExceptionHandler getExceptionHandler() {
@@ -142,6 +230,32 @@ public class LoopHandle implements Closeable {
         return _run(pointer, RunMode.DEFAULT.value) != 0;
     }
 
+    /**
+     * Runs the loop without blocking for as long as callbacks keep firing,
+     * falling back to a blocking poll once none fired for spinMicros.
+     * Trades CPU for latency on loops that carry steady traffic.
+     */
+    public boolean runBusyPoll(final long spinMicros) throws Throwable {
+        if (spinMicros < 0) {
+            throw new IllegalArgumentException("spinMicros must not be negative");
+        }
+        throwPendingException();
+        busyPolling = true;
+        try {
+            return _run_busy_poll(pointer, spinMicros * 1000) != 0;
+        } finally {
+            busyPolling = false;
+        }
+    }
+
+    /**
+     * The number of libuv callbacks that called up into Java so far, a
+     * batched upcall counts once. Counted whether metrics are enabled or not.
+     */
+    public long getCallbackCount() {
+        return _callback_count(pointer);
+    }
+
     public void stop() {
         _stop(pointer);
     }
@@ -175,10 +289,80 @@ public class LoopHandle implements Closeable {
         return _list(pointer);
     }
 
+    /**
+     * Writes one CENSUS_RECORD_SIZE record of longs per handle into the
+     * direct {@code buffer}, which is switched to native byte order. The
+     * type is an ordinal of LoopMetrics.HandleType. Streams and udp
+     * handles have CENSUS_COUNTED set and carry their I/O counters, the
+     * idle time is the milliseconds since their last read or write, or -1
+     * before the first. Udp handles have no write queue.
+     *
+     * @return the number of handles, records beyond the buffer are dropped
+     */
+    public int census(final ByteBuffer buffer) {
+        Objects.requireNonNull(buffer);
+        if (!buffer.isDirect()) {
+            throw new IllegalArgumentException("census buffer must be direct");
+        }
+        buffer.order(ByteOrder.nativeOrder());
+        return _census(pointer, buffer);
+    }
+
     public long pointer() {
         return pointer;
     }
 
+    /**
+     * Returns a buffer delivered by a stream with pooled reads enabled to
+     * the loop's read buffer pool. The buffer must not be used afterwards.
+     *
+     * @return false if the buffer does not belong to the pool or was
+     *         already recycled
+     */
+    public boolean recycle(final ByteBuffer buffer) {
+        Objects.requireNonNull(buffer);
+        return buffer.isDirect() && _recycle(pointer, buffer);
+    }
+
+    /**
+     * Fills {@code stats} (indexed by the FREELIST_* constants) with the
+     * current usage of the freelist for {@code type}: objects in use, cached
+     * for reuse, the in use high water mark, the number ever allocated from
+     * the heap and the cache limit.
+     */
+    public void getFreeListStats(final RequestType type, final long[] stats) {
+        Objects.requireNonNull(type);
+        Objects.requireNonNull(stats);
+        _get_freelist_stats(pointer, type.ordinal(), stats);
+    }
+
+    /**
+     * Sets how many released objects of {@code type} are kept for reuse.
+     */
+    public void setFreeListLimit(final RequestType type, final int limit) {
+        Objects.requireNonNull(type);
+        if (limit < 0) {
+            throw new IllegalArgumentException("limit must not be negative");
+        }
+        _set_freelist_limit(pointer, type.ordinal(), limit);
+    }
+
+    /**
+     * Starts or stops recording loop metrics. Enabling them again resets
+     * all counters.
+     */
+    public void setMetricsEnabled(final boolean enabled) {
+        _set_metrics_enabled(pointer, enabled);
+    }
+
+    /**
+     * Copies the current metrics of this loop into {@code metrics}.
+     */
+    public void getMetrics(final LoopMetrics metrics) {
+        Objects.requireNonNull(metrics);
+        _get_metrics(pointer, metrics.values);
+    }
+
     @Override
     protected void finalize() throws Throwable {
         close();
@@ -200,6 +384,10 @@ public class LoopHandle implements Closeable {
 
     private native int _run(final long ptr, final int mode);
 
+    private native int _run_busy_poll(final long ptr, final long spinNanos);
+
+    private native long _callback_count(final long ptr);
+
     private native void _stop(final long ptr);
 
     private native void _destroy(final long ptr);
@@ -208,7 +396,19 @@ public class LoopHandle implements Closeable {
 
     private native String[] _list(final long ptr);
 
+    private native int _census(final long ptr, final ByteBuffer buffer);
+
     private native NativeException _get_last_error(final long ptr);
 
     private native void _set_last_error(final long ptr, final int code);
+
+    private native boolean _recycle(final long ptr, final ByteBuffer buffer);
+
+    private native void _get_freelist_stats(final long ptr, final int type, final long[] stats);
+
+    private native void _set_freelist_limit(final long ptr, final int type, final int limit);
+
+    private native void _set_metrics_enabled(final long ptr, final boolean enabled);
+
+    private native void _get_metrics(final long ptr, final long[] values);
 }
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+package com.oracle.libuv.handles;
+
+import java.util.Objects;
+
+/**
+ * A reusable snapshot of the native metrics of a loop, filled in place by
+ * {@link LoopHandle#getMetrics(LoopMetrics)} so that sampling does not
+ * allocate. Times are in nanoseconds and cover the period since metrics
+ * were last enabled.
+ */
+public final class LoopMetrics {
+
+    /**
+     * Categories callback durations are recorded under.
+     */
+    public enum HandleType {
+
+        // must be in the order of uv_handle_type in uv.h
+        UNKNOWN,
+        ASYNC,
+        CHECK,
+        FS_EVENT,
+        FS_POLL,
+        HANDLE,
+        IDLE,
+        PIPE,
+        POLL,
+        PREPARE,
+        PROCESS,
+        STREAM,
+        TCP,
+        TIMER,
+        TTY,
+        UDP,
+        SIGNAL,
+        FILE
+    }
+
+    // must be equal to LoopMetrics::BUCKETS in metrics.h
+    public static final int BUCKETS = 24;
+
+    // must be equal to MetricsLayout in loop.cpp
+    private static final int ENABLED = 0;
+    private static final int ELAPSED = 1;
+    private static final int ITERATIONS = 2;
+    private static final int POLL_TIME = 3;
+    private static final int CALLBACK_TIME = 4;
+    private static final int CALLBACKS = 5;
+    private static final int PENDING = 6;
+    private static final int CATEGORIES = PENDING + LoopHandle.RequestType.values().length;
+    private static final int CATEGORY_LENGTH = 2 + BUCKETS;
+    static final int LENGTH = CATEGORIES + HandleType.values().length * CATEGORY_LENGTH;
+
+    final long[] values = new long[LENGTH];
+
+    public boolean isEnabled() {
+        return values[ENABLED] != 0;
+    }
+
+    public long elapsedTime() {
+        return values[ELAPSED];
+    }
+
+    public long iterations() {
+        return values[ITERATIONS];
+    }
+
+    /**
+     * Time spent blocked in the poll phase, without the i/o callbacks run
+     * from it which count as callback time.
+     */
+    public long pollTime() {
+        return values[POLL_TIME];
+    }
+
+    /**
+     * Time spent in callbacks calling up into Java.
+     */
+    public long callbackTime() {
+        return values[CALLBACK_TIME];
+    }
+
+    public long callbacks() {
+        return values[CALLBACKS];
+    }
+
+    /**
+     * Time neither polling nor in callbacks, that is spent by the loop itself.
+     */
+    public long loopTime() {
+        return Math.max(0, elapsedTime() - pollTime() - callbackTime());
+    }
+
+    /**
+     * Requests of {@code type} in flight, also tracked with metrics disabled.
+     */
+    public long pendingRequests(final LoopHandle.RequestType type) {
+        Objects.requireNonNull(type);
+        return values[PENDING + type.ordinal()];
+    }
+
+    public long callbacks(final HandleType type) {
+        return values[offset(type)];
+    }
+
+    public long callbackTime(final HandleType type) {
+        return values[offset(type) + 1];
+    }
+
+    /**
+     * Number of callbacks of {@code type} that took less than
+     * {@link #bucketLimit(int)} microseconds and at least the limit of the
+     * previous bucket.
+     */
+    public long histogram(final HandleType type, final int bucket) {
+        if (bucket < 0 || bucket >= BUCKETS) {
+            throw new IndexOutOfBoundsException("bucket " + bucket);
+        }
+        return values[offset(type) + 2 + bucket];
+    }
+
+    /**
+     * Exclusive upper bound in microseconds of {@code bucket}, the last
+     * bucket is unbounded.
+     */
+    public static long bucketLimit(final int bucket) {
+        if (bucket < 0 || bucket >= BUCKETS) {
+            throw new IndexOutOfBoundsException("bucket " + bucket);
+        }
+        return bucket == BUCKETS - 1 ? Long.MAX_VALUE : 1L << bucket;
+    }
+
+    /**
+     * Approximates the callback duration percentile {@code p} (0 to 100) of
+     * {@code type} in microseconds as the upper bound of its bucket.
+     */
+    public long percentile(final HandleType type, final double p) {
+        if (p < 0 || p > 100) {
+            throw new IllegalArgumentException("percentile must be between 0 and 100");
+        }
+        final long count = callbacks(type);
+        if (count == 0) {
+            return 0;
+        }
+        final long rank = (long) Math.ceil(count * p / 100);
+        long seen = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += histogram(type, i);
+            if (seen >= rank && seen > 0) {
+                return bucketLimit(i);
+            }
+        }
+        return bucketLimit(BUCKETS - 1);
+    }
+
+    private static int offset(final HandleType type) {
+        Objects.requireNonNull(type);
+        return CATEGORIES + type.ordinal() * CATEGORY_LENGTH;
+    }
+}
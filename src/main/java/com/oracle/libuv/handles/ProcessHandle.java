@@ -162,6 +162,37 @@ public class ProcessHandle extends Handle {
                 gid);
     }
 
+    /**
+     * Spawns the program of template with extraArgs appended to its
+     * arguments. Each non-null element of streams takes the place of the
+     * template's stdio stream at the same index, such as a pipe created
+     * for this child.
+     */
+    public int spawn(final SpawnTemplate template,
+                     final String[] extraArgs,
+                     final StreamHandle[] streams) {
+        Objects.requireNonNull(template);
+        long[] streamPointers = null;
+        if (streams != null) {
+            if (streams.length > template.getStdioCount()) {
+                throw new IllegalArgumentException("more streams than stdio options");
+            }
+            streamPointers = new long[streams.length];
+            for (int i = 0; i < streams.length; i++) {
+                streamPointers[i] = streams[i] != null ? streams[i].pointer : 0;
+            }
+        }
+        if (extraArgs != null) {
+            for (final String arg : extraArgs) {
+                Objects.requireNonNull(arg);
+            }
+        }
+
+        LibUVPermission.checkSpawn(template.getProgram());
+
+        return _spawn_template(pointer, template.pointer(), extraArgs, streamPointers);
+    }
+
     public void close() {
         if (!closed) {
             _close(pointer);
@@ -209,6 +240,11 @@ public class ProcessHandle extends Handle {
                               final int uid,
                               final int gid);
 
+    private native int _spawn_template(final long ptr,
+                                       final long template,
+                                       final String[] extraArgs,
+                                       final long[] streams);
+
     private native void _close(final long ptr);
 
     private native int _kill(final long ptr, final int signal);
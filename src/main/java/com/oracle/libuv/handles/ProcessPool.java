@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+package com.oracle.libuv.handles;
+
+import java.io.Closeable;
+import java.util.ArrayDeque;
+import java.util.Objects;
+
+import com.oracle.libuv.cb.IdleCallback;
+import com.oracle.libuv.cb.ProcessExitCallback;
+import com.oracle.libuv.cb.TimerCallback;
+
+/**
+ * Children of a {@link SpawnTemplate} spawned ahead of time with pipes on
+ * their stdin and stdout, so acquiring one does not wait for fork/exec.
+ * Replacements are spawned on the next loop iteration after a worker is
+ * taken. Idle workers that exit are closed and replaced after a delay
+ * that doubles with every exit, from 10ms up to 10s, so a template whose
+ * children crash does not respawn in a tight loop. Acquiring a worker
+ * resets the delay.
+ */
+public final class ProcessPool implements Closeable {
+
+    public static final int SIGTERM = 15;
+
+    private static final long MIN_BACKOFF = 10;
+    private static final long MAX_BACKOFF = 10000;
+
+    public static final class Worker {
+        private final ProcessHandle process;
+        private final PipeHandle stdin;
+        private final PipeHandle stdout;
+
+        private Worker(final ProcessHandle process, final PipeHandle stdin, final PipeHandle stdout) {
+            this.process = process;
+            this.stdin = stdin;
+            this.stdout = stdout;
+        }
+
+        public ProcessHandle process() {
+            return process;
+        }
+
+        public PipeHandle stdin() {
+            return stdin;
+        }
+
+        public PipeHandle stdout() {
+            return stdout;
+        }
+
+        private void close() {
+            stdin.close();
+            stdout.close();
+            process.close();
+        }
+    }
+
+    private final HandleFactory factory;
+    private final SpawnTemplate template;
+    private final int size;
+    private final ArrayDeque<Worker> idle;
+    private final IdleHandle refill;
+    private final TimerHandle backoff;
+    private int failures;
+    private boolean closed;
+
+    /**
+     * The template must create pipes for stdin and stdout.
+     */
+    public ProcessPool(final HandleFactory factory, final SpawnTemplate template, final int size) {
+        Objects.requireNonNull(factory);
+        Objects.requireNonNull(template);
+        if (size <= 0) {
+            throw new IllegalArgumentException("size must be positive");
+        }
+        if (template.getStdioCount() < 2 ||
+                template.getStdioType(0) != StdioOptions.StdioType.CREATE_PIPE ||
+                template.getStdioType(1) != StdioOptions.StdioType.CREATE_PIPE) {
+            throw new IllegalArgumentException("template must pipe stdin and stdout");
+        }
+        this.factory = factory;
+        this.template = template;
+        this.size = size;
+        this.idle = new ArrayDeque<>(size);
+        this.refill = factory.newIdleHandle();
+        refill.setIdleCallback(new IdleCallback() {
+            @Override
+            public void onIdle(final int status) throws Exception {
+                refill.stop();
+                fill();
+            }
+        });
+        this.backoff = factory.newTimerHandle();
+        backoff.setTimerFiredCallback(new TimerCallback() {
+            @Override
+            public void onTimer(final int status) throws Exception {
+                fill();
+            }
+        });
+        fill();
+    }
+
+    public int idleCount() {
+        return idle.size();
+    }
+
+    /**
+     * Takes an idle worker, spawning one if none is ready. The caller owns
+     * the worker from then on: it should set its own exit callback on the
+     * process and close the process and both pipes when done.
+     */
+    public Worker acquire() {
+        if (closed) {
+            throw new IllegalStateException("process pool closed");
+        }
+        Worker worker = idle.pollFirst();
+        if (worker == null) {
+            worker = spawn();
+        }
+        failures = 0;
+        refill.start();
+        return worker;
+    }
+
+    @Override
+    public void close() {
+        if (closed) {
+            return;
+        }
+        closed = true;
+        refill.close();
+        backoff.close();
+        for (final Worker worker : idle) {
+            worker.process.kill(SIGTERM);
+            worker.close();
+        }
+        idle.clear();
+    }
+
+    private void fill() {
+        while (!closed && idle.size() < size) {
+            idle.addLast(spawn());
+        }
+    }
+
+    private void respawnLater() {
+        final long delay = failures < 10 ? Math.min(MIN_BACKOFF << failures, MAX_BACKOFF) : MAX_BACKOFF;
+        failures++;
+        backoff.start(delay, 0);
+    }
+
+    private Worker spawn() {
+        final ProcessHandle process = factory.newProcessHandle();
+        final PipeHandle stdin = factory.newPipeHandle(false);
+        final PipeHandle stdout = factory.newPipeHandle(false);
+        final Worker worker = new Worker(process, stdin, stdout);
+        process.setExitCallback(new ProcessExitCallback() {
+            @Override
+            public void onExit(final int status, final int signal, final Exception error) throws Exception {
+                // only reached while the pool still owns the worker
+                if (idle.remove(worker)) {
+                    worker.close();
+                    if (!closed) {
+                        respawnLater();
+                    }
+                }
+            }
+        });
+        try {
+            process.spawn(template, null, new StreamHandle[] {stdin, stdout});
+        } catch (final RuntimeException ex) {
+            worker.close();
+            throw ex;
+        }
+        return worker;
+    }
+
+}
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+package com.oracle.libuv.handles;
+
+import java.net.UnknownHostException;
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.Objects;
+
+import com.oracle.libuv.cb.ResolveCallback;
+
+/**
+ * Resolves hostnames with uv_getaddrinfo on the thread pool, one per loop
+ * (see {@link LoopHandle#getResolver()}). Results, failed lookups included,
+ * are kept in a bounded LRU cache for a fixed time to live, and concurrent
+ * lookups of the same name share a single request. Not thread safe, like
+ * the loop it belongs to.
+ */
+public final class Resolver {
+
+    public static final int DEFAULT_CACHE_SIZE = 1024;
+    public static final long DEFAULT_TTL = 30000;
+    public static final long DEFAULT_NEGATIVE_TTL = 5000;
+
+    private static final class Entry {
+        final String[] addresses;
+        final Exception error;
+        final long expiry;
+
+        Entry(final String[] addresses, final Exception error, final long expiry) {
+            this.addresses = addresses;
+            this.error = error;
+            this.expiry = expiry;
+        }
+    }
+
+    private final LoopHandle loop;
+    private final LinkedHashMap<String, Entry> cache;
+    private final Map<String, List<ResolveCallback>> pending = new HashMap<>();
+    private int cacheSize = DEFAULT_CACHE_SIZE;
+    private long ttl = DEFAULT_TTL;
+    private long negativeTtl = DEFAULT_NEGATIVE_TTL;
+    private long hits;
+    private long lookups;
+
+    static {
+        _static_initialize();
+    }
+
+    protected Resolver(final LoopHandle loop) {
+        this.loop = loop;
+        this.cache = new LinkedHashMap<String, Entry>(16, 0.75f, true) {
+            private static final long serialVersionUID = 1L;
+
+            @Override
+            protected boolean removeEldestEntry(final Map.Entry<String, Entry> eldest) {
+                return size() > cacheSize;
+            }
+        };
+    }
+
+    public void setCacheSize(final int cacheSize) {
+        if (cacheSize < 0) {
+            throw new IllegalArgumentException("cacheSize must not be negative");
+        }
+        this.cacheSize = cacheSize;
+        while (cache.size() > cacheSize) {
+            cache.remove(cache.keySet().iterator().next());
+        }
+    }
+
+    /**
+     * Sets how long, in milliseconds, resolved names and failed lookups
+     * are served from the cache. Only lookups completed afterwards use it.
+     */
+    public void setTtl(final long ttl, final long negativeTtl) {
+        if (ttl < 0 || negativeTtl < 0) {
+            throw new IllegalArgumentException("ttl must not be negative");
+        }
+        this.ttl = ttl;
+        this.negativeTtl = negativeTtl;
+    }
+
+    public void clear() {
+        cache.clear();
+    }
+
+    /**
+     * Lookups answered from the cache, or merged into one in flight.
+     */
+    public long getHits() {
+        return hits;
+    }
+
+    /**
+     * Lookups that went to uv_getaddrinfo.
+     */
+    public long getLookups() {
+        return lookups;
+    }
+
+    /**
+     * @return the cached addresses of hostname, the hostname itself if it
+     *         is a numeric address, or null if it has to be resolved or
+     *         the cached lookup failed
+     */
+    public String[] lookup(final String hostname) {
+        Objects.requireNonNull(hostname);
+        if (isNumeric(hostname)) {
+            return new String[] {hostname};
+        }
+        final Entry entry = cached(hostname);
+        if (entry == null || entry.error != null) {
+            return null;
+        }
+        hits++;
+        return entry.addresses;
+    }
+
+    /**
+     * Resolves hostname, calling back right away when the answer is cached.
+     */
+    public void resolve(final String hostname, final ResolveCallback callback) {
+        Objects.requireNonNull(hostname);
+        Objects.requireNonNull(callback);
+        if (isNumeric(hostname)) {
+            loop.getCallbackHandler().handleResolveCallback(callback, new String[] {hostname}, null);
+            return;
+        }
+        final Entry entry = cached(hostname);
+        if (entry != null) {
+            hits++;
+            loop.getCallbackHandler().handleResolveCallback(callback, entry.addresses, entry.error);
+            return;
+        }
+        List<ResolveCallback> waiting = pending.get(hostname);
+        if (waiting != null) {
+            hits++;
+            waiting.add(callback);
+            return;
+        }
+        waiting = new ArrayList<>(1);
+        waiting.add(callback);
+        pending.put(hostname, waiting);
+        lookups++;
+        try {
+            _resolve(loop.pointer(), hostname);
+        } catch (final RuntimeException ex) {
+            pending.remove(hostname);
+            throw ex;
+        }
+    }
+
+    static boolean isIPv6(final String address) {
+        return address.indexOf(':') >= 0;
+    }
+
+    private static boolean isNumeric(final String hostname) {
+        if (isIPv6(hostname)) {
+            return true;
+        }
+        int dots = 0;
+        for (int i = 0; i < hostname.length(); i++) {
+            final char c = hostname.charAt(i);
+            if (c == '.') {
+                dots++;
+            } else if (c < '0' || c > '9') {
+                return false;
+            }
+        }
+        return dots == 3;
+    }
+
+    private Entry cached(final String hostname) {
+        final Entry entry = cache.get(hostname);
+        if (entry != null && entry.expiry - System.nanoTime() <= 0) {
+            cache.remove(hostname);
+            return null;
+        }
+        return entry;
+    }
+
+    private void callResolved(final String hostname, final String[] addresses, final Exception error) {
+        final Exception failure = error == null && addresses.length == 0 ? new UnknownHostException(hostname) : error;
+        final String[] resolved = failure == null ? addresses : null;
+        final long lifetime = failure == null ? ttl : negativeTtl;
+        if (lifetime > 0 && cacheSize > 0) {
+            cache.put(hostname, new Entry(resolved, failure, System.nanoTime() + lifetime * 1000000L));
+        }
+        final List<ResolveCallback> waiting = pending.remove(hostname);
+        assert waiting != null : "no lookup pending for " + hostname;
+        for (final ResolveCallback callback : waiting) {
+            loop.getCallbackHandler().handleResolveCallback(callback, resolved, failure);
+        }
+    }
+
+    private static native void _static_initialize();
+
+    private native int _resolve(final long loopPtr, final String hostname);
+
+}
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+package com.oracle.libuv.handles;
+
+import java.nio.ByteBuffer;
+import java.util.Objects;
+
+import com.oracle.libuv.NativeException;
+import com.oracle.libuv.cb.SharedMemoryRingCallback;
+import com.oracle.libuv.cb.StreamReadCallback;
+
+/**
+ * A single producer, single consumer message ring in a file mapped by two
+ * processes, typically a parent that {@link #create}s it and a child that
+ * {@link #open}s the path it was given. Messages are copied into the ring
+ * once and read in place. A stream between the two, such as a stdio pipe,
+ * only carries a byte to wake the consumer when it went idle.
+ * Not supported on Windows.
+ */
+public final class SharedMemoryRing implements AutoCloseable {
+
+    // must be equal to SharedRing::OfferResult in ring.h
+    private static final int FULL = 0;
+    private static final int OFFERED_WAKEUP = 2;
+
+    // only ever read, shared by every wakeup write
+    private static final ByteBuffer WAKEUP = ByteBuffer.allocateDirect(1);
+
+    private final long capacity;
+    private long pointer;
+
+    private SharedMemoryRing(final long pointer) {
+        this.pointer = pointer;
+        this.capacity = _capacity(pointer);
+    }
+
+    /**
+     * Creates, or truncates, the file at path and maps a ring of capacity
+     * bytes, rounded up to a power of two.
+     */
+    public static SharedMemoryRing create(final String path, final long capacity) {
+        Objects.requireNonNull(path);
+        if (capacity < 16 || capacity > 1L << 40) {
+            throw new IllegalArgumentException("invalid capacity " + capacity);
+        }
+        return new SharedMemoryRing(_create(path, Long.highestOneBit(capacity - 1) << 1));
+    }
+
+    public static SharedMemoryRing open(final String path) {
+        Objects.requireNonNull(path);
+        return new SharedMemoryRing(_open(path));
+    }
+
+    public long capacity() {
+        return capacity;
+    }
+
+    /**
+     * The largest message the ring takes, half its capacity less a header.
+     */
+    public int maxMessageSize() {
+        return (int) Math.min(Integer.MAX_VALUE, capacity / 2 - 4);
+    }
+
+    /**
+     * Copies the remaining bytes of data into the ring, without changing
+     * its position, and writes a wakeup byte to wakeup if the consumer
+     * went idle.
+     *
+     * @return false if the ring is full
+     */
+    public boolean send(final ByteBuffer data, final StreamHandle wakeup) {
+        Objects.requireNonNull(data);
+        Objects.requireNonNull(wakeup);
+        final int r = offer(data);
+        if (r == OFFERED_WAKEUP) {
+            wakeup.write(WAKEUP);
+        }
+        return r != FULL;
+    }
+
+    /**
+     * Reads wakeups from the stream and passes every message in the ring to
+     * callback, until the stream ends. A ring holding a record its producer
+     * could not have written is corrupt, the stream is then closed and the
+     * read callback throws a NativeException with EINVAL.
+     */
+    public void receive(final StreamHandle wakeup, final SharedMemoryRingCallback callback) {
+        Objects.requireNonNull(wakeup);
+        Objects.requireNonNull(callback);
+        final LoopHandle loop = wakeup.loop;
+        wakeup.setReadCallback(new StreamReadCallback() {
+            @Override
+            public void onRead(final ByteBuffer data) throws Exception {
+                if (data == null) {
+                    wakeup.close();
+                    return;
+                }
+                // a wakeup can only be asked for again once armed
+                do {
+                    ByteBuffer message;
+                    while (pointer != 0 && (message = peek(wakeup)) != null) {
+                        loop.getCallbackHandler().handleSharedMemoryRingCallback(callback, message);
+                        if (pointer != 0) {
+                            _release(pointer);
+                        }
+                    }
+                } while (pointer != 0 && !_arm(pointer));
+            }
+        });
+        wakeup.readStart();
+    }
+
+    @Override
+    public void close() {
+        if (pointer != 0) {
+            _close(pointer);
+            pointer = 0;
+        }
+    }
+
+    @Override
+    protected void finalize() throws Throwable {
+        close();
+        super.finalize();
+    }
+
+    private ByteBuffer peek(final StreamHandle wakeup) {
+        try {
+            return _peek(pointer);
+        } catch (final NativeException ex) {
+            wakeup.close();
+            throw ex;
+        }
+    }
+
+    private int offer(final ByteBuffer data) {
+        if (pointer == 0) {
+            throw new IllegalStateException("shared memory ring closed");
+        }
+        final int length = data.remaining();
+        if (length > maxMessageSize()) {
+            throw new IllegalArgumentException("message of " + length + " bytes does not fit the ring");
+        }
+        return data.hasArray() ?
+                _offer(pointer, null, data.array(), data.arrayOffset() + data.position(), length) :
+                _offer(pointer, data, null, data.position(), length);
+    }
+
+    private static native long _create(final String path, final long capacity);
+
+    private static native long _open(final String path);
+
+    private static native long _capacity(final long ptr);
+
+    private static native int _offer(final long ptr, final ByteBuffer buffer, final byte[] data, final int offset, final int length);
+
+    private static native ByteBuffer _peek(final long ptr);
+
+    private static native void _release(final long ptr);
+
+    private static native boolean _arm(final long ptr);
+
+    private static native void _close(final long ptr);
+
+}
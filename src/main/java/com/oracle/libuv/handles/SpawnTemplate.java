@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+package com.oracle.libuv.handles;
+
+import java.util.EnumSet;
+import java.util.Objects;
+
+import com.oracle.libuv.handles.ProcessHandle.ProcessFlags;
+
+/**
+ * A command whose program, arguments, environment, working directory and
+ * stdio layout are marshalled to native memory once and reused by every
+ * {@link ProcessHandle#spawn(SpawnTemplate, String[], StreamHandle[])}.
+ * Unlike {@link ProcessHandle#spawn}, args[0] is the program as is and
+ * is not split on spaces.
+ */
+public final class SpawnTemplate implements AutoCloseable {
+
+    private final String program;
+    private final int[] stdioTypes;
+    private long pointer;
+
+    public SpawnTemplate(final String[] args,
+                         final String[] env,
+                         final String dir,
+                         final EnumSet<ProcessFlags> flags,
+                         final StdioOptions[] stdio,
+                         final int uid,
+                         final int gid) {
+        Objects.requireNonNull(args);
+        Objects.requireNonNull(flags);
+        Objects.requireNonNull(stdio);
+        if (args.length == 0) {
+            throw new IllegalArgumentException("args must start with the program");
+        }
+        if (stdio.length == 0) {
+            throw new IllegalArgumentException("StdioOptions cannot be null or empty");
+        }
+        for (final String arg : args) {
+            Objects.requireNonNull(arg);
+        }
+        if (env != null) {
+            for (final String var : env) {
+                Objects.requireNonNull(var);
+            }
+        }
+        program = args[0];
+        stdioTypes = new int[stdio.length];
+        final long[] streams = new long[stdio.length];
+        final int[] fds = new int[stdio.length];
+        for (int i = 0; i < stdio.length; i++) {
+            stdioTypes[i] = stdio[i].type();
+            streams[i] = stdio[i].stream();
+            fds[i] = stdio[i].fd();
+        }
+
+        int processFlags = ProcessFlags.NONE.value;
+        if (flags.contains(ProcessFlags.WINDOWS_VERBATIM_ARGUMENTS)) {
+            processFlags |= ProcessFlags.WINDOWS_VERBATIM_ARGUMENTS.value;
+        }
+        if (flags.contains(ProcessFlags.DETACHED)) {
+            processFlags |= ProcessFlags.DETACHED.value;
+        }
+        pointer = _new(program, args, env, dir, processFlags, stdioTypes, streams, fds, uid, gid);
+        assert pointer != 0;
+    }
+
+    public String getProgram() {
+        return program;
+    }
+
+    public int getStdioCount() {
+        return stdioTypes.length;
+    }
+
+    public StdioOptions.StdioType getStdioType(final int index) {
+        for (final StdioOptions.StdioType type : StdioOptions.StdioType.values()) {
+            if (type.value == stdioTypes[index]) {
+                return type;
+            }
+        }
+        return StdioOptions.StdioType.IGNORE;
+    }
+
+    @Override
+    public void close() {
+        if (pointer != 0) {
+            _delete(pointer);
+            pointer = 0;
+        }
+    }
+
+    @Override
+    protected void finalize() throws Throwable {
+        close();
+        super.finalize();
+    }
+
+    long pointer() {
+        if (pointer == 0) {
+            throw new IllegalStateException("spawn template closed");
+        }
+        return pointer;
+    }
+
+    private static native long _new(final String program,
+                                    final String[] args,
+                                    final String[] env,
+                                    final String dir,
+                                    final int flags,
+                                    final int[] stdioFlags,
+                                    final long[] streams,
+                                    final int[] fds,
+                                    final int uid,
+                                    final int gid);
+
+    private static native void _delete(final long ptr);
+
+}
@@ -31,11 +31,14 @@ import java.util.Deque;
 import java.util.Objects;
 
 import com.oracle.libuv.StringUtils;
+import com.oracle.libuv.cb.CallbackExceptionHandler;
 import com.oracle.libuv.cb.StreamCloseCallback;
 import com.oracle.libuv.cb.StreamConnectCallback;
 import com.oracle.libuv.cb.StreamConnectionCallback;
+import com.oracle.libuv.cb.StreamDrainCallback;
 import com.oracle.libuv.cb.StreamRead2Callback;
 import com.oracle.libuv.cb.StreamReadCallback;
+import com.oracle.libuv.cb.StreamSendFileCallback;
 import com.oracle.libuv.cb.StreamShutdownCallback;
 import com.oracle.libuv.cb.StreamWriteCallback;
 
@@ -43,8 +46,26 @@ import jdk.nashorn.internal.runtime.ConsString;
 
 class StreamHandle extends Handle {
 
+    // must be equal to StringEncoding in encoding.h
+    private static final int ENCODING_UTF8 = 0;
+    private static final int ENCODING_LATIN1 = 1;
+    private static final int ENCODING_NONE = -1;
+
+    /**
+     * Returned by the write methods instead of 0 once the write queue has
+     * reached the high water mark, see {@link #setWaterMarks(long, long)}.
+     */
+    public static final int WRITE_THROTTLED = 1;
+
+    // must be equal to ReadFramer::Mode in stream.h
+    private static final int FRAMING_NONE = 0;
+    private static final int FRAMING_LENGTH_PREFIX = 1;
+    private static final int FRAMING_DELIMITER = 2;
+
     protected boolean closed;
     protected boolean readStarted;
+    // set on a fast dispatch loop, see LoopHandle.isFastDispatch
+    private final CallbackExceptionHandler dispatchExceptionHandler;
 
     protected StreamReadCallback onRead = null;
     protected StreamRead2Callback onRead2 = null;
@@ -53,6 +74,8 @@ class StreamHandle extends Handle {
     protected StreamConnectionCallback onConnection = null;
     protected StreamCloseCallback onClose = null;
     protected StreamShutdownCallback onShutdown = null;
+    protected StreamDrainCallback onDrain = null;
+    protected StreamSendFileCallback onSendFile = null;
 
     static {
         _static_initialize();
@@ -82,10 +105,73 @@ class StreamHandle extends Handle {
         onClose = callback;
     }
 
+    public void setDrainCallback(final StreamDrainCallback callback) {
+        onDrain = callback;
+    }
+
+    public void setSendFileCallback(final StreamSendFileCallback callback) {
+        onSendFile = callback;
+    }
+
     public void setShutdownCallback(final StreamShutdownCallback callback) {
         onShutdown = callback;
     }
 
+    /**
+     * When enabled, read callbacks receive chunks of the loop's read buffer
+     * pool without a copy. Each non-null buffer passed to the read callback
+     * must be handed back with {@link #recycle(ByteBuffer)} once consumed.
+     * Otherwise they get a heap buffer holding a copy, left to the gc.
+     * Framed reads pack small frames into a shared chunk, which is reused
+     * once every frame in it has been recycled.
+     */
+    public void setReadBufferPooling(final boolean pooled) {
+        _set_read_pooling(pointer, pooled);
+    }
+
+    public boolean recycle(final ByteBuffer buffer) {
+        return loop.recycle(buffer);
+    }
+
+    /**
+     * Splits reads into frames preceded by a prefixBytes wide unsigned
+     * length, the read callback then gets one buffer per complete frame
+     * holding only its payload. A frame longer than maxFrameSize stops
+     * reading and is reported like an end of stream. Not applied to read2.
+     */
+    public void setLengthPrefixFraming(final int prefixBytes, final boolean bigEndian, final long maxFrameSize) {
+        if (prefixBytes < 1 || prefixBytes > 8) {
+            throw new IllegalArgumentException("prefixBytes must be in [1, 8]: " + prefixBytes);
+        }
+        if (maxFrameSize < 0) {
+            throw new IllegalArgumentException("maxFrameSize must not be negative");
+        }
+        _set_framing(pointer, FRAMING_LENGTH_PREFIX, prefixBytes, bigEndian, null, maxFrameSize);
+    }
+
+    /**
+     * Splits reads into frames ending with delimiter, such as "\n" or
+     * "\r\n", which is not part of the buffers passed to the read callback.
+     */
+    public void setDelimiterFraming(final byte[] delimiter, final long maxFrameSize) {
+        Objects.requireNonNull(delimiter);
+        if (delimiter.length == 0) {
+            throw new IllegalArgumentException("empty delimiter");
+        }
+        if (maxFrameSize < 0) {
+            throw new IllegalArgumentException("maxFrameSize must not be negative");
+        }
+        _set_framing(pointer, FRAMING_DELIMITER, 0, false, delimiter, maxFrameSize);
+    }
+
+    /**
+     * Goes back to unframed reads, bytes of a partial frame are passed on
+     * with the next read.
+     */
+    public void clearFraming() {
+        _set_framing(pointer, FRAMING_NONE, 0, false, null, 0);
+    }
+
     public void readStart() {
         if (!readStarted) {
             _read_start(pointer);
@@ -141,6 +227,10 @@ class StreamHandle extends Handle {
                 return write(parts.pollFirst(), encoding);
             }
             final String[] fragments = parts.toArray(new String[parts.size()]);
+            final int nativeEncoding = nativeEncoding(encoding);
+            if (nativeEncoding != ENCODING_NONE) {
+                return _write_strings(pointer, fragments, nativeEncoding, loop.getContext());
+            }
             final byte[][] buffers = new byte[fragments.length][];
             for (int i = 0; i < fragments.length; i++) {
                 if (StringUtils.hasMultiByte(fragments[i], encoding)) {
@@ -159,19 +249,36 @@ class StreamHandle extends Handle {
 
     public int write(final String str) {
         Objects.requireNonNull(str);
-        try {
-            return write(str, "utf-8");
-        } catch (final UnsupportedEncodingException e) {
-            throw new RuntimeException(e); // "utf-8" is always supported
-        }
+        return _write_string(pointer, str, ENCODING_UTF8, loop.getContext());
     }
 
+    /**
+     * UTF-8 and Latin-1 strings are encoded natively, straight into a pooled
+     * write buffer. Other encodings go through {@link String#getBytes(String)}.
+     */
     public int write(final String str, final String encoding) throws UnsupportedEncodingException {
         Objects.requireNonNull(str);
+        final int nativeEncoding = nativeEncoding(encoding);
+        if (nativeEncoding != ENCODING_NONE) {
+            return _write_string(pointer, str, nativeEncoding, loop.getContext());
+        }
         final byte[] data = str.getBytes(encoding);
         return write(ByteBuffer.wrap(data), 0, data.length);
     }
 
+    private static int nativeEncoding(final String encoding) {
+        switch (encoding.toLowerCase()) {
+            case "utf8":
+            case "utf-8":
+                return ENCODING_UTF8;
+            case "latin1":
+            case "iso-8859-1":
+                return ENCODING_LATIN1;
+            default:
+                return ENCODING_NONE;
+        }
+    }
+
     @SuppressWarnings("deprecation")
     public int writeLowerBytes(final String str) {
         Objects.requireNonNull(str);
@@ -193,6 +300,81 @@ class StreamHandle extends Handle {
         return write(buffer, 0, buffer.capacity());
     }
 
+    /**
+     * Writes all buffers with a single uv_write. Each buffer is written in
+     * full, from 0 to its capacity, like {@link #write(ByteBuffer)}. Direct
+     * buffers are handed to libuv as is; arrays that mix in heap buffers go
+     * through the byte[] path.
+     */
+    public int write(final ByteBuffer[] buffers) {
+        Objects.requireNonNull(buffers);
+        if (buffers.length == 0) {
+            return 0;
+        }
+        boolean direct = true;
+        for (final ByteBuffer buffer : buffers) {
+            Objects.requireNonNull(buffer);
+            direct &= buffer.isDirect();
+        }
+        if (direct) {
+            return _writev_direct(pointer, buffers, buffers.length, loop.getContext());
+        }
+        final byte[][] arrays = new byte[buffers.length][];
+        for (int i = 0; i < buffers.length; i++) {
+            final ByteBuffer buffer = buffers[i];
+            if (buffer.hasArray() && buffer.arrayOffset() == 0 && buffer.array().length == buffer.capacity()) {
+                arrays[i] = buffer.array();
+            } else {
+                arrays[i] = new byte[buffer.capacity()];
+                final ByteBuffer view = buffer.duplicate();
+                view.clear();
+                view.get(arrays[i]);
+            }
+        }
+        return _writev(pointer, arrays, arrays.length, loop.getContext());
+    }
+
+    /**
+     * Sends length bytes of the file fd, from offset, with non-blocking
+     * sendfile(2) from the loop whenever the socket is writable. The file
+     * goes out after every write issued before, writes issued while it is
+     * sent are held back until it is done, and the send file callback fires
+     * once with the bytes sent (fewer than length at the end of the file).
+     * Closing the stream cancels it, the callback then fires with ECANCELED
+     * just before the close callback. Only one file can be in flight, and
+     * closeWrite and write2 fail with EBUSY until it is done. If the socket
+     * cannot be polled right away this throws and the callback never fires.
+     * Not supported on Windows.
+     */
+    public int sendFile(final int fd, final long offset, final long length) {
+        if (offset < 0 || length < 0) {
+            throw new IllegalArgumentException("invalid range " + offset + "+" + length);
+        }
+        return _send_file(pointer, fd, offset, length, loop.getContext());
+    }
+
+    /**
+     * Holds back subsequent writes in a native buffer until {@link #uncork()},
+     * which sends them all with a single uv_write. The write callback still
+     * fires once per write. Pending writes are flushed early once they exceed
+     * 64KB, and before write2, closeWrite and close.
+     */
+    public void cork() {
+        _cork(pointer);
+    }
+
+    public int uncork() {
+        return _uncork(pointer);
+    }
+
+    /**
+     * When enabled, writes issued during a loop iteration are gathered as if
+     * corked and flushed by a check handle at the end of the iteration.
+     */
+    public int setAutoCork(final boolean enabled) {
+        return _set_auto_cork(pointer, enabled);
+    }
+
     public int closeWrite() {
         return _close_write(pointer, loop.getContext());
     }
@@ -224,11 +406,25 @@ class StreamHandle extends Handle {
         return _write_queue_size(pointer);
     }
 
+    /**
+     * Once the queued bytes, corked ones included, reach high, writes
+     * return {@link #WRITE_THROTTLED} until the queue falls back to low,
+     * at which point the drain callback fires once. A high mark of 0
+     * turns backpressure off.
+     */
+    public void setWaterMarks(final long high, final long low) {
+        if (high < 0 || low < 0 || (high > 0 && low > high)) {
+            throw new IllegalArgumentException("invalid water marks " + high + "/" + low);
+        }
+        _set_water_marks(pointer, high, low);
+    }
+
     protected StreamHandle(final long pointer, final LoopHandle loop) {
         super(pointer, loop);
         this.closed = false;
         this.readStarted = false;
-        _initialize(pointer);
+        this.dispatchExceptionHandler = loop.isFastDispatch() ? loop.getDispatchExceptionHandler() : null;
+        _initialize(pointer, dispatchExceptionHandler != null);
     }
 
     @Override
@@ -243,6 +439,17 @@ class StreamHandle extends Handle {
         }
     }
 
+    // called by native code instead of callRead on a fast dispatch loop
+    private void dispatchRead(final ByteBuffer data) {
+        if (onRead != null) {
+            try {
+                onRead.onRead(data);
+            } catch (final Exception ex) {
+                dispatchExceptionHandler.handle(ex);
+            }
+        }
+    }
+
     protected void callRead2(final ByteBuffer data, long handle, int type) {
         if (onRead2 != null) {
             loop.getCallbackHandler().handleStreamRead2Callback(onRead2, data, handle, type);
@@ -255,6 +462,30 @@ class StreamHandle extends Handle {
         }
     }
 
+    // called by native code instead of callWrite on a fast dispatch loop,
+    // the handler ignores the context so none is passed up
+    private void dispatchWrite(final int status, final Exception error) {
+        if (onWrite != null) {
+            try {
+                onWrite.onWrite(status, error);
+            } catch (final Exception ex) {
+                dispatchExceptionHandler.handle(ex);
+            }
+        }
+    }
+
+    protected void callDrain() {
+        if (onDrain != null) {
+            loop.getCallbackHandler().handleStreamDrainCallback(onDrain);
+        }
+    }
+
+    protected void callSendFile(final long bytesSent, final Exception error, final Object context) {
+        if (onSendFile != null) {
+            loop.getCallbackHandler(context).handleStreamSendFileCallback(onSendFile, bytesSent, error);
+        }
+    }
+
     protected void callConnect(final int status, final Exception error, final Object context) {
         if (onConnect != null) {
             loop.getCallbackHandler(context).handleStreamConnectCallback(onConnect, status, error);
@@ -267,6 +498,11 @@ class StreamHandle extends Handle {
         }
     }
 
+    // connections accepted natively, see TCPHandle.setAcceptBatch
+    protected void callConnectionBatch(final int count) {
+        assert false : "no accept batch on " + this;
+    }
+
     protected void callClose() {
         if (onClose != null) {
             loop.getCallbackHandler().handleStreamCloseCallback(onClose);
@@ -281,7 +517,7 @@ class StreamHandle extends Handle {
 
     private static native void _static_initialize();
 
-    private native void _initialize(final long ptr);
+    private native void _initialize(final long ptr, final boolean directDispatch);
 
     private native void _read_start(final long ptr);
 
@@ -300,11 +536,26 @@ class StreamHandle extends Handle {
                               final int length,
                               final Object context);
 
+    private native int _write_string(final long ptr,
+                                     final String str,
+                                     final int encoding,
+                                     final Object context);
+
+    private native int _write_strings(final long ptr,
+                                      final String[] strs,
+                                      final int encoding,
+                                      final Object context);
+
     private native int _writev(final long ptr,
                                final byte[][] buffers,
                                final int bufcount,
                                final Object context);
 
+    private native int _writev_direct(final long ptr,
+                                      final ByteBuffer[] buffers,
+                                      final int bufcount,
+                                      final Object context);
+
     private native int _write2(final long ptr,
                                final ByteBuffer buffer,
                                final byte[] data,
@@ -315,6 +566,10 @@ class StreamHandle extends Handle {
 
     private native long _write_queue_size(final long ptr);
 
+    private native void _set_water_marks(final long ptr, final long high, final long low);
+
+    private native int _send_file(final long ptr, final int fd, final long offset, final long length, final Object context);
+
     private native void _close(final long ptr);
 
     private native int _close_write(final long ptr, final Object context);
@@ -323,4 +578,14 @@ class StreamHandle extends Handle {
 
     private native int _accept(final long ptr, final long client);
 
+    private native void _set_read_pooling(final long ptr, final boolean pooled);
+
+    private native void _set_framing(final long ptr, final int mode, final int prefixBytes, final boolean bigEndian, final byte[] delimiter, final long maxFrameSize);
+
+    private native void _cork(final long ptr);
+
+    private native int _uncork(final long ptr);
+
+    private native int _set_auto_cork(final long ptr, final boolean enabled);
+
 }
@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+package com.oracle.libuv.handles;
+
+import java.io.Closeable;
+import java.util.ArrayDeque;
+import java.util.HashMap;
+import java.util.Iterator;
+import java.util.Map;
+import java.util.Objects;
+
+import com.oracle.libuv.cb.StreamConnectCallback;
+import com.oracle.libuv.cb.TimerCallback;
+
+/**
+ * Keeps idle connected TCPHandles per (address, port) for reuse by later
+ * requests to the same peer. Connections get no delay and keep alive
+ * applied once connected, are checked with {@link TCPHandle#probe()} on
+ * checkout and closed once idle for longer than the idle timeout. A
+ * checkout that finds a connection allocates nothing.
+ */
+public final class TCPConnectionPool implements Closeable {
+
+    private static final class Key {
+        private String address;
+        private int port;
+
+        private Key(final String address, final int port) {
+            this.address = address;
+            this.port = port;
+        }
+
+        @Override
+        public int hashCode() {
+            return address.hashCode() * 31 + port;
+        }
+
+        @Override
+        public boolean equals(final Object other) {
+            if (!(other instanceof Key)) {
+                return false;
+            }
+            final Key key = (Key) other;
+            return port == key.port && address.equals(key.address);
+        }
+    }
+
+    private static final class Entry {
+        private TCPHandle handle;
+        private long idleSince;
+    }
+
+    private final HandleFactory factory;
+    private final int maxIdlePerKey;
+    private final long idleTimeout;
+    private final Map<Key, ArrayDeque<Entry>> idle = new HashMap<>();
+    private final ArrayDeque<Entry> spare = new ArrayDeque<>();
+    // probes the map without allocating a key per checkout
+    private final Key probe = new Key("", 0);
+    private final TimerHandle evictor;
+    private boolean noDelay = true;
+    private boolean keepAlive = true;
+    private int keepAliveDelay = 60;
+    private boolean evicting;
+    private int idleCount;
+    private long hits;
+    private long misses;
+    private long evictions;
+    private long invalid;
+    private boolean closed;
+
+    public TCPConnectionPool(final HandleFactory factory, final int maxIdlePerKey, final long idleTimeoutMillis) {
+        Objects.requireNonNull(factory);
+        if (maxIdlePerKey <= 0) {
+            throw new IllegalArgumentException("maxIdlePerKey must be positive");
+        }
+        if (idleTimeoutMillis <= 0) {
+            throw new IllegalArgumentException("idleTimeoutMillis must be positive");
+        }
+        this.factory = factory;
+        this.maxIdlePerKey = maxIdlePerKey;
+        this.idleTimeout = idleTimeoutMillis;
+        this.evictor = factory.newTimerHandle();
+        evictor.setTimerFiredCallback(new TimerCallback() {
+            @Override
+            public void onTimer(final int status) throws Exception {
+                evict();
+            }
+        });
+        // idle connections must not keep the loop alive
+        evictor.unref();
+    }
+
+    /**
+     * Applies to connections opened from then on.
+     */
+    public void setNoDelay(final boolean enable) {
+        noDelay = enable;
+    }
+
+    /**
+     * Applies to connections opened from then on, a delay in seconds.
+     */
+    public void setKeepAlive(final boolean enable, final int delay) {
+        keepAlive = enable;
+        keepAliveDelay = delay;
+    }
+
+    /**
+     * Takes an idle connection to address and port, closing any that fail
+     * their probe on the way.
+     *
+     * @return null when none is left, open a new connection then
+     */
+    public TCPHandle checkout(final String address, final int port) {
+        Objects.requireNonNull(address);
+        if (closed) {
+            throw new IllegalStateException("connection pool closed");
+        }
+        probe.address = address;
+        probe.port = port;
+        final ArrayDeque<Entry> entries = idle.get(probe);
+        probe.address = "";
+        if (entries != null) {
+            Entry entry;
+            while ((entry = entries.pollFirst()) != null) {
+                final TCPHandle handle = entry.handle;
+                entry.handle = null;
+                spare.addFirst(entry);
+                idleCount--;
+                if (handle.probe()) {
+                    hits++;
+                    handle.ref();
+                    return handle;
+                }
+                invalid++;
+                handle.close();
+            }
+        }
+        misses++;
+        return null;
+    }
+
+    /**
+     * Opens a new connection to address, which may be a hostname, and port.
+     * No delay and keep alive are applied once it is connected, the socket
+     * does not exist before, then callback is called. Replacing the connect
+     * callback of the returned handle before that skips both.
+     */
+    public TCPHandle open(final String address, final int port, final StreamConnectCallback callback) {
+        Objects.requireNonNull(address);
+        Objects.requireNonNull(callback);
+        if (closed) {
+            throw new IllegalStateException("connection pool closed");
+        }
+        final TCPHandle handle = factory.newTCPHandle();
+        final boolean noDelay = this.noDelay;
+        final boolean keepAlive = this.keepAlive;
+        final int keepAliveDelay = this.keepAliveDelay;
+        handle.setConnectCallback(new StreamConnectCallback() {
+            @Override
+            public void onConnect(final int status, final Exception error) throws Exception {
+                handle.setConnectCallback(null);
+                if (status == 0) {
+                    handle.setNoDelay(noDelay);
+                    handle.setKeepAlive(keepAlive, keepAliveDelay);
+                }
+                callback.onConnect(status, error);
+            }
+        });
+        handle.connectHost(address, port);
+        return handle;
+    }
+
+    /**
+     * Returns a connection to address and port once its last request is
+     * done. Connections with writes still queued, half closed ones and
+     * those beyond maxIdlePerKey are closed instead. Reading stops, and the
+     * stream callbacks, corking, water marks, framing and read buffer
+     * pooling are reset, so the next checkout gets the connection as open
+     * returned it. Only no delay and keep alive carry over.
+     */
+    public void release(final TCPHandle handle, final String address, final int port) {
+        Objects.requireNonNull(handle);
+        Objects.requireNonNull(address);
+        if (closed || handle.isClosing() || !handle.isReadable() || !handle.isWritable() ||
+                handle.writeQueueSize() != 0) {
+            handle.close();
+            return;
+        }
+        probe.address = address;
+        probe.port = port;
+        ArrayDeque<Entry> entries = idle.get(probe);
+        probe.address = "";
+        if (entries == null) {
+            entries = new ArrayDeque<>(maxIdlePerKey);
+            idle.put(new Key(address, port), entries);
+        }
+        if (entries.size() >= maxIdlePerKey) {
+            handle.close();
+            return;
+        }
+        handle.readStop();
+        handle.setReadCallback(null);
+        handle.setRead2Callback(null);
+        handle.setWriteCallback(null);
+        handle.setConnectCallback(null);
+        handle.setCloseCallback(null);
+        handle.setDrainCallback(null);
+        handle.setSendFileCallback(null);
+        handle.setShutdownCallback(null);
+        // nothing is corked here, writeQueueSize counts corked bytes
+        handle.setAutoCork(false);
+        handle.uncork();
+        handle.setWaterMarks(0, 0);
+        handle.clearFraming();
+        handle.setReadBufferPooling(false);
+        handle.unref();
+        Entry entry = spare.pollFirst();
+        if (entry == null) {
+            entry = new Entry();
+        }
+        entry.handle = handle;
+        entry.idleSince = now();
+        // the most recently used connection goes out first
+        entries.addFirst(entry);
+        idleCount++;
+        if (!evicting) {
+            evicting = true;
+            final long period = Math.max(1, idleTimeout / 4);
+            evictor.start(period, period);
+        }
+    }
+
+    public int idleCount() {
+        return idleCount;
+    }
+
+    public long getHits() {
+        return hits;
+    }
+
+    public long getMisses() {
+        return misses;
+    }
+
+    /**
+     * Connections closed for being idle past the timeout.
+     */
+    public long getEvictions() {
+        return evictions;
+    }
+
+    /**
+     * Connections closed because they failed their probe on checkout.
+     */
+    public long getInvalid() {
+        return invalid;
+    }
+
+    @Override
+    public void close() {
+        if (closed) {
+            return;
+        }
+        closed = true;
+        evictor.close();
+        for (final ArrayDeque<Entry> entries : idle.values()) {
+            for (final Entry entry : entries) {
+                entry.handle.close();
+            }
+        }
+        idle.clear();
+        spare.clear();
+        idleCount = 0;
+    }
+
+    private void evict() {
+        final long expired = now() - idleTimeout;
+        final Iterator<ArrayDeque<Entry>> it = idle.values().iterator();
+        while (it.hasNext()) {
+            final ArrayDeque<Entry> entries = it.next();
+            Entry entry;
+            while ((entry = entries.peekLast()) != null && entry.idleSince <= expired) {
+                entries.pollLast();
+                entry.handle.close();
+                entry.handle = null;
+                spare.addFirst(entry);
+                idleCount--;
+                evictions++;
+            }
+            if (entries.isEmpty()) {
+                it.remove();
+            }
+        }
+        if (idleCount == 0) {
+            evicting = false;
+            evictor.stop();
+        }
+    }
+
+    private static long now() {
+        return System.nanoTime() / 1000000;
+    }
+
+}
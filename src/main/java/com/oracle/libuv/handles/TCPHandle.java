@@ -28,12 +28,18 @@ package com.oracle.libuv.handles;
 import java.util.Objects;
 
 import com.oracle.libuv.Address;
+import com.oracle.libuv.Constants;
 import com.oracle.libuv.LibUVPermission;
 import com.oracle.libuv.LibUVPermission.AddressResolver;
+import com.oracle.libuv.NativeException;
+import com.oracle.libuv.cb.ResolveCallback;
+import com.oracle.libuv.cb.StreamConnectionBatchCallback;
 
 public class TCPHandle extends StreamHandle {
 
     private int bindPort = 0;
+    private StreamConnectionBatchCallback onConnectionBatch = null;
+    private long[] accepted = null;
 
     protected TCPHandle(final LoopHandle loop) {
         super(_new(loop.pointer()), loop);
@@ -61,6 +67,26 @@ public class TCPHandle extends StreamHandle {
         return _bind6(pointer, address, port);
     }
 
+    /**
+     * Binds with SO_REUSEPORT so that listeners on several loops can share
+     * the port and have the kernel balance incoming connections between
+     * them. Throws a NativeException with ENOTSUP where the option is not
+     * available.
+     */
+    public int bindShared(final String address, final int port) {
+        Objects.requireNonNull(address);
+        bindPort = port;
+        LibUVPermission.checkBind(address, port);
+        return _bind_shared(pointer, address, port, false);
+    }
+
+    public int bindShared6(final String address, final int port) {
+        Objects.requireNonNull(address);
+        bindPort = port;
+        LibUVPermission.checkBind(address, port);
+        return _bind_shared(pointer, address, port, true);
+    }
+
     public int connect(final String address, final int port) {
         Objects.requireNonNull(address);
         LibUVPermission.checkConnect(address, port);
@@ -73,6 +99,43 @@ public class TCPHandle extends StreamHandle {
         return _connect6(pointer, address, port, loop.getContext());
     }
 
+    /**
+     * Connects to the first address hostname resolves to through the loop's
+     * {@link Resolver}, right away when it is cached. A failed lookup is
+     * reported to the connect callback, as is ECANCELED when the handle was
+     * closed before the lookup completed.
+     */
+    public int connectHost(final String hostname, final int port) {
+        Objects.requireNonNull(hostname);
+        final Object context = loop.getContext();
+        final Resolver resolver = loop.getResolver();
+        final String[] cached = resolver.lookup(hostname);
+        if (cached != null) {
+            return connectTo(cached[0], port, context);
+        }
+        resolver.resolve(hostname, new ResolveCallback() {
+            @Override
+            public void onResolve(final String[] addresses, final Exception error) throws Exception {
+                if (closed) {
+                    // the native handle is gone
+                    callConnect(-1, NativeException.of(Constants.UV_ECANCELED, "connect"), context);
+                } else if (error != null) {
+                    callConnect(-1, error, context);
+                } else {
+                    connectTo(addresses[0], port, context);
+                }
+            }
+        });
+        return 0;
+    }
+
+    private int connectTo(final String address, final int port, final Object context) {
+        LibUVPermission.checkConnect(address, port);
+        return Resolver.isIPv6(address) ?
+                _connect6(pointer, address, port, context) :
+                _connect(pointer, address, port, context);
+    }
+
     @Override
     public int listen(final int backlog) {
         LibUVPermission.checkListen(bindPort);
@@ -118,10 +181,81 @@ public class TCPHandle extends StreamHandle {
         return _keep_alive(pointer, enable ? 1 : 0, delay);
     }
 
+    /**
+     * Sets SO_BUSY_POLL on the socket, on Linux only. The socket must be
+     * open, so call it after connect, accept or bind.
+     */
+    public int setBusyPoll(final int micros) {
+        if (micros < 0) {
+            throw new IllegalArgumentException("micros must not be negative");
+        }
+        return _set_busy_poll(pointer, micros);
+    }
+
+    /**
+     * Checks without blocking that an idle connection is still usable,
+     * false once the peer closed it or sent data while nobody was reading.
+     * Always true on Windows.
+     */
+    public boolean probe() {
+        return _probe(pointer);
+    }
+
     public int setSimultaneousAccepts(final boolean enable) {
         return _simultaneous_accepts(pointer, enable ? 1 : 0);
     }
 
+    public void setConnectionBatchCallback(final StreamConnectionBatchCallback callback) {
+        onConnectionBatch = callback;
+    }
+
+    /**
+     * Accepts connections natively on this listening handle, applying the
+     * no delay and keep alive options to each, and hands them to the
+     * connection batch callback up to max at a time: when max are pending
+     * or at the end of the loop iteration. The connection callback then
+     * only reports accept errors. A max of 0 turns batching off. Connections
+     * pending when this is called are delivered later from the loop, those
+     * pending when the handle is closed are closed without a callback.
+     */
+    public void setAcceptBatch(final int max, final boolean noDelay, final boolean keepAlive, final int keepAliveDelay) {
+        if (max < 0) {
+            throw new IllegalArgumentException("negative batch size " + max);
+        }
+        // kept when batching is turned off, anything still pending is
+        // handed over in it later from the loop
+        final long[] pointers = max > 0 ? new long[max] : accepted;
+        _set_accept_batch(pointer, pointers, max, noDelay, keepAlive, keepAliveDelay);
+        accepted = pointers;
+    }
+
+    @Override
+    protected void callConnectionBatch(final int count) {
+        final long[] clients = accepted;
+        int allowed = 0;
+        for (int i = 0; i < count; i++) {
+            final long client = clients[i];
+            try {
+                LibUVPermission.checkAccept(new AddressResolver() {
+                    @Override
+                    public Address resolve() {
+                        return _peer_name(client);
+                    }
+                });
+                clients[allowed++] = client;
+            } catch (final SecurityException ex) {
+                new TCPHandle(loop, client, true).close();
+            }
+        }
+        if (onConnectionBatch != null) {
+            loop.getCallbackHandler().handleStreamConnectionBatchCallback(onConnectionBatch, allowed, clients);
+        } else {
+            for (int i = 0; i < allowed; i++) {
+                new TCPHandle(loop, clients[i], true).close();
+            }
+        }
+    }
+
     private static native long _new(final long loop);
 
     private static native long _new(final long loop, final long socket);
@@ -130,6 +264,8 @@ public class TCPHandle extends StreamHandle {
 
     private native int _bind6(final long ptr, final String address, final int port);
 
+    private native int _bind_shared(final long ptr, final String address, final int port, final boolean ipv6);
+
     private native int _connect(final long ptr, final String address, final int port, final Object context);
 
     private native int _connect6(final long ptr, final String address, final int port, final Object context);
@@ -144,6 +280,12 @@ public class TCPHandle extends StreamHandle {
 
     private native int _keep_alive(final long ptr, final int enable, final int delay);
 
+    private native int _set_busy_poll(final long ptr, final int micros);
+
+    private native boolean _probe(final long ptr);
+
     private native int _simultaneous_accepts(final long ptr, final int enable);
 
+    private native void _set_accept_batch(final long ptr, final long[] pointers, final int max, final boolean noDelay, final boolean keepAlive, final int delay);
+
 }
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+package com.oracle.libuv.handles;
+
+import com.oracle.libuv.cb.TimerWheelCallback;
+
+/**
+ * Many cheap one shot timers multiplexed on a single native timer that
+ * ticks every {@code resolution} milliseconds while any are pending.
+ * Timers carry a caller chosen long token instead of a callback object,
+ * expire on the first tick at or after their delay and are delivered
+ * together to the wheel's {@link TimerWheelCallback}.
+ */
+public final class TimerWheel extends Handle {
+
+    // tokens per upcall, more expiries in one tick take several calls
+    private static final int BATCH_SIZE = 1024;
+
+    private final long resolution;
+    private final long[] batch = new long[BATCH_SIZE];
+    private boolean closed;
+
+    private TimerWheelCallback onExpired = null;
+
+    static {
+        _static_initialize();
+    }
+
+    protected TimerWheel(final LoopHandle loop, final long resolution) {
+        super(_new(loop.pointer(), checkResolution(resolution)), loop);
+        this.resolution = resolution;
+        _initialize(pointer, batch);
+    }
+
+    public void setExpiredCallback(final TimerWheelCallback callback) {
+        onExpired = callback;
+    }
+
+    public long getResolution() {
+        return resolution;
+    }
+
+    /**
+     * Schedules {@code token} to expire after {@code delay} milliseconds.
+     *
+     * @return the id to cancel the timer with
+     */
+    public long schedule(final long delay, final long token) {
+        if (delay < 0) {
+            throw new IllegalArgumentException("delay must not be negative");
+        }
+        if (closed) {
+            throw new IllegalStateException("timer wheel closed");
+        }
+        return _schedule(pointer, delay, token);
+    }
+
+    /**
+     * @return false if the timer already expired or was cancelled
+     */
+    public boolean cancel(final long id) {
+        return !closed && _cancel(pointer, id);
+    }
+
+    /**
+     * The number of pending timers.
+     */
+    public int size() {
+        return closed ? 0 : _size(pointer);
+    }
+
+    @Override
+    public void close() {
+        if (!closed) {
+            _close(pointer);
+        }
+        closed = true;
+    }
+
+    @Override
+    protected void finalize() throws Throwable {
+        close();
+        super.finalize();
+    }
+
+    private void callExpired(final int count) {
+        if (onExpired != null) {
+            loop.getCallbackHandler().handleTimerWheelCallback(onExpired, count, batch);
+        }
+    }
+
+    private static long checkResolution(final long resolution) {
+        if (resolution <= 0) {
+            throw new IllegalArgumentException("resolution must be positive");
+        }
+        return resolution;
+    }
+
+    private static native long _new(final long loop, final long resolution);
+
+    private static native void _static_initialize();
+
+    private native void _initialize(final long ptr, final long[] batch);
+
+    private native long _schedule(final long ptr, final long delay, final long token);
+
+    private native boolean _cancel(final long ptr, final long id);
+
+    private native int _size(final long ptr);
+
+    private native void _close(final long ptr);
+
+}
@@ -32,7 +32,9 @@ import java.util.Objects;
 import com.oracle.libuv.Address;
 import com.oracle.libuv.LibUVPermission;
 import com.oracle.libuv.cb.UDPCloseCallback;
+import com.oracle.libuv.cb.UDPRecvBatchCallback;
 import com.oracle.libuv.cb.UDPRecvCallback;
+import com.oracle.libuv.cb.UDPRecvRingCallback;
 import com.oracle.libuv.cb.UDPSendCallback;
 
 public class UDPHandle extends Handle {
@@ -40,6 +42,12 @@ public class UDPHandle extends Handle {
     private boolean closed;
 
     private UDPRecvCallback onRecv = null;
+    private UDPRecvRingCallback onRecvRing = null;
+    private UDPRecvBatchCallback onRecvBatch = null;
+    private ByteBuffer recvRing = null;
+    private int[] batchOffsets = null;
+    private int[] batchLengths = null;
+    private Address[] batchAddresses = null;
     private UDPSendCallback onSend = null;
     private UDPCloseCallback onClose = null;
 
@@ -63,6 +71,14 @@ public class UDPHandle extends Handle {
         onRecv = callback;
     }
 
+    public void setRecvRingCallback(final UDPRecvRingCallback callback) {
+        onRecvRing = callback;
+    }
+
+    public void setRecvBatchCallback(final UDPRecvBatchCallback callback) {
+        onRecvBatch = callback;
+    }
+
     public void setSendCallback(final UDPSendCallback callback) {
         onSend = callback;
     }
@@ -210,10 +226,88 @@ public class UDPHandle extends Handle {
                 _send6(pointer, buffer, null, offset, length, port, host, loop.getContext());
     }
 
+    /**
+     * Sends {@code buffers[i]} to {@code hosts[i]}:{@code ports[i]} for every i
+     * with one native call. Hosts may be IPv4 or IPv6 literals. Buffers must
+     * be direct and are sent in full, from 0 to their capacity. The send
+     * callback fires once, after the last datagram of the batch. If the first
+     * datagram cannot be queued this throws and no callback fires; a failure
+     * after that is reported through the callback's status and error
+     * instead, and the datagrams after the failed one are not sent.
+     */
+    public int sendBatch(final ByteBuffer[] buffers,
+                         final int[] ports,
+                         final String[] hosts) {
+        Objects.requireNonNull(buffers);
+        Objects.requireNonNull(ports);
+        Objects.requireNonNull(hosts);
+        if (buffers.length != ports.length || buffers.length != hosts.length) {
+            throw new IllegalArgumentException("buffers, ports and hosts must have the same length");
+        }
+        if (buffers.length == 0) {
+            return 0;
+        }
+        for (int i = 0; i < buffers.length; i++) {
+            Objects.requireNonNull(hosts[i]);
+            if (!buffers[i].isDirect()) {
+                throw new IllegalArgumentException("sendBatch requires direct buffers");
+            }
+            LibUVPermission.checkUDPSend(hosts[i], ports[i]);
+        }
+        return _send_batch(pointer, buffers, ports, hosts, buffers.length, loop.getContext());
+    }
+
     public int recvStart() {
         return _recv_start(pointer);
     }
 
+    /**
+     * Starts receiving into a ring of {@code slots} preallocated slots of
+     * {@code slotSize} bytes each, delivered to the ring callback as an
+     * offset into {@link #recvRing()}. A slot is reused after {@code slots}
+     * further datagrams, so consumers that keep data longer must copy it.
+     * Datagrams larger than a slot are truncated. The ring is allocated
+     * once and kept until the handle is closed, restarting with a different
+     * geometry fails.
+     */
+    public int recvStart(final int slots, final int slotSize) {
+        if (slots <= 0 || slotSize <= 0) {
+            throw new IllegalArgumentException("slots and slotSize must be positive");
+        }
+        if ((long) slots * slotSize > Integer.MAX_VALUE) {
+            throw new IllegalArgumentException("slots * slotSize must not exceed 2^31 - 1");
+        }
+        recvRing = _recv_ring_start(pointer, slots, slotSize);
+        return recvRing != null ? 0 : -1;
+    }
+
+    /**
+     * Like {@link #recvStart(int, int)} but datagrams are handed to the batch
+     * callback up to {@code batchSize} at a time, at the latest once the
+     * current loop iteration has polled for I/O.
+     */
+    public int recvBatchStart(final int slots, final int slotSize, final int batchSize) {
+        if (slots <= 0 || slotSize <= 0 || batchSize <= 0) {
+            throw new IllegalArgumentException("slots, slotSize and batchSize must be positive");
+        }
+        if ((long) slots * slotSize > Integer.MAX_VALUE) {
+            throw new IllegalArgumentException("slots * slotSize must not exceed 2^31 - 1");
+        }
+        if (batchSize > slots) {
+            // slots of a pending batch must not be overwritten before delivery
+            throw new IllegalArgumentException("batchSize must not exceed slots");
+        }
+        batchOffsets = new int[batchSize];
+        batchLengths = new int[batchSize];
+        batchAddresses = new Address[batchSize];
+        recvRing = _recv_batch_start(pointer, slots, slotSize, batchOffsets, batchLengths, batchAddresses);
+        return recvRing != null ? 0 : -1;
+    }
+
+    public ByteBuffer recvRing() {
+        return recvRing;
+    }
+
     public int recvStop() {
         return _recv_stop(pointer);
     }
@@ -252,6 +346,18 @@ public class UDPHandle extends Handle {
         }
     }
 
+    private void callRecvRing(final int nread, final int offset, final Address address) {
+        if (onRecvRing != null) {
+            loop.getCallbackHandler().handleUDPRecvRingCallback(onRecvRing, nread, recvRing, offset, address);
+        }
+    }
+
+    private void callRecvBatch(final int count) {
+        if (onRecvBatch != null) {
+            loop.getCallbackHandler().handleUDPRecvBatchCallback(onRecvBatch, count, recvRing, batchOffsets, batchLengths, batchAddresses);
+        }
+    }
+
     private void callSend(final int status, final Exception error, final Object context) {
         if (onSend != null) {
             loop.getCallbackHandler(context).handleUDPSendCallback(onSend, status, error);
@@ -304,6 +410,22 @@ public class UDPHandle extends Handle {
 
     private native int _recv_start(final long ptr);
 
+    private native ByteBuffer _recv_ring_start(final long ptr, final int slots, final int slotSize);
+
+    private native ByteBuffer _recv_batch_start(final long ptr,
+                                                final int slots,
+                                                final int slotSize,
+                                                final int[] offsets,
+                                                final int[] lengths,
+                                                final Address[] addresses);
+
+    private native int _send_batch(final long ptr,
+                                   final ByteBuffer[] buffers,
+                                   final int[] ports,
+                                   final String[] hosts,
+                                   final int count,
+                                   final Object context);
+
     private native int _recv_stop(final long ptr);
 
     private native int _set_ttl(long ptr,
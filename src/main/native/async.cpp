@@ -31,6 +31,8 @@
 #include "uv.h"
 #include "exception.h"
 #include "stream.h"
+#include "loop.h"
+#include "ring.h"
 #include "com_oracle_libuv_handles_AsyncHandle.h"
 
 class AsyncCallbacks {
@@ -38,9 +40,14 @@ private:
   static jclass _async_handle_cid;
 
   static jmethodID _send_callback_mid;
+  static jmethodID _drain_callback_mid;
 
   JNIEnv* _env;
   jobject _instance;
+  MPSCRing* _ring;
+  jlongArray _values;
+  jintArray _offsets;
+  jintArray _lengths;
 
 public:
   static void static_initialize(JNIEnv* env, jclass cls);
@@ -51,11 +58,17 @@ public:
   void initialize(JNIEnv *env, jobject instance);
 
   void on_send(int status);
+
+  // false when out of memory
+  bool enable_queue(size_t capacity, size_t slot_size, jlongArray values, jintArray offsets, jintArray lengths);
+  inline MPSCRing* ring() { return _ring; }
+  void on_drain();
 };
 
 jclass AsyncCallbacks::_async_handle_cid = NULL;
 
 jmethodID AsyncCallbacks::_send_callback_mid = NULL;
+jmethodID AsyncCallbacks::_drain_callback_mid = NULL;
 
 void AsyncCallbacks::static_initialize(JNIEnv* env, jclass cls) {
   _async_handle_cid = (jclass) env->NewGlobalRef(cls);
@@ -63,6 +76,9 @@ void AsyncCallbacks::static_initialize(JNIEnv* env, jclass cls) {
 
   _send_callback_mid = env->GetMethodID(_async_handle_cid, "callSend", "(I)V");
   assert(_send_callback_mid);
+
+  _drain_callback_mid = env->GetMethodID(_async_handle_cid, "callDrain", "(I)V");
+  assert(_drain_callback_mid);
 }
 
 void AsyncCallbacks::initialize(JNIEnv *env, jobject instance) {
@@ -74,10 +90,36 @@ void AsyncCallbacks::initialize(JNIEnv *env, jobject instance) {
 
 AsyncCallbacks::AsyncCallbacks() {
   _env = NULL;
+  _ring = NULL;
+  _values = NULL;
+  _offsets = NULL;
+  _lengths = NULL;
 }
 
 AsyncCallbacks::~AsyncCallbacks() {
   _env->DeleteGlobalRef(_instance);
+  if (_ring) {
+    _env->DeleteGlobalRef(_values);
+    _env->DeleteGlobalRef(_offsets);
+    _env->DeleteGlobalRef(_lengths);
+    delete _ring;
+  }
+}
+
+bool AsyncCallbacks::enable_queue(size_t capacity, size_t slot_size, jlongArray values, jintArray offsets, jintArray lengths) {
+  assert(_env);
+  assert(!_ring);
+  MPSCRing* ring = new MPSCRing(capacity, slot_size);
+  if (!ring->valid()) {
+    delete ring;
+    return false;
+  }
+  assert(ring->capacity() == capacity);
+  _values = reinterpret_cast<jlongArray>(_env->NewGlobalRef(values));
+  _offsets = reinterpret_cast<jintArray>(_env->NewGlobalRef(offsets));
+  _lengths = reinterpret_cast<jintArray>(_env->NewGlobalRef(lengths));
+  _ring = ring;
+  return true;
 }
 
 void AsyncCallbacks::on_send(int status) {
@@ -88,11 +130,53 @@ void AsyncCallbacks::on_send(int status) {
       status);
 }
 
+void AsyncCallbacks::on_drain() {
+  assert(_env);
+  assert(_ring);
+  // offers from here on signal again, the whole published run goes up at once
+  _ring->clear_signal();
+  size_t count = _ring->peek(_ring->capacity());
+  if (count == 0) {
+    return;
+  }
+  jlong* values = reinterpret_cast<jlong*>(_env->GetPrimitiveArrayCritical(_values, NULL));
+  OOM(_env, values);
+  for (size_t i = 0; i < count; i++) {
+    values[i] = _ring->cell(i).value;
+  }
+  _env->ReleasePrimitiveArrayCritical(_values, values, 0);
+  if (_ring->slot_size()) {
+    jint* offsets = reinterpret_cast<jint*>(_env->GetPrimitiveArrayCritical(_offsets, NULL));
+    OOM(_env, offsets);
+    for (size_t i = 0; i < count; i++) {
+      offsets[i] = static_cast<jint>(_ring->offset(i));
+    }
+    _env->ReleasePrimitiveArrayCritical(_offsets, offsets, 0);
+    jint* lengths = reinterpret_cast<jint*>(_env->GetPrimitiveArrayCritical(_lengths, NULL));
+    OOM(_env, lengths);
+    for (size_t i = 0; i < count; i++) {
+      lengths[i] = _ring->cell(i).length;
+    }
+    _env->ReleasePrimitiveArrayCritical(_lengths, lengths, 0);
+  }
+  _env->CallVoidMethod(
+      _instance,
+      _drain_callback_mid,
+      static_cast<jint>(count));
+  // the payload slots stay untouched until the upcall returned
+  _ring->release(count);
+}
+
 static void _send_cb(uv_async_t* handle, int status) {
   assert(handle);
   assert(handle->data);
+  CallbackScope scope(handle->loop, UV_ASYNC);
   AsyncCallbacks* cb = reinterpret_cast<AsyncCallbacks*>(handle->data);
-  cb->on_send(status);
+  if (cb->ring()) {
+    cb->on_drain();
+  } else {
+    cb->on_send(status);
+  }
 }
 
 static void _close_cb(uv_handle_t* handle) {
@@ -178,3 +262,75 @@ JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_AsyncHandle__1close
   uv_handle_t* handle = reinterpret_cast<uv_handle_t*>(async);
   uv_close(handle, _close_cb);
 }
+
+/*
+ * Class:     com_oracle_libuv_handles_AsyncHandle
+ * Method:    _enable_queue
+ * Signature: (JII[J[I[I)Ljava/nio/ByteBuffer;
+ */
+JNIEXPORT jobject JNICALL Java_com_oracle_libuv_handles_AsyncHandle__1enable_1queue
+  (JNIEnv *env, jobject that, jlong async, jint capacity, jint slot_size, jlongArray values, jintArray offsets, jintArray lengths) {
+
+  assert(async);
+  assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+  assert(slot_size >= 0);
+  assert(static_cast<int64_t>(capacity) * slot_size <= 0x7fffffff);
+  uv_async_t* handle = reinterpret_cast<uv_async_t*>(async);
+  assert(handle->data);
+  AsyncCallbacks* cb = reinterpret_cast<AsyncCallbacks*>(handle->data);
+  if (!cb->enable_queue(static_cast<size_t>(capacity), static_cast<size_t>(slot_size), values, offsets, lengths)) {
+    ThrowOutOfMemoryError(env, FUNCTION_NAME, __FILE__, TOSTRING(__LINE__), "ring");
+    return NULL;
+  }
+  if (slot_size == 0) {
+    return NULL;
+  }
+  MPSCRing* ring = cb->ring();
+  jobject payload = env->NewDirectByteBuffer(ring->payload(), static_cast<jlong>(ring->capacity() * ring->slot_size()));
+  OOMN(env, payload);
+  return payload;
+}
+
+static jboolean _offer(uv_async_t* handle, jlong value, const char* data, size_t length) {
+  assert(handle->data);
+  MPSCRing* ring = reinterpret_cast<AsyncCallbacks*>(handle->data)->ring();
+  assert(ring);
+  if (!ring->offer(value, data, length)) {
+    return JNI_FALSE;
+  }
+  // only the offer that finds the loop idle pays for the wakeup
+  if (ring->signal()) {
+    uv_async_send(handle);
+  }
+  return JNI_TRUE;
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_AsyncHandle
+ * Method:    _offer
+ * Signature: (JJ)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_oracle_libuv_handles_AsyncHandle__1offer
+  (JNIEnv *env, jobject that, jlong async, jlong value) {
+
+  assert(async);
+  return _offer(reinterpret_cast<uv_async_t*>(async), value, NULL, 0);
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_AsyncHandle
+ * Method:    _offer_buffer
+ * Signature: (JJLjava/nio/ByteBuffer;II)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_oracle_libuv_handles_AsyncHandle__1offer_1buffer
+  (JNIEnv *env, jobject that, jlong async, jlong value, jobject buffer, jint offset, jint length) {
+
+  assert(async);
+  assert(buffer);
+  const char* base = reinterpret_cast<const char*>(env->GetDirectBufferAddress(buffer));
+  if (!base) {
+    ThrowException(env, UV_EINVAL, "offer", "buffer is not direct");
+    return JNI_FALSE;
+  }
+  return _offer(reinterpret_cast<uv_async_t*>(async), value, base + offset, static_cast<size_t>(length));
+}
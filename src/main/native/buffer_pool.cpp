@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "buffer_pool.h"
+
+BufferPool::BufferPool(size_t chunk_size, size_t chunks_per_slab) {
+  assert(chunk_size > 0);
+  assert(chunks_per_slab > 0);
+  _chunk_size = chunk_size;
+  _chunks_per_slab = chunks_per_slab;
+  _in_use = 0;
+  _packing = NULL;
+  _packed = 0;
+}
+
+BufferPool::~BufferPool() {
+  for (size_t i = 0; i < _slabs.size(); i++) {
+    delete[] _slabs[i].base;
+  }
+  for (std::set<char*>::iterator it = _large.begin(); it != _large.end(); ++it) {
+    delete[] *it;
+  }
+}
+
+void BufferPool::grow() {
+  Slab slab;
+  slab.base = new char[_chunk_size * _chunks_per_slab];
+  slab.used.assign(_chunks_per_slab, false);
+  slab.slices.assign(_chunks_per_slab, 0);
+  _slabs.push_back(slab);
+  // push in reverse so that chunks are handed out in address order
+  for (size_t i = _chunks_per_slab; i > 0; i--) {
+    _free.push_back(slab.base + (i - 1) * _chunk_size);
+  }
+}
+
+BufferPool::Slab* BufferPool::slab_of(const char* base) {
+  for (size_t i = 0; i < _slabs.size(); i++) {
+    const char* start = _slabs[i].base;
+    if (base >= start && base < start + _chunk_size * _chunks_per_slab) {
+      return &_slabs[i];
+    }
+  }
+  return NULL;
+}
+
+char* BufferPool::allocate() {
+  if (_free.empty()) {
+    grow();
+  }
+  char* base = _free.back();
+  _free.pop_back();
+  Slab* slab = slab_of(base);
+  assert(slab);
+  slab->used[(base - slab->base) / _chunk_size] = true;
+  _in_use++;
+  return base;
+}
+
+char* BufferPool::allocate_slice(size_t length) {
+  assert(length <= _chunk_size);
+  // keep slices 8 byte aligned, and never let one start at the end of
+  // its chunk where it would be taken for the next chunk
+  size_t start = (_packed + 7) & ~static_cast<size_t>(7);
+  if (!_packing || start >= _chunk_size || start + length > _chunk_size) {
+    char* previous = _packing;
+    _packing = allocate();
+    start = 0;
+    if (previous) {
+      Slab* slab = slab_of(previous);
+      size_t index = static_cast<size_t>(previous - slab->base) / _chunk_size;
+      if (!slab->slices[index]) {
+        free_chunk(slab, index);
+      }
+    }
+  }
+  Slab* slab = slab_of(_packing);
+  slab->slices[static_cast<size_t>(_packing - slab->base) / _chunk_size]++;
+  // an empty slice still takes a byte, so the next one can not share its address
+  _packed = start + (length ? length : 1);
+  _live_slices.insert(_packing + start);
+  return _packing + start;
+}
+
+char* BufferPool::allocate_large(size_t length) {
+  char* base = new char[length ? length : 1];
+  _large.insert(base);
+  return base;
+}
+
+void BufferPool::free_chunk(Slab* slab, size_t index) {
+  slab->used[index] = false;
+  _free.push_back(slab->base + index * _chunk_size);
+  assert(_in_use > 0);
+  _in_use--;
+}
+
+bool BufferPool::release(char* base) {
+  Slab* slab = slab_of(base);
+  if (!slab) {
+    std::set<char*>::iterator it = _large.find(base);
+    if (it == _large.end()) {
+      return false;
+    }
+    _large.erase(it);
+    delete[] base;
+    return true;
+  }
+  size_t offset = static_cast<size_t>(base - slab->base);
+  size_t index = offset / _chunk_size;
+  if (slab->slices[index]) {
+    std::set<char*>::iterator it = _live_slices.find(base);
+    if (it == _live_slices.end()) {
+      return false;
+    }
+    _live_slices.erase(it);
+    if (--slab->slices[index]) {
+      return true;
+    }
+    if (slab->base + index * _chunk_size == _packing) {
+      // still open for slices, start over at its beginning
+      _packed = 0;
+    } else {
+      free_chunk(slab, index);
+    }
+    return true;
+  }
+  if (offset % _chunk_size != 0 || !slab->used[index]) {
+    return false;
+  }
+  if (slab->base + offset == _packing) {
+    // the open chunk without a live slice is only the pool's to free
+    return false;
+  }
+  free_chunk(slab, index);
+  return true;
+}
+
+bool BufferPool::owns(const char* base) {
+  Slab* slab = slab_of(base);
+  return slab && static_cast<size_t>(base - slab->base) % _chunk_size == 0;
+}
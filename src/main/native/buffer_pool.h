@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+#ifndef _libuv_java_buffer_pool_h_
+#define _libuv_java_buffer_pool_h_
+
+#include <stddef.h>
+#include <set>
+#include <vector>
+
+// A pool of fixed size chunks carved out of larger slabs.
+// Chunks are handed out by allocate(), slices of a shared chunk by
+// allocate_slice() and buffers larger than a chunk by allocate_large();
+// all of them must be returned with release().
+// Not thread safe, a pool belongs to exactly one loop.
+class BufferPool {
+private:
+  struct Slab {
+    char* base;
+    std::vector<bool> used;
+    std::vector<size_t> slices;   // live slices per chunk, 0 for whole chunks
+  };
+
+  size_t _chunk_size;
+  size_t _chunks_per_slab;
+  size_t _in_use;
+  std::vector<Slab> _slabs;
+  std::vector<char*> _free;
+  char* _packing;                 // chunk slices are currently carved from
+  size_t _packed;
+  std::set<char*> _live_slices;
+  std::set<char*> _large;
+
+  Slab* slab_of(const char* base);
+  void grow();
+  void free_chunk(Slab* slab, size_t index);
+
+public:
+  static const size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+  static const size_t DEFAULT_CHUNKS_PER_SLAB = 16;
+
+  BufferPool(size_t chunk_size, size_t chunks_per_slab);
+  ~BufferPool();
+
+  inline size_t chunk_size() const { return _chunk_size; }
+  inline size_t in_use() const { return _in_use; }
+  inline size_t capacity() const { return _slabs.size() * _chunks_per_slab; }
+
+  char* allocate();
+  // packs length bytes, at most a chunk, into the chunk of the previous
+  // slices while they fit. The chunk is freed once its last slice is.
+  // Every slice starts at its own address, empty ones included.
+  char* allocate_slice(size_t length);
+  char* allocate_large(size_t length);
+  // returns false if base is neither a chunk, a live slice nor a large
+  // buffer of this pool, or if it has already been released. Addresses
+  // inside a chunk or a slice are rejected.
+  bool release(char* base);
+  bool owns(const char* base);
+};
+
+#endif // _libuv_java_buffer_pool_h_
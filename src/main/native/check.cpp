@@ -31,6 +31,7 @@
 #include "uv.h"
 #include "exception.h"
 #include "stream.h"
+#include "loop.h"
 #include "com_oracle_libuv_handles_CheckHandle.h"
 
 class CheckCallbacks {
@@ -107,6 +108,7 @@ void CheckCallbacks::on_close() {
 static void _check_cb(uv_check_t* handle, int status) {
   assert(handle);
   assert(handle->data);
+  CallbackScope scope(handle->loop, UV_CHECK);
   CheckCallbacks* cb = reinterpret_cast<CheckCallbacks*>(handle->data);
   cb->on_check(status);
 }
@@ -114,6 +116,7 @@ static void _check_cb(uv_check_t* handle, int status) {
 static void _close_cb(uv_handle_t* handle) {
   assert(handle);
   assert(handle->data);
+  CallbackScope scope(handle->loop, handle->type);
   CheckCallbacks* cb = reinterpret_cast<CheckCallbacks*>(handle->data);
   cb->on_close();
   delete cb;
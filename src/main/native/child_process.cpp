@@ -25,10 +25,14 @@
 
 #include <string.h>
 #include <assert.h>
+#include <string>
+#include <vector>
 
 #include "uv.h"
 #include "exception.h"
+#include "loop.h"
 #include "com_oracle_libuv_handles_ProcessHandle.h"
+#include "com_oracle_libuv_handles_SpawnTemplate.h"
 
 class ProcessCallbacks {
 private:
@@ -122,6 +126,7 @@ void ProcessCallbacks::on_close() {
 static void _close_cb(uv_handle_t* handle) {
   assert(handle);
   assert(handle->data);
+  CallbackScope scope(handle->loop, handle->type);
   ProcessCallbacks* cb = reinterpret_cast<ProcessCallbacks*>(handle->data);
   cb->on_close();
   delete cb;
@@ -130,6 +135,7 @@ static void _close_cb(uv_handle_t* handle) {
 
 static void _exit_cb(uv_process_t* process, int exit_status, int term_signal) {
   assert(process);
+  CallbackScope scope(process->loop, UV_PROCESS);
   uv_process_t* handle = reinterpret_cast<uv_process_t*>(process);
   assert(handle->data);
   ProcessCallbacks* cb = reinterpret_cast<ProcessCallbacks*>(handle->data);
@@ -354,3 +360,220 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_ProcessHandle__1kill
   }
   return r;
 }
+
+// The parts of uv_process_options_t that stay the same from one spawn to
+// the next, marshalled from java once. A spawn copies the argv pointers,
+// appends its own arguments and patches in its stdio streams.
+class SpawnTemplate {
+public:
+  std::string file;
+  std::string cwd;
+  bool has_cwd;
+  bool has_env;
+  std::vector<std::string> args;
+  std::vector<std::string> env;
+  std::vector<char*> args_ptrs;
+  std::vector<char*> env_ptrs;
+  std::vector<uv_stdio_container_t> stdio;
+  unsigned int flags;
+  uv_uid_t uid;
+  uv_gid_t gid;
+
+  SpawnTemplate() : has_cwd(false), has_env(false), flags(0), uid(0), gid(0) {}
+
+  // the strings must not change once the pointers are taken
+  void pin() {
+    args_ptrs.clear();
+    for (size_t i = 0; i < args.size(); i++) {
+      args_ptrs.push_back(const_cast<char*>(args[i].c_str()));
+    }
+    // without an environment the child inherits the one of the parent
+    env_ptrs.clear();
+    if (has_env) {
+      for (size_t i = 0; i < env.size(); i++) {
+        env_ptrs.push_back(const_cast<char*>(env[i].c_str()));
+      }
+      env_ptrs.push_back(NULL);
+    }
+  }
+};
+
+static bool _utf_strings(JNIEnv* env, jobjectArray array, std::vector<std::string>* out) {
+  jsize length = env->GetArrayLength(array);
+  out->reserve(length);
+  for (jsize i = 0; i < length; i++) {
+    jstring element = (jstring) env->GetObjectArrayElement(array, i);
+    // null elements are rejected by SpawnTemplate
+    assert(element);
+    const char* chars = env->GetStringUTFChars(element, 0);
+    if (!chars) {
+      env->DeleteLocalRef(element);
+      return false;
+    }
+    out->push_back(chars);
+    env->ReleaseStringUTFChars(element, chars);
+    env->DeleteLocalRef(element);
+  }
+  return true;
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_SpawnTemplate
+ * Method:    _new
+ * Signature: (Ljava/lang/String;[Ljava/lang/String;[Ljava/lang/String;Ljava/lang/String;I[I[J[III)J
+ */
+JNIEXPORT jlong JNICALL Java_com_oracle_libuv_handles_SpawnTemplate__1new
+  (JNIEnv *env, jclass cls, jstring program, jobjectArray args, jobjectArray environ,
+    jstring dir, jint process_flags, jintArray stdio_flags, jlongArray streams, jintArray fds, jint uid, jint gid) {
+
+  assert(program);
+  assert(args);
+  assert(stdio_flags);
+  SpawnTemplate* t = new SpawnTemplate();
+  t->flags = process_flags & (UV_PROCESS_WINDOWS_VERBATIM_ARGUMENTS | UV_PROCESS_DETACHED);
+
+  if (uid != -1) {
+    if (uid & ~((uv_uid_t) ~0)) {
+      delete t;
+      ThrowException(env, UV_EINVAL, "uv_spawn", "uid is out of range");
+      return 0;
+    }
+    t->flags |= UV_PROCESS_SETUID;
+    t->uid = (uv_uid_t) uid;
+  }
+  if (gid != -1) {
+    if (gid & ~((uv_gid_t) ~0)) {
+      delete t;
+      ThrowException(env, UV_EINVAL, "uv_spawn", "gid is out of range");
+      return 0;
+    }
+    t->flags |= UV_PROCESS_SETGID;
+    t->gid = (uv_gid_t) gid;
+  }
+
+  const char* program_chars = env->GetStringUTFChars(program, 0);
+  if (!program_chars) {
+    delete t;
+    return 0;
+  }
+  t->file = program_chars;
+  env->ReleaseStringUTFChars(program, program_chars);
+  if (dir) {
+    const char* dir_chars = env->GetStringUTFChars(dir, 0);
+    if (!dir_chars) {
+      delete t;
+      return 0;
+    }
+    t->cwd = dir_chars;
+    t->has_cwd = true;
+    env->ReleaseStringUTFChars(dir, dir_chars);
+  }
+  if (!_utf_strings(env, args, &t->args) || (environ && !_utf_strings(env, environ, &t->env))) {
+    delete t;
+    return 0;
+  }
+  t->has_env = environ != NULL;
+  t->pin();
+
+  jsize stdio_len = env->GetArrayLength(stdio_flags);
+  t->stdio.resize(stdio_len);
+  jint* flag = env->GetIntArrayElements(stdio_flags, 0);
+  jlong* stream = streams ? env->GetLongArrayElements(streams, 0) : NULL;
+  jint* fd = fds ? env->GetIntArrayElements(fds, 0) : NULL;
+  for (jsize i = 0; i < stdio_len; i++) {
+    uv_stdio_container_t* c = &t->stdio[i];
+    if (flag[i] == UV_IGNORE) {
+      c->flags = UV_IGNORE;
+    } else if (flag[i] == UV_CREATE_PIPE) {
+      c->flags = static_cast<uv_stdio_flags>(UV_CREATE_PIPE | UV_READABLE_PIPE | UV_WRITABLE_PIPE);
+      c->data.stream = stream ? reinterpret_cast<uv_stream_t*>(stream[i]) : NULL;
+    } else if (flag[i] == UV_INHERIT_STREAM) {
+      c->flags = UV_INHERIT_STREAM;
+      c->data.stream = stream ? reinterpret_cast<uv_stream_t*>(stream[i]) : NULL;
+    } else {
+      c->flags = UV_INHERIT_FD;
+      c->data.fd = fd ? fd[i] : -1;
+    }
+  }
+  env->ReleaseIntArrayElements(stdio_flags, flag, JNI_ABORT);
+  if (stream) {
+    env->ReleaseLongArrayElements(streams, stream, JNI_ABORT);
+  }
+  if (fd) {
+    env->ReleaseIntArrayElements(fds, fd, JNI_ABORT);
+  }
+  return reinterpret_cast<jlong>(t);
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_SpawnTemplate
+ * Method:    _delete
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_SpawnTemplate__1delete
+  (JNIEnv *env, jclass cls, jlong ptr) {
+
+  assert(ptr);
+  delete reinterpret_cast<SpawnTemplate*>(ptr);
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_ProcessHandle
+ * Method:    _spawn_template
+ * Signature: (JJ[Ljava/lang/String;[J)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_ProcessHandle__1spawn_1template
+  (JNIEnv *env, jobject that, jlong process, jlong template_ptr, jobjectArray extra_args, jlongArray streams) {
+
+  assert(process);
+  assert(template_ptr);
+  uv_process_t* handle = reinterpret_cast<uv_process_t*>(process);
+  assert(handle->loop);
+  const SpawnTemplate* t = reinterpret_cast<SpawnTemplate*>(template_ptr);
+
+  // only the per spawn arguments are marshalled
+  std::vector<std::string> extra;
+  if (extra_args && !_utf_strings(env, extra_args, &extra)) {
+    return -1;
+  }
+  std::vector<char*> args(t->args_ptrs);
+  for (size_t i = 0; i < extra.size(); i++) {
+    args.push_back(const_cast<char*>(extra[i].c_str()));
+  }
+  args.push_back(NULL);
+
+  std::vector<uv_stdio_container_t> stdio(t->stdio);
+  if (streams) {
+    jsize count = env->GetArrayLength(streams);
+    assert(count <= static_cast<jsize>(stdio.size()));
+    jlong* stream = env->GetLongArrayElements(streams, 0);
+    OOME(env, stream);
+    for (jsize i = 0; i < count; i++) {
+      if (stream[i]) {
+        stdio[i].data.stream = reinterpret_cast<uv_stream_t*>(stream[i]);
+      }
+    }
+    env->ReleaseLongArrayElements(streams, stream, JNI_ABORT);
+  }
+
+  uv_process_options_t options;
+  memset(&options, 0, sizeof(uv_process_options_t));
+  options.exit_cb = _exit_cb;
+  options.file = t->file.c_str();
+  options.args = &args[0];
+  options.env = t->env_ptrs.empty() ? NULL : const_cast<char**>(&t->env_ptrs[0]);
+  options.cwd = t->has_cwd ? const_cast<char*>(t->cwd.c_str()) : NULL;
+  options.flags = t->flags;
+  options.uid = t->uid;
+  options.gid = t->gid;
+  options.stdio_count = static_cast<int>(stdio.size());
+  options.stdio = stdio.empty() ? NULL : &stdio[0];
+
+  int r = uv_spawn(handle->loop, handle, options);
+  if (r) {
+    ThrowException(env, handle->loop, "uv_spawn", options.file);
+  } else {
+    r = handle->pid;
+  }
+  return r;
+}
@@ -28,6 +28,7 @@
 #include <fcntl.h>
 #include <signal.h>
 
+#include "uv.h"
 #include "com_oracle_libuv_Constants.h"
 
 #ifdef _WIN32
@@ -213,6 +214,7 @@ JNIEXPORT void JNICALL Java_com_oracle_libuv_Constants__1get_1field_1values
 #else
   values[66] = SIGUNUSED;
 #endif
+  values[67] = UV_ECANCELED;
 
   env->ReleaseIntArrayElements(array, values, 0);
 }
@@ -28,6 +28,23 @@
 #include <jni.h>
 
 #include "context.h"
+#include "loop.h"
+
+void* ContextHolder::operator new(size_t size) throw() {
+  return FreeList::allocate(NULL, size);
+}
+
+void* ContextHolder::operator new(size_t size, uv_loop_t* loop) throw() {
+  return LoopData::get(loop)->freelist(LoopData::CONTEXT_HOLDER)->allocate(size);
+}
+
+void ContextHolder::operator delete(void* ptr) {
+  FreeList::release(ptr);
+}
+
+void ContextHolder::operator delete(void* ptr, uv_loop_t* loop) {
+  FreeList::release(ptr);
+}
 
 ContextHolder::ContextHolder(JNIEnv* env, jobject data, jobject context) {
   _data = data ? (jobject) env->NewGlobalRef(data) : NULL;
@@ -80,11 +97,11 @@ ContextHolder::~ContextHolder() {
   }
   if (_buffers && _elements && _bases && _element_count > 0) {
     for (int i=0; i < _element_count; i++) {
-      _env->DeleteGlobalRef(_buffers);
       _env->ReleaseByteArrayElements((jbyteArray) _elements[i], (jbyte*) _bases[i], JNI_ABORT);
       _env->DeleteGlobalRef(_elements[i]);
     }
-    delete _bases;
-    delete _elements;
+    _env->DeleteGlobalRef(_buffers);
+    delete[] _bases;
+    delete[] _elements;
   }
 }
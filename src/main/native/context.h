@@ -41,6 +41,12 @@ class ContextHolder {
     JNIEnv* _env;
 
   public:
+    // allocated from the loop freelist when constructed with new (loop)
+    static void* operator new(size_t size) throw();
+    static void* operator new(size_t size, uv_loop_t* loop) throw();
+    static void operator delete(void* ptr);
+    static void operator delete(void* ptr, uv_loop_t* loop);
+
     inline jobject context() { return _context; }
     inline jobject data() { return _data; }
     ContextHolder(JNIEnv* env, jobject data, jobject context);
@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+#include <assert.h>
+#include <string.h>
+#include <vector>
+
+#include <jni.h>
+
+#include "uv.h"
+#include "exception.h"
+#include "loop.h"
+#include "com_oracle_libuv_handles_Resolver.h"
+
+// A name lookup run by uv_getaddrinfo on the thread pool. The hostname
+// string java passed in is handed back with the numeric addresses so the
+// Resolver can find the callers waiting on it.
+class ResolveRequest {
+private:
+  static jclass _resolver_cid;
+  static jclass _string_cid;
+  static jmethodID _call_resolved_mid;
+
+  JNIEnv* _env;
+  jobject _instance;
+  jstring _hostname;
+
+public:
+  uv_getaddrinfo_t req;
+
+  static void static_initialize(JNIEnv* env, jclass cls);
+
+  ResolveRequest(JNIEnv* env, jobject instance, jstring hostname);
+  ~ResolveRequest();
+
+  void on_resolved(int status, const struct addrinfo* res);
+};
+
+jclass ResolveRequest::_resolver_cid = NULL;
+jclass ResolveRequest::_string_cid = NULL;
+jmethodID ResolveRequest::_call_resolved_mid = NULL;
+
+void ResolveRequest::static_initialize(JNIEnv* env, jclass cls) {
+  _resolver_cid = (jclass) env->NewGlobalRef(cls);
+  assert(_resolver_cid);
+
+  _string_cid = env->FindClass("java/lang/String");
+  assert(_string_cid);
+  _string_cid = (jclass) env->NewGlobalRef(_string_cid);
+  assert(_string_cid);
+
+  _call_resolved_mid = env->GetMethodID(_resolver_cid, "callResolved", "(Ljava/lang/String;[Ljava/lang/String;Ljava/lang/Exception;)V");
+  assert(_call_resolved_mid);
+}
+
+ResolveRequest::ResolveRequest(JNIEnv* env, jobject instance, jstring hostname) {
+  _env = env;
+  _instance = env->NewGlobalRef(instance);
+  _hostname = (jstring) env->NewGlobalRef(hostname);
+  req.data = this;
+}
+
+ResolveRequest::~ResolveRequest() {
+  _env->DeleteGlobalRef(_hostname);
+  _env->DeleteGlobalRef(_instance);
+}
+
+void ResolveRequest::on_resolved(int status, const struct addrinfo* res) {
+  jobjectArray addresses = NULL;
+  jthrowable error = NULL;
+  if (status < 0) {
+    error = NewException(_env, uv_last_error(req.loop).code, "getaddrinfo", NULL, NULL);
+  } else {
+    // one entry per address, hints limit the results to one socket type
+    std::vector<const struct addrinfo*> found;
+    for (const struct addrinfo* ai = res; ai; ai = ai->ai_next) {
+      if (ai->ai_family == AF_INET || ai->ai_family == AF_INET6) {
+        found.push_back(ai);
+      }
+    }
+    addresses = _env->NewObjectArray(static_cast<jsize>(found.size()), _string_cid, NULL);
+    OOM(_env, addresses);
+    for (size_t i = 0; i < found.size(); i++) {
+      char ip[INET6_ADDRSTRLEN];
+      if (found[i]->ai_family == AF_INET) {
+        uv_ip4_name(reinterpret_cast<struct sockaddr_in*>(found[i]->ai_addr), ip, sizeof(ip));
+      } else {
+        uv_ip6_name(reinterpret_cast<struct sockaddr_in6*>(found[i]->ai_addr), ip, sizeof(ip));
+      }
+      jstring address = _env->NewStringUTF(ip);
+      OOM(_env, address);
+      _env->SetObjectArrayElement(addresses, static_cast<jsize>(i), address);
+      _env->DeleteLocalRef(address);
+    }
+  }
+  _env->CallVoidMethod(
+      _instance,
+      _call_resolved_mid,
+      _hostname,
+      addresses,
+      error);
+  if (addresses) {
+    _env->DeleteLocalRef(addresses);
+  }
+  if (error) {
+    _env->DeleteLocalRef(error);
+  }
+}
+
+static void _getaddrinfo_cb(uv_getaddrinfo_t* req, int status, struct addrinfo* res) {
+  assert(req->data);
+  // lookups have no handle type of their own
+  CallbackScope scope(req->loop, UV_UNKNOWN_HANDLE);
+  ResolveRequest* request = reinterpret_cast<ResolveRequest*>(req->data);
+  request->on_resolved(status, res);
+  if (res) {
+    uv_freeaddrinfo(res);
+  }
+  delete request;
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_Resolver
+ * Method:    _static_initialize
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_Resolver__1static_1initialize
+  (JNIEnv *env, jclass cls) {
+
+  ResolveRequest::static_initialize(env, cls);
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_Resolver
+ * Method:    _resolve
+ * Signature: (JLjava/lang/String;)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_Resolver__1resolve
+  (JNIEnv *env, jobject that, jlong loop_ptr, jstring hostname) {
+
+  assert(loop_ptr);
+  assert(hostname);
+  uv_loop_t* loop = reinterpret_cast<uv_loop_t*>(loop_ptr);
+  const char* node = env->GetStringUTFChars(hostname, 0);
+  OOME(env, node);
+
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+
+  ResolveRequest* request = new ResolveRequest(env, that, hostname);
+  int r = uv_getaddrinfo(loop, &request->req, _getaddrinfo_cb, node, NULL, &hints);
+  env->ReleaseStringUTFChars(hostname, node);
+  if (r) {
+    delete request;
+    ThrowException(env, loop, "uv_getaddrinfo");
+  }
+  return r;
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "encoding.h"
+
+// four chars are checked at a time, a high bit in any of them ends the
+// ascii (or latin1) run
+static const uint64_t ASCII_MASK = 0xff80ff80ff80ff80ULL;
+static const uint64_t LATIN1_MASK = 0xff00ff00ff00ff00ULL;
+
+static inline bool _is_high_surrogate(jchar c) {
+  return c >= 0xd800 && c <= 0xdbff;
+}
+
+static inline bool _is_low_surrogate(jchar c) {
+  return c >= 0xdc00 && c <= 0xdfff;
+}
+
+// length of the leading run of chars with none of the mask bits set
+static size_t _run_length(const jchar* chars, size_t length, uint64_t mask) {
+  size_t i = 0;
+  for (; i + 4 <= length; i += 4) {
+    uint64_t word;
+    memcpy(&word, chars + i, sizeof(word));
+    if (word & mask) {
+      break;
+    }
+  }
+  const jchar limit = static_cast<jchar>(~mask & 0xffff);
+  while (i < length && chars[i] <= limit) {
+    i++;
+  }
+  return i;
+}
+
+static inline void _narrow(const jchar* chars, size_t length, char* out) {
+  for (size_t i = 0; i < length; i++) {
+    out[i] = static_cast<char>(chars[i]);
+  }
+}
+
+size_t encoded_length(const jchar* chars, size_t length, StringEncoding encoding) {
+  if (encoding == ENCODING_LATIN1) {
+    // a surrogate pair is one code point and becomes a single '?'
+    size_t size = 0;
+    for (size_t i = _run_length(chars, length, LATIN1_MASK); i < length; i++) {
+      if (_is_high_surrogate(chars[i]) && i + 1 < length && _is_low_surrogate(chars[i + 1])) {
+        size++;
+      }
+    }
+    return length - size;
+  }
+  assert(encoding == ENCODING_UTF8);
+  size_t i = _run_length(chars, length, ASCII_MASK);
+  size_t size = i;
+  while (i < length) {
+    jchar c = chars[i++];
+    if (c < 0x80) {
+      size += 1;
+    } else if (c < 0x800) {
+      size += 2;
+    } else if (_is_high_surrogate(c) && i < length && _is_low_surrogate(chars[i])) {
+      size += 4;
+      i++;
+    } else if (_is_high_surrogate(c) || _is_low_surrogate(c)) {
+      size += 1;
+    } else {
+      size += 3;
+    }
+  }
+  return size;
+}
+
+size_t encode_chars(const jchar* chars, size_t length, StringEncoding encoding, char* out) {
+  if (encoding == ENCODING_LATIN1) {
+    size_t i = 0;
+    char* p = out;
+    while (i < length) {
+      size_t run = _run_length(chars + i, length - i, LATIN1_MASK);
+      _narrow(chars + i, run, p);
+      i += run;
+      p += run;
+      if (i < length) {
+        if (_is_high_surrogate(chars[i]) && i + 1 < length && _is_low_surrogate(chars[i + 1])) {
+          i++;
+        }
+        i++;
+        *p++ = '?';
+      }
+    }
+    return static_cast<size_t>(p - out);
+  }
+
+  assert(encoding == ENCODING_UTF8);
+  size_t i = 0;
+  char* p = out;
+  while (i < length) {
+    size_t run = _run_length(chars + i, length - i, ASCII_MASK);
+    _narrow(chars + i, run, p);
+    i += run;
+    p += run;
+    // multi byte chars until the next ascii char
+    while (i < length && chars[i] >= 0x80) {
+      jchar c = chars[i++];
+      if (c < 0x800) {
+        *p++ = static_cast<char>(0xc0 | (c >> 6));
+        *p++ = static_cast<char>(0x80 | (c & 0x3f));
+      } else if (_is_high_surrogate(c) && i < length && _is_low_surrogate(chars[i])) {
+        uint32_t cp = 0x10000 + ((static_cast<uint32_t>(c) - 0xd800) << 10) + (chars[i++] - 0xdc00);
+        *p++ = static_cast<char>(0xf0 | (cp >> 18));
+        *p++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+        *p++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+        *p++ = static_cast<char>(0x80 | (cp & 0x3f));
+      } else if (_is_high_surrogate(c) || _is_low_surrogate(c)) {
+        *p++ = '?';
+      } else {
+        *p++ = static_cast<char>(0xe0 | (c >> 12));
+        *p++ = static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+        *p++ = static_cast<char>(0x80 | (c & 0x3f));
+      }
+    }
+  }
+  return static_cast<size_t>(p - out);
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+#ifndef _libuv_java_encoding_h_
+#define _libuv_java_encoding_h_
+
+#include <jni.h>
+#include <stddef.h>
+
+// must be equal to the ENCODING_* constants in StreamHandle.java
+enum StringEncoding {
+  ENCODING_UTF8 = 0,
+  ENCODING_LATIN1 = 1
+};
+
+// Encoding of java UTF-16 chars without going through a byte[].
+// Unpaired surrogates, and chars above 0xff in latin1, become '?' like
+// String.getBytes does.
+
+size_t encoded_length(const jchar* chars, size_t length, StringEncoding encoding);
+
+// out must hold encoded_length bytes, returns the number written
+size_t encode_chars(const jchar* chars, size_t length, StringEncoding encoding, char* out);
+
+#endif // _libuv_java_encoding_h_
@@ -31,6 +31,8 @@
 #include <string>
 
 #include "uv.h"
+#include "exception.h"
+#include "ring.h"
 #include "com_oracle_libuv_NativeException.h"
 
 const char* get_uv_errno_string(int errorno) {
@@ -47,79 +49,67 @@ const char* get_uv_errno_message(int errorno) {
   return uv_strerror(err);
 }
 
-static inline jstring utf(JNIEnv* env, const std::string& s) {
-    return env->NewStringUTF(s.data());
-}
-
-jthrowable NewException(JNIEnv* env, int errorno, const char *syscall, const char *msg, const char *path) {
-  assert(env);
+// not part of the public libuv api, but compiled into this library with it
+extern "C" uv_err_code uv_translate_sys_error(int sys_errno);
 
-  jobject syscall_arg = syscall ? env->NewStringUTF(syscall) : NULL;
+uv_err_code sys_error_code(int sys_errno) {
+  return uv_translate_sys_error(sys_errno);
+}
 
-  std::string errno_message = get_uv_errno_message(errorno);
-  if (!msg || !msg[0]) {
-    msg = errno_message.data();
-  }
+static jclass _native_exception_cid = NULL;
+static jmethodID _native_exception_init_mid = NULL;
 
-  std::string errno_string = get_uv_errno_string(errorno);
-  std::string message = msg;
-  std::string cons1 = errno_string + ", ";
-  std::string cons2 = cons1 + message;
+// with lightweight exceptions enabled, code only exceptions are shared
+// stackless instances. Loop threads read the flag while another thread
+// may toggle it, so the instances are built on the first enable and never
+// deleted, and only the flag changes afterwards.
+static volatile size_t _lightweight = 0;
+static jobject _shared[UV_MAX_ERRORS];
+static bool _shared_built = false;
 
-  jclass nativeExceptionClassID = env->FindClass("com/oracle/libuv/NativeException");
-  assert(nativeExceptionClassID);
-  jmethodID nativeExceptionConstructorMID = env->GetMethodID(
-      nativeExceptionClassID,
-      "<init>",
-      "(ILjava/lang/String;Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;)V");
-  assert(nativeExceptionConstructorMID);
+static inline jstring _new_string(JNIEnv* env, const char* s) {
+  return s && s[0] ? env->NewStringUTF(s) : NULL;
+}
 
-  jthrowable e;
-  std::string path_str;
+// error name, message and the formatted text are left to NativeException
+// to build lazily, only the strings it can not derive from errorno cross JNI
+jthrowable NewException(JNIEnv* env, int errorno, const char *syscall, const char *msg, const char *path) {
+  assert(env);
+  assert(_native_exception_cid);
 
-  jstring err_str = utf(env, errno_string);
-  jstring err_msg = utf(env, errno_message);
+  if (ring_load(&_lightweight) && !syscall && !msg && !path && errorno >= 0 && errorno < UV_MAX_ERRORS) {
+    return reinterpret_cast<jthrowable>(env->NewLocalRef(_shared[errorno]));
+  }
 
-  if (path) {
 #ifdef _WIN32
+  // report paths without the long path prefixes
+  std::string unc;
+  if (path) {
     if (strncmp(path, "\\\\?\\UNC\\", 8) == 0) {
-      path_str = "\\\\" + std::string(path + 8);
+      unc = "\\\\" + std::string(path + 8);
+      path = unc.c_str();
     } else if (strncmp(path, "\\\\?\\", 4) == 0) {
-      path_str = std::string(path + 4);
-    } else {
-      path_str = std::string(path);
+      path += 4;
     }
-#else
-    path_str = std::string(path);
+  }
 #endif
 
-    std::string cons3 = cons2 + " '";
-    std::string cons4 = cons3 + path_str;
-    std::string cons5 = cons4 + "'";
-
-    jstring err_cons5 = utf(env, cons5);
-    jstring err_path = utf(env, path_str);
-
-    e = (jthrowable) env->NewObject(nativeExceptionClassID, nativeExceptionConstructorMID,
-        errorno, err_str, err_msg, syscall_arg, err_cons5, err_path);
+  jstring syscall_arg = _new_string(env, syscall);
+  jstring msg_arg = _new_string(env, msg);
+  jstring path_arg = path ? env->NewStringUTF(path) : NULL;
 
-    env->DeleteLocalRef(err_cons5);
-    env->DeleteLocalRef(err_path);
-  } else {
-    jstring err_cons2 = utf(env, cons2);
+  jthrowable e = reinterpret_cast<jthrowable>(env->NewObject(_native_exception_cid, _native_exception_init_mid,
+      errorno, syscall_arg, msg_arg, path_arg));
 
-    e = (jthrowable) env->NewObject(nativeExceptionClassID, nativeExceptionConstructorMID,
-        errorno, err_str, err_msg, syscall_arg, err_cons2, NULL);
-
-    env->DeleteLocalRef(err_cons2);
-  }
-
-  if (syscall_arg != NULL) {
+  if (syscall_arg) {
     env->DeleteLocalRef(syscall_arg);
   }
-  env->DeleteLocalRef(err_str);
-  env->DeleteLocalRef(err_msg);
-
+  if (msg_arg) {
+    env->DeleteLocalRef(msg_arg);
+  }
+  if (path_arg) {
+    env->DeleteLocalRef(path_arg);
+  }
   return e;
 }
 
@@ -155,4 +145,55 @@ JNIEXPORT void JNICALL Java_com_oracle_libuv_NativeException__1static_1initializ
   assert(_oom_cid);
   _oom_cid = (jclass) env->NewGlobalRef(_oom_cid);
   assert(_oom_cid);
+
+  _native_exception_cid = (jclass) env->NewGlobalRef(cls);
+  assert(_native_exception_cid);
+  _native_exception_init_mid = env->GetMethodID(_native_exception_cid, "<init>",
+      "(ILjava/lang/String;Ljava/lang/String;Ljava/lang/String;)V");
+  assert(_native_exception_init_mid);
+}
+
+/*
+ * Class:     com_oracle_libuv_NativeException
+ * Method:    _set_lightweight
+ * Signature: (Z)V
+ */
+JNIEXPORT void JNICALL Java_com_oracle_libuv_NativeException__1set_1lightweight
+  (JNIEnv* env, jclass cls, jboolean enabled) {
+
+  assert(_native_exception_cid);
+  // NativeException.setLightweight is synchronized, one caller at a time
+  if (enabled && !_shared_built) {
+    for (int i = 0; i < UV_MAX_ERRORS; i++) {
+      jobject e = env->NewObject(_native_exception_cid, _native_exception_init_mid, i, NULL, NULL, NULL);
+      OOM(env, e);
+      _shared[i] = env->NewGlobalRef(e);
+      env->DeleteLocalRef(e);
+    }
+    _shared_built = true;
+  }
+  // the barrier publishes _shared before the flag
+  ring_store(&_lightweight, enabled ? 1 : 0);
+}
+
+/*
+ * Class:     com_oracle_libuv_NativeException
+ * Method:    _err_name
+ * Signature: (I)Ljava/lang/String;
+ */
+JNIEXPORT jstring JNICALL Java_com_oracle_libuv_NativeException__1err_1name
+  (JNIEnv* env, jclass cls, jint code) {
+
+  return env->NewStringUTF(get_uv_errno_string(code));
+}
+
+/*
+ * Class:     com_oracle_libuv_NativeException
+ * Method:    _strerror
+ * Signature: (I)Ljava/lang/String;
+ */
+JNIEXPORT jstring JNICALL Java_com_oracle_libuv_NativeException__1strerror
+  (JNIEnv* env, jclass cls, jint code) {
+
+  return env->NewStringUTF(get_uv_errno_message(code));
 }
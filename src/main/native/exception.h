@@ -60,6 +60,8 @@
 
 const char* get_uv_errno_string(int errorno);
 const char* get_uv_errno_message(int errorno);
+// errno, or GetLastError() on windows, as a libuv error code
+uv_err_code sys_error_code(int sys_errno);
 jstring utf(JNIEnv* env, const std::string& s);
 jthrowable NewException(JNIEnv* env, int errorno, const char *syscall, const char *msg, const char *path);
 void ThrowOutOfMemoryError(JNIEnv* env, const char* func, const char* file, const char* line, const char* msg);
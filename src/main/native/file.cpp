@@ -24,12 +24,18 @@
  */
 
 #include <assert.h>
+#include <errno.h>
+#include <stdint.h>
 #include <time.h>
 #include <string.h>
+#include <map>
+#include <string>
+#include <vector>
 
 #include "uv.h"
 #include "stats.h"
 #include "exception.h"
+#include "loop.h"
 #include "com_oracle_libuv_Files.h"
 
 #ifdef __MACOS__
@@ -40,9 +46,17 @@
 #include <io.h>
 #include <Shlwapi.h>
 #include <tchar.h>
+#else
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
 #endif
 
 class FileCallback;
+class FileBatchRequest;
+class StatManyRequest;
 
 class FileRequest {
 
@@ -62,6 +76,17 @@ private:
   void init(const char* syscall, FileCallback* ptr, jobject callback, jint fd, jstring path, jint flags, jobject context);
 
 public:
+  // allocated from the loop freelist when constructed with new (loop)
+  static void* operator new(size_t size, uv_loop_t* loop) throw() {
+    return LoopData::get(loop)->freelist(LoopData::FILE_REQUEST)->allocate(size);
+  }
+  static void operator delete(void* ptr) {
+    FreeList::release(ptr);
+  }
+  static void operator delete(void* ptr, uv_loop_t* loop) {
+    FreeList::release(ptr);
+  }
+
   FileRequest(const char* syscall, FileCallback* ptr, jobject callback, jint fd, jstring path, jobject context);
   FileRequest(const char* syscall, FileCallback* ptr, jobject callback, jint fd, jstring path, jint flags, jobject context);
   ~FileRequest();
@@ -102,6 +127,9 @@ private:
   static jmethodID _stats_callback_mid;
   static jmethodID _utime_callback_mid;
   static jmethodID _write_callback_mid;
+  static jmethodID _vector_callback_mid;
+  static jmethodID _batch_callback_mid;
+  static jmethodID _stat_many_callback_mid;
   static jmethodID _stats_init_mid;
 
   JNIEnv* _env;
@@ -122,6 +150,8 @@ public:
   void initialize(JNIEnv* env, jobject instance, uv_loop_t* loop);
   void fs_cb(FileRequest* request, uv_fs_type fs_type, ssize_t result, void* ptr);
   void fs_cb(FileRequest* request, uv_fs_type fs_type, const char* target_path, int errorno);
+  void batch_cb(FileBatchRequest* request);
+  void stat_many_cb(StatManyRequest* request);
 };
 
 jclass FileCallback::_files_cid = NULL;
@@ -137,6 +167,9 @@ jmethodID FileCallback::_readlink_callback_mid = NULL;
 jmethodID FileCallback::_stats_callback_mid = NULL;
 jmethodID FileCallback::_utime_callback_mid = NULL;
 jmethodID FileCallback::_write_callback_mid = NULL;
+jmethodID FileCallback::_vector_callback_mid = NULL;
+jmethodID FileCallback::_batch_callback_mid = NULL;
+jmethodID FileCallback::_stat_many_callback_mid = NULL;
 jmethodID FileCallback::_stats_init_mid = NULL;
 
 FileRequest::FileRequest(const char* syscall, FileCallback* ptr, jobject callback, jint fd, jstring path, jint flags, jobject context) {
@@ -249,6 +282,15 @@ void FileCallback::static_initialize(JNIEnv* env, jclass cls) {
   _write_callback_mid = env->GetMethodID(_files_cid, "callWrite", "(Ljava/lang/Object;ILjava/lang/Exception;Ljava/lang/Object;)V");
   assert(_write_callback_mid);
 
+  _vector_callback_mid = env->GetMethodID(_files_cid, "callVector", "(ILjava/lang/Object;J[Ljava/nio/ByteBuffer;Ljava/lang/Exception;Ljava/lang/Object;)V");
+  assert(_vector_callback_mid);
+
+  _batch_callback_mid = env->GetMethodID(_files_cid, "callBatch", "(Ljava/lang/Object;Ljava/lang/Object;Ljava/lang/Object;)V");
+  assert(_batch_callback_mid);
+
+  _stat_many_callback_mid = env->GetMethodID(_files_cid, "callStatMany", "(Ljava/lang/Object;I[JLjava/lang/Object;)V");
+  assert(_stat_many_callback_mid);
+
   _stats_init_mid = env->GetMethodID(_stats_cid, "<init>", "(IIIIIIIJIJJJJ)V");
   assert(_stats_init_mid);
 
@@ -562,6 +604,7 @@ void FileCallback::fs_cb(FileRequest* request, uv_fs_type fs_type, const char* t
 static void _fs_cb(uv_fs_t* req) {
   assert(req);
   assert(req->data);
+  CallbackScope scope(req->loop, UV_FILE);
 
   FileRequest* request = reinterpret_cast<FileRequest*>(req->data);
   assert(request);
@@ -575,10 +618,334 @@ static void _fs_cb(uv_fs_t* req) {
   }
 
   uv_fs_req_cleanup(req);
-  delete(req);
+  freelist_delete(req);
   delete(request);
 }
 
+// One readv/writev, or a batch of single buffer reads and writes, on direct
+// buffers. The whole request runs as one work item on the libuv thread pool,
+// the ops in order, and completes with a single upcall.
+struct FileOp {
+  int type;          // UV_FS_READ or UV_FS_WRITE
+  int fd;
+  int64_t position;  // -1 for the current file position
+  size_t first;      // index of the first buffer in FileBatchRequest::bufs
+  size_t count;
+  ssize_t result;
+  int error;         // uv error code when result is -1
+};
+
+class FileBatchRequest {
+public:
+  uv_work_t work;
+  FileCallback* file_callback;
+  bool vector;
+  jobject callback;
+  jobject context;
+  jobject buffers;
+  jobject batch;
+  jintArray results;
+  jobjectArray errors;
+  std::vector<FileOp> ops;
+  std::vector<uv_buf_t> bufs;
+
+  FileBatchRequest(FileCallback* cb, bool vector) {
+    memset(&work, 0, sizeof(work));
+    work.data = this;
+    file_callback = cb;
+    this->vector = vector;
+    callback = NULL;
+    context = NULL;
+    buffers = NULL;
+    batch = NULL;
+    results = NULL;
+    errors = NULL;
+  }
+
+  ~FileBatchRequest() {
+    JNIEnv* env = file_callback->env();
+    if (callback) { env->DeleteGlobalRef(callback); }
+    if (context) { env->DeleteGlobalRef(context); }
+    if (buffers) { env->DeleteGlobalRef(buffers); }
+    if (batch) { env->DeleteGlobalRef(batch); }
+    if (results) { env->DeleteGlobalRef(results); }
+    if (errors) { env->DeleteGlobalRef(errors); }
+  }
+
+  // keeps everything the upcall needs alive until the work is done
+  void retain(JNIEnv* env, jobject callback, jobject context, jobject buffers, jobject batch, jintArray results, jobjectArray errors) {
+    this->callback = callback ? env->NewGlobalRef(callback) : NULL;
+    this->context = context ? env->NewGlobalRef(context) : NULL;
+    this->buffers = buffers ? env->NewGlobalRef(buffers) : NULL;
+    this->batch = batch ? env->NewGlobalRef(batch) : NULL;
+    this->results = results ? (jintArray) env->NewGlobalRef(results) : NULL;
+    this->errors = errors ? (jobjectArray) env->NewGlobalRef(errors) : NULL;
+  }
+};
+
+#ifdef _WIN32
+
+static ssize_t _file_io(int type, int fd, int64_t position, uv_buf_t* bufs, size_t count, int* error) {
+  HANDLE handle = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+  if (handle == INVALID_HANDLE_VALUE) {
+    *error = UV_EBADF;
+    return -1;
+  }
+  ssize_t total = 0;
+  for (size_t i = 0; i < count; i++) {
+    OVERLAPPED overlapped;
+    OVERLAPPED* overlapped_ptr = NULL;
+    if (position >= 0) {
+      memset(&overlapped, 0, sizeof(overlapped));
+      uint64_t offset = static_cast<uint64_t>(position + total);
+      overlapped.Offset = static_cast<DWORD>(offset);
+      overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+      overlapped_ptr = &overlapped;
+    }
+    DWORD n = 0;
+    BOOL ok = type == UV_FS_READ ?
+        ReadFile(handle, bufs[i].base, bufs[i].len, &n, overlapped_ptr) :
+        WriteFile(handle, bufs[i].base, bufs[i].len, &n, overlapped_ptr);
+    if (!ok) {
+      DWORD code = GetLastError();
+      if (code == ERROR_HANDLE_EOF) {
+        break;
+      }
+      if (total > 0) {
+        break;
+      }
+      *error = sys_error_code(code);
+      return -1;
+    }
+    total += n;
+    if (n < bufs[i].len) {
+      break;
+    }
+  }
+  return total;
+}
+
+#else
+
+static ssize_t _file_io(int type, int fd, int64_t position, uv_buf_t* bufs, size_t count, int* error) {
+  ssize_t r;
+#if defined(__linux__)
+  // uv_buf_t is laid out like struct iovec on unix
+  const struct iovec* iov = reinterpret_cast<const struct iovec*>(bufs);
+  do {
+    if (type == UV_FS_READ) {
+      r = position < 0 ? readv(fd, iov, count) : preadv(fd, iov, count, position);
+    } else {
+      r = position < 0 ? writev(fd, iov, count) : pwritev(fd, iov, count, position);
+    }
+  } while (r == -1 && errno == EINTR);
+#else
+  ssize_t total = 0;
+  r = 0;
+  for (size_t i = 0; i < count; i++) {
+    do {
+      if (type == UV_FS_READ) {
+        r = position < 0 ?
+            read(fd, bufs[i].base, bufs[i].len) :
+            pread(fd, bufs[i].base, bufs[i].len, position + total);
+      } else {
+        r = position < 0 ?
+            write(fd, bufs[i].base, bufs[i].len) :
+            pwrite(fd, bufs[i].base, bufs[i].len, position + total);
+      }
+    } while (r == -1 && errno == EINTR);
+    if (r < 0) {
+      break;
+    }
+    total += r;
+    if (static_cast<size_t>(r) < bufs[i].len) {
+      break;
+    }
+  }
+  if (r >= 0 || total > 0) {
+    r = total;
+  }
+#endif
+  if (r < 0) {
+    *error = sys_error_code(errno);
+  }
+  return r;
+}
+
+#endif // _WIN32
+
+static void _batch_work_cb(uv_work_t* work) {
+  FileBatchRequest* request = reinterpret_cast<FileBatchRequest*>(work->data);
+  for (size_t i = 0; i < request->ops.size(); i++) {
+    FileOp* op = &request->ops[i];
+    op->error = 0;
+    op->result = _file_io(op->type, op->fd, op->position, &request->bufs[op->first], op->count, &op->error);
+  }
+}
+
+static void _batch_after_work_cb(uv_work_t* work, int status) {
+  CallbackScope scope(work->loop, UV_FILE);
+  FileBatchRequest* request = reinterpret_cast<FileBatchRequest*>(work->data);
+  request->file_callback->batch_cb(request);
+  delete request;
+}
+
+// copies the per op results (and exceptions for failed ops) into the batch
+static bool _store_batch_results(JNIEnv* env, FileBatchRequest* request) {
+  jsize count = static_cast<jsize>(request->ops.size());
+  jint* results = env->GetIntArrayElements(request->results, NULL);
+  if (!results) {
+    ThrowOutOfMemoryError(env, FUNCTION_NAME, __FILE__, TOSTRING(__LINE__), "results");
+    return false;
+  }
+  for (jsize i = 0; i < count; i++) {
+    FileOp* op = &request->ops[i];
+    results[i] = static_cast<jint>(op->result);
+    if (op->result < 0) {
+      jthrowable exception = NewException(env, op->error, op->type == UV_FS_READ ? "read" : "write", NULL, NULL);
+      env->SetObjectArrayElement(request->errors, i, exception);
+      env->DeleteLocalRef(exception);
+    }
+  }
+  env->ReleaseIntArrayElements(request->results, results, 0);
+  return true;
+}
+
+void FileCallback::batch_cb(FileBatchRequest* request) {
+  assert(_env);
+  if (request->vector) {
+    assert(request->ops.size() == 1);
+    FileOp* op = &request->ops[0];
+    jthrowable exception = op->result < 0 ?
+        NewException(_env, op->error, op->type == UV_FS_READ ? "readv" : "writev", NULL, NULL) : NULL;
+    _env->CallVoidMethod(
+        _instance,
+        _vector_callback_mid,
+        op->type,
+        request->callback,
+        static_cast<jlong>(op->result),
+        request->buffers,
+        exception,
+        request->context);
+    if (exception) { _env->DeleteLocalRef(exception); }
+    return;
+  }
+
+  if (!_store_batch_results(_env, request)) {
+    return;
+  }
+  _env->CallVoidMethod(
+      _instance,
+      _batch_callback_mid,
+      request->callback,
+      request->batch,
+      request->context);
+}
+
+// fills request->bufs from the direct buffers, returns why it failed
+// when a buffer is not direct or a range does not fit its buffer
+static const char* _batch_buffers(JNIEnv* env, FileBatchRequest* request, jobjectArray buffers, jintArray offsets, jintArray lengths, jsize count) {
+  jint* offs = env->GetIntArrayElements(offsets, NULL);
+  jint* lens = env->GetIntArrayElements(lengths, NULL);
+  const char* error = offs && lens ? NULL : "direct buffers required";
+  request->bufs.reserve(count);
+  for (jsize i = 0; i < count && !error; i++) {
+    jobject buffer = env->GetObjectArrayElement(buffers, i);
+    char* base = reinterpret_cast<char*>(env->GetDirectBufferAddress(buffer));
+    jlong capacity = env->GetDirectBufferCapacity(buffer);
+    env->DeleteLocalRef(buffer);
+    if (!base) {
+      error = "direct buffers required";
+    } else if (offs[i] < 0 || lens[i] < 0 || static_cast<jlong>(offs[i]) + lens[i] > capacity) {
+      error = "offset and length out of buffer bounds";
+    } else {
+      request->bufs.push_back(uv_buf_init(base + offs[i], static_cast<unsigned int>(lens[i])));
+    }
+  }
+  if (offs) { env->ReleaseIntArrayElements(offsets, offs, JNI_ABORT); }
+  if (lens) { env->ReleaseIntArrayElements(lengths, lens, JNI_ABORT); }
+  return error;
+}
+
+// stat(2) of many paths as one work item, the results go into a flat long[]
+// of ROW values per path: the uv error code (0 on success) then the
+// Stats::FIELDS values. Nothing is allocated on the java heap.
+class StatManyRequest {
+public:
+  static const int ROW = Stats::FIELDS + 1;
+
+  uv_work_t work;
+  FileCallback* file_callback;
+  jobject callback;
+  jobject context;
+  jlongArray out;
+  std::vector<std::string> paths;
+  std::vector<jlong> values;
+  jint succeeded;
+
+  StatManyRequest(FileCallback* cb) {
+    memset(&work, 0, sizeof(work));
+    work.data = this;
+    file_callback = cb;
+    callback = NULL;
+    context = NULL;
+    out = NULL;
+    succeeded = 0;
+  }
+
+  ~StatManyRequest() {
+    JNIEnv* env = file_callback->env();
+    if (callback) { env->DeleteGlobalRef(callback); }
+    if (context) { env->DeleteGlobalRef(context); }
+    if (out) { env->DeleteGlobalRef(out); }
+  }
+
+  void retain(JNIEnv* env, jobject callback, jobject context, jlongArray out) {
+    this->callback = callback ? env->NewGlobalRef(callback) : NULL;
+    this->context = context ? env->NewGlobalRef(context) : NULL;
+    this->out = (jlongArray) env->NewGlobalRef(out);
+  }
+};
+
+static void _stat_many_work_cb(uv_work_t* work) {
+  StatManyRequest* request = reinterpret_cast<StatManyRequest*>(work->data);
+  jlong* row = &request->values[0];
+  for (size_t i = 0; i < request->paths.size(); i++, row += StatManyRequest::ROW) {
+    uv_statbuf_t buf;
+    int error = Stats::stat_path(request->paths[i].c_str(), &buf);
+    row[0] = error;
+    if (error) {
+      memset(row + 1, 0, Stats::FIELDS * sizeof(jlong));
+    } else {
+      Stats::fill(row + 1, &buf);
+      request->succeeded++;
+    }
+  }
+}
+
+static void _stat_many_after_work_cb(uv_work_t* work, int status) {
+  CallbackScope scope(work->loop, UV_FILE);
+  StatManyRequest* request = reinterpret_cast<StatManyRequest*>(work->data);
+  request->file_callback->stat_many_cb(request);
+  delete request;
+}
+
+static void _store_stat_many_results(JNIEnv* env, StatManyRequest* request) {
+  env->SetLongArrayRegion(request->out, 0, static_cast<jsize>(request->values.size()), &request->values[0]);
+}
+
+void FileCallback::stat_many_cb(StatManyRequest* request) {
+  assert(_env);
+  _store_stat_many_results(_env, request);
+  _env->CallVoidMethod(
+      _instance,
+      _stat_many_callback_mid,
+      request->callback,
+      static_cast<jint>(request->paths.size()),
+      request->out,
+      request->context);
+}
+
 /*
  * Class:     com_oracle_libuv_Files
  * Method:    _static_initialize
@@ -645,8 +1012,14 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1close__JILjava_lang_Object_
   int r;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    req->data = new FileRequest("close", cb, callback, fd, NULL, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    OOME(env, req);
+    FileRequest* request = new (cb->loop()) FileRequest("close", cb, callback, fd, NULL, context);
+    if (!request) {
+      freelist_delete(req);
+      OOME(env, request);
+    }
+    req->data = request;
     r = uv_fs_close(cb->loop(), req, fd, _fs_cb);
   } else {
     uv_fs_t req;
@@ -673,8 +1046,18 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1open
   int fd;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    req->data = new FileRequest("open", cb, callback, 0, path, flags, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    if (!req) {
+      env->ReleaseStringUTFChars(path, cpath);
+      OOME(env, req);
+    }
+    FileRequest* request = new (cb->loop()) FileRequest("open", cb, callback, 0, path, flags, context);
+    if (!request) {
+      freelist_delete(req);
+      env->ReleaseStringUTFChars(path, cpath);
+      OOME(env, request);
+    }
+    req->data = request;
     fd = uv_fs_open(cb->loop(), req, cpath, flags, mode, _fs_cb);
   } else {
     uv_fs_t req;
@@ -701,8 +1084,13 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1read
   int r;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    FileRequest* request = new FileRequest("read", cb, callback, fd, NULL, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    OOME(env, req);
+    FileRequest* request = new (cb->loop()) FileRequest("read", cb, callback, fd, NULL, context);
+    if (!request) {
+      freelist_delete(req);
+      OOME(env, request);
+    }
     request->get_bytes(buffer, data, static_cast<jsize>(offset), static_cast<jsize>(length));
     req->data = request;
     jbyte* base = request->bytes();
@@ -740,8 +1128,18 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1unlink
   int r;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    req->data = new FileRequest("unlink", cb, callback, 0, path, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    if (!req) {
+      env->ReleaseStringUTFChars(path, cpath);
+      OOME(env, req);
+    }
+    FileRequest* request = new (cb->loop()) FileRequest("unlink", cb, callback, 0, path, context);
+    if (!request) {
+      freelist_delete(req);
+      env->ReleaseStringUTFChars(path, cpath);
+      OOME(env, request);
+    }
+    req->data = request;
     r = uv_fs_unlink(cb->loop(), req, cpath, _fs_cb);
   } else {
     uv_fs_t req;
@@ -768,8 +1166,14 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1write
   int r;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    req->data = new FileRequest("write", cb, callback, fd, NULL, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    OOME(env, req);
+    FileRequest* request = new (cb->loop()) FileRequest("write", cb, callback, fd, NULL, context);
+    if (!request) {
+      freelist_delete(req);
+      OOME(env, request);
+    }
+    req->data = request;
     if (data) {
       jbyte* base = (jbyte*) env->GetPrimitiveArrayCritical(data, NULL);
       OOME(env, base);
@@ -812,8 +1216,18 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1mkdir
   int r;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    req->data = new FileRequest("mkdir", cb, callback, 0, path, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    if (!req) {
+      env->ReleaseStringUTFChars(path, cpath);
+      OOME(env, req);
+    }
+    FileRequest* request = new (cb->loop()) FileRequest("mkdir", cb, callback, 0, path, context);
+    if (!request) {
+      freelist_delete(req);
+      env->ReleaseStringUTFChars(path, cpath);
+      OOME(env, request);
+    }
+    req->data = request;
     r = uv_fs_mkdir(cb->loop(), req, cpath, mode, _fs_cb);
   } else {
     uv_fs_t req;
@@ -841,8 +1255,18 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1rmdir
   int r;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    req->data = new FileRequest("rmdir", cb, callback, 0, path, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    if (!req) {
+      env->ReleaseStringUTFChars(path, cpath);
+      OOME(env, req);
+    }
+    FileRequest* request = new (cb->loop()) FileRequest("rmdir", cb, callback, 0, path, context);
+    if (!request) {
+      freelist_delete(req);
+      env->ReleaseStringUTFChars(path, cpath);
+      OOME(env, request);
+    }
+    req->data = request;
     r = uv_fs_rmdir(cb->loop(), req, cpath, _fs_cb);
   } else {
     uv_fs_t req;
@@ -870,8 +1294,18 @@ JNIEXPORT jobjectArray JNICALL Java_com_oracle_libuv_Files__1readdir
   jobjectArray names = NULL;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    req->data = new FileRequest("readdir", cb, callback, 0, path, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    if (!req) {
+      env->ReleaseStringUTFChars(path, cpath);
+      OOMN(env, req);
+    }
+    FileRequest* request = new (cb->loop()) FileRequest("readdir", cb, callback, 0, path, context);
+    if (!request) {
+      freelist_delete(req);
+      env->ReleaseStringUTFChars(path, cpath);
+      OOME(env, request);
+    }
+    req->data = request;
     uv_fs_readdir(cb->loop(), req, cpath, flags, _fs_cb);
   } else {
     uv_fs_t req;
@@ -917,8 +1351,18 @@ JNIEXPORT jobject JNICALL Java_com_oracle_libuv_Files__1stat
   jobject stats = NULL;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    req->data = new FileRequest("stat", cb, callback, 0, path, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    if (!req) {
+      env->ReleaseStringUTFChars(path, cpath);
+      OOMN(env, req);
+    }
+    FileRequest* request = new (cb->loop()) FileRequest("stat", cb, callback, 0, path, context);
+    if (!request) {
+      freelist_delete(req);
+      env->ReleaseStringUTFChars(path, cpath);
+      OOME(env, request);
+    }
+    req->data = request;
     uv_fs_stat(cb->loop(), req, cpath, _fs_cb);
   } else {
     uv_fs_t req;
@@ -946,8 +1390,14 @@ JNIEXPORT jobject JNICALL Java_com_oracle_libuv_Files__1fstat
   jobject stats = NULL;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    req->data = new FileRequest("fstat", cb, callback, fd, NULL, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    OOMN(env, req);
+    FileRequest* request = new (cb->loop()) FileRequest("fstat", cb, callback, fd, NULL, context);
+    if (!request) {
+      freelist_delete(req);
+      OOME(env, request);
+    }
+    req->data = request;
     uv_fs_fstat(cb->loop(), req, fd, _fs_cb);
   } else {
     uv_fs_t req;
@@ -961,6 +1411,52 @@ JNIEXPORT jobject JNICALL Java_com_oracle_libuv_Files__1fstat
   return stats;
 }
 
+/*
+ * Class:     com_oracle_libuv_Files
+ * Method:    _stat_into
+ * Signature: (JLjava/lang/String;Lcom/oracle/libuv/Stats;)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1stat_1into
+  (JNIEnv *env, jobject that, jlong ptr, jstring path, jobject stats) {
+
+  assert(ptr);
+  assert(stats);
+  FileCallback* cb = reinterpret_cast<FileCallback*>(ptr);
+  const char* cpath = env->GetStringUTFChars(path, 0);
+  uv_fs_t req;
+  int r = uv_fs_stat(cb->loop(), &req, cpath, NULL);
+  if (r < 0) {
+    ThrowException(env, uv_last_error(cb->loop()).code, "stat", NULL, cpath);
+  } else {
+    Stats::update(env, stats, static_cast<uv_statbuf_t*>(req.ptr));
+  }
+  uv_fs_req_cleanup(&req);
+  env->ReleaseStringUTFChars(path, cpath);
+  return r;
+}
+
+/*
+ * Class:     com_oracle_libuv_Files
+ * Method:    _fstat_into
+ * Signature: (JILcom/oracle/libuv/Stats;)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1fstat_1into
+  (JNIEnv *env, jobject that, jlong ptr, jint fd, jobject stats) {
+
+  assert(ptr);
+  assert(stats);
+  FileCallback* cb = reinterpret_cast<FileCallback*>(ptr);
+  uv_fs_t req;
+  int r = uv_fs_fstat(cb->loop(), &req, fd, NULL);
+  if (r < 0) {
+    ThrowException(env, uv_last_error(cb->loop()).code, "fstat");
+  } else {
+    Stats::update(env, stats, static_cast<uv_statbuf_t*>(req.ptr));
+  }
+  uv_fs_req_cleanup(&req);
+  return r;
+}
+
 /*
  * Class:     com_oracle_libuv_Files
  * Method:    _rename
@@ -976,8 +1472,20 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1rename
   int r;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    req->data = new FileRequest("rename", cb, callback, 0, new_path, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    if (!req) {
+      env->ReleaseStringUTFChars(path, src_path);
+      env->ReleaseStringUTFChars(new_path, dst_path);
+      OOME(env, req);
+    }
+    FileRequest* request = new (cb->loop()) FileRequest("rename", cb, callback, 0, new_path, context);
+    if (!request) {
+      freelist_delete(req);
+      env->ReleaseStringUTFChars(path, src_path);
+      env->ReleaseStringUTFChars(new_path, dst_path);
+      OOME(env, request);
+    }
+    req->data = request;
     r = uv_fs_rename(cb->loop(), req, src_path, dst_path, _fs_cb);
   } else {
     uv_fs_t req;
@@ -1011,8 +1519,14 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1fsync
   int r;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    req->data = new FileRequest("fsync", cb, callback, fd, NULL, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    OOME(env, req);
+    FileRequest* request = new (cb->loop()) FileRequest("fsync", cb, callback, fd, NULL, context);
+    if (!request) {
+      freelist_delete(req);
+      OOME(env, request);
+    }
+    req->data = request;
     r = uv_fs_fsync(cb->loop(), req, fd, _fs_cb);
   } else {
     uv_fs_t req;
@@ -1038,8 +1552,14 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1fdatasync
   int r;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    req->data = new FileRequest("fdatasync", cb, callback, fd, NULL, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    OOME(env, req);
+    FileRequest* request = new (cb->loop()) FileRequest("fdatasync", cb, callback, fd, NULL, context);
+    if (!request) {
+      freelist_delete(req);
+      OOME(env, request);
+    }
+    req->data = request;
     r = uv_fs_fdatasync(cb->loop(), req, fd, _fs_cb);
   } else {
     uv_fs_t req;
@@ -1065,8 +1585,14 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1ftruncate
   int r;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    req->data = new FileRequest("ftruncate", cb, callback, fd, NULL, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    OOME(env, req);
+    FileRequest* request = new (cb->loop()) FileRequest("ftruncate", cb, callback, fd, NULL, context);
+    if (!request) {
+      freelist_delete(req);
+      OOME(env, request);
+    }
+    req->data = request;
     r = uv_fs_ftruncate(cb->loop(), req, fd, offset, _fs_cb);
   } else {
     uv_fs_t req;
@@ -1092,8 +1618,14 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1sendfile
   int r;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    req->data = new FileRequest("sendfile", cb, callback, in_fd, NULL, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    OOME(env, req);
+    FileRequest* request = new (cb->loop()) FileRequest("sendfile", cb, callback, in_fd, NULL, context);
+    if (!request) {
+      freelist_delete(req);
+      OOME(env, request);
+    }
+    req->data = request;
     r = uv_fs_sendfile(cb->loop(), req, out_fd, in_fd, offset, length, _fs_cb);
   } else {
     uv_fs_t req;
@@ -1120,8 +1652,18 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1chmod
   int r;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    req->data = new FileRequest("chmod", cb, callback, 0, path, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    if (!req) {
+      env->ReleaseStringUTFChars(path, cpath);
+      OOME(env, req);
+    }
+    FileRequest* request = new (cb->loop()) FileRequest("chmod", cb, callback, 0, path, context);
+    if (!request) {
+      freelist_delete(req);
+      env->ReleaseStringUTFChars(path, cpath);
+      OOME(env, request);
+    }
+    req->data = request;
     r = uv_fs_chmod(cb->loop(), req, cpath, mode, _fs_cb);
   } else {
     uv_fs_t req;
@@ -1149,8 +1691,18 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1utime
   int r;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    req->data = new FileRequest("utime", cb, callback, 0, path, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    if (!req) {
+      env->ReleaseStringUTFChars(path, cpath);
+      OOME(env, req);
+    }
+    FileRequest* request = new (cb->loop()) FileRequest("utime", cb, callback, 0, path, context);
+    if (!request) {
+      freelist_delete(req);
+      env->ReleaseStringUTFChars(path, cpath);
+      OOME(env, request);
+    }
+    req->data = request;
     r = uv_fs_utime(cb->loop(), req, cpath, atime, mtime, _fs_cb);
   } else {
     uv_fs_t req;
@@ -1177,8 +1729,14 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1futime
   int r;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    req->data = new FileRequest("futime", cb, callback, fd, NULL, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    OOME(env, req);
+    FileRequest* request = new (cb->loop()) FileRequest("futime", cb, callback, fd, NULL, context);
+    if (!request) {
+      freelist_delete(req);
+      OOME(env, request);
+    }
+    req->data = request;
     r = uv_fs_futime(cb->loop(), req, fd, atime, mtime, _fs_cb);
   } else {
     uv_fs_t req;
@@ -1205,8 +1763,18 @@ JNIEXPORT jobject JNICALL Java_com_oracle_libuv_Files__1lstat
   jobject stats = NULL;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    req->data = new FileRequest("lstat", cb, callback, 0, path, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    if (!req) {
+      env->ReleaseStringUTFChars(path, cpath);
+      OOMN(env, req);
+    }
+    FileRequest* request = new (cb->loop()) FileRequest("lstat", cb, callback, 0, path, context);
+    if (!request) {
+      freelist_delete(req);
+      env->ReleaseStringUTFChars(path, cpath);
+      OOME(env, request);
+    }
+    req->data = request;
     uv_fs_lstat(cb->loop(), req, cpath, _fs_cb);
   } else {
     uv_fs_t req;
@@ -1236,8 +1804,20 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1link
   int r;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    req->data = new FileRequest("link", cb, callback, 0, new_path, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    if (!req) {
+      env->ReleaseStringUTFChars(path, src_path);
+      env->ReleaseStringUTFChars(new_path, dst_path);
+      OOME(env, req);
+    }
+    FileRequest* request = new (cb->loop()) FileRequest("link", cb, callback, 0, new_path, context);
+    if (!request) {
+      freelist_delete(req);
+      env->ReleaseStringUTFChars(path, src_path);
+      env->ReleaseStringUTFChars(new_path, dst_path);
+      OOME(env, request);
+    }
+    req->data = request;
     r = uv_fs_link(cb->loop(), req, src_path, dst_path, _fs_cb);
   } else {
     uv_fs_t req;
@@ -1273,8 +1853,20 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1symlink
   int r;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    req->data = new FileRequest("symlink", cb, callback, 0, path, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    if (!req) {
+      env->ReleaseStringUTFChars(path, src_path);
+      env->ReleaseStringUTFChars(new_path, dst_path);
+      OOME(env, req);
+    }
+    FileRequest* request = new (cb->loop()) FileRequest("symlink", cb, callback, 0, path, context);
+    if (!request) {
+      freelist_delete(req);
+      env->ReleaseStringUTFChars(path, src_path);
+      env->ReleaseStringUTFChars(new_path, dst_path);
+      OOME(env, request);
+    }
+    req->data = request;
     r = uv_fs_symlink(cb->loop(), req, src_path, dst_path, flags, _fs_cb);
   } else {
     uv_fs_t req;
@@ -1303,8 +1895,18 @@ JNIEXPORT jstring JNICALL Java_com_oracle_libuv_Files__1readlink
   jstring link = NULL;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    req->data = new FileRequest("readlink", cb, callback, 0, path, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    if (!req) {
+      env->ReleaseStringUTFChars(path, cpath);
+      OOMN(env, req);
+    }
+    FileRequest* request = new (cb->loop()) FileRequest("readlink", cb, callback, 0, path, context);
+    if (!request) {
+      freelist_delete(req);
+      env->ReleaseStringUTFChars(path, cpath);
+      OOME(env, request);
+    }
+    req->data = request;
     uv_fs_readlink(cb->loop(), req, cpath, _fs_cb);
   } else {
     uv_fs_t req;
@@ -1332,8 +1934,14 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1fchmod
   int r;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    req->data = new FileRequest("fchmod", cb, callback, fd, NULL, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    OOME(env, req);
+    FileRequest* request = new (cb->loop()) FileRequest("fchmod", cb, callback, fd, NULL, context);
+    if (!request) {
+      freelist_delete(req);
+      OOME(env, request);
+    }
+    req->data = request;
     r = uv_fs_fchmod(cb->loop(), req, fd, mode, _fs_cb);
   } else {
     uv_fs_t req;
@@ -1360,8 +1968,18 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1chown
   int r;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    req->data = new FileRequest("chown", cb, callback, 0, path, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    if (!req) {
+      env->ReleaseStringUTFChars(path, cpath);
+      OOME(env, req);
+    }
+    FileRequest* request = new (cb->loop()) FileRequest("chown", cb, callback, 0, path, context);
+    if (!request) {
+      freelist_delete(req);
+      env->ReleaseStringUTFChars(path, cpath);
+      OOME(env, request);
+    }
+    req->data = request;
     r = uv_fs_chown(cb->loop(), req, cpath, (uv_uid_t) uid, (uv_gid_t) gid, _fs_cb);
   } else {
     uv_fs_t req;
@@ -1388,8 +2006,14 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1fchown
   int r;
 
   if (callback) {
-    uv_fs_t* req = new uv_fs_t();
-    req->data = new FileRequest("fchown", cb, callback, fd, NULL, context);
+    uv_fs_t* req = loop_new_req<uv_fs_t>(cb->loop(), LoopData::FS_REQ);
+    OOME(env, req);
+    FileRequest* request = new (cb->loop()) FileRequest("fchown", cb, callback, fd, NULL, context);
+    if (!request) {
+      freelist_delete(req);
+      OOME(env, request);
+    }
+    req->data = request;
     r = uv_fs_fchown(cb->loop(), req, fd, (uv_uid_t) uid, (uv_gid_t) gid, _fs_cb);
   } else {
     uv_fs_t req;
@@ -1401,3 +2025,604 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1fchown
   }
   return r;
 }
+
+/*
+ * Class:     com_oracle_libuv_Files
+ * Method:    _vector_io
+ * Signature: (JII[Ljava/nio/ByteBuffer;[I[IJLjava/lang/Object;Ljava/lang/Object;)J
+ */
+JNIEXPORT jlong JNICALL Java_com_oracle_libuv_Files__1vector_1io
+  (JNIEnv *env, jobject that, jlong ptr, jint type, jint fd, jobjectArray buffers, jintArray offsets, jintArray lengths, jlong position, jobject callback, jobject context) {
+
+  assert(ptr);
+  assert(type == UV_FS_READ || type == UV_FS_WRITE);
+  FileCallback* cb = reinterpret_cast<FileCallback*>(ptr);
+  const char* syscall = type == UV_FS_READ ? "readv" : "writev";
+  jsize count = env->GetArrayLength(buffers);
+
+  FileBatchRequest* request = new FileBatchRequest(cb, true);
+  const char* invalid = _batch_buffers(env, request, buffers, offsets, lengths, count);
+  if (invalid) {
+    delete request;
+    ThrowException(env, UV_EINVAL, syscall, invalid);
+    return -1;
+  }
+  FileOp op = {type, fd, position, 0, static_cast<size_t>(count), 0, 0};
+  request->ops.push_back(op);
+
+  if (!callback) {
+    FileOp* sync = &request->ops[0];
+    sync->result = _file_io(type, fd, position, &request->bufs[0], sync->count, &sync->error);
+    jlong r = static_cast<jlong>(sync->result);
+    if (r < 0) {
+      ThrowException(env, sync->error, syscall);
+    }
+    delete request;
+    return r;
+  }
+
+  request->retain(env, callback, context, buffers, NULL, NULL, NULL);
+  int r = uv_queue_work(cb->loop(), &request->work, _batch_work_cb, _batch_after_work_cb);
+  if (r) {
+    delete request;
+    ThrowException(env, uv_last_error(cb->loop()).code, "uv_queue_work");
+  }
+  return r;
+}
+
+/*
+ * Class:     com_oracle_libuv_Files
+ * Method:    _submit
+ * Signature: (JI[I[I[Ljava/nio/ByteBuffer;[I[I[J[I[Ljava/lang/Exception;Ljava/lang/Object;Ljava/lang/Object;Ljava/lang/Object;)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1submit
+  (JNIEnv *env, jobject that, jlong ptr, jint count, jintArray types, jintArray fds, jobjectArray buffers, jintArray offsets, jintArray lengths, jlongArray positions, jintArray results, jobjectArray errors, jobject batch, jobject callback, jobject context) {
+
+  assert(ptr);
+  assert(count > 0);
+  FileCallback* cb = reinterpret_cast<FileCallback*>(ptr);
+
+  FileBatchRequest* request = new FileBatchRequest(cb, false);
+  const char* invalid = _batch_buffers(env, request, buffers, offsets, lengths, count);
+  if (invalid) {
+    delete request;
+    ThrowException(env, UV_EINVAL, "submit", invalid);
+    return -1;
+  }
+  jint* optypes = env->GetIntArrayElements(types, NULL);
+  jint* opfds = env->GetIntArrayElements(fds, NULL);
+  jlong* oppositions = env->GetLongArrayElements(positions, NULL);
+  if (!optypes || !opfds || !oppositions) {
+    if (optypes) { env->ReleaseIntArrayElements(types, optypes, JNI_ABORT); }
+    if (opfds) { env->ReleaseIntArrayElements(fds, opfds, JNI_ABORT); }
+    if (oppositions) { env->ReleaseLongArrayElements(positions, oppositions, JNI_ABORT); }
+    delete request;
+    ThrowOutOfMemoryError(env, FUNCTION_NAME, __FILE__, TOSTRING(__LINE__), "batch arrays");
+    return -1;
+  }
+  request->ops.reserve(count);
+  for (jint i = 0; i < count; i++) {
+    assert(optypes[i] == UV_FS_READ || optypes[i] == UV_FS_WRITE);
+    FileOp op = {optypes[i], opfds[i], oppositions[i], static_cast<size_t>(i), 1, 0, 0};
+    request->ops.push_back(op);
+  }
+  env->ReleaseIntArrayElements(types, optypes, JNI_ABORT);
+  env->ReleaseIntArrayElements(fds, opfds, JNI_ABORT);
+  env->ReleaseLongArrayElements(positions, oppositions, JNI_ABORT);
+
+  request->retain(env, callback, context, buffers, batch, results, errors);
+  if (!callback) {
+    // sync mode runs the batch on the calling thread and reports per op
+    // results through the batch, without an upcall
+    _batch_work_cb(&request->work);
+    bool stored = _store_batch_results(env, request);
+    delete request;
+    return stored ? 0 : -1;
+  }
+
+  int r = uv_queue_work(cb->loop(), &request->work, _batch_work_cb, _batch_after_work_cb);
+  if (r) {
+    delete request;
+    ThrowException(env, uv_last_error(cb->loop()).code, "uv_queue_work");
+  }
+  return r;
+}
+
+/*
+ * Class:     com_oracle_libuv_Files
+ * Method:    _stat_many
+ * Signature: (J[Ljava/lang/String;[JLjava/lang/Object;Ljava/lang/Object;)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1stat_1many
+  (JNIEnv *env, jobject that, jlong ptr, jobjectArray paths, jlongArray out, jobject callback, jobject context) {
+
+  assert(ptr);
+  FileCallback* cb = reinterpret_cast<FileCallback*>(ptr);
+  jsize count = env->GetArrayLength(paths);
+  assert(count > 0);
+  assert(env->GetArrayLength(out) >= count * StatManyRequest::ROW);
+
+  StatManyRequest* request = new StatManyRequest(cb);
+  request->paths.reserve(count);
+  for (jsize i = 0; i < count; i++) {
+    jstring path = (jstring) env->GetObjectArrayElement(paths, i);
+    const char* cpath = env->GetStringUTFChars(path, 0);
+    if (!cpath) {
+      env->DeleteLocalRef(path);
+      delete request;
+      ThrowOutOfMemoryError(env, FUNCTION_NAME, __FILE__, TOSTRING(__LINE__), "path");
+      return -1;
+    }
+    request->paths.push_back(cpath);
+    env->ReleaseStringUTFChars(path, cpath);
+    env->DeleteLocalRef(path);
+  }
+  request->values.resize(count * StatManyRequest::ROW);
+
+  if (!callback) {
+    // sync mode stats on the calling thread and returns how many succeeded
+    _stat_many_work_cb(&request->work);
+    _store_stat_many_results(env, request);
+    jint succeeded = request->succeeded;
+    delete request;
+    return succeeded;
+  }
+
+  request->retain(env, callback, context, out);
+  int r = uv_queue_work(cb->loop(), &request->work, _stat_many_work_cb, _stat_many_after_work_cb);
+  if (r) {
+    delete request;
+    ThrowException(env, uv_last_error(cb->loop()).code, "uv_queue_work");
+  }
+  return r;
+}
+
+// must be equal to the PROT_* and MADV_* constants in Files.java
+enum MapProtection {
+  MAP_PROTECTION_READ = 1,
+  MAP_PROTECTION_WRITE = 2
+};
+
+enum MapAdvice {
+  MAP_ADVICE_NORMAL = 0,
+  MAP_ADVICE_SEQUENTIAL = 1,
+  MAP_ADVICE_RANDOM = 2,
+  MAP_ADVICE_WILLNEED = 3,
+  MAP_ADVICE_DONTNEED = 4
+};
+
+// mappings start at a multiple of this, file offsets are rounded down to it
+static size_t _map_granularity() {
+#ifdef _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return static_cast<size_t>(info.dwAllocationGranularity);
+#else
+  return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+static inline int _map_error() {
+#ifdef _WIN32
+  return sys_error_code(GetLastError());
+#else
+  return sys_error_code(errno);
+#endif
+}
+
+// A mapping created by _mmap. Its buffer address is offset into the first
+// page when the file offset was not aligned.
+struct Mapping {
+  char* base;
+  size_t length;
+  jlong capacity;
+};
+
+// every live mapping by buffer address, so that munmap, madvise and msync
+// never touch memory that did not come from _mmap; files of all loops share
+// it, calls hold the lock until done so a mapping can not go away meanwhile
+static std::map<char*, Mapping> _mappings;
+static uv_mutex_t _mappings_lock;
+static uv_once_t _mappings_once = UV_ONCE_INIT;
+
+static void _init_mappings_lock() {
+  int r = uv_mutex_init(&_mappings_lock);
+  assert(r == 0);
+}
+
+static void _lock_mappings() {
+  uv_once(&_mappings_once, _init_mappings_lock);
+  uv_mutex_lock(&_mappings_lock);
+}
+
+static void _unlock_mappings() {
+  uv_mutex_unlock(&_mappings_lock);
+}
+
+// the mapping behind a buffer returned by _mmap, NULL for any other buffer,
+// called with the lock held
+static std::map<char*, Mapping>::iterator _mapping_of(JNIEnv* env, jobject buffer) {
+  char* address = reinterpret_cast<char*>(env->GetDirectBufferAddress(buffer));
+  std::map<char*, Mapping>::iterator it = address ? _mappings.find(address) : _mappings.end();
+  if (it != _mappings.end() && it->second.capacity != env->GetDirectBufferCapacity(buffer)) {
+    it = _mappings.end();
+  }
+  return it;
+}
+
+/*
+ * Class:     com_oracle_libuv_Files
+ * Method:    _mmap
+ * Signature: (JIJJI)Ljava/nio/ByteBuffer;
+ */
+JNIEXPORT jobject JNICALL Java_com_oracle_libuv_Files__1mmap
+  (JNIEnv *env, jobject that, jlong ptr, jint fd, jlong offset, jlong length, jint prot) {
+
+  assert(ptr);
+  assert(offset >= 0);
+  assert(length > 0);
+  size_t delta = static_cast<size_t>(offset) % _map_granularity();
+  int64_t aligned = offset - static_cast<int64_t>(delta);
+  size_t size = static_cast<size_t>(length) + delta;
+  bool writable = (prot & MAP_PROTECTION_WRITE) != 0;
+  char* base;
+
+#ifdef _WIN32
+  HANDLE file = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+  if (file == INVALID_HANDLE_VALUE) {
+    ThrowException(env, UV_EBADF, "mmap");
+    return NULL;
+  }
+  uint64_t end = static_cast<uint64_t>(offset + length);
+  HANDLE mapping = CreateFileMapping(file, NULL, writable ? PAGE_READWRITE : PAGE_READONLY,
+                                     static_cast<DWORD>(end >> 32), static_cast<DWORD>(end), NULL);
+  if (!mapping) {
+    ThrowException(env, _map_error(), "mmap");
+    return NULL;
+  }
+  // the view keeps the mapping object alive
+  base = reinterpret_cast<char*>(MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ,
+                                               static_cast<DWORD>(static_cast<uint64_t>(aligned) >> 32),
+                                               static_cast<DWORD>(aligned), size));
+  int error = base ? 0 : _map_error();
+  CloseHandle(mapping);
+  if (!base) {
+    ThrowException(env, error, "mmap");
+    return NULL;
+  }
+#else
+  int flags = (prot & MAP_PROTECTION_READ ? PROT_READ : 0) | (writable ? PROT_WRITE : 0);
+  void* address = mmap(NULL, size, flags, MAP_SHARED, fd, static_cast<off_t>(aligned));
+  if (address == MAP_FAILED) {
+    ThrowException(env, _map_error(), "mmap");
+    return NULL;
+  }
+  base = reinterpret_cast<char*>(address);
+#endif
+
+  jobject buffer = env->NewDirectByteBuffer(base + delta, length);
+  if (!buffer) {
+#ifdef _WIN32
+    UnmapViewOfFile(base);
+#else
+    munmap(base, size);
+#endif
+    return NULL;
+  }
+  Mapping entry = {base, size, length};
+  _lock_mappings();
+  _mappings[base + delta] = entry;
+  _unlock_mappings();
+  return buffer;
+}
+
+/*
+ * Class:     com_oracle_libuv_Files
+ * Method:    _munmap
+ * Signature: (JLjava/nio/ByteBuffer;)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1munmap
+  (JNIEnv *env, jobject that, jlong ptr, jobject buffer) {
+
+  assert(ptr);
+  _lock_mappings();
+  std::map<char*, Mapping>::iterator it = _mapping_of(env, buffer);
+  if (it == _mappings.end()) {
+    _unlock_mappings();
+    ThrowException(env, UV_EINVAL, "munmap", "not a mapped buffer");
+    return -1;
+  }
+#ifdef _WIN32
+  int r = UnmapViewOfFile(it->second.base) ? 0 : -1;
+#else
+  int r = munmap(it->second.base, it->second.length);
+#endif
+  int error = r ? _map_error() : 0;
+  if (!r) {
+    _mappings.erase(it);
+  }
+  _unlock_mappings();
+  if (r) {
+    ThrowException(env, error, "munmap");
+  }
+  return r;
+}
+
+/*
+ * Class:     com_oracle_libuv_Files
+ * Method:    _madvise
+ * Signature: (JLjava/nio/ByteBuffer;I)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1madvise
+  (JNIEnv *env, jobject that, jlong ptr, jobject buffer, jint advice) {
+
+  assert(ptr);
+  _lock_mappings();
+  std::map<char*, Mapping>::iterator it = _mapping_of(env, buffer);
+  if (it == _mappings.end()) {
+    _unlock_mappings();
+    ThrowException(env, UV_EINVAL, "madvise", "not a mapped buffer");
+    return -1;
+  }
+#ifdef _WIN32
+  // advice is only a hint, windows has no direct equivalent
+  _unlock_mappings();
+  return 0;
+#else
+  int native_advice;
+  switch (advice) {
+    case MAP_ADVICE_SEQUENTIAL: native_advice = MADV_SEQUENTIAL; break;
+    case MAP_ADVICE_RANDOM: native_advice = MADV_RANDOM; break;
+    case MAP_ADVICE_WILLNEED: native_advice = MADV_WILLNEED; break;
+    case MAP_ADVICE_DONTNEED: native_advice = MADV_DONTNEED; break;
+    default: native_advice = MADV_NORMAL; break;
+  }
+  int r = madvise(it->second.base, it->second.length, native_advice);
+  int error = r ? _map_error() : 0;
+  _unlock_mappings();
+  if (r) {
+    ThrowException(env, error, "madvise");
+  }
+  return r;
+#endif
+}
+
+/*
+ * Class:     com_oracle_libuv_Files
+ * Method:    _msync
+ * Signature: (JLjava/nio/ByteBuffer;Z)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1msync
+  (JNIEnv *env, jobject that, jlong ptr, jobject buffer, jboolean sync) {
+
+  assert(ptr);
+  _lock_mappings();
+  std::map<char*, Mapping>::iterator it = _mapping_of(env, buffer);
+  if (it == _mappings.end()) {
+    _unlock_mappings();
+    ThrowException(env, UV_EINVAL, "msync", "not a mapped buffer");
+    return -1;
+  }
+#ifdef _WIN32
+  int r = FlushViewOfFile(it->second.base, it->second.length) ? 0 : -1;
+#else
+  int r = msync(it->second.base, it->second.length, sync ? MS_SYNC : MS_ASYNC);
+#endif
+  int error = r ? _map_error() : 0;
+  _unlock_mappings();
+  if (r) {
+    ThrowException(env, error, "msync");
+  }
+  return r;
+}
+
+// must be equal to the TYPE_* constants in DirectoryCursor.java
+enum DirentType {
+  DIRENT_UNKNOWN = 0,
+  DIRENT_FILE = 1,
+  DIRENT_DIR = 2,
+  DIRENT_LINK = 3,
+  DIRENT_FIFO = 4,
+  DIRENT_SOCKET = 5,
+  DIRENT_CHAR = 6,
+  DIRENT_BLOCK = 7
+};
+
+// An open directory read in batches by _readdir_next. The entry that did
+// not fit in the previous batch is kept pending for the next one.
+struct DirCursor {
+#ifdef _WIN32
+  HANDLE find;
+  WIN32_FIND_DATAW data;
+  bool pending;
+#else
+  DIR* dir;
+  struct dirent* pending;
+#endif
+};
+
+static inline bool _is_dot_entry(const char* name) {
+  return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+#ifdef _WIN32
+
+static int _dirent_type(const WIN32_FIND_DATAW* data) {
+  if (data->dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) {
+    return DIRENT_LINK;
+  }
+  return data->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ? DIRENT_DIR : DIRENT_FILE;
+}
+
+#else
+
+static int _dirent_type(const struct dirent* entry) {
+#ifdef DT_UNKNOWN
+  switch (entry->d_type) {
+    case DT_REG: return DIRENT_FILE;
+    case DT_DIR: return DIRENT_DIR;
+    case DT_LNK: return DIRENT_LINK;
+    case DT_FIFO: return DIRENT_FIFO;
+    case DT_SOCK: return DIRENT_SOCKET;
+    case DT_CHR: return DIRENT_CHAR;
+    case DT_BLK: return DIRENT_BLOCK;
+  }
+#endif
+  return DIRENT_UNKNOWN;
+}
+
+#endif // _WIN32
+
+/*
+ * Class:     com_oracle_libuv_Files
+ * Method:    _opendir
+ * Signature: (JLjava/lang/String;)J
+ */
+JNIEXPORT jlong JNICALL Java_com_oracle_libuv_Files__1opendir
+  (JNIEnv *env, jobject that, jlong ptr, jstring path) {
+
+  assert(ptr);
+  const char* cpath = env->GetStringUTFChars(path, 0);
+  DirCursor* cursor = new DirCursor();
+#ifdef _WIN32
+  std::string pattern(cpath);
+  pattern.append("\\*");
+  int length = MultiByteToWideChar(CP_UTF8, 0, pattern.c_str(), -1, NULL, 0);
+  std::vector<WCHAR> wpattern(length > 0 ? length : 1);
+  MultiByteToWideChar(CP_UTF8, 0, pattern.c_str(), -1, &wpattern[0], length);
+  cursor->find = FindFirstFileW(&wpattern[0], &cursor->data);
+  cursor->pending = cursor->find != INVALID_HANDLE_VALUE;
+  bool failed = !cursor->pending && GetLastError() != ERROR_FILE_NOT_FOUND;
+#else
+  cursor->dir = opendir(cpath);
+  cursor->pending = NULL;
+  bool failed = cursor->dir == NULL;
+#endif
+  if (failed) {
+    ThrowException(env, _map_error(), "opendir", NULL, cpath);
+    delete cursor;
+    cursor = NULL;
+  }
+  env->ReleaseStringUTFChars(path, cpath);
+  return reinterpret_cast<jlong>(cursor);
+}
+
+/*
+ * Class:     com_oracle_libuv_Files
+ * Method:    _readdir_next
+ * Signature: (JJLjava/nio/ByteBuffer;I[I[I[I)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1readdir_1next
+  (JNIEnv *env, jobject that, jlong ptr, jlong dir, jobject buffer, jint capacity, jintArray offsets, jintArray lengths, jintArray types) {
+
+  assert(ptr);
+  assert(dir);
+  DirCursor* cursor = reinterpret_cast<DirCursor*>(dir);
+  char* base = reinterpret_cast<char*>(env->GetDirectBufferAddress(buffer));
+  if (!base) {
+    ThrowException(env, UV_EINVAL, "readdir", "direct buffer required");
+    return -1;
+  }
+  jsize max = env->GetArrayLength(types);
+  jint* offs = env->GetIntArrayElements(offsets, NULL);
+  jint* lens = env->GetIntArrayElements(lengths, NULL);
+  jint* kinds = env->GetIntArrayElements(types, NULL);
+  if (!offs || !lens || !kinds) {
+    if (offs) { env->ReleaseIntArrayElements(offsets, offs, JNI_ABORT); }
+    if (lens) { env->ReleaseIntArrayElements(lengths, lens, JNI_ABORT); }
+    if (kinds) { env->ReleaseIntArrayElements(types, kinds, JNI_ABORT); }
+    ThrowOutOfMemoryError(env, FUNCTION_NAME, __FILE__, TOSTRING(__LINE__), "cursor arrays");
+    return -1;
+  }
+
+  jint count = 0;
+  jint used = 0;
+  int error = 0;
+  while (count < max) {
+#ifdef _WIN32
+    if (!cursor->pending) {
+      if (cursor->find == INVALID_HANDLE_VALUE || !FindNextFileW(cursor->find, &cursor->data)) {
+        if (cursor->find != INVALID_HANDLE_VALUE && GetLastError() != ERROR_NO_MORE_FILES) {
+          error = _map_error();
+        }
+        break;
+      }
+      cursor->pending = true;
+    }
+    char name[MAX_PATH * 3];
+    int length = WideCharToMultiByte(CP_UTF8, 0, cursor->data.cFileName, -1, name, sizeof(name), NULL, NULL) - 1;
+    int type = _dirent_type(&cursor->data);
+    if (length < 0 || _is_dot_entry(name)) {
+      cursor->pending = false;
+      continue;
+    }
+#else
+    if (!cursor->pending) {
+      errno = 0;
+      cursor->pending = readdir(cursor->dir);
+      if (!cursor->pending) {
+        error = errno ? sys_error_code(errno) : 0;
+        break;
+      }
+    }
+    const char* name = cursor->pending->d_name;
+    if (_is_dot_entry(name)) {
+      cursor->pending = NULL;
+      continue;
+    }
+    int length = static_cast<int>(strlen(name));
+    int type = _dirent_type(cursor->pending);
+#endif
+    if (used + length > capacity) {
+      // left pending for the next batch
+      if (count == 0) {
+        error = UV_ENOBUFS;
+      }
+      break;
+    }
+    memcpy(base + used, name, length);
+    offs[count] = used;
+    lens[count] = length;
+    kinds[count] = type;
+    used += length;
+    count++;
+#ifdef _WIN32
+    cursor->pending = false;
+#else
+    cursor->pending = NULL;
+#endif
+  }
+
+  env->ReleaseIntArrayElements(offsets, offs, 0);
+  env->ReleaseIntArrayElements(lengths, lens, 0);
+  env->ReleaseIntArrayElements(types, kinds, 0);
+  if (error) {
+    ThrowException(env, error, "readdir");
+    return -1;
+  }
+  return count;
+}
+
+/*
+ * Class:     com_oracle_libuv_Files
+ * Method:    _closedir
+ * Signature: (JJ)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_Files__1closedir
+  (JNIEnv *env, jobject that, jlong ptr, jlong dir) {
+
+  assert(ptr);
+  assert(dir);
+  DirCursor* cursor = reinterpret_cast<DirCursor*>(dir);
+#ifdef _WIN32
+  int r = cursor->find == INVALID_HANDLE_VALUE || FindClose(cursor->find) ? 0 : -1;
+#else
+  int r = closedir(cursor->dir);
+#endif
+  int error = r ? _map_error() : 0;
+  delete cursor;
+  if (r) {
+    ThrowException(env, error, "closedir");
+  }
+  return r;
+}
@@ -27,21 +27,51 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <jni.h>
+#include <map>
+#include <string>
+#include <vector>
 
 #include "uv.h"
 #include "exception.h"
 #include "stream.h"
+#include "loop.h"
 #include "com_oracle_libuv_handles_FileEventHandle.h"
 
+// Events merged per filename, their bits or'ed, until the window elapses
+// or max distinct filenames are pending.
+struct PendingFileEvent {
+  std::string filename;
+  bool named;
+  int events;
+};
+
 class FileEventCallbacks {
 private:
   static jclass _file_event_handle_cid;
 
   static jmethodID _file_event_callback_mid;
+  static jmethodID _file_event_batch_callback_mid;
+
+  // filename strings handed to java are cached up to this many
+  static const size_t NAME_CACHE_LIMIT = 1024;
 
   JNIEnv* _env;
   jobject _instance;
 
+  uv_timer_t* _timer;
+  uint64_t _window;
+  jint _max;
+  jobjectArray _names;
+  jintArray _events;
+  std::vector<PendingFileEvent> _pending;
+  // position in _pending of each named filename, and of the unnamed entry
+  std::map<std::string, size_t> _pending_index;
+  ssize_t _pending_unnamed;
+  std::map<std::string, jstring> _name_cache;
+
+  jstring cached_name(const std::string& filename);
+  void clear_name_cache();
+
 public:
   static void static_initialize(JNIEnv* env, jclass cls);
 
@@ -49,6 +79,15 @@ public:
   ~FileEventCallbacks();
 
   void initialize(JNIEnv* env, jobject instance);
+  // a window of 0 delivers every event as it comes
+  // events already pending are delivered from the loop, not from the call
+  void set_coalescing(uv_loop_t* loop, uint64_t window, jint max, jobjectArray names, jintArray events);
+  void coalesce(int events, const char* filename);
+  void flush();
+  void close_coalescing();
+  void release_coalescing();
+  inline bool coalescing() { return _window > 0; }
+
   void on_event(int status, int event, const char* filename);
   void on_close();
 };
@@ -61,6 +100,7 @@ typedef enum {
 jclass FileEventCallbacks::_file_event_handle_cid = NULL;
 
 jmethodID FileEventCallbacks::_file_event_callback_mid = NULL;
+jmethodID FileEventCallbacks::_file_event_batch_callback_mid = NULL;
 
 void FileEventCallbacks::static_initialize(JNIEnv* env, jclass cls) {
   _file_event_handle_cid = (jclass) env->NewGlobalRef(cls);
@@ -68,6 +108,9 @@ void FileEventCallbacks::static_initialize(JNIEnv* env, jclass cls) {
 
   _file_event_callback_mid = env->GetMethodID(_file_event_handle_cid, "callback", "(IIILjava/lang/String;)V");
   assert(_file_event_callback_mid);
+
+  _file_event_batch_callback_mid = env->GetMethodID(_file_event_handle_cid, "callBatch", "(I)V");
+  assert(_file_event_batch_callback_mid);
 }
 
 void FileEventCallbacks::initialize(JNIEnv* env, jobject instance) {
@@ -78,12 +121,160 @@ void FileEventCallbacks::initialize(JNIEnv* env, jobject instance) {
 }
 
 FileEventCallbacks::FileEventCallbacks() {
+  _timer = NULL;
+  _window = 0;
+  _max = 0;
+  _names = NULL;
+  _events = NULL;
+  _pending_unnamed = -1;
 }
 
 FileEventCallbacks::~FileEventCallbacks() {
+  assert(!_timer);
+  if (_names) { _env->DeleteGlobalRef(_names); }
+  if (_events) { _env->DeleteGlobalRef(_events); }
+  clear_name_cache();
   _env->DeleteGlobalRef(_instance);
 }
 
+static void _coalesce_timer_cb(uv_timer_t* timer, int status) {
+  assert(timer->data);
+  CallbackScope scope(timer->loop, UV_FS_EVENT);
+  FileEventCallbacks* cb = reinterpret_cast<FileEventCallbacks*>(timer->data);
+  cb->flush();
+}
+
+static void _coalesce_timer_close_cb(uv_handle_t* handle) {
+  delete reinterpret_cast<uv_timer_t*>(handle);
+}
+
+jstring FileEventCallbacks::cached_name(const std::string& filename) {
+  std::map<std::string, jstring>::iterator it = _name_cache.find(filename);
+  if (it != _name_cache.end()) {
+    return it->second;
+  }
+  if (_name_cache.size() >= NAME_CACHE_LIMIT) {
+    clear_name_cache();
+  }
+  jstring name = _env->NewStringUTF(filename.c_str());
+  if (!name) {
+    return NULL;
+  }
+  jstring global = (jstring) _env->NewGlobalRef(name);
+  _env->DeleteLocalRef(name);
+  _name_cache[filename] = global;
+  return global;
+}
+
+void FileEventCallbacks::clear_name_cache() {
+  for (std::map<std::string, jstring>::iterator it = _name_cache.begin(); it != _name_cache.end(); ++it) {
+    _env->DeleteGlobalRef(it->second);
+  }
+  _name_cache.clear();
+}
+
+void FileEventCallbacks::set_coalescing(uv_loop_t* loop, uint64_t window, jint max, jobjectArray names, jintArray events) {
+  if (window && !_timer) {
+    uv_timer_t* timer = new uv_timer_t();
+    if (uv_timer_init(loop, timer)) {
+      delete timer;
+      ThrowException(_env, loop, "uv_timer_init");
+      return;
+    }
+    timer->data = this;
+    _timer = timer;
+  }
+  _window = window;
+  _max = window ? max : 0;
+  if (!_pending.empty()) {
+    // the java arrays only grow, the new ones hold what is pending
+    uv_timer_start(_timer, _coalesce_timer_cb, 0, 0);
+  } else if (!window) {
+    release_coalescing();
+    return;
+  }
+  if (_names) { _env->DeleteGlobalRef(_names); }
+  if (_events) { _env->DeleteGlobalRef(_events); }
+  _names = (jobjectArray) _env->NewGlobalRef(names);
+  _events = (jintArray) _env->NewGlobalRef(events);
+}
+
+// once nothing is pending after coalescing was turned off
+void FileEventCallbacks::release_coalescing() {
+  assert(_pending.empty());
+  if (_names) { _env->DeleteGlobalRef(_names); }
+  if (_events) { _env->DeleteGlobalRef(_events); }
+  _names = NULL;
+  _events = NULL;
+  clear_name_cache();
+}
+
+void FileEventCallbacks::coalesce(int events, const char* filename) {
+  if (filename) {
+    std::map<std::string, size_t>::iterator it = _pending_index.find(filename);
+    if (it != _pending_index.end()) {
+      _pending[it->second].events |= events;
+      return;
+    }
+    _pending_index[filename] = _pending.size();
+  } else if (_pending_unnamed >= 0) {
+    _pending[_pending_unnamed].events |= events;
+    return;
+  } else {
+    _pending_unnamed = static_cast<ssize_t>(_pending.size());
+  }
+  PendingFileEvent pending;
+  pending.named = filename != NULL;
+  if (filename) {
+    pending.filename = filename;
+  }
+  pending.events = events;
+  _pending.push_back(pending);
+  if (static_cast<jint>(_pending.size()) >= _max) {
+    flush();
+  } else if (_pending.size() == 1) {
+    uv_timer_start(_timer, _coalesce_timer_cb, _window, 0);
+  }
+}
+
+void FileEventCallbacks::flush() {
+  if (_pending.empty()) {
+    return;
+  }
+  if (_timer) {
+    uv_timer_stop(_timer);
+  }
+  jint count = static_cast<jint>(_pending.size());
+  assert(count <= _env->GetArrayLength(_events));
+  jint* events = _env->GetIntArrayElements(_events, NULL);
+  OOM(_env, events);
+  for (jint i = 0; i < count; i++) {
+    PendingFileEvent* pending = &_pending[i];
+    events[i] = pending->events;
+    _env->SetObjectArrayElement(_names, i, pending->named ? cached_name(pending->filename) : NULL);
+  }
+  _env->ReleaseIntArrayElements(_events, events, 0);
+  _pending.clear();
+  _pending_index.clear();
+  _pending_unnamed = -1;
+  _env->CallVoidMethod(
+      _instance,
+      _file_event_batch_callback_mid,
+      count);
+  if (!_window && _pending.empty()) {
+    release_coalescing();
+  }
+}
+
+// what is pending is delivered by the close callback
+void FileEventCallbacks::close_coalescing() {
+  if (_timer) {
+    uv_close(reinterpret_cast<uv_handle_t*>(_timer), _coalesce_timer_close_cb);
+    _timer = NULL;
+  }
+  _window = 0;
+}
+
 void FileEventCallbacks::on_event(int status, int events, const char* filename) {
   assert(_env);
   jstring f = _env->NewStringUTF(filename);
@@ -111,7 +302,14 @@ void FileEventCallbacks::on_close() {
 static void on_event_cb(uv_fs_event_t* handle, const char* filename, int events, int status) {
   assert(handle);
   assert(handle->data);
+  CallbackScope scope(handle->loop, UV_FS_EVENT);
   FileEventCallbacks* cb = reinterpret_cast<FileEventCallbacks*>(handle->data);
+  if (status == 0 && cb->coalescing()) {
+    cb->coalesce(events, filename);
+    return;
+  }
+  // errors are reported right away, after whatever was pending
+  cb->flush();
   cb->on_event(status, events, filename);
 }
 
@@ -119,7 +317,9 @@ static void _close_cb(uv_handle_t* handle) {
 
   assert(handle);
   assert(handle->data);
+  CallbackScope scope(handle->loop, handle->type);
   FileEventCallbacks* cb = reinterpret_cast<FileEventCallbacks*>(handle->data);
+  cb->flush();
   cb->on_close();
   delete cb;
   delete handle;
@@ -200,5 +400,26 @@ JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_FileEventHandle__1close
 
   assert(fs_event_ptr);
   uv_handle_t* handle = reinterpret_cast<uv_handle_t*>(fs_event_ptr);
+  assert(handle->data);
+  FileEventCallbacks* cb = reinterpret_cast<FileEventCallbacks*>(handle->data);
+  cb->close_coalescing();
   uv_close(handle, _close_cb);
 }
+
+/*
+ * Class:     com_oracle_libuv_handles_FileEventHandle
+ * Method:    _set_coalescing
+ * Signature: (JJJI[Ljava/lang/String;[I)V
+ */
+JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_FileEventHandle__1set_1coalescing
+  (JNIEnv *env, jobject that, jlong loop_ptr, jlong fs_event_ptr, jlong window, jint max, jobjectArray names, jintArray events) {
+
+  assert(loop_ptr);
+  assert(fs_event_ptr);
+  uv_loop_t* loop = reinterpret_cast<uv_loop_t*>(loop_ptr);
+  uv_fs_event_t* handle = reinterpret_cast<uv_fs_event_t*>(fs_event_ptr);
+  assert(handle->data);
+  assert(!window || (max > 0 && env->GetArrayLength(names) >= max && env->GetArrayLength(events) >= max));
+  FileEventCallbacks* cb = reinterpret_cast<FileEventCallbacks*>(handle->data);
+  cb->set_coalescing(loop, static_cast<uint64_t>(window), max, names, events);
+}
@@ -32,6 +32,7 @@
 #include "exception.h"
 #include "stats.h"
 #include "stream.h"
+#include "loop.h"
 #include "com_oracle_libuv_handles_FilePollHandle.h"
 
 class FilePollCallbacks {
@@ -128,6 +129,7 @@ void FilePollCallbacks::set_stats(jobject previous, jobject current) {
 static void _poll_cb(uv_fs_poll_t* handle, int status, const uv_statbuf_t* previous, const uv_statbuf_t* current) {
   assert(handle);
   assert(handle->data);
+  CallbackScope scope(handle->loop, UV_FS_POLL);
   FilePollCallbacks* cb = reinterpret_cast<FilePollCallbacks*>(handle->data);
   cb->on_poll(status, previous, current);
 }
@@ -135,6 +137,7 @@ static void _poll_cb(uv_fs_poll_t* handle, int status, const uv_statbuf_t* previ
 static void _stop_cb(uv_handle_t* handle) {
   assert(handle);
   assert(handle->data);
+  CallbackScope scope(handle->loop, handle->type);
   FilePollCallbacks* cb = reinterpret_cast<FilePollCallbacks*>(handle->data);
   cb->on_stop();
   delete cb;
@@ -0,0 +1,577 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+#include <assert.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <jni.h>
+
+#include "uv.h"
+#include "exception.h"
+#include "stats.h"
+#include "loop.h"
+#include "com_oracle_libuv_handles_FilePollGroup.h"
+
+// Polls many paths on one uv_timer_t schedule. Each round stats the
+// watched paths in chunks on the thread pool, with at most MAX_JOBS chunks
+// queued so other file requests are not starved, diffs the results
+// against a compact per path snapshot and sends the changes of the whole
+// round up to Java in batches once the last chunk is in.
+class FilePollGroup {
+public:
+  static const int MAX_JOBS = 2;
+
+  // the fields uv_fs_poll compares, times in nanoseconds
+  struct Snapshot {
+    int64_t size;
+    int64_t mtime;
+    int64_t ctime;
+    uint64_t ino;
+    uint64_t dev;
+    uint32_t mode;
+    int32_t error;
+
+    void set(int error, const uv_statbuf_t* buf);
+    bool differs(const Snapshot& other) const;
+  };
+
+  struct Batch {
+    uv_work_t work;
+    FilePollGroup* group;
+    std::vector<int32_t> ids;
+    std::vector<uint32_t> generations;
+    std::vector<std::string> paths;
+    std::vector<Snapshot> results;
+  };
+
+private:
+  struct Entry {
+    std::string path;
+    Snapshot snapshot;
+    uint32_t generation;
+    bool active;
+    bool seen;
+    int32_t next_free;
+  };
+
+  struct Change {
+    int32_t id;
+    uint32_t generation;
+    int32_t status;
+  };
+
+  static jclass _file_poll_group_cid;
+  static jmethodID _changes_mid;
+
+  JNIEnv* _env;
+  jobject _instance;
+  jintArray _ids;
+  jintArray _statuses;
+  jsize _batch_size;
+
+  uv_loop_t* _loop;
+  uv_timer_t* _timer;
+  uint64_t _interval;
+  size_t _chunk_size;
+  uint64_t _round_start;
+  size_t _cursor;
+  int _jobs;
+  bool _running;
+  bool _in_round;
+  size_t _count;
+  int32_t _free;
+  std::vector<Entry> _entries;
+  std::vector<Change> _changes;
+  std::vector<Batch*> _spare;
+  std::vector<jint> _out_ids;
+  std::vector<jint> _out_statuses;
+
+  void pump();
+  void end_round();
+  void flush();
+
+public:
+  static void static_initialize(JNIEnv* env, jclass cls);
+
+  FilePollGroup(uv_timer_t* timer, uint64_t interval, size_t chunk_size);
+  ~FilePollGroup();
+
+  void initialize(JNIEnv* env, jobject instance, jintArray ids, jintArray statuses);
+
+  inline size_t count() const { return _count; }
+
+  jint add(const char* path);
+  bool remove(jint id);
+  void start();
+  void stop();
+  void begin_round();
+  void on_batch(Batch* batch);
+  // the timer is gone, false while chunks are still out
+  bool detach();
+};
+
+jclass FilePollGroup::_file_poll_group_cid = NULL;
+jmethodID FilePollGroup::_changes_mid = NULL;
+
+static void _round_cb(uv_timer_t* handle, int status) {
+  assert(handle);
+  assert(handle->data);
+  CallbackScope scope(handle->loop, UV_FS_POLL);
+  reinterpret_cast<FilePollGroup*>(handle->data)->begin_round();
+}
+
+static void _close_cb(uv_handle_t* handle) {
+  assert(handle);
+  assert(handle->data);
+  FilePollGroup* group = reinterpret_cast<FilePollGroup*>(handle->data);
+  if (group->detach()) {
+    delete group;
+  }
+  delete handle;
+}
+
+static void _stat_work_cb(uv_work_t* work) {
+  FilePollGroup::Batch* batch = reinterpret_cast<FilePollGroup::Batch*>(work->data);
+  for (size_t i = 0; i < batch->paths.size(); i++) {
+    uv_statbuf_t buf;
+    int error = Stats::stat_path(batch->paths[i].c_str(), &buf);
+    batch->results[i].set(error, &buf);
+  }
+}
+
+static void _stat_after_work_cb(uv_work_t* work, int status) {
+  CallbackScope scope(work->loop, UV_FS_POLL);
+  FilePollGroup::Batch* batch = reinterpret_cast<FilePollGroup::Batch*>(work->data);
+  FilePollGroup* group = batch->group;
+  group->on_batch(batch);
+}
+
+void FilePollGroup::Snapshot::set(int error, const uv_statbuf_t* buf) {
+  if (error) {
+    memset(this, 0, sizeof(*this));
+    this->error = error;
+    return;
+  }
+  int64_t mtime_nsec = 0;
+  int64_t ctime_nsec = 0;
+#if defined(__linux__)
+  mtime_nsec = buf->st_mtim.tv_nsec;
+  ctime_nsec = buf->st_ctim.tv_nsec;
+#elif defined(__APPLE__)
+  mtime_nsec = buf->st_mtimespec.tv_nsec;
+  ctime_nsec = buf->st_ctimespec.tv_nsec;
+#endif
+  size = buf->st_size;
+  mtime = static_cast<int64_t>(buf->st_mtime) * 1000000000 + mtime_nsec;
+  ctime = static_cast<int64_t>(buf->st_ctime) * 1000000000 + ctime_nsec;
+  ino = buf->st_ino;
+  dev = buf->st_dev;
+  mode = buf->st_mode;
+  this->error = 0;
+}
+
+bool FilePollGroup::Snapshot::differs(const Snapshot& other) const {
+  if (error || other.error) {
+    return error != other.error;
+  }
+  return size != other.size ||
+         mtime != other.mtime ||
+         ctime != other.ctime ||
+         ino != other.ino ||
+         dev != other.dev ||
+         mode != other.mode;
+}
+
+void FilePollGroup::static_initialize(JNIEnv* env, jclass cls) {
+  _file_poll_group_cid = (jclass) env->NewGlobalRef(cls);
+  assert(_file_poll_group_cid);
+
+  _changes_mid = env->GetMethodID(_file_poll_group_cid, "callChanges", "(I)V");
+  assert(_changes_mid);
+}
+
+FilePollGroup::FilePollGroup(uv_timer_t* timer, uint64_t interval, size_t chunk_size) :
+  _env(NULL),
+  _instance(NULL),
+  _ids(NULL),
+  _statuses(NULL),
+  _batch_size(0),
+  _loop(timer->loop),
+  _timer(timer),
+  _interval(interval),
+  _chunk_size(chunk_size),
+  _round_start(0),
+  _cursor(0),
+  _jobs(0),
+  _running(false),
+  _in_round(false),
+  _count(0),
+  _free(-1) {
+
+  assert(interval > 0);
+  assert(chunk_size > 0);
+}
+
+FilePollGroup::~FilePollGroup() {
+  assert(_jobs == 0);
+  for (size_t i = 0; i < _spare.size(); i++) {
+    delete _spare[i];
+  }
+  if (_env) {
+    _env->DeleteGlobalRef(_instance);
+    _env->DeleteGlobalRef(_ids);
+    _env->DeleteGlobalRef(_statuses);
+  }
+}
+
+void FilePollGroup::initialize(JNIEnv* env, jobject instance, jintArray ids, jintArray statuses) {
+  _env = env;
+  assert(_env);
+  assert(instance);
+  assert(ids);
+  assert(statuses);
+  _instance = _env->NewGlobalRef(instance);
+  _ids = reinterpret_cast<jintArray>(_env->NewGlobalRef(ids));
+  _statuses = reinterpret_cast<jintArray>(_env->NewGlobalRef(statuses));
+  _batch_size = _env->GetArrayLength(ids);
+  assert(_batch_size > 0);
+  assert(_batch_size == _env->GetArrayLength(statuses));
+}
+
+jint FilePollGroup::add(const char* path) {
+  int32_t index = _free;
+  if (index >= 0) {
+    _free = _entries[index].next_free;
+  } else {
+    Entry entry;
+    entry.generation = 0;
+    index = static_cast<int32_t>(_entries.size());
+    _entries.push_back(entry);
+  }
+  Entry* entry = &_entries[index];
+  entry->path = path;
+  // results of chunks stating the previous owner of the slot are dropped
+  entry->generation++;
+  entry->active = true;
+  entry->seen = false;
+  entry->next_free = -1;
+  _count++;
+  return index;
+}
+
+bool FilePollGroup::remove(jint id) {
+  if (id < 0 || static_cast<size_t>(id) >= _entries.size() || !_entries[id].active) {
+    return false;
+  }
+  Entry* entry = &_entries[id];
+  entry->active = false;
+  std::string().swap(entry->path);
+  entry->next_free = _free;
+  _free = id;
+  _count--;
+  return true;
+}
+
+void FilePollGroup::start() {
+  _running = true;
+  if (!_in_round) {
+    // the first round takes the snapshots to compare against
+    uv_timer_start(_timer, _round_cb, 0, 0);
+  }
+}
+
+void FilePollGroup::stop() {
+  // chunks already queued finish, their changes are dropped
+  _running = false;
+  if (!_in_round) {
+    uv_timer_stop(_timer);
+  }
+}
+
+void FilePollGroup::begin_round() {
+  assert(!_in_round);
+  _in_round = true;
+  _round_start = uv_now(_loop);
+  _cursor = 0;
+  pump();
+}
+
+void FilePollGroup::pump() {
+  while (_running && _jobs < MAX_JOBS && _cursor < _entries.size()) {
+    Batch* batch;
+    if (_spare.empty()) {
+      batch = new Batch();
+      batch->group = this;
+    } else {
+      batch = _spare.back();
+      _spare.pop_back();
+    }
+    batch->ids.clear();
+    batch->generations.clear();
+    batch->paths.clear();
+    // the worker only sees copies, adds and removes stay on the loop thread
+    for (; _cursor < _entries.size() && batch->ids.size() < _chunk_size; _cursor++) {
+      const Entry& entry = _entries[_cursor];
+      if (entry.active) {
+        batch->ids.push_back(static_cast<int32_t>(_cursor));
+        batch->generations.push_back(entry.generation);
+        batch->paths.push_back(entry.path);
+      }
+    }
+    if (batch->ids.empty()) {
+      _spare.push_back(batch);
+      break;
+    }
+    batch->results.resize(batch->ids.size());
+    batch->work.data = batch;
+    int r = uv_queue_work(_loop, &batch->work, _stat_work_cb, _stat_after_work_cb);
+    if (r) {
+      // the paths of this chunk get stated again next round
+      _spare.push_back(batch);
+      break;
+    }
+    _jobs++;
+  }
+  if (_jobs == 0) {
+    end_round();
+  }
+}
+
+void FilePollGroup::on_batch(Batch* batch) {
+  assert(_jobs > 0);
+  _jobs--;
+  if (!_timer) {
+    // closed while the chunk was out
+    delete batch;
+    if (_jobs == 0) {
+      delete this;
+    }
+    return;
+  }
+
+  for (size_t i = 0; i < batch->ids.size(); i++) {
+    Entry* entry = &_entries[batch->ids[i]];
+    if (!entry->active || entry->generation != batch->generations[i]) {
+      continue;
+    }
+    const Snapshot& current = batch->results[i];
+    // like uv_fs_poll the first stat only reports an error
+    bool changed = entry->seen ? entry->snapshot.differs(current) : current.error != 0;
+    entry->snapshot = current;
+    entry->seen = true;
+    if (changed && _running) {
+      Change change;
+      change.id = batch->ids[i];
+      change.generation = batch->generations[i];
+      change.status = current.error;
+      _changes.push_back(change);
+    }
+  }
+  _spare.push_back(batch);
+  pump();
+}
+
+void FilePollGroup::end_round() {
+  _in_round = false;
+  if (!_running) {
+    _changes.clear();
+    return;
+  }
+  uint64_t elapsed = uv_now(_loop) - _round_start;
+  uv_timer_start(_timer, _round_cb, elapsed < _interval ? _interval - elapsed : 0, 0);
+  flush();
+}
+
+void FilePollGroup::flush() {
+  assert(_env);
+  // paths removed by earlier upcalls of this flush are skipped
+  size_t offset = 0;
+  while (offset < _changes.size()) {
+    _out_ids.clear();
+    _out_statuses.clear();
+    for (; offset < _changes.size() && _out_ids.size() < static_cast<size_t>(_batch_size); offset++) {
+      const Change& change = _changes[offset];
+      const Entry& entry = _entries[change.id];
+      if (entry.active && entry.generation == change.generation) {
+        _out_ids.push_back(change.id);
+        _out_statuses.push_back(change.status);
+      }
+    }
+    if (_out_ids.empty()) {
+      break;
+    }
+    jsize count = static_cast<jsize>(_out_ids.size());
+    _env->SetIntArrayRegion(_ids, 0, count, &_out_ids[0]);
+    _env->SetIntArrayRegion(_statuses, 0, count, &_out_statuses[0]);
+    _env->CallVoidMethod(_instance, _changes_mid, count);
+    if (uv_is_closing(reinterpret_cast<uv_handle_t*>(_timer))) {
+      break;
+    }
+  }
+  _changes.clear();
+}
+
+bool FilePollGroup::detach() {
+  _timer = NULL;
+  _running = false;
+  return _jobs == 0;
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_FilePollGroup
+ * Method:    _static_initialize
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_FilePollGroup__1static_1initialize
+  (JNIEnv *env, jclass cls) {
+
+  FilePollGroup::static_initialize(env, cls);
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_FilePollGroup
+ * Method:    _new
+ * Signature: (JJI)J
+ */
+JNIEXPORT jlong JNICALL Java_com_oracle_libuv_handles_FilePollGroup__1new
+  (JNIEnv *env, jclass cls, jlong loop, jlong interval, jint chunk_size) {
+
+  assert(loop);
+  assert(interval > 0);
+  assert(chunk_size > 0);
+  uv_loop_t* lp = reinterpret_cast<uv_loop_t*>(loop);
+  uv_timer_t* timer = new uv_timer_t();
+  int r = uv_timer_init(lp, timer);
+  if (r) {
+    ThrowException(env, timer->loop, "uv_timer_init");
+  } else {
+    timer->data = new FilePollGroup(timer, static_cast<uint64_t>(interval), static_cast<size_t>(chunk_size));
+  }
+  return reinterpret_cast<jlong>(timer);
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_FilePollGroup
+ * Method:    _initialize
+ * Signature: (J[I[I)V
+ */
+JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_FilePollGroup__1initialize
+  (JNIEnv *env, jobject that, jlong ptr, jintArray ids, jintArray statuses) {
+
+  assert(ptr);
+  uv_timer_t* handle = reinterpret_cast<uv_timer_t*>(ptr);
+  assert(handle->data);
+  reinterpret_cast<FilePollGroup*>(handle->data)->initialize(env, that, ids, statuses);
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_FilePollGroup
+ * Method:    _add
+ * Signature: (JLjava/lang/String;)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_FilePollGroup__1add
+  (JNIEnv *env, jobject that, jlong ptr, jstring path) {
+
+  assert(ptr);
+  assert(path);
+  uv_timer_t* handle = reinterpret_cast<uv_timer_t*>(ptr);
+  assert(handle->data);
+  const char* cpath = env->GetStringUTFChars(path, 0);
+  jint id = reinterpret_cast<FilePollGroup*>(handle->data)->add(cpath);
+  env->ReleaseStringUTFChars(path, cpath);
+  return id;
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_FilePollGroup
+ * Method:    _remove
+ * Signature: (JI)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_oracle_libuv_handles_FilePollGroup__1remove
+  (JNIEnv *env, jobject that, jlong ptr, jint id) {
+
+  assert(ptr);
+  uv_timer_t* handle = reinterpret_cast<uv_timer_t*>(ptr);
+  assert(handle->data);
+  return reinterpret_cast<FilePollGroup*>(handle->data)->remove(id) ? JNI_TRUE : JNI_FALSE;
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_FilePollGroup
+ * Method:    _start
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_FilePollGroup__1start
+  (JNIEnv *env, jobject that, jlong ptr) {
+
+  assert(ptr);
+  uv_timer_t* handle = reinterpret_cast<uv_timer_t*>(ptr);
+  assert(handle->data);
+  reinterpret_cast<FilePollGroup*>(handle->data)->start();
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_FilePollGroup
+ * Method:    _stop
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_FilePollGroup__1stop
+  (JNIEnv *env, jobject that, jlong ptr) {
+
+  assert(ptr);
+  uv_timer_t* handle = reinterpret_cast<uv_timer_t*>(ptr);
+  assert(handle->data);
+  reinterpret_cast<FilePollGroup*>(handle->data)->stop();
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_FilePollGroup
+ * Method:    _size
+ * Signature: (J)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_FilePollGroup__1size
+  (JNIEnv *env, jobject that, jlong ptr) {
+
+  assert(ptr);
+  uv_timer_t* handle = reinterpret_cast<uv_timer_t*>(ptr);
+  assert(handle->data);
+  return static_cast<jint>(reinterpret_cast<FilePollGroup*>(handle->data)->count());
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_FilePollGroup
+ * Method:    _close
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_FilePollGroup__1close
+  (JNIEnv *env, jobject that, jlong ptr) {
+
+  assert(ptr);
+  uv_timer_t* handle = reinterpret_cast<uv_timer_t*>(ptr);
+  assert(handle->data);
+  reinterpret_cast<FilePollGroup*>(handle->data)->stop();
+  uv_close(reinterpret_cast<uv_handle_t*>(handle), _close_cb);
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "freelist.h"
+
+FreeList::FreeList() {
+  _size = 0;
+  _limit = DEFAULT_LIMIT;
+  _in_use = 0;
+  _high_water = 0;
+  _allocated = 0;
+}
+
+FreeList::~FreeList() {
+  for (size_t i = 0; i < _free.size(); i++) {
+    free(_free[i]);
+  }
+}
+
+void FreeList::set_limit(size_t limit) {
+  _limit = limit;
+  while (_free.size() > _limit) {
+    free(_free.back());
+    _free.pop_back();
+  }
+}
+
+void* FreeList::allocate(size_t size) {
+  if (_size == 0) {
+    _size = size;
+  }
+  assert(size <= _size);
+  Header* header;
+  if (_free.empty()) {
+    header = static_cast<Header*>(malloc(sizeof(Header) + _size));
+    if (!header) {
+      return NULL;
+    }
+    _allocated++;
+  } else {
+    header = _free.back();
+    _free.pop_back();
+  }
+  header->owner = this;
+  if (++_in_use > _high_water) {
+    _high_water = _in_use;
+  }
+  return header + 1;
+}
+
+void* FreeList::allocate(FreeList* list, size_t size) {
+  if (list) {
+    return list->allocate(size);
+  }
+  Header* header = static_cast<Header*>(malloc(sizeof(Header) + size));
+  if (!header) {
+    return NULL;
+  }
+  header->owner = NULL;
+  return header + 1;
+}
+
+void FreeList::release(void* ptr) {
+  if (!ptr) {
+    return;
+  }
+  Header* header = static_cast<Header*>(ptr) - 1;
+  FreeList* list = header->owner;
+  if (!list) {
+    free(header);
+    return;
+  }
+  assert(list->_in_use > 0);
+  list->_in_use--;
+  if (list->_free.size() < list->_limit) {
+    list->_free.push_back(header);
+  } else {
+    free(header);
+  }
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+#ifndef _libuv_java_freelist_h_
+#define _libuv_java_freelist_h_
+
+#include <assert.h>
+#include <stddef.h>
+#include <new>
+#include <vector>
+
+// A cache of equally sized blocks for one kind of request object.
+// Every block starts with a hidden header naming its owning list, so a
+// block can be released through FreeList::release without knowing the
+// list, and blocks allocated with a NULL list simply go back to the heap.
+// Not thread safe, a list belongs to exactly one loop.
+class FreeList {
+private:
+  union Header {
+    FreeList* owner;
+    double align_double;
+    long long align_long;
+    void* align_pointer;
+  };
+
+  size_t _size;
+  size_t _limit;
+  size_t _in_use;
+  size_t _high_water;
+  size_t _allocated;
+  std::vector<Header*> _free;
+
+public:
+  static const size_t DEFAULT_LIMIT = 1024;
+
+  FreeList();
+  ~FreeList();
+
+  inline size_t in_use() const { return _in_use; }
+  inline size_t cached() const { return _free.size(); }
+  inline size_t high_water() const { return _high_water; }
+  inline size_t allocated() const { return _allocated; }
+  inline size_t limit() const { return _limit; }
+  void set_limit(size_t limit);
+
+  // the first allocation fixes the block size of the list,
+  // returns NULL when out of memory
+  void* allocate(size_t size);
+
+  static void* allocate(FreeList* list, size_t size);
+  static void release(void* ptr);
+};
+
+// value initialized (zeroed for plain libuv request structs)
+template <typename T>
+inline T* freelist_new(FreeList* list) {
+  void* ptr = FreeList::allocate(list, sizeof(T));
+  return ptr ? new (ptr) T() : NULL;
+}
+
+template <typename T>
+inline void freelist_delete(T* ptr) {
+  if (ptr) {
+    ptr->~T();
+    FreeList::release(ptr);
+  }
+}
+
+#endif // _libuv_java_freelist_h_
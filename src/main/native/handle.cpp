@@ -29,6 +29,8 @@
 #include "uv.h"
 #include "exception.h"
 #include "handle.h"
+#include "stream.h"
+#include "udp.h"
 #include "com_oracle_libuv_handles_Handle.h"
 
 const char* handle_typeof(const uv_handle_t* handle) {
@@ -65,6 +67,22 @@ const char* handle_to_string(const uv_handle_t* handle) {
     return buffer;
 }
 
+const IoCounters* handle_io_counters(const uv_handle_t* handle) {
+    if (!handle->data) {
+      return NULL;
+    }
+    switch (handle->type) {
+        case UV_NAMED_PIPE:
+        case UV_TCP:
+        case UV_TTY:
+            return &reinterpret_cast<StreamCallbacks*>(handle->data)->counters();
+        case UV_UDP:
+            return &reinterpret_cast<UDPCallbacks*>(handle->data)->counters();
+        default:
+            return NULL;
+    }
+}
+
 /*
  * Class:     com_oracle_libuv_handles_Handle
  * Method:    _ref
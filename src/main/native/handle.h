@@ -24,6 +24,7 @@
  */
 
 #include <jni.h>
+#include <stdint.h>
 
 #include "uv.h"
 
@@ -40,4 +41,43 @@ const char* handle_typeof(const uv_handle_t* handle);
 // caller must delete the returned c string
 const char* handle_to_string(const uv_handle_t* handle);
 
+// I/O accounting of a stream or udp handle, reported by LoopHandle.census
+struct IoCounters {
+  uint64_t bytes_read;
+  uint64_t reads;
+  uint64_t bytes_written;
+  uint64_t writes;
+  uint64_t write_queue_peak;
+  // loop time in milliseconds, 0 until the first read or write
+  uint64_t last_activity;
+
+  IoCounters() :
+    bytes_read(0),
+    reads(0),
+    bytes_written(0),
+    writes(0),
+    write_queue_peak(0),
+    last_activity(0) {
+  }
+
+  inline void count_read(uv_loop_t* loop, size_t bytes) {
+    bytes_read += bytes;
+    reads++;
+    last_activity = uv_now(loop);
+  }
+
+  // queued is the write queue size including this write
+  inline void count_write(uv_loop_t* loop, size_t bytes, size_t queued) {
+    bytes_written += bytes;
+    writes++;
+    if (queued > write_queue_peak) {
+      write_queue_peak = queued;
+    }
+    last_activity = uv_now(loop);
+  }
+};
+
+// the counters of a stream or udp handle, NULL for other handle types
+const IoCounters* handle_io_counters(const uv_handle_t* handle);
+
 #endif // _libuv_java_handle_h_
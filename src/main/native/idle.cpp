@@ -31,6 +31,7 @@
 #include "uv.h"
 #include "exception.h"
 #include "stream.h"
+#include "loop.h"
 #include "com_oracle_libuv_handles_IdleHandle.h"
 
 class IdleCallbacks {
@@ -107,6 +108,7 @@ void IdleCallbacks::on_close() {
 static void _idle_cb(uv_idle_t* handle, int status) {
   assert(handle);
   assert(handle->data);
+  CallbackScope scope(handle->loop, UV_IDLE);
   IdleCallbacks* cb = reinterpret_cast<IdleCallbacks*>(handle->data);
   cb->on_idle(status);
 }
@@ -114,6 +116,7 @@ static void _idle_cb(uv_idle_t* handle, int status) {
 static void _close_cb(uv_handle_t* handle) {
   assert(handle);
   assert(handle->data);
+  CallbackScope scope(handle->loop, handle->type);
   IdleCallbacks* cb = reinterpret_cast<IdleCallbacks*>(handle->data);
   cb->on_close();
   delete cb;
@@ -31,25 +31,139 @@
 #include "uv.h"
 #include "exception.h"
 #include "handle.h"
+#include "loop.h"
 #include "com_oracle_libuv_handles_LoopHandle.h"
 
 static jclass _string_cid = NULL;
 
+LoopData::LoopData() :
+  _read_pool(BufferPool::DEFAULT_CHUNK_SIZE, BufferPool::DEFAULT_CHUNKS_PER_SLAB),
+  _write_pool(WRITE_CHUNK_SIZE, WRITE_CHUNKS_PER_SLAB),
+  _metrics(NULL),
+  _callbacks(0),
+  _stop_requested(false) {
+}
+
+LoopData::~LoopData() {
+  if (_metrics) {
+    // the loop goes away with it, there is no closing phase left to run
+    _metrics->abandon();
+    delete _metrics;
+  }
+}
+
+void LoopData::set_metrics_enabled(uv_loop_t* loop, bool enabled) {
+  if (enabled && !_metrics) {
+    _metrics = new LoopMetrics(loop);
+  } else if (!enabled && _metrics) {
+    _metrics->close();
+    _metrics = NULL;
+  }
+}
+
+static inline bool _is_internal(uv_handle_t* handle) {
+  LoopMetrics* metrics = handle->loop->data ? LoopData::get(handle->loop)->metrics() : NULL;
+  return metrics && metrics->owns(handle);
+}
+
 static void _close_cb(uv_handle_t* handle) {
 }
 
 static void _close_all_cb(uv_handle_t* handle, void* arg) {
-  if (!uv_is_closing(handle)) {
+  if (!uv_is_closing(handle) && !_is_internal(handle)) {
     uv_close(handle, _close_cb);
   }
 }
 
 static void _list_cb(uv_handle_t* handle, void* arg) {
+    if (_is_internal(handle)) {
+      return;
+    }
     const char* s = handle_to_string(handle);
     std::vector<const char*>* bag = static_cast<std::vector<const char*>*>(arg);
     bag->push_back(s);
 }
 
+// uv_has_ref only arrived with libuv 1.0, 0.10 keeps the bit in uv-common.h
+#ifdef _WIN32
+static const unsigned int HANDLE_REF_FLAG = 0x20;
+#else
+static const unsigned int HANDLE_REF_FLAG = 0x2000;
+#endif
+
+// must be equal to the CENSUS_ offsets in LoopHandle.java, in longs
+enum CensusLayout {
+  CENSUS_TYPE = 0,
+  CENSUS_POINTER,
+  CENSUS_FLAGS,
+  CENSUS_BYTES_READ,
+  CENSUS_READS,
+  CENSUS_BYTES_WRITTEN,
+  CENSUS_WRITES,
+  CENSUS_WRITE_QUEUE_PEAK,
+  CENSUS_WRITE_QUEUE_SIZE,
+  CENSUS_IDLE_TIME,
+  CENSUS_LENGTH
+};
+
+enum CensusFlags {
+  CENSUS_ACTIVE = 1,
+  CENSUS_REFED = 2,
+  CENSUS_CLOSING = 4,
+  CENSUS_COUNTED = 8
+};
+
+struct Census {
+  char* out;
+  size_t capacity;
+  size_t count;
+  uint64_t now;
+};
+
+static void _census_cb(uv_handle_t* handle, void* arg) {
+  if (_is_internal(handle)) {
+    return;
+  }
+  Census* census = static_cast<Census*>(arg);
+  if (census->count++ >= census->capacity) {
+    // keep counting so the caller learns how much room it needs
+    return;
+  }
+  jlong record[CENSUS_LENGTH];
+  memset(record, 0, sizeof(record));
+  record[CENSUS_TYPE] = handle->type;
+  record[CENSUS_POINTER] = reinterpret_cast<jlong>(handle);
+  jlong flags = 0;
+  if (uv_is_active(handle)) {
+    flags |= CENSUS_ACTIVE;
+  }
+  if (handle->flags & HANDLE_REF_FLAG) {
+    flags |= CENSUS_REFED;
+  }
+  if (uv_is_closing(handle)) {
+    flags |= CENSUS_CLOSING;
+  }
+  record[CENSUS_IDLE_TIME] = -1;
+  const IoCounters* counters = handle_io_counters(handle);
+  if (counters) {
+    flags |= CENSUS_COUNTED;
+    record[CENSUS_BYTES_READ] = static_cast<jlong>(counters->bytes_read);
+    record[CENSUS_READS] = static_cast<jlong>(counters->reads);
+    record[CENSUS_BYTES_WRITTEN] = static_cast<jlong>(counters->bytes_written);
+    record[CENSUS_WRITES] = static_cast<jlong>(counters->writes);
+    record[CENSUS_WRITE_QUEUE_PEAK] = static_cast<jlong>(counters->write_queue_peak);
+    if (handle->type != UV_UDP) {
+      record[CENSUS_WRITE_QUEUE_SIZE] = static_cast<jlong>(reinterpret_cast<uv_stream_t*>(handle)->write_queue_size);
+    }
+    if (counters->last_activity) {
+      record[CENSUS_IDLE_TIME] = static_cast<jlong>(census->now - counters->last_activity);
+    }
+  }
+  record[CENSUS_FLAGS] = flags;
+  // the buffer need not be aligned for longs
+  memcpy(census->out + (census->count - 1) * sizeof(record), record, sizeof(record));
+}
+
 /*
  * Class:     com_oracle_libuv_handles_LoopHandle
  * Method:    _static_initialize
@@ -74,6 +188,7 @@ JNIEXPORT jlong JNICALL Java_com_oracle_libuv_handles_LoopHandle__1new
 
   uv_loop_t* ptr = uv_loop_new();
   assert(ptr);
+  ptr->data = new LoopData();
   return reinterpret_cast<jlong>(ptr);
 }
 
@@ -86,7 +201,62 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_LoopHandle__1run
   (JNIEnv *env, jobject that, jlong ptr, jint mode) {
 
   assert(ptr);
-  return uv_run(reinterpret_cast<uv_loop_t*>(ptr), (uv_run_mode) mode);
+  uv_loop_t* loop = reinterpret_cast<uv_loop_t*>(ptr);
+  int alive = uv_run(loop, (uv_run_mode) mode);
+  // uv_run has consumed any stop, do not let it linger for busy polling
+  LoopData::get(loop)->take_stop_request();
+  return alive;
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_LoopHandle
+ * Method:    _run_busy_poll
+ * Signature: (JJ)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_LoopHandle__1run_1busy_1poll
+  (JNIEnv *env, jobject that, jlong ptr, jlong spin_nanos) {
+
+  assert(ptr);
+  assert(spin_nanos >= 0);
+  uv_loop_t* loop = reinterpret_cast<uv_loop_t*>(ptr);
+  LoopData* data = LoopData::get(loop);
+  const uint64_t spin = static_cast<uint64_t>(spin_nanos);
+
+  // spins through non blocking iterations while callbacks keep coming,
+  // and blocks in poll once none came for the whole window
+  int alive = 1;
+  uint64_t last = uv_hrtime();
+  while (alive) {
+    unsigned long callbacks = data->callbacks();
+    alive = uv_run(loop, UV_RUN_NOWAIT);
+    if (data->take_stop_request() || env->ExceptionCheck()) {
+      break;
+    }
+    uint64_t now = uv_hrtime();
+    if (data->callbacks() != callbacks) {
+      last = now;
+    } else if (alive && now - last >= spin) {
+      alive = uv_run(loop, UV_RUN_ONCE);
+      if (data->take_stop_request() || env->ExceptionCheck()) {
+        break;
+      }
+      last = uv_hrtime();
+    }
+  }
+  return alive;
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_LoopHandle
+ * Method:    _callback_count
+ * Signature: (J)J
+ */
+JNIEXPORT jlong JNICALL Java_com_oracle_libuv_handles_LoopHandle__1callback_1count
+  (JNIEnv *env, jobject that, jlong ptr) {
+
+  assert(ptr);
+  uv_loop_t* loop = reinterpret_cast<uv_loop_t*>(ptr);
+  return static_cast<jlong>(LoopData::get(loop)->callbacks());
 }
 
 /*
@@ -98,7 +268,9 @@ JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_LoopHandle__1stop
   (JNIEnv *env, jobject that, jlong ptr) {
 
   assert(ptr);
-  uv_stop(reinterpret_cast<uv_loop_t*>(ptr));
+  uv_loop_t* loop = reinterpret_cast<uv_loop_t*>(ptr);
+  LoopData::get(loop)->request_stop();
+  uv_stop(loop);
 }
 
 /*
@@ -111,6 +283,8 @@ JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_LoopHandle__1destroy
 
   assert(ptr);
   uv_loop_t* handle = reinterpret_cast<uv_loop_t*>(ptr);
+  delete LoopData::get(handle);
+  handle->data = NULL;
   uv_loop_delete(handle);
 }
 
@@ -142,16 +316,43 @@ JNIEXPORT jobjectArray JNICALL Java_com_oracle_libuv_handles_LoopHandle__1list
   uv_walk(loop, _list_cb, &bag);
   jsize size = static_cast<jsize>(bag.size());
   jobjectArray handles = env->NewObjectArray(size, _string_cid, 0);
-  OOMN(env, handles);
-  for (int i=0; i < size; i++) {
+  for (int i=0; i < size && handles; i++) {
     jstring s = env->NewStringUTF(bag[i]);
-    OOMN(env, s);
-    env->SetObjectArrayElement(handles, i, s);
-    env->DeleteLocalRef(s);
+    if (s) {
+      env->SetObjectArrayElement(handles, i, s);
+      env->DeleteLocalRef(s);
+    } else {
+      handles = NULL;
+    }
   }
+  for (int i=0; i < size; i++) {
+    delete[] bag[i];
+  }
+  OOMN(env, handles);
   return handles;
 }
 
+/*
+ * Class:     com_oracle_libuv_handles_LoopHandle
+ * Method:    _census
+ * Signature: (JLjava/nio/ByteBuffer;)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_LoopHandle__1census
+  (JNIEnv *env, jobject that, jlong ptr, jobject buffer) {
+
+  assert(ptr);
+  assert(buffer);
+  uv_loop_t* loop = reinterpret_cast<uv_loop_t*>(ptr);
+  Census census;
+  census.out = reinterpret_cast<char*>(env->GetDirectBufferAddress(buffer));
+  OOME(env, census.out);
+  census.capacity = static_cast<size_t>(env->GetDirectBufferCapacity(buffer)) / (CENSUS_LENGTH * sizeof(jlong));
+  census.count = 0;
+  census.now = uv_now(loop);
+  uv_walk(loop, _census_cb, &census);
+  return static_cast<jint>(census.count);
+}
+
 /*
  * Class:     com_oracle_libuv_handles_LoopHandle
  * Method:    _get_last_error
@@ -183,3 +384,132 @@ JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_LoopHandle__1set_1last_1err
   error.sys_errno_ = 0;
   loop->last_err = error;
 }
+
+/*
+ * Class:     com_oracle_libuv_handles_LoopHandle
+ * Method:    _recycle
+ * Signature: (JLjava/nio/ByteBuffer;)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_oracle_libuv_handles_LoopHandle__1recycle
+  (JNIEnv *env, jobject that, jlong ptr, jobject buffer) {
+
+  assert(ptr);
+  assert(buffer);
+  uv_loop_t* loop = reinterpret_cast<uv_loop_t*>(ptr);
+  char* base = reinterpret_cast<char*>(env->GetDirectBufferAddress(buffer));
+  if (!base) {
+    return JNI_FALSE;
+  }
+  return LoopData::get(loop)->read_pool()->release(base) ? JNI_TRUE : JNI_FALSE;
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_LoopHandle
+ * Method:    _get_freelist_stats
+ * Signature: (JI[J)V
+ */
+JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_LoopHandle__1get_1freelist_1stats
+  (JNIEnv *env, jobject that, jlong ptr, jint type, jlongArray stats) {
+
+  assert(ptr);
+  assert(type >= 0 && type < LoopData::REQUEST_TYPE_COUNT);
+  uv_loop_t* loop = reinterpret_cast<uv_loop_t*>(ptr);
+  FreeList* list = LoopData::get(loop)->freelist(static_cast<LoopData::RequestType>(type));
+  jlong values[] = {
+    static_cast<jlong>(list->in_use()),
+    static_cast<jlong>(list->cached()),
+    static_cast<jlong>(list->high_water()),
+    static_cast<jlong>(list->allocated()),
+    static_cast<jlong>(list->limit())
+  };
+  jsize count = env->GetArrayLength(stats);
+  jsize size = static_cast<jsize>(sizeof(values) / sizeof(values[0]));
+  env->SetLongArrayRegion(stats, 0, count < size ? count : size, values);
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_LoopHandle
+ * Method:    _set_freelist_limit
+ * Signature: (JII)V
+ */
+JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_LoopHandle__1set_1freelist_1limit
+  (JNIEnv *env, jobject that, jlong ptr, jint type, jint limit) {
+
+  assert(ptr);
+  assert(type >= 0 && type < LoopData::REQUEST_TYPE_COUNT);
+  assert(limit >= 0);
+  uv_loop_t* loop = reinterpret_cast<uv_loop_t*>(ptr);
+  LoopData::get(loop)->freelist(static_cast<LoopData::RequestType>(type))->set_limit(static_cast<size_t>(limit));
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_LoopHandle
+ * Method:    _set_metrics_enabled
+ * Signature: (JZ)V
+ */
+JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_LoopHandle__1set_1metrics_1enabled
+  (JNIEnv *env, jobject that, jlong ptr, jboolean enabled) {
+
+  assert(ptr);
+  uv_loop_t* loop = reinterpret_cast<uv_loop_t*>(ptr);
+  LoopData::get(loop)->set_metrics_enabled(loop, enabled == JNI_TRUE);
+}
+
+// must be equal to the offsets in LoopMetrics.java
+enum MetricsLayout {
+  METRICS_ENABLED = 0,
+  METRICS_ELAPSED,
+  METRICS_ITERATIONS,
+  METRICS_POLL_TIME,
+  METRICS_CALLBACK_TIME,
+  METRICS_CALLBACKS,
+  METRICS_PENDING,
+  METRICS_CATEGORIES = METRICS_PENDING + LoopData::REQUEST_TYPE_COUNT,
+  METRICS_CATEGORY_LENGTH = 2 + LoopMetrics::BUCKETS,
+  METRICS_LENGTH = METRICS_CATEGORIES + LoopMetrics::CATEGORIES * METRICS_CATEGORY_LENGTH
+};
+
+/*
+ * Class:     com_oracle_libuv_handles_LoopHandle
+ * Method:    _get_metrics
+ * Signature: (J[J)V
+ */
+JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_LoopHandle__1get_1metrics
+  (JNIEnv *env, jobject that, jlong ptr, jlongArray values) {
+
+  assert(ptr);
+  assert(values);
+  if (env->GetArrayLength(values) < METRICS_LENGTH) {
+    ThrowException(env, UV_EINVAL, "get_metrics", "metrics array too short");
+    return;
+  }
+  uv_loop_t* loop = reinterpret_cast<uv_loop_t*>(ptr);
+  LoopData* data = LoopData::get(loop);
+  LoopMetrics* metrics = data->metrics();
+
+  jlong* snapshot = reinterpret_cast<jlong*>(env->GetPrimitiveArrayCritical(values, NULL));
+  OOM(env, snapshot);
+  memset(snapshot, 0, METRICS_LENGTH * sizeof(jlong));
+  for (int i = 0; i < LoopData::REQUEST_TYPE_COUNT; i++) {
+    FreeList* list = data->freelist(static_cast<LoopData::RequestType>(i));
+    snapshot[METRICS_PENDING + i] = static_cast<jlong>(list->in_use());
+  }
+  if (metrics) {
+    snapshot[METRICS_ENABLED] = 1;
+    snapshot[METRICS_ELAPSED] = static_cast<jlong>(uv_hrtime() - metrics->started());
+    snapshot[METRICS_ITERATIONS] = static_cast<jlong>(metrics->iterations());
+    snapshot[METRICS_POLL_TIME] = static_cast<jlong>(metrics->poll_time());
+    snapshot[METRICS_CALLBACK_TIME] = static_cast<jlong>(metrics->callback_time());
+    snapshot[METRICS_CALLBACKS] = static_cast<jlong>(metrics->callbacks());
+    for (int i = 0; i < LoopMetrics::CATEGORIES; i++) {
+      const LoopMetrics::Category& c = metrics->category(i);
+      jlong* out = snapshot + METRICS_CATEGORIES + i * METRICS_CATEGORY_LENGTH;
+      out[0] = static_cast<jlong>(c.count);
+      out[1] = static_cast<jlong>(c.time);
+      for (int j = 0; j < LoopMetrics::BUCKETS; j++) {
+        out[2 + j] = static_cast<jlong>(c.histogram[j]);
+      }
+    }
+  }
+  env->ReleasePrimitiveArrayCritical(values, snapshot, 0);
+}
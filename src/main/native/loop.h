@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+#ifndef _libuv_java_loop_h_
+#define _libuv_java_loop_h_
+
+#include <assert.h>
+
+#include "uv.h"
+#include "buffer_pool.h"
+#include "freelist.h"
+#include "metrics.h"
+
+// Per loop native state, attached to uv_loop_t.data by LoopHandle._new
+// and released by LoopHandle._destroy.
+class LoopData {
+public:
+  // must be equal to LoopHandle.RequestType ordinals
+  enum RequestType {
+    WRITE_REQ = 0,
+    SHUTDOWN_REQ,
+    CONNECT_REQ,
+    UDP_SEND_REQ,
+    FS_REQ,
+    CONTEXT_HOLDER,
+    FILE_REQUEST,
+    REQUEST_TYPE_COUNT
+  };
+
+  // natively encoded string writes, larger ones go to the heap
+  static const size_t WRITE_CHUNK_SIZE = 16 * 1024;
+  static const size_t WRITE_CHUNKS_PER_SLAB = 64;
+
+private:
+  BufferPool _read_pool;
+  BufferPool _write_pool;
+  FreeList _freelists[REQUEST_TYPE_COUNT];
+  LoopMetrics* _metrics;
+  unsigned long _callbacks;
+  bool _stop_requested;
+
+public:
+  static inline LoopData* get(uv_loop_t* loop) {
+    assert(loop);
+    assert(loop->data);
+    return reinterpret_cast<LoopData*>(loop->data);
+  }
+
+  LoopData();
+  ~LoopData();
+
+  inline BufferPool* read_pool() { return &_read_pool; }
+  inline BufferPool* write_pool() { return &_write_pool; }
+  inline FreeList* freelist(RequestType type) { return &_freelists[type]; }
+
+  // NULL unless metrics are enabled
+  inline LoopMetrics* metrics() { return _metrics; }
+  // enabling again starts from zero
+  void set_metrics_enabled(uv_loop_t* loop, bool enabled);
+
+  // upcalls so far, a busy polling loop keeps spinning while this changes
+  inline void count_callback() { _callbacks++; }
+  inline unsigned long callbacks() const { return _callbacks; }
+  // uv_run forgets a uv_stop once it returns, busy polling has to see it
+  inline void request_stop() { _stop_requested = true; }
+  inline bool take_stop_request() {
+    bool requested = _stop_requested;
+    _stop_requested = false;
+    return requested;
+  }
+};
+
+// Times a libuv callback that calls up into Java, declare it first thing
+// in the callback. Costs a counter increment when metrics are disabled.
+class CallbackScope {
+private:
+  LoopMetrics* _metrics;
+  int _category;
+  uint64_t _start;
+
+public:
+  inline CallbackScope(uv_loop_t* loop, uv_handle_type category) :
+    _metrics(NULL),
+    _category(category),
+    _start(0) {
+
+    if (loop && loop->data) {
+      LoopData* data = LoopData::get(loop);
+      data->count_callback();
+      _metrics = data->metrics();
+    }
+    if (_metrics) {
+      _metrics->enter();
+      _start = uv_hrtime();
+    }
+  }
+
+  inline ~CallbackScope() {
+    // metrics disabled from within the callback are closing but
+    // not released before the closing phase of the loop
+    if (_metrics) {
+      _metrics->leave(_category, uv_hrtime() - _start);
+    }
+  }
+};
+
+// records code as the last error of the loop, for failures detected
+// before libuv is called
+inline void loop_set_error(uv_loop_t* loop, uv_err_code code) {
+  loop->last_err.code = code;
+  loop->last_err.sys_errno_ = 0;
+}
+
+// allocates a zeroed libuv request from the loop freelist for its type,
+// NULL when out of memory, release with freelist_delete
+template <typename T>
+inline T* loop_new_req(uv_loop_t* loop, LoopData::RequestType type) {
+  return freelist_new<T>(LoopData::get(loop)->freelist(type));
+}
+
+#endif // _libuv_java_loop_h_
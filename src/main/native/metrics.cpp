@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+#include <string.h>
+
+#include "metrics.h"
+
+LoopMetrics::LoopMetrics(uv_loop_t* loop) :
+  _started(uv_hrtime()),
+  _poll_start(0),
+  _poll_callback_time(0),
+  _iterations(0),
+  _poll_time(0),
+  _callback_time(0),
+  _callbacks(0),
+  _depth(0) {
+
+  memset(_categories, 0, sizeof(_categories));
+  int r = uv_prepare_init(loop, &_prepare);
+  assert(r == 0);
+  r = uv_check_init(loop, &_check);
+  assert(r == 0);
+  _prepare.data = this;
+  _check.data = this;
+  uv_prepare_start(&_prepare, _prepare_cb);
+  uv_check_start(&_check, _check_cb);
+  // never keep the loop alive on their own
+  uv_unref(reinterpret_cast<uv_handle_t*>(&_prepare));
+  uv_unref(reinterpret_cast<uv_handle_t*>(&_check));
+}
+
+void LoopMetrics::_prepare_cb(uv_prepare_t* handle, int status) {
+  assert(handle->data);
+  LoopMetrics* metrics = reinterpret_cast<LoopMetrics*>(handle->data);
+  metrics->_iterations++;
+  metrics->_poll_start = uv_hrtime();
+  metrics->_poll_callback_time = metrics->_callback_time;
+}
+
+void LoopMetrics::_check_cb(uv_check_t* handle, int status) {
+  assert(handle->data);
+  LoopMetrics* metrics = reinterpret_cast<LoopMetrics*>(handle->data);
+  if (metrics->_poll_start) {
+    // the i/o callbacks run between prepare and check too, they are
+    // already counted as callback time
+    uint64_t elapsed = uv_hrtime() - metrics->_poll_start;
+    uint64_t callbacks = metrics->_callback_time - metrics->_poll_callback_time;
+    metrics->_poll_time += elapsed > callbacks ? elapsed - callbacks : 0;
+    metrics->_poll_start = 0;
+  }
+}
+
+void LoopMetrics::_close_cb(uv_handle_t* handle) {
+  assert(handle->data);
+  LoopMetrics* metrics = reinterpret_cast<LoopMetrics*>(handle->data);
+  handle->data = NULL;
+  if (!metrics->_prepare.data && !metrics->_check.data) {
+    delete metrics;
+  }
+}
+
+void LoopMetrics::close() {
+  uv_close(reinterpret_cast<uv_handle_t*>(&_prepare), _close_cb);
+  uv_close(reinterpret_cast<uv_handle_t*>(&_check), _close_cb);
+}
+
+void LoopMetrics::abandon() {
+  uv_prepare_stop(&_prepare);
+  uv_check_stop(&_check);
+}
+
+void LoopMetrics::leave(int category, uint64_t elapsed) {
+  assert(_depth > 0);
+  assert(category >= 0 && category < CATEGORIES);
+  // nested upcalls (sync calls made from a callback) are counted for
+  // their category but not twice towards the overall callback time
+  if (--_depth == 0) {
+    _callback_time += elapsed;
+    _callbacks++;
+  }
+  Category* c = &_categories[category];
+  c->count++;
+  c->time += elapsed;
+  uint64_t micros = elapsed / 1000;
+  int bucket = 0;
+  while (micros && bucket < BUCKETS - 1) {
+    micros >>= 1;
+    bucket++;
+  }
+  c->histogram[bucket]++;
+}
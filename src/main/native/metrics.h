@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+#ifndef _libuv_java_metrics_h_
+#define _libuv_java_metrics_h_
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "uv.h"
+
+// Loop instrumentation, allocated by LoopData when metrics are enabled.
+// An unref'd prepare/check pair brackets the poll phase of every loop
+// iteration, CallbackScope (loop.h) times the libuv callbacks that call
+// up into Java. Everything is preallocated, recording never allocates.
+class LoopMetrics {
+public:
+  // callbacks are categorized by uv_handle_type, fs requests use UV_FILE
+  static const int CATEGORIES = UV_HANDLE_TYPE_MAX;
+  // bucket 0 counts callbacks under 1us, bucket n those under 2^n us,
+  // the last bucket is open ended
+  static const int BUCKETS = 24;
+
+  struct Category {
+    uint64_t count;
+    uint64_t time;
+    uint64_t histogram[BUCKETS];
+  };
+
+private:
+  uv_prepare_t _prepare;
+  uv_check_t _check;
+  uint64_t _started;
+  uint64_t _poll_start;
+  uint64_t _poll_callback_time;
+  uint64_t _iterations;
+  uint64_t _poll_time;
+  uint64_t _callback_time;
+  uint64_t _callbacks;
+  int _depth;
+  Category _categories[CATEGORIES];
+
+  static void _prepare_cb(uv_prepare_t* handle, int status);
+  static void _check_cb(uv_check_t* handle, int status);
+  static void _close_cb(uv_handle_t* handle);
+
+public:
+  LoopMetrics(uv_loop_t* loop);
+
+  // closes the phase handles, the instance deletes itself when both are closed
+  void close();
+  // stops the phase handles of a loop that is about to be deleted
+  void abandon();
+
+  inline bool owns(uv_handle_t* handle) const {
+    return handle == reinterpret_cast<const uv_handle_t*>(&_prepare) ||
+           handle == reinterpret_cast<const uv_handle_t*>(&_check);
+  }
+
+  inline void enter() { _depth++; }
+  void leave(int category, uint64_t elapsed);
+
+  inline uint64_t started() const { return _started; }
+  inline uint64_t iterations() const { return _iterations; }
+  inline uint64_t poll_time() const { return _poll_time; }
+  inline uint64_t callback_time() const { return _callback_time; }
+  inline uint64_t callbacks() const { return _callbacks; }
+  inline const Category& category(int index) const {
+    assert(index >= 0 && index < CATEGORIES);
+    return _categories[index];
+  }
+};
+
+#endif // _libuv_java_metrics_h_
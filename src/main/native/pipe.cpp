@@ -28,6 +28,7 @@
 #include "uv.h"
 #include "exception.h"
 #include "context.h"
+#include "loop.h"
 #include "stream.h"
 #include "com_oracle_libuv_handles_PipeHandle.h"
 
@@ -36,11 +37,12 @@ static void _pipe_connect_cb(uv_connect_t* req, int status) {
   assert(req->data);
   assert(req->handle);
   assert(req->handle->data);
+  CallbackScope scope(req->handle->loop, req->handle->type);
   ContextHolder* req_data = reinterpret_cast<ContextHolder*>(req->data);
   StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(req->handle->data);
   cb->on_connect(status, status < 0 ? uv_last_error(req->handle->loop).code : 0, req_data->context());
   delete req_data;
-  delete req;
+  freelist_delete(req);
 }
 
 /*
@@ -110,8 +112,14 @@ JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_PipeHandle__1connect
 
   assert(pipe);
   uv_pipe_t* handle = reinterpret_cast<uv_pipe_t*>(pipe);
-  uv_connect_t* connect = new uv_connect_t();
-  connect->data = new ContextHolder(env, context);
+  uv_connect_t* connect = loop_new_req<uv_connect_t>(handle->loop, LoopData::CONNECT_REQ);
+  OOM(env, connect);
+  ContextHolder* req_data = new (handle->loop) ContextHolder(env, context);
+  if (!req_data) {
+    freelist_delete(connect);
+    OOM(env, req_data);
+  }
+  connect->data = req_data;
   connect->handle = reinterpret_cast<uv_stream_t*>(handle);
   const char *pipeName = env->GetStringUTFChars(name, 0);
   uv_pipe_connect(connect, handle, pipeName, _pipe_connect_cb);
@@ -31,6 +31,7 @@
 #include "uv.h"
 #include "exception.h"
 #include "stream.h"
+#include "loop.h"
 #include "com_oracle_libuv_handles_PollHandle.h"
 
 class PollCallbacks {
@@ -92,6 +93,7 @@ void PollCallbacks::on_poll(int status, int events) {
 static void _poll_cb(uv_poll_t* handle, int status, int events) {
   assert(handle);
   assert(handle->data);
+  CallbackScope scope(handle->loop, UV_POLL);
   PollCallbacks* cb = reinterpret_cast<PollCallbacks*>(handle->data);
   cb->on_poll(status, events);
 }
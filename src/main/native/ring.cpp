@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+#include <string.h>
+#include <new>
+
+#include "ring.h"
+
+MPSCRing::MPSCRing(size_t capacity, size_t slot_size) :
+  _capacity(1),
+  _slot_size(slot_size),
+  _cells(NULL),
+  _payload(NULL),
+  _tail(0),
+  _head(0),
+  _signalled(0) {
+
+  while (_capacity < capacity) {
+    _capacity <<= 1;
+  }
+  _mask = _capacity - 1;
+  _cells = new (std::nothrow) Cell[_capacity];
+  if (_cells) {
+    for (size_t i = 0; i < _capacity; i++) {
+      _cells[i].sequence = i;
+    }
+  }
+  if (_slot_size) {
+    _payload = new (std::nothrow) char[_capacity * _slot_size];
+  }
+}
+
+MPSCRing::~MPSCRing() {
+  delete[] _cells;
+  delete[] _payload;
+}
+
+bool MPSCRing::offer(jlong value, const char* data, size_t length) {
+  if (length > _slot_size) {
+    return false;
+  }
+  size_t pos = ring_load(&_tail);
+  Cell* cell;
+  for (;;) {
+    cell = &_cells[pos & _mask];
+    size_t sequence = ring_load(&cell->sequence);
+    ptrdiff_t diff = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(pos);
+    if (diff == 0) {
+      if (ring_cas(&_tail, pos, pos + 1)) {
+        break;
+      }
+      pos = ring_load(&_tail);
+    } else if (diff < 0) {
+      // the consumer has not released this cell from the previous lap
+      return false;
+    } else {
+      pos = ring_load(&_tail);
+    }
+  }
+  cell->value = value;
+  cell->length = static_cast<jint>(length);
+  if (length) {
+    memcpy(_payload + (pos & _mask) * _slot_size, data, length);
+  }
+  ring_store(&cell->sequence, pos + 1);
+  return true;
+}
+
+size_t MPSCRing::peek(size_t max) {
+  size_t count = 0;
+  while (count < max && count < _capacity) {
+    size_t pos = _head + count;
+    if (ring_load(&_cells[pos & _mask].sequence) != pos + 1) {
+      break;
+    }
+    count++;
+  }
+  return count;
+}
+
+void MPSCRing::release(size_t count) {
+  assert(count <= _capacity);
+  for (size_t i = 0; i < count; i++) {
+    size_t pos = _head + i;
+    ring_store(&_cells[pos & _mask].sequence, pos + _capacity);
+  }
+  _head += count;
+}
+
+SharedRing::SharedRing(void* memory, size_t size, bool format) :
+  _header(reinterpret_cast<Header*>(memory)),
+  _data(NULL),
+  _mask(0),
+  _peeked(0),
+  _corrupt(false) {
+
+  assert(size > sizeof(Header));
+  size_t capacity = size - sizeof(Header);
+  if (format) {
+    assert((capacity & (capacity - 1)) == 0);
+    memset(_header, 0, sizeof(Header));
+    _header->capacity = capacity;
+    _header->version = VERSION;
+    // no one has woken the consumer yet
+    _header->waiting = 1;
+    // the magic goes last, behind a barrier, for a process opening the ring
+    ring_store(&_header->head, 0);
+    _header->magic = MAGIC;
+  } else if (_header->magic != MAGIC || _header->version != VERSION || _header->capacity != capacity) {
+    return;
+  }
+  _data = reinterpret_cast<char*>(memory) + sizeof(Header);
+  _mask = capacity - 1;
+}
+
+char* SharedRing::reserve(size_t length) {
+  assert(length <= max_message());
+  const size_t capacity = this->capacity();
+  const size_t record = record_size(length);
+  size_t tail = _header->tail;
+  const size_t head = ring_load(&_header->head);
+  size_t position = tail & _mask;
+  size_t contiguous = capacity - position;
+  size_t needed = contiguous < record ? contiguous + record : record;
+  if (capacity - (tail - head) < needed) {
+    return NULL;
+  }
+  if (contiguous < record) {
+    // records are aligned, there is always room for the marker
+    *reinterpret_cast<unsigned int*>(_data + position) = ~0u;
+    tail += contiguous;
+    ring_store(&_header->tail, tail);
+    position = 0;
+  }
+  *reinterpret_cast<unsigned int*>(_data + position) = static_cast<unsigned int>(length);
+  return _data + position + sizeof(unsigned int);
+}
+
+SharedRing::OfferResult SharedRing::commit(size_t length) {
+  ring_store(&_header->tail, _header->tail + record_size(length));
+  if (ring_load(&_header->waiting) && ring_exchange(&_header->waiting, 0)) {
+    return OFFERED_WAKEUP;
+  }
+  return OFFERED;
+}
+
+SharedRing::OfferResult SharedRing::offer(const char* data, size_t length) {
+  char* base = reserve(length);
+  if (!base) {
+    return FULL;
+  }
+  memcpy(base, data, length);
+  return commit(length);
+}
+
+const char* SharedRing::peek(size_t* length) {
+  assert(!_peeked);
+  if (_corrupt) {
+    return NULL;
+  }
+  const size_t capacity = this->capacity();
+  size_t head = _header->head;
+  for (;;) {
+    size_t tail = ring_load(&_header->tail);
+    if (head == tail) {
+      return NULL;
+    }
+    size_t position = head & _mask;
+    // everything below comes from memory the peer can write
+    if (tail - head > capacity) {
+      _corrupt = true;
+      return NULL;
+    }
+    unsigned int n = *reinterpret_cast<volatile unsigned int*>(_data + position);
+    if (n == ~0u) {
+      head += capacity - position;
+      ring_store(&_header->head, head);
+      continue;
+    }
+    if (n > max_message() || position + record_size(n) > capacity || record_size(n) > tail - head) {
+      _corrupt = true;
+      return NULL;
+    }
+    *length = n;
+    _peeked = record_size(n);
+    return _data + position + sizeof(unsigned int);
+  }
+}
+
+void SharedRing::release() {
+  assert(_peeked);
+  ring_store(&_header->head, _header->head + _peeked);
+  _peeked = 0;
+}
+
+bool SharedRing::arm() {
+  ring_exchange(&_header->waiting, 1);
+  if (_header->head != ring_load(&_header->tail)) {
+    ring_exchange(&_header->waiting, 0);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+#ifndef _libuv_java_ring_h_
+#define _libuv_java_ring_h_
+
+#include <assert.h>
+#include <stddef.h>
+
+#include <jni.h>
+
+#include "uv.h"
+
+// full barrier atomics on size_t, the tree predates C++11 <atomic>
+#ifdef _WIN32
+inline size_t ring_load(volatile size_t* ptr) {
+  size_t value = *ptr;
+  MemoryBarrier();
+  return value;
+}
+
+inline void ring_store(volatile size_t* ptr, size_t value) {
+  MemoryBarrier();
+  *ptr = value;
+  MemoryBarrier();
+}
+
+inline bool ring_cas(volatile size_t* ptr, size_t expected, size_t desired) {
+  return InterlockedCompareExchangePointer(reinterpret_cast<PVOID volatile*>(ptr),
+      reinterpret_cast<PVOID>(desired), reinterpret_cast<PVOID>(expected)) == reinterpret_cast<PVOID>(expected);
+}
+
+inline size_t ring_exchange(volatile size_t* ptr, size_t value) {
+  return reinterpret_cast<size_t>(InterlockedExchangePointer(reinterpret_cast<PVOID volatile*>(ptr),
+      reinterpret_cast<PVOID>(value)));
+}
+#else
+inline size_t ring_load(volatile size_t* ptr) {
+  size_t value = *ptr;
+  __sync_synchronize();
+  return value;
+}
+
+inline void ring_store(volatile size_t* ptr, size_t value) {
+  __sync_synchronize();
+  *ptr = value;
+  __sync_synchronize();
+}
+
+inline bool ring_cas(volatile size_t* ptr, size_t expected, size_t desired) {
+  return __sync_bool_compare_and_swap(ptr, expected, desired);
+}
+
+inline size_t ring_exchange(volatile size_t* ptr, size_t value) {
+  __sync_synchronize();
+  return __sync_lock_test_and_set(ptr, value);
+}
+#endif
+
+// Bounded lock free multi producer, single consumer queue of a long and
+// an optional payload of up to slot_size bytes copied into the slot.
+// Every cell carries a sequence number (Vyukov): a producer claims a cell
+// by advancing _tail and publishes it by bumping the sequence, the
+// consumer peeks a run of published cells and hands them back at once.
+class MPSCRing {
+public:
+  struct Cell {
+    volatile size_t sequence;
+    jlong value;
+    jint length;
+  };
+
+private:
+  size_t _capacity;
+  size_t _mask;
+  size_t _slot_size;
+  Cell* _cells;
+  char* _payload;
+  volatile size_t _tail;
+  size_t _head;
+  volatile size_t _signalled;
+
+public:
+  // capacity is rounded up to a power of two
+  MPSCRing(size_t capacity, size_t slot_size);
+  ~MPSCRing();
+
+  // false until the memory was allocated
+  inline bool valid() const { return _cells != NULL && (_slot_size == 0 || _payload != NULL); }
+  inline size_t capacity() const { return _capacity; }
+  inline size_t slot_size() const { return _slot_size; }
+  inline char* payload() const { return _payload; }
+
+  // any thread, false when full or the payload does not fit a slot
+  bool offer(jlong value, const char* data, size_t length);
+
+  // true for the producer whose offer found the consumer idle and has to wake it
+  inline bool signal() { return ring_exchange(&_signalled, 1) == 0; }
+  // the consumer must clear before peeking, a later offer signals again
+  inline void clear_signal() { ring_exchange(&_signalled, 0); }
+
+  // consumer only, the count of published cells from the head, up to max
+  size_t peek(size_t max);
+  inline const Cell& cell(size_t index) const { return _cells[(_head + index) & _mask]; }
+  inline size_t offset(size_t index) const { return ((_head + index) & _mask) * _slot_size; }
+  // consumer only, returns count peeked cells to the producers
+  void release(size_t count);
+};
+
+// Single producer, single consumer ring of length prefixed messages laid
+// out in memory that can be shared between processes, header included.
+// Records are 8 byte aligned, one that does not fit before the end of the
+// data is preceded by a wrap marker. A consumer about to sleep sets the
+// waiting flag, the next offer clears it and tells its producer to wake
+// the consumer through some other channel.
+class SharedRing {
+public:
+  static const unsigned int MAGIC = 0x6c75726a;
+  static const unsigned int VERSION = 1;
+
+  struct Header {
+    unsigned int magic;
+    unsigned int version;
+    size_t capacity;
+    char pad0[64 - 2 * sizeof(unsigned int) - sizeof(size_t)];
+    volatile size_t head;
+    char pad1[64 - sizeof(size_t)];
+    volatile size_t tail;
+    char pad2[64 - sizeof(size_t)];
+    volatile size_t waiting;
+    char pad3[64 - sizeof(size_t)];
+  };
+
+  enum OfferResult {
+    FULL = 0,
+    OFFERED = 1,
+    OFFERED_WAKEUP = 2
+  };
+
+private:
+  Header* _header;
+  char* _data;
+  size_t _mask;
+  size_t _peeked;
+  bool _corrupt;
+
+  static inline size_t record_size(size_t length) { return (sizeof(unsigned int) + length + 7) & ~static_cast<size_t>(7); }
+
+public:
+  // the bytes to map for a capacity, which must be a power of two
+  static inline size_t mapped_size(size_t capacity) { return sizeof(Header) + capacity; }
+
+  // format initializes the header of fresh memory, otherwise it is checked
+  SharedRing(void* memory, size_t size, bool format);
+
+  // false if the memory did not hold a ring of a matching layout
+  inline bool valid() const { return _data != NULL; }
+  // from the validated header, the peer may write to it later on
+  inline size_t capacity() const { return _mask + 1; }
+  inline size_t max_message() const { return capacity() / 2 - sizeof(unsigned int); }
+  // set once peek found a record or tail the producer could not have written
+  inline bool corrupt() const { return _corrupt; }
+
+  // producer only, length must not exceed max_message
+  OfferResult offer(const char* data, size_t length);
+  // reserve makes room for a message of length bytes, commit publishes it
+  char* reserve(size_t length);
+  OfferResult commit(size_t length);
+
+  // consumer only, the next message stays in place until released. NULL
+  // when empty or, for good, once the ring is corrupt
+  const char* peek(size_t* length);
+  void release();
+  // sets the waiting flag, false (and cleared again) if messages arrived
+  bool arm();
+};
+
+#endif // _libuv_java_ring_h_
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include <jni.h>
+
+#include "uv.h"
+#include "exception.h"
+#include "ring.h"
+#include "com_oracle_libuv_handles_SharedMemoryRing.h"
+
+// A SharedRing over a file mapped into this process, the parent creates
+// it and passes the path to the child, which maps the same pages.
+class MappedRing {
+public:
+  void* base;
+  size_t size;
+  SharedRing ring;
+
+  MappedRing(void* base, size_t size, bool format) : base(base), size(size), ring(base, size, format) {}
+};
+
+static jlong _map_ring(JNIEnv* env, jstring path, size_t capacity, bool create) {
+#ifdef _WIN32
+  ThrowException(env, UV_ENOSYS, "mmap", "shared memory rings are not supported on windows");
+  return 0;
+#else
+  const char* path_chars = env->GetStringUTFChars(path, 0);
+  OOME(env, path_chars);
+  int fd = create ? open(path_chars, O_RDWR | O_CREAT | O_TRUNC, 0600) : open(path_chars, O_RDWR);
+  if (fd < 0) {
+    ThrowException(env, sys_error_code(errno), "open", NULL, path_chars);
+    env->ReleaseStringUTFChars(path, path_chars);
+    return 0;
+  }
+  size_t size = SharedRing::mapped_size(capacity);
+  struct stat st;
+  const char* syscall = NULL;
+  if (create && ftruncate(fd, static_cast<off_t>(size))) {
+    syscall = "ftruncate";
+  } else if (!create && fstat(fd, &st)) {
+    syscall = "fstat";
+  }
+  if (!create && !syscall) {
+    size = static_cast<size_t>(st.st_size);
+  }
+  void* base = NULL;
+  if (!syscall) {
+    base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+      syscall = "mmap";
+    }
+  }
+  if (syscall) {
+    ThrowException(env, sys_error_code(errno), syscall, NULL, path_chars);
+    close(fd);
+    env->ReleaseStringUTFChars(path, path_chars);
+    return 0;
+  }
+  // the mapping outlives the descriptor
+  close(fd);
+
+  MappedRing* mapped = NULL;
+  if (size > sizeof(SharedRing::Header)) {
+    mapped = new MappedRing(base, size, create);
+  }
+  if (!mapped || !mapped->ring.valid()) {
+    delete mapped;
+    munmap(base, size);
+    ThrowException(env, UV_EINVAL, "mmap", "not a shared memory ring", path_chars);
+    env->ReleaseStringUTFChars(path, path_chars);
+    return 0;
+  }
+  env->ReleaseStringUTFChars(path, path_chars);
+  return reinterpret_cast<jlong>(mapped);
+#endif
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_SharedMemoryRing
+ * Method:    _create
+ * Signature: (Ljava/lang/String;J)J
+ */
+JNIEXPORT jlong JNICALL Java_com_oracle_libuv_handles_SharedMemoryRing__1create
+  (JNIEnv *env, jclass cls, jstring path, jlong capacity) {
+
+  assert(path);
+  assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+  return _map_ring(env, path, static_cast<size_t>(capacity), true);
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_SharedMemoryRing
+ * Method:    _open
+ * Signature: (Ljava/lang/String;)J
+ */
+JNIEXPORT jlong JNICALL Java_com_oracle_libuv_handles_SharedMemoryRing__1open
+  (JNIEnv *env, jclass cls, jstring path) {
+
+  assert(path);
+  return _map_ring(env, path, 0, false);
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_SharedMemoryRing
+ * Method:    _capacity
+ * Signature: (J)J
+ */
+JNIEXPORT jlong JNICALL Java_com_oracle_libuv_handles_SharedMemoryRing__1capacity
+  (JNIEnv *env, jclass cls, jlong ptr) {
+
+  assert(ptr);
+  MappedRing* mapped = reinterpret_cast<MappedRing*>(ptr);
+  return static_cast<jlong>(mapped->ring.capacity());
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_SharedMemoryRing
+ * Method:    _offer
+ * Signature: (JLjava/nio/ByteBuffer;[BII)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_SharedMemoryRing__1offer
+  (JNIEnv *env, jclass cls, jlong ptr, jobject buffer, jbyteArray data, jint offset, jint length) {
+
+  assert(ptr);
+  MappedRing* mapped = reinterpret_cast<MappedRing*>(ptr);
+  assert(static_cast<size_t>(length) <= mapped->ring.max_message());
+  char* base = mapped->ring.reserve(static_cast<size_t>(length));
+  if (!base) {
+    return SharedRing::FULL;
+  }
+  // straight from the java heap or the direct buffer into the ring
+  if (data) {
+    env->GetByteArrayRegion(data, offset, length, reinterpret_cast<jbyte*>(base));
+  } else {
+    char* address = reinterpret_cast<char*>(env->GetDirectBufferAddress(buffer));
+    assert(address);
+    memcpy(base, address + offset, length);
+  }
+  return mapped->ring.commit(static_cast<size_t>(length));
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_SharedMemoryRing
+ * Method:    _peek
+ * Signature: (J)Ljava/nio/ByteBuffer;
+ */
+JNIEXPORT jobject JNICALL Java_com_oracle_libuv_handles_SharedMemoryRing__1peek
+  (JNIEnv *env, jclass cls, jlong ptr) {
+
+  assert(ptr);
+  MappedRing* mapped = reinterpret_cast<MappedRing*>(ptr);
+  size_t length = 0;
+  const char* message = mapped->ring.peek(&length);
+  if (!message) {
+    if (mapped->ring.corrupt()) {
+      ThrowException(env, UV_EINVAL, "peek", "shared memory ring is corrupt");
+    }
+    return NULL;
+  }
+  return env->NewDirectByteBuffer(const_cast<char*>(message), static_cast<jlong>(length));
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_SharedMemoryRing
+ * Method:    _release
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_SharedMemoryRing__1release
+  (JNIEnv *env, jclass cls, jlong ptr) {
+
+  assert(ptr);
+  MappedRing* mapped = reinterpret_cast<MappedRing*>(ptr);
+  mapped->ring.release();
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_SharedMemoryRing
+ * Method:    _arm
+ * Signature: (J)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_oracle_libuv_handles_SharedMemoryRing__1arm
+  (JNIEnv *env, jclass cls, jlong ptr) {
+
+  assert(ptr);
+  MappedRing* mapped = reinterpret_cast<MappedRing*>(ptr);
+  return mapped->ring.arm() ? JNI_TRUE : JNI_FALSE;
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_SharedMemoryRing
+ * Method:    _close
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_SharedMemoryRing__1close
+  (JNIEnv *env, jclass cls, jlong ptr) {
+
+  assert(ptr);
+  MappedRing* mapped = reinterpret_cast<MappedRing*>(ptr);
+#ifndef _WIN32
+  munmap(mapped->base, mapped->size);
+#endif
+  delete mapped;
+}
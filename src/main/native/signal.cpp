@@ -31,6 +31,7 @@
 #include "uv.h"
 #include "exception.h"
 #include "stream.h"
+#include "loop.h"
 #include "com_oracle_libuv_handles_SignalHandle.h"
 
 class SignalCallbacks {
@@ -91,6 +92,7 @@ void SignalCallbacks::on_signal(int signum) {
 static void _signal_cb(uv_signal_t* handle, int signum) {
   assert(handle);
   assert(handle->data);
+  CallbackScope scope(handle->loop, UV_SIGNAL);
   SignalCallbacks* cb = reinterpret_cast<SignalCallbacks*>(handle->data);
   cb->on_signal(signum);
 }
@@ -26,6 +26,13 @@
 #include "stats.h"
 
 #include <assert.h>
+#include <errno.h>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+#include "exception.h"
 
 jclass Stats::_stats_cid = NULL;
 
@@ -113,3 +120,49 @@ void Stats::update(JNIEnv* env, jobject stats, const uv_statbuf_t* ptr) {
         ptr->st_ctime * 1000);    // Convert seconds to milliseconds
   }
 }
+
+void Stats::fill(jlong* out, const uv_statbuf_t* ptr) {
+  assert(ptr);
+  jlong blksize = 0;
+  jlong blocks = 0;
+#ifdef __POSIX__
+  blksize = ptr->st_blksize;
+  blocks = ptr->st_blocks;
+#endif
+
+  out[0] = ptr->st_dev;
+  out[1] = ptr->st_ino;
+  out[2] = ptr->st_mode;
+  out[3] = ptr->st_nlink;
+  out[4] = ptr->st_uid;
+  out[5] = ptr->st_gid;
+  out[6] = ptr->st_rdev;
+  out[7] = ptr->st_size;
+  out[8] = blksize;
+  out[9] = blocks;
+  out[10] = static_cast<jlong>(ptr->st_atime) * 1000;  // Convert seconds to milliseconds
+  out[11] = static_cast<jlong>(ptr->st_mtime) * 1000;  // Convert seconds to milliseconds
+  out[12] = static_cast<jlong>(ptr->st_ctime) * 1000;  // Convert seconds to milliseconds
+}
+
+// uv_fs_stat without a callback records errors on the loop, which is not
+// safe from the thread pool, so workers call stat directly
+int Stats::stat_path(const char* path, uv_statbuf_t* buf) {
+#ifdef _WIN32
+  if (_stati64(path, buf) == 0) {
+    return 0;
+  }
+  switch (errno) {
+    case ENOENT: return UV_ENOENT;
+    case EACCES: return UV_EACCES;
+    case EINVAL: return UV_EINVAL;
+    default: return UV_UNKNOWN;
+  }
+#else
+  int r;
+  do {
+    r = stat(path, buf);
+  } while (r == -1 && errno == EINTR);
+  return r == 0 ? 0 : sys_error_code(errno);
+#endif
+}
@@ -40,6 +40,12 @@ public:
   static void static_initialize(JNIEnv* env);
   static jobject create(JNIEnv* env, const uv_statbuf_t* ptr);
   static void update(JNIEnv* env, jobject stats, const uv_statbuf_t* ptr);
+  // writes the FIELDS values in the order of Stats.set(long[], int)
+  static void fill(jlong* out, const uv_statbuf_t* ptr);
+  // stats a path on the calling thread, returns 0 or a uv_err_code
+  static int stat_path(const char* path, uv_statbuf_t* buf);
+
+  static const int FIELDS = 13;
 
   Stats();
   ~Stats();
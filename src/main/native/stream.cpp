@@ -24,12 +24,26 @@
  */
 
 #include <assert.h>
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifndef _WIN32
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#elif defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+#endif
+
 #include "uv.h"
 #include "exception.h"
 #include "context.h"
+#include "encoding.h"
+#include "loop.h"
 #include "stream.h"
 #include "udp.h"
 #include "com_oracle_libuv_handles_StreamHandle.h"
@@ -39,15 +53,22 @@ jstring StreamCallbacks::_IPV6 = NULL;
 
 jclass StreamCallbacks::_address_cid = NULL;
 jclass StreamCallbacks::_stream_handle_cid = NULL;
+jclass StreamCallbacks::_byte_buffer_cid = NULL;
+jmethodID StreamCallbacks::_byte_buffer_wrap_mid = NULL;
 
 jmethodID StreamCallbacks::_address_init_mid = NULL;
 jmethodID StreamCallbacks::_call_read_callback_mid = NULL;
 jmethodID StreamCallbacks::_call_read2_callback_mid = NULL;
 jmethodID StreamCallbacks::_call_write_callback_mid = NULL;
+jmethodID StreamCallbacks::_call_drain_callback_mid = NULL;
+jmethodID StreamCallbacks::_call_sendfile_callback_mid = NULL;
+jmethodID StreamCallbacks::_call_connection_batch_callback_mid = NULL;
 jmethodID StreamCallbacks::_call_connect_callback_mid = NULL;
 jmethodID StreamCallbacks::_call_connection_callback_mid = NULL;
 jmethodID StreamCallbacks::_call_close_callback_mid = NULL;
 jmethodID StreamCallbacks::_call_shutdown_callback_mid = NULL;
+jmethodID StreamCallbacks::_dispatch_read_mid = NULL;
+jmethodID StreamCallbacks::_dispatch_write_mid = NULL;
 
 void StreamCallbacks::static_initialize(JNIEnv* env, jclass cls) {
   _IPV4 = env->NewStringUTF("IPv4");
@@ -80,6 +101,29 @@ void StreamCallbacks::static_initialize(JNIEnv* env, jclass cls) {
   _call_shutdown_callback_mid = env->GetMethodID(_stream_handle_cid, "callShutdown", "(ILjava/lang/Exception;Ljava/lang/Object;)V");
   assert(_call_shutdown_callback_mid);
 
+  _call_drain_callback_mid = env->GetMethodID(_stream_handle_cid, "callDrain", "()V");
+  assert(_call_drain_callback_mid);
+
+  _call_sendfile_callback_mid = env->GetMethodID(_stream_handle_cid, "callSendFile", "(JLjava/lang/Exception;Ljava/lang/Object;)V");
+  assert(_call_sendfile_callback_mid);
+
+  _call_connection_batch_callback_mid = env->GetMethodID(_stream_handle_cid, "callConnectionBatch", "(I)V");
+  assert(_call_connection_batch_callback_mid);
+
+  _dispatch_read_mid = env->GetMethodID(_stream_handle_cid, "dispatchRead", "(Ljava/nio/ByteBuffer;)V");
+  assert(_dispatch_read_mid);
+
+  _dispatch_write_mid = env->GetMethodID(_stream_handle_cid, "dispatchWrite", "(ILjava/lang/Exception;)V");
+  assert(_dispatch_write_mid);
+
+  _byte_buffer_cid = env->FindClass("java/nio/ByteBuffer");
+  assert(_byte_buffer_cid);
+  _byte_buffer_cid = (jclass) env->NewGlobalRef(_byte_buffer_cid);
+  assert(_byte_buffer_cid);
+
+  _byte_buffer_wrap_mid = env->GetStaticMethodID(_byte_buffer_cid, "wrap", "([B)Ljava/nio/ByteBuffer;");
+  assert(_byte_buffer_wrap_mid);
+
   static_initialize_address(env);
 }
 
@@ -97,18 +141,35 @@ void StreamCallbacks::static_initialize_address(JNIEnv* env) {
   }
 }
 
-void StreamCallbacks::initialize(JNIEnv *env, jobject instance) {
+void StreamCallbacks::initialize(JNIEnv *env, jobject instance, bool direct_dispatch) {
   _env = env;
   assert(_env);
   assert(instance);
   _instance = _env->NewGlobalRef(instance);
+  _direct_dispatch = direct_dispatch;
 }
 
 StreamCallbacks::StreamCallbacks() {
   _env = NULL;
+  _direct_dispatch = false;
+  _read_pool = NULL;
+  _cork = NULL;
+  _high_water_mark = 0;
+  _low_water_mark = 0;
+  _throttled = false;
+  _sendfile = NULL;
+  _cancelled_send_file = NULL;
+  _cancelled_send_file_bytes = 0;
+  _accept_batch = NULL;
+  _framer = NULL;
 }
 
 StreamCallbacks::~StreamCallbacks() {
+  assert(!_sendfile);
+  delete _cancelled_send_file;
+  delete _cork;
+  delete _accept_batch;
+  delete _framer;
   _env->DeleteGlobalRef(_instance);
 }
 
@@ -117,30 +178,240 @@ void StreamCallbacks::throw_exception(int code, const char* syscall) {
   ThrowException(_env, code, syscall);
 }
 
+jobject StreamCallbacks::heap_buffer(const char* data, size_t length) {
+  jbyteArray array = _env->NewByteArray(static_cast<jsize>(length));
+  if (!array) {
+    return NULL;
+  }
+  _env->SetByteArrayRegion(array, 0, static_cast<jsize>(length), reinterpret_cast<const jbyte*>(data));
+  jobject buffer = _env->CallStaticObjectMethod(_byte_buffer_cid, _byte_buffer_wrap_mid, array);
+  _env->DeleteLocalRef(array);
+  return buffer;
+}
+
+jobject StreamCallbacks::read_buffer(uv_buf_t* buf, jsize nread, BufferPool* pool) {
+  if (pool) {
+    // zero copy, the chunk stays with java until it is recycled
+    return _env->NewDirectByteBuffer(buf->base, nread);
+  }
+  // nothing would ever free a direct buffer over a native copy
+  return heap_buffer(buf->base, static_cast<size_t>(nread));
+}
+
+static void _release_read_buffer(uv_buf_t* buf, BufferPool* pool) {
+  if (buf->base == NULL) {
+    return;
+  }
+  if (pool) {
+    pool->release(buf->base);
+  } else {
+    delete[] buf->base;
+  }
+}
+
+ReadFramer::ReadFramer(uv_stream_t* stream) {
+  this->stream = stream;
+  mode = NONE;
+  prefix_bytes = 0;
+  big_endian = true;
+  max_frame = 0;
+}
+
+int ReadFramer::next(const char* data, size_t length, size_t scan, size_t* offset, size_t* frame_length, size_t* consumed) const {
+  if (mode == LENGTH_PREFIX) {
+    size_t prefix = static_cast<size_t>(prefix_bytes);
+    if (length < prefix) {
+      return 0;
+    }
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    uint64_t n = 0;
+    for (size_t i = 0; i < prefix; i++) {
+      n = (n << 8) | p[big_endian ? i : prefix - 1 - i];
+    }
+    if (n > max_frame) {
+      return -1;
+    }
+    if (length - prefix < n) {
+      return 0;
+    }
+    *offset = prefix;
+    *frame_length = static_cast<size_t>(n);
+    *consumed = prefix + *frame_length;
+    return 1;
+  }
+  assert(mode == DELIMITER);
+  const size_t d = delimiter.size();
+  for (size_t i = scan; i + d <= length; i++) {
+    const char* found = reinterpret_cast<const char*>(memchr(data + i, delimiter[0], length - d + 1 - i));
+    if (!found) {
+      break;
+    }
+    i = found - data;
+    if (memcmp(found, &delimiter[0], d) == 0) {
+      if (i > max_frame) {
+        return -1;
+      }
+      *offset = 0;
+      *frame_length = i;
+      *consumed = i + d;
+      return 1;
+    }
+  }
+  // a delimiter could only follow a payload that is already too long
+  return length >= max_frame + d ? -1 : 0;
+}
+
+void StreamCallbacks::set_framing(uv_stream_t* stream, int mode, int prefix_bytes, bool big_endian, const char* delimiter, size_t delimiter_length, size_t max_frame) {
+  if (!_framer) {
+    if (mode == ReadFramer::NONE) {
+      return;
+    }
+    _framer = new ReadFramer(stream);
+  }
+  _framer->mode = mode;
+  _framer->prefix_bytes = prefix_bytes;
+  _framer->big_endian = big_endian;
+  _framer->max_frame = max_frame;
+  _framer->delimiter.assign(delimiter, delimiter + delimiter_length);
+}
+
+jobject StreamCallbacks::frame_buffer(const char* data, size_t length, BufferPool* pool) {
+  if (!pool) {
+    return heap_buffer(data, length);
+  }
+  // small frames share a chunk, every buffer goes back with recycle
+  char* base = length <= pool->chunk_size() ? pool->allocate_slice(length) : pool->allocate_large(length);
+  memcpy(base, data, length);
+  jobject buffer = _env->NewDirectByteBuffer(base, length);
+  if (!buffer) {
+    pool->release(base);
+  }
+  return buffer;
+}
+
+// Hands every complete frame to the read callback. A frame that fills the
+// whole pooled chunk it was read into is passed on without a copy, others
+// are copied out into slices of a shared chunk, or a large pool buffer when
+// bigger than a chunk. Without pooling each frame is a java heap copy.
+void StreamCallbacks::on_framed_read(uv_buf_t* buf, jsize nread) {
+  BufferPool* pool = _read_pool;
+  ReadFramer* framer = _framer;
+  std::vector<char>& partial = framer->partial;
+  const size_t d = framer->mode == ReadFramer::DELIMITER ? framer->delimiter.size() : 1;
+  const bool buffered = !partial.empty();
+  const char* data = buf->base;
+  size_t length = static_cast<size_t>(nread);
+  size_t scan = 0;
+  if (buffered) {
+    // the delimiter was not in what we had, only its tail can be
+    scan = partial.size() >= d ? partial.size() - d + 1 : 0;
+    partial.insert(partial.end(), buf->base, buf->base + nread);
+    _release_read_buffer(buf, pool);
+    buf->base = NULL;
+    data = &partial[0];
+    length = partial.size();
+  }
+
+  size_t position = 0;
+  bool failed = false;
+  while (position < length && !uv_is_closing(reinterpret_cast<uv_handle_t*>(framer->stream))) {
+    size_t offset = 0;
+    size_t frame_length = length - position;
+    size_t consumed = frame_length;
+    if (framer->mode != ReadFramer::NONE) {
+      int r = framer->next(data + position, length - position, scan, &offset, &frame_length, &consumed);
+      if (r == 0) {
+        break;
+      }
+      if (r < 0) {
+        failed = true;
+        break;
+      }
+    }
+    scan = 0;
+
+    jobject arg = NULL;
+    if (pool && !buffered && position == 0 && offset == 0 && consumed == length) {
+      arg = _env->NewDirectByteBuffer(buf->base, frame_length);
+      if (arg) {
+        // the chunk now belongs to java
+        buf->base = NULL;
+      }
+    } else {
+      arg = frame_buffer(data + position + offset, frame_length, pool);
+    }
+    if (!arg) {
+      _release_read_buffer(buf, pool);
+      partial.clear();
+      ThrowOutOfMemoryError(_env, FUNCTION_NAME, __FILE__, TOSTRING(__LINE__), "frame");
+      return;
+    }
+    position += consumed;
+    _env->CallVoidMethod(
+        _instance,
+        read_mid(),
+        arg);
+    _env->DeleteLocalRef(arg);
+  }
+
+  if (failed || uv_is_closing(reinterpret_cast<uv_handle_t*>(framer->stream))) {
+    partial.clear();
+  } else if (buffered) {
+    partial.erase(partial.begin(), partial.begin() + position);
+  } else {
+    partial.assign(data + position, data + length);
+  }
+  _release_read_buffer(buf, pool);
+
+  if (failed) {
+    // an oversized frame cannot be skipped, end the stream as on a read error
+    uv_read_stop(framer->stream);
+    _env->CallVoidMethod(
+        _instance,
+        read_mid(),
+        NULL);
+  }
+}
+
 void StreamCallbacks::on_read(uv_buf_t* buf, jsize nread) {
   assert(_env);
+  if (nread > 0 && framed()) {
+    on_framed_read(buf, nread);
+    return;
+  }
+  // the buffer was allocated under the current mode, do not let the
+  // callback change how it is released
+  BufferPool* pool = _read_pool;
   if (nread < 0) {
+    if (_framer) {
+      _framer->partial.clear();
+    }
+    _release_read_buffer(buf, pool);
     _env->CallVoidMethod(
         _instance,
-        _call_read_callback_mid,
+        read_mid(),
         NULL);
   } else if (nread > 0) {
-    jbyte* data = new jbyte[nread];
-    memcpy(data, buf->base, nread);
-    jobject arg = _env->NewDirectByteBuffer(data, nread);
+    jobject arg = read_buffer(buf, nread, pool);
+    if (!arg || !pool) {
+      _release_read_buffer(buf, pool);
+    }
     OOM(_env, arg);
     _env->CallVoidMethod(
         _instance,
-        _call_read_callback_mid,
+        read_mid(),
         arg);
     _env->DeleteLocalRef(arg);
+  } else {
+    _release_read_buffer(buf, pool);
   }
-  delete[] buf->base;
 }
 
 void StreamCallbacks::on_read2(uv_buf_t* buf, jsize nread, jlong ptr, uv_handle_type pending) {
   assert(_env);
+  BufferPool* pool = _read_pool;
   if (nread < 0) {
+    _release_read_buffer(buf, pool);
     _env->CallVoidMethod(
         _instance,
         _call_read2_callback_mid,
@@ -148,9 +419,10 @@ void StreamCallbacks::on_read2(uv_buf_t* buf, jsize nread, jlong ptr, uv_handle_
         ptr,
         pending);
   } else if (nread > 0) {
-    jbyte* data = new jbyte[nread];
-    memcpy(data, buf->base, nread);
-    jobject array = _env->NewDirectByteBuffer(data, nread);
+    jobject array = read_buffer(buf, nread, pool);
+    if (!array || !pool) {
+      _release_read_buffer(buf, pool);
+    }
     OOM(_env, array);
     _env->CallVoidMethod(
         _instance,
@@ -159,22 +431,87 @@ void StreamCallbacks::on_read2(uv_buf_t* buf, jsize nread, jlong ptr, uv_handle_
         ptr,
         pending);
     _env->DeleteLocalRef(array);
+  } else {
+    _release_read_buffer(buf, pool);
   }
-  delete[] buf->base;
 }
 
 void StreamCallbacks::on_write(int status, int error_code, jobject buffer, jobject context) {
+  assert(_env);
+  jthrowable exception = error_code ? NewException(_env, error_code) : NULL;
+  if (_direct_dispatch) {
+    _env->CallVoidMethod(
+        _instance,
+        _dispatch_write_mid,
+        status,
+        exception);
+  } else {
+    _env->CallVoidMethod(
+        _instance,
+        _call_write_callback_mid,
+        status,
+        exception,
+        context);
+  }
+  if (exception) { _env->DeleteLocalRef(exception); }
+}
+
+void StreamCallbacks::on_send_file(int error_code, jlong bytes, jobject context) {
   assert(_env);
   jthrowable exception = error_code ? NewException(_env, error_code) : NULL;
   _env->CallVoidMethod(
       _instance,
-      _call_write_callback_mid,
-      status,
+      _call_sendfile_callback_mid,
+      bytes,
       exception,
       context);
   if (exception) { _env->DeleteLocalRef(exception); }
 }
 
+void StreamCallbacks::on_drain() {
+  assert(_env);
+  _env->CallVoidMethod(
+      _instance,
+      _call_drain_callback_mid);
+}
+
+size_t StreamCallbacks::queued(uv_stream_t* stream) {
+  size_t corked = _cork ? _cork->data.size() : 0;
+  return stream->write_queue_size + corked;
+}
+
+void StreamCallbacks::set_water_marks(size_t high, size_t low) {
+  assert(!high || low <= high);
+  _high_water_mark = high;
+  _low_water_mark = low;
+  if (!high) {
+    _throttled = false;
+  }
+}
+
+int StreamCallbacks::check_high_water_mark(uv_stream_t* stream, int r, size_t bytes) {
+  if (r) {
+    return r;
+  }
+  size_t size = queued(stream);
+  _counters.count_write(stream->loop, bytes, size);
+  if (!_high_water_mark) {
+    return r;
+  }
+  if (_throttled || size >= _high_water_mark) {
+    _throttled = true;
+    return WRITE_THROTTLED;
+  }
+  return 0;
+}
+
+void StreamCallbacks::check_low_water_mark(uv_stream_t* stream) {
+  if (_throttled && queued(stream) <= _low_water_mark && !uv_is_closing(reinterpret_cast<uv_handle_t*>(stream))) {
+    _throttled = false;
+    on_drain();
+  }
+}
+
 void StreamCallbacks::on_connect(int status, int error_code, jobject context) {
   assert(_env);
   jthrowable exception = error_code ? NewException(_env, error_code) : NULL;
@@ -198,6 +535,14 @@ void StreamCallbacks::on_connection(int status, int error_code) {
   if (exception) { _env->DeleteLocalRef(exception); }
 }
 
+void StreamCallbacks::on_connection_batch(jint count) {
+  assert(_env);
+  _env->CallVoidMethod(
+      _instance,
+      _call_connection_batch_callback_mid,
+      count);
+}
+
 void StreamCallbacks::on_shutdown(int status, int error_code, jobject context) {
   assert(_env);
   jthrowable exception = error_code ? NewException(_env, error_code) : NULL;
@@ -217,6 +562,544 @@ void StreamCallbacks::on_close() {
       _call_close_callback_mid);
 }
 
+// the writes of one cork flush, owned by the uv_write_t until _cork_write_cb
+struct CorkedWrite {
+  std::vector<char> data;
+  std::vector<ContextHolder*> holders;
+};
+
+static void _cork_write_cb(uv_write_t* req, int status) {
+  assert(req->handle);
+  assert(req->handle->data);
+  CallbackScope scope(req->handle->loop, req->handle->type);
+  StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(req->handle->data);
+  CorkedWrite* batch = reinterpret_cast<CorkedWrite*>(req->data);
+  int error_code = status < 0 ? uv_last_error(req->handle->loop).code : 0;
+  for (size_t i = 0; i < batch->holders.size(); i++) {
+    cb->on_write(status, error_code, NULL, batch->holders[i]->context());
+    delete batch->holders[i];
+  }
+  cb->check_low_water_mark(req->handle);
+  cb->start_send_file(req->handle);
+  delete batch;
+  freelist_delete(req);
+}
+
+static void _cork_check_cb(uv_check_t* check, int status) {
+  assert(check->data);
+  StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(check->data);
+  uv_check_stop(check);
+  cb->flush_cork(false);
+}
+
+static void _cork_check_close_cb(uv_handle_t* handle) {
+  delete reinterpret_cast<uv_check_t*>(handle);
+}
+
+WriteCork::WriteCork(uv_stream_t* stream) {
+  this->stream = stream;
+  check = NULL;
+  corked = false;
+  automatic = false;
+  sending = false;
+}
+
+WriteCork::~WriteCork() {
+  assert(!check);
+  for (size_t i = 0; i < holders.size(); i++) {
+    delete holders[i];
+  }
+}
+
+WriteCork* StreamCallbacks::create_cork(uv_stream_t* stream) {
+  if (!_cork) {
+    _cork = new WriteCork(stream);
+  }
+  return _cork;
+}
+
+void StreamCallbacks::set_auto_cork(bool automatic) {
+  assert(_cork);
+  if (automatic && !_cork->check) {
+    _cork->check = new uv_check_t();
+    uv_check_init(_cork->stream->loop, _cork->check);
+    _cork->check->data = this;
+  }
+  _cork->automatic = automatic;
+  if (!automatic && _cork->check) {
+    uv_check_stop(_cork->check);
+  }
+}
+
+int StreamCallbacks::cork_write(const uv_buf_t* bufs, int count, jobject context) {
+  assert(_cork);
+  size_t size = 0;
+  for (int i = 0; i < count; i++) {
+    _cork->data.insert(_cork->data.end(), bufs[i].base, bufs[i].base + bufs[i].len);
+    size += bufs[i].len;
+  }
+  return cork_commit(size, context);
+}
+
+char* StreamCallbacks::cork_reserve(size_t size) {
+  assert(_cork);
+  size_t offset = _cork->data.size();
+  _cork->data.resize(offset + size);
+  return size ? &_cork->data[offset] : NULL;
+}
+
+void StreamCallbacks::cork_shrink(size_t unused) {
+  assert(_cork);
+  assert(unused <= _cork->data.size());
+  _cork->data.resize(_cork->data.size() - unused);
+}
+
+int StreamCallbacks::cork_commit(size_t size, jobject context) {
+  assert(_cork);
+  ContextHolder* holder = new (_cork->stream->loop) ContextHolder(_env, context);
+  if (!holder) {
+    // drop the bytes of the write, it fails like a failed uv_write
+    cork_shrink(size);
+    loop_set_error(_cork->stream->loop, UV_ENOMEM);
+    return -1;
+  }
+  _cork->holders.push_back(holder);
+  if (_cork->data.size() >= WriteCork::FLUSH_THRESHOLD) {
+    return flush_cork(true);
+  }
+  if (_cork->automatic && !uv_is_active(reinterpret_cast<uv_handle_t*>(_cork->check))) {
+    // active while writes are pending, so the loop runs until they are flushed
+    uv_check_start(_cork->check, _cork_check_cb);
+  }
+  return 0;
+}
+
+int StreamCallbacks::flush_cork(bool caller_owns_last) {
+  if (!_cork || _cork->empty() || _cork->sending) {
+    return 0;
+  }
+  if (_cork->check) {
+    uv_check_stop(_cork->check);
+  }
+  uv_stream_t* stream = _cork->stream;
+  CorkedWrite* batch = new CorkedWrite();
+  batch->data.swap(_cork->data);
+  batch->holders.swap(_cork->holders);
+  uv_write_t* req = loop_new_req<uv_write_t>(stream->loop, LoopData::WRITE_REQ);
+  int r = -1;
+  if (req) {
+    req->handle = stream;
+    req->data = batch;
+    uv_buf_t buf = uv_buf_init(batch->data.empty() ? NULL : &batch->data[0],
+                               static_cast<unsigned int>(batch->data.size()));
+    r = uv_write(req, stream, &buf, 1, _cork_write_cb);
+  } else {
+    loop_set_error(stream->loop, UV_ENOMEM);
+  }
+  if (r) {
+    int error_code = uv_last_error(stream->loop).code;
+    size_t notified = batch->holders.size();
+    if (caller_owns_last && notified) {
+      notified--;
+    }
+    for (size_t i = 0; i < batch->holders.size(); i++) {
+      if (i < notified) {
+        // accepted by an earlier write call, so only its callback can tell
+        on_write(r, error_code, NULL, batch->holders[i]->context());
+      }
+      delete batch->holders[i];
+    }
+    delete batch;
+    freelist_delete(req);
+  }
+  return r;
+}
+
+void StreamCallbacks::close_cork() {
+  if (!_cork) {
+    return;
+  }
+  flush_cork(false);
+  if (_cork->check) {
+    uv_handle_t* check = reinterpret_cast<uv_handle_t*>(_cork->check);
+    // LoopHandle.closeAll may have closed it already
+    if (!uv_is_closing(check)) {
+      uv_close(check, _cork_check_close_cb);
+    }
+    _cork->check = NULL;
+  }
+}
+
+// A file sent to a stream with non-blocking sendfile(2) from the loop. A
+// poll handle waits for the socket to become writable and each wakeup sends
+// at most SEND_FILE_SLICE bytes, so one large file can not starve the other
+// handles. The poll watches a dup of the socket, as libuv allows a single
+// watcher per descriptor and the stream already owns the original one.
+struct SendFile {
+  uv_poll_t poll;
+  StreamCallbacks* callbacks;
+  ContextHolder* holder;
+  int socket;
+  int fd;
+  int64_t offset;
+  int64_t length;
+  int64_t sent;
+  int error;
+  uv_handle_type type;
+  bool started;
+  bool polling;   // the poll handle is initialized and frees the request on close
+};
+
+#ifndef _WIN32
+
+static const int64_t SEND_FILE_SLICE = 1024 * 1024;
+
+// bytes sent, 0 at the end of the file, -1 with errno set
+static ssize_t _send_file_chunk(SendFile* request) {
+  int64_t remaining = request->length - request->sent;
+  size_t chunk = remaining > 0x7ffff000 ? 0x7ffff000 : static_cast<size_t>(remaining);
+#if defined(__linux__)
+  off_t offset = static_cast<off_t>(request->offset + request->sent);
+  return sendfile(request->socket, request->fd, &offset, chunk);
+#elif defined(__APPLE__)
+  off_t length = static_cast<off_t>(chunk);
+  int r = sendfile(request->fd, request->socket, static_cast<off_t>(request->offset + request->sent), &length, NULL, 0);
+  // partial sends report EAGAIN along with the bytes that did go out
+  if (length > 0) {
+    return static_cast<ssize_t>(length);
+  }
+  return r == 0 ? 0 : -1;
+#else
+  // no zero copy here, but the same semantics
+  char buffer[64 * 1024];
+  if (chunk > sizeof(buffer)) {
+    chunk = sizeof(buffer);
+  }
+  ssize_t n = pread(request->fd, buffer, chunk, request->offset + request->sent);
+  if (n <= 0) {
+    return n;
+  }
+  ssize_t written = write(request->socket, buffer, n);
+  return written;
+#endif
+}
+
+// false while there is more to send once the socket is writable again
+static bool _send_file_pump(SendFile* request) {
+  int64_t slice = 0;
+  while (request->sent < request->length && slice < SEND_FILE_SLICE) {
+    ssize_t r = _send_file_chunk(request);
+    if (r > 0) {
+      request->sent += r;
+      slice += r;
+    } else if (r == 0) {
+      return true;  // the file is shorter than length
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return false;
+    } else if (errno != EINTR) {
+      request->error = sys_error_code(errno);
+      return true;
+    }
+  }
+  return request->sent >= request->length;
+}
+
+static void _send_file_close_cb(uv_handle_t* handle) {
+  SendFile* request = reinterpret_cast<SendFile*>(handle->data);
+  close(request->socket);
+  delete request->holder;
+  delete request;
+}
+
+static void _send_file_release(SendFile* request) {
+  if (!request->polling) {
+    close(request->socket);
+    delete request->holder;
+    delete request;
+    return;
+  }
+  uv_handle_t* handle = reinterpret_cast<uv_handle_t*>(&request->poll);
+  if (uv_is_closing(handle)) {
+    // already closed by the loop's closeAll, make sure we still free it
+    handle->close_cb = _send_file_close_cb;
+  } else {
+    uv_close(handle, _send_file_close_cb);
+  }
+}
+
+static void _send_file_poll_cb(uv_poll_t* poll, int status, int events) {
+  SendFile* request = reinterpret_cast<SendFile*>(poll->data);
+  assert(request->callbacks);
+  if (status < 0) {
+    request->error = uv_last_error(poll->loop).code;
+  } else if (!_send_file_pump(request)) {
+    return;
+  }
+  uv_poll_stop(poll);
+  {
+    CallbackScope scope(poll->loop, request->type);
+    request->callbacks->send_file_done(request);
+  }
+  _send_file_release(request);
+}
+
+#endif // _WIN32
+
+int StreamCallbacks::send_file(uv_stream_t* stream, int fd, int64_t offset, int64_t length, jobject context) {
+#ifdef _WIN32
+  return UV_ENOTSUP;
+#else
+  if (_sendfile) {
+    return UV_EBUSY;
+  }
+  // corked writes go first to keep the stream in order
+  int r = flush_cork(false);
+  if (r) {
+    return uv_last_error(stream->loop).code;
+  }
+  int out = dup(stream->io_watcher.fd);
+  if (out < 0) {
+    return sys_error_code(errno);
+  }
+  ContextHolder* holder = new (stream->loop) ContextHolder(_env, context);
+  if (!holder) {
+    close(out);
+    return UV_ENOMEM;
+  }
+  SendFile* request = new SendFile();
+  memset(&request->poll, 0, sizeof(request->poll));
+  request->callbacks = this;
+  request->holder = holder;
+  request->socket = out;
+  request->fd = fd;
+  request->offset = offset;
+  request->length = length;
+  request->sent = 0;
+  request->error = 0;
+  request->type = stream->type;
+  request->started = false;
+  request->polling = false;
+  _sendfile = request;
+  WriteCork* cork = create_cork(stream);
+  cork->sending = true;
+  int error = poll_send_file(stream);
+  if (error) {
+    // thrown by the caller, no callback for this one
+    _sendfile = NULL;
+    cork->sending = false;
+    _send_file_release(request);
+  }
+  return error;
+#endif
+}
+
+int StreamCallbacks::poll_send_file(uv_stream_t* stream) {
+#ifndef _WIN32
+  SendFile* request = _sendfile;
+  if (!request || request->started || stream->write_queue_size) {
+    return 0;
+  }
+  request->started = true;
+  // the first slice goes out from the poll callback too, never from within
+  // the call that queued the file
+  int r = uv_poll_init(stream->loop, &request->poll, request->socket);
+  if (!r) {
+    request->polling = true;
+    request->poll.data = request;
+    r = uv_poll_start(&request->poll, UV_WRITABLE, _send_file_poll_cb);
+  }
+  if (r) {
+    return uv_last_error(stream->loop).code;
+  }
+#endif
+  return 0;
+}
+
+void StreamCallbacks::start_send_file(uv_stream_t* stream) {
+#ifndef _WIN32
+  int error = poll_send_file(stream);
+  if (error) {
+    SendFile* request = _sendfile;
+    request->error = error;
+    send_file_done(request);
+    _send_file_release(request);
+  }
+#endif
+}
+
+void StreamCallbacks::send_file_done(SendFile* request) {
+  assert(_sendfile == request);
+  _sendfile = NULL;
+  _cork->sending = false;
+  if (!_cork->corked) {
+    flush_cork(false);
+  }
+  if (request->sent) {
+    _counters.count_write(_cork->stream->loop, static_cast<size_t>(request->sent), queued(_cork->stream));
+  }
+  on_send_file(request->error, static_cast<jlong>(request->sent), request->holder->context());
+}
+
+void StreamCallbacks::close_send_file() {
+  SendFile* request = _sendfile;
+  if (!request) {
+    return;
+  }
+  _sendfile = NULL;
+  _cork->sending = false;
+  // reported from the close callback of the stream, like cancelled writes
+  assert(!_cancelled_send_file);
+  _cancelled_send_file = request->holder;
+  _cancelled_send_file_bytes = request->sent;
+  request->holder = NULL;
+#ifndef _WIN32
+  _send_file_release(request);
+#endif
+}
+
+void StreamCallbacks::report_cancelled_send_file() {
+  ContextHolder* holder = _cancelled_send_file;
+  if (!holder) {
+    return;
+  }
+  _cancelled_send_file = NULL;
+  on_send_file(UV_ECANCELED, static_cast<jlong>(_cancelled_send_file_bytes), holder->context());
+  delete holder;
+}
+
+AcceptBatch::AcceptBatch(uv_stream_t* server) {
+  this->server = server;
+  check = NULL;
+  pointers = NULL;
+  max = 0;
+  no_delay = false;
+  keep_alive = false;
+  delay = 0;
+}
+
+AcceptBatch::~AcceptBatch() {
+  assert(!check);
+  assert(pending.empty());
+}
+
+static void _accept_check_cb(uv_check_t* check, int status) {
+  assert(check->data);
+  CallbackScope scope(check->loop, UV_TCP);
+  StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(check->data);
+  uv_check_stop(check);
+  cb->flush_accepted();
+}
+
+static void _accept_check_close_cb(uv_handle_t* handle) {
+  delete reinterpret_cast<uv_check_t*>(handle);
+}
+
+static void _accept_failed_close_cb(uv_handle_t* handle) {
+  delete reinterpret_cast<uv_tcp_t*>(handle);
+}
+
+void StreamCallbacks::set_accept_batch(JNIEnv* env, uv_stream_t* server, jlongArray pointers, jint max, bool no_delay, bool keep_alive, unsigned int delay) {
+  if (!_accept_batch) {
+    if (!max) {
+      return;
+    }
+    _accept_batch = new AcceptBatch(server);
+    _accept_batch->check = new uv_check_t();
+    uv_check_init(server->loop, _accept_batch->check);
+    _accept_batch->check->data = this;
+    uv_unref(reinterpret_cast<uv_handle_t*>(_accept_batch->check));
+  }
+  // clients still pending are handed over from the check callback, in the
+  // new array, which is the current one when batching is turned off
+  if (!_accept_batch->pending.empty()) {
+    uv_check_start(_accept_batch->check, _accept_check_cb);
+  }
+  if (_accept_batch->pointers) {
+    env->DeleteGlobalRef(_accept_batch->pointers);
+  }
+  _accept_batch->pointers = pointers ? (jlongArray) env->NewGlobalRef(pointers) : NULL;
+  _accept_batch->max = max;
+  _accept_batch->no_delay = no_delay;
+  _accept_batch->keep_alive = keep_alive;
+  _accept_batch->delay = delay;
+}
+
+void StreamCallbacks::accept_one(uv_stream_t* server) {
+  assert(accept_batched());
+  uv_loop_t* loop = server->loop;
+  uv_tcp_t* client = new uv_tcp_t();
+  int r = uv_tcp_init(loop, client);
+  if (r) {
+    delete client;
+    on_connection(r, uv_last_error(loop).code);
+    return;
+  }
+  r = uv_accept(server, reinterpret_cast<uv_stream_t*>(client));
+  if (!r && _accept_batch->no_delay) {
+    r = uv_tcp_nodelay(client, 1);
+  }
+  if (!r && _accept_batch->keep_alive) {
+    r = uv_tcp_keepalive(client, 1, _accept_batch->delay);
+  }
+  if (r) {
+    int error_code = uv_last_error(loop).code;
+    uv_close(reinterpret_cast<uv_handle_t*>(client), _accept_failed_close_cb);
+    on_connection(r, error_code);
+    return;
+  }
+  // callbacks are attached when java takes the client over
+  _accept_batch->pending.push_back(reinterpret_cast<jlong>(client));
+  if (static_cast<jint>(_accept_batch->pending.size()) >= _accept_batch->max) {
+    flush_accepted();
+  } else if (!uv_is_active(reinterpret_cast<uv_handle_t*>(_accept_batch->check))) {
+    uv_check_start(_accept_batch->check, _accept_check_cb);
+  }
+}
+
+void StreamCallbacks::flush_accepted() {
+  if (!_accept_batch || _accept_batch->pending.empty()) {
+    return;
+  }
+  uv_check_stop(_accept_batch->check);
+  // the batch may have shrunk since these were accepted, and the callback
+  // may change or close it again
+  while (_accept_batch->check && !_accept_batch->pending.empty()) {
+    std::vector<jlong>& pending = _accept_batch->pending;
+    jint count = static_cast<jint>(pending.size());
+    jint capacity = _env->GetArrayLength(_accept_batch->pointers);
+    if (count > capacity) {
+      count = capacity;
+    }
+    for (jint i = 0; i < count; i++) {
+      reinterpret_cast<uv_tcp_t*>(pending[i])->data = new StreamCallbacks();
+    }
+    _env->SetLongArrayRegion(_accept_batch->pointers, 0, count, &pending[0]);
+    pending.erase(pending.begin(), pending.begin() + count);
+    on_connection_batch(count);
+  }
+}
+
+void StreamCallbacks::close_accept_batch() {
+  if (!_accept_batch) {
+    return;
+  }
+  // clients java has not seen yet are closed here, not handed over from
+  // within close
+  std::vector<jlong>& pending = _accept_batch->pending;
+  for (size_t i = 0; i < pending.size(); i++) {
+    uv_close(reinterpret_cast<uv_handle_t*>(pending[i]), _accept_failed_close_cb);
+  }
+  pending.clear();
+  if (_accept_batch->check) {
+    uv_close(reinterpret_cast<uv_handle_t*>(_accept_batch->check), _accept_check_close_cb);
+    _accept_batch->check = NULL;
+  }
+  if (_accept_batch->pointers) {
+    _env->DeleteGlobalRef(_accept_batch->pointers);
+    _accept_batch->pointers = NULL;
+  }
+}
+
 // used in tcp.cpp and udp.cpp
 jobject StreamCallbacks::_address_to_js(JNIEnv* env, const sockaddr* addr) {
   char ip[INET6_ADDRSTRLEN];
@@ -250,12 +1133,21 @@ jobject StreamCallbacks::_address_to_js(JNIEnv* env, const sockaddr* addr) {
 }
 
 static uv_buf_t _alloc_cb(uv_handle_t* handle, size_t suggested_size) {
+  StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(handle->data);
+  if (cb && cb->read_pool()) {
+    BufferPool* pool = cb->read_pool();
+    return uv_buf_init(pool->allocate(), static_cast<unsigned int>(pool->chunk_size()));
+  }
   return uv_buf_init(new char[suggested_size], static_cast<unsigned int>(suggested_size));
 }
 
 static void _read_cb(uv_stream_t* stream, ssize_t nread, uv_buf_t buf) {
+  CallbackScope scope(stream->loop, stream->type);
   StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(stream->data);
   assert(cb);
+  if (nread > 0) {
+    cb->counters().count_read(stream->loop, static_cast<size_t>(nread));
+  }
   jsize size = static_cast<jsize>(nread);
   cb->on_read(&buf, size);
 }
@@ -265,27 +1157,34 @@ static void _shutdown_cb(uv_shutdown_t* req, int status) {
   assert(req->data);
   assert(req->handle);
   assert(req->handle->data);
+  CallbackScope scope(req->handle->loop, req->handle->type);
   StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(req->handle->data);
   ContextHolder* req_data = reinterpret_cast<ContextHolder*>(req->data);
   cb->on_shutdown(status, status < 0 ? uv_last_error(req->handle->loop).code : 0, req_data->context());
   delete req_data;
-  delete req;
+  freelist_delete(req);
 }
 
 static void _close_cb(uv_handle_t* handle) {
   assert(handle);
   assert(handle->data);
+  CallbackScope scope(handle->loop, handle->type);
   StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(handle->data);
+  cb->report_cancelled_send_file();
   cb->on_close();
   delete cb;
   delete handle;
 }
 
 static void _read2_cb(uv_pipe_t* pipe, ssize_t nread, uv_buf_t buf, uv_handle_type pending) {
+  CallbackScope scope(pipe->loop, pipe->type);
   int r;
   StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(pipe->data);
   assert(cb);
   uv_stream_t* handle = reinterpret_cast<uv_stream_t*>(pipe);
+  if (nread > 0) {
+    cb->counters().count_read(handle->loop, static_cast<size_t>(nread));
+  }
   jsize size = static_cast<jsize>(nread);
   if (pending == UV_TCP) {
     uv_tcp_t* tcp = new uv_tcp_t();
@@ -338,17 +1237,25 @@ static void _read2_cb(uv_pipe_t* pipe, ssize_t nread, uv_buf_t buf, uv_handle_ty
 static void _write_cb(uv_write_t* req, int status) {
   assert(req->handle);
   assert(req->handle->data);
+  CallbackScope scope(req->handle->loop, req->handle->type);
   StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(req->handle->data);
   ContextHolder* req_data = reinterpret_cast<ContextHolder*>(req->data);
   cb->on_write(status, status < 0 ? uv_last_error(req->handle->loop).code : 0, req_data->data(), req_data->context());
-  delete req;
+  cb->check_low_water_mark(req->handle);
+  cb->start_send_file(req->handle);
+  freelist_delete(req);
   delete req_data;
 }
 
 static void _connection_cb(uv_stream_t* stream, int status) {
   assert(stream);
   assert(stream->data);
+  CallbackScope scope(stream->loop, stream->type);
   StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(stream->data);
+  if (status == 0 && cb->accept_batched()) {
+    cb->accept_one(stream);
+    return;
+  }
   cb->on_connection(status, status < 0 ? uv_last_error(stream->loop).code : 0);
 }
 
@@ -366,16 +1273,16 @@ JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_StreamHandle__1static_1init
 /*
  * Class:     com_oracle_libuv_handles_StreamHandle
  * Method:    _initialize
- * Signature: (J)V
+ * Signature: (JZ)V
  */
 JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_StreamHandle__1initialize
-  (JNIEnv *env, jobject that, jlong stream) {
+  (JNIEnv *env, jobject that, jlong stream, jboolean direct_dispatch) {
 
   assert(stream);
   uv_stream_t* handle = reinterpret_cast<uv_stream_t*>(stream);
   assert(handle->data);
   StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(handle->data);
-  cb->initialize(env, that);
+  cb->initialize(env, that, direct_dispatch == JNI_TRUE);
 }
 
 /*
@@ -478,17 +1385,44 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_StreamHandle__1write
 
   int r;
   uv_stream_t* handle = reinterpret_cast<uv_stream_t*>(stream);
-  uv_write_t* req = new uv_write_t();
+  StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(handle->data);
+  if (cb->corked()) {
+    jbyte* base = data ?
+        (jbyte*) env->GetByteArrayElements(data, NULL) :
+        (jbyte*) env->GetDirectBufferAddress(buffer);
+    OOME(env, base);
+    uv_buf_t buf = uv_buf_init(reinterpret_cast<char*>(base + offset), length);
+    r = cb->cork_write(&buf, 1, context);
+    if (data) {
+      env->ReleaseByteArrayElements(data, base, JNI_ABORT);
+    }
+    if (r) {
+      ThrowException(env, handle->loop, "uv_write");
+    }
+    return cb->check_high_water_mark(handle, r, length);
+  }
+
+  uv_write_t* req = loop_new_req<uv_write_t>(handle->loop, LoopData::WRITE_REQ);
+  OOME(env, req);
   req->handle = handle;
-  ContextHolder* req_data = NULL;
+  ContextHolder* req_data = data ?
+      new (handle->loop) ContextHolder(env, context) :
+      new (handle->loop) ContextHolder(env, buffer, context);
+  if (!req_data) {
+    freelist_delete(req);
+    OOME(env, req_data);
+  }
+  req->data = req_data;
   if (data) {
     jbyte* base = (jbyte*) env->GetPrimitiveArrayCritical(data, NULL);
-    OOME(env, base);
+    if (!base) {
+      delete req_data;
+      freelist_delete(req);
+      OOME(env, base);
+    }
     uv_buf_t buf;
     buf.base = reinterpret_cast<char*>(base + offset);
     buf.len = length;
-    req_data = new ContextHolder(env, context);
-    req->data = req_data;
     r = uv_write(req, handle, &buf, 1, _write_cb);
     env->ReleasePrimitiveArrayCritical(data, base, 0);
   } else {
@@ -496,15 +1430,183 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_StreamHandle__1write
     uv_buf_t buf;
     buf.base = reinterpret_cast<char*>(base + offset);
     buf.len = length;
-    req->data = new ContextHolder(env, buffer, context);
     r = uv_write(req, handle, &buf, 1, _write_cb);
   }
   if (r) {
     delete req_data;
-    delete req;
+    freelist_delete(req);
     ThrowException(env, handle->loop, "uv_write");
   }
-  return r;
+  return cb->check_high_water_mark(handle, r, length);
+}
+
+// a natively encoded string write, base is a chunk of pool or heap allocated
+struct EncodedWrite {
+  char* base;
+  BufferPool* pool;
+  ContextHolder* holder;
+};
+
+static void _release_encoded_write(EncodedWrite* write) {
+  if (write->pool) {
+    write->pool->release(write->base);
+  } else {
+    delete[] write->base;
+  }
+  delete write->holder;
+  delete write;
+}
+
+static void _encoded_write_cb(uv_write_t* req, int status) {
+  assert(req->handle);
+  assert(req->handle->data);
+  CallbackScope scope(req->handle->loop, req->handle->type);
+  StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(req->handle->data);
+  EncodedWrite* write = reinterpret_cast<EncodedWrite*>(req->data);
+  cb->on_write(status, status < 0 ? uv_last_error(req->handle->loop).code : 0, NULL, write->holder->context());
+  cb->check_low_water_mark(req->handle);
+  cb->start_send_file(req->handle);
+  _release_encoded_write(write);
+  freelist_delete(req);
+}
+
+// false when the chars of str can not be pinned
+static bool _encoded_length(JNIEnv* env, jstring str, StringEncoding encoding, size_t* size) {
+  const jchar* chars = env->GetStringCritical(str, NULL);
+  if (!chars) {
+    return false;
+  }
+  *size = encoded_length(chars, env->GetStringLength(str), encoding);
+  env->ReleaseStringCritical(str, chars);
+  return true;
+}
+
+static bool _encode_string(JNIEnv* env, jstring str, StringEncoding encoding, char* out, size_t* size) {
+  const jchar* chars = env->GetStringCritical(str, NULL);
+  if (!chars) {
+    return false;
+  }
+  *size = encode_chars(chars, env->GetStringLength(str), encoding, out);
+  env->ReleaseStringCritical(str, chars);
+  return true;
+}
+
+static inline jstring _string_at(JNIEnv* env, jstring str, jobjectArray strs, jint index) {
+  return str ? str : (jstring) env->GetObjectArrayElement(strs, index);
+}
+
+static inline void _release_string_at(JNIEnv* env, jstring element, jstring str) {
+  if (element != str) {
+    env->DeleteLocalRef(element);
+  }
+}
+
+// encodes str, or the count elements of strs, into a single buffer taken
+// from the loop write pool (or the cork) and writes it
+static jint _write_encoded(JNIEnv* env, uv_stream_t* handle, jstring str, jobjectArray strs, jint count, StringEncoding encoding, jobject context) {
+  StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(handle->data);
+  size_t total = 0;
+  for (jint i = 0; i < count; i++) {
+    jstring element = _string_at(env, str, strs, i);
+    size_t size = 0;
+    bool pinned = _encoded_length(env, element, encoding, &size);
+    _release_string_at(env, element, str);
+    OOME(env, pinned);
+    total += size;
+  }
+
+  bool corked = cb->corked();
+  BufferPool* pool = NULL;
+  char* base;
+  if (corked) {
+    base = cb->cork_reserve(total);
+  } else if (total <= LoopData::WRITE_CHUNK_SIZE) {
+    pool = LoopData::get(handle->loop)->write_pool();
+    base = pool->allocate();
+  } else {
+    base = new char[total];
+  }
+
+  size_t offset = 0;
+  for (jint i = 0; i < count; i++) {
+    jstring element = _string_at(env, str, strs, i);
+    size_t size = 0;
+    bool pinned = _encode_string(env, element, encoding, base + offset, &size);
+    _release_string_at(env, element, str);
+    if (!pinned) {
+      if (corked) {
+        cb->cork_shrink(total);
+      } else if (pool) {
+        pool->release(base);
+      } else {
+        delete[] base;
+      }
+    }
+    OOME(env, pinned);
+    offset += size;
+  }
+  assert(offset == total);
+
+  int r;
+  if (corked) {
+    r = cb->cork_commit(total, context);
+  } else {
+    EncodedWrite* write = new EncodedWrite();
+    write->base = base;
+    write->pool = pool;
+    write->holder = new (handle->loop) ContextHolder(env, context);
+    if (!write->holder) {
+      _release_encoded_write(write);
+      ThrowOutOfMemoryError(env, FUNCTION_NAME, __FILE__, TOSTRING(__LINE__), "holder");
+      return -1;
+    }
+    uv_write_t* req = loop_new_req<uv_write_t>(handle->loop, LoopData::WRITE_REQ);
+    if (!req) {
+      _release_encoded_write(write);
+      OOME(env, req);
+    }
+    req->handle = handle;
+    req->data = write;
+    uv_buf_t buf = uv_buf_init(base, static_cast<unsigned int>(total));
+    r = uv_write(req, handle, &buf, 1, _encoded_write_cb);
+    if (r) {
+      _release_encoded_write(write);
+      freelist_delete(req);
+    }
+  }
+  if (r) {
+    ThrowException(env, handle->loop, "uv_write");
+  }
+  return cb->check_high_water_mark(handle, r, total);
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_StreamHandle
+ * Method:    _write_string
+ * Signature: (JLjava/lang/String;ILjava/lang/Object;)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_StreamHandle__1write_1string
+  (JNIEnv *env, jobject that, jlong stream, jstring str, jint encoding, jobject context) {
+
+  assert(stream);
+  assert(str);
+  uv_stream_t* handle = reinterpret_cast<uv_stream_t*>(stream);
+  return _write_encoded(env, handle, str, NULL, 1, static_cast<StringEncoding>(encoding), context);
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_StreamHandle
+ * Method:    _write_strings
+ * Signature: (J[Ljava/lang/String;ILjava/lang/Object;)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_StreamHandle__1write_1strings
+  (JNIEnv *env, jobject that, jlong stream, jobjectArray strs, jint encoding, jobject context) {
+
+  assert(stream);
+  assert(strs);
+  uv_stream_t* handle = reinterpret_cast<uv_stream_t*>(stream);
+  jint count = env->GetArrayLength(strs);
+  return _write_encoded(env, handle, NULL, strs, count, static_cast<StringEncoding>(encoding), context);
 }
 
 /*
@@ -521,10 +1623,42 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_StreamHandle__1writev
   assert(bufcount == env->GetArrayLength(buffers));
 
   int r;
+  size_t bytes = 0;
   uv_stream_t* handle = reinterpret_cast<uv_stream_t*>(stream);
-  uv_write_t* req = new uv_write_t();
+  StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(handle->data);
+  if (cb->corked()) {
+    jbyteArray* arrays = new jbyteArray[bufcount];
+    jbyte** bases = new jbyte*[bufcount];
+    uv_buf_t* bufs = new uv_buf_t[bufcount];
+    for (int i=0; i < bufcount; i++) {
+      arrays[i] = (jbyteArray) env->GetObjectArrayElement(buffers, i);
+      bases[i] = (jbyte*) env->GetByteArrayElements(arrays[i], NULL);
+      OOME(env, bases[i]);
+      bufs[i] = uv_buf_init(reinterpret_cast<char*>(bases[i]), env->GetArrayLength(arrays[i]));
+      bytes += bufs[i].len;
+    }
+    r = cb->cork_write(bufs, bufcount, context);
+    for (int i=0; i < bufcount; i++) {
+      env->ReleaseByteArrayElements(arrays[i], bases[i], JNI_ABORT);
+      env->DeleteLocalRef(arrays[i]);
+    }
+    delete[] bufs;
+    delete[] bases;
+    delete[] arrays;
+    if (r) {
+      ThrowException(env, handle->loop, "uv_write");
+    }
+    return cb->check_high_water_mark(handle, r, bytes);
+  }
+
+  uv_write_t* req = loop_new_req<uv_write_t>(handle->loop, LoopData::WRITE_REQ);
+  OOME(env, req);
   req->handle = handle;
-  ContextHolder* req_data = NULL;
+  ContextHolder* req_data = new (handle->loop) ContextHolder(env, buffers, context);
+  if (!req_data) {
+    freelist_delete(req);
+    OOME(env, req_data);
+  }
   jobject* elements = new jobject[bufcount];
   jbyte** bases = new jbyte*[bufcount];
   uv_buf_t* bufs = new uv_buf_t[bufcount];
@@ -536,20 +1670,89 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_StreamHandle__1writev
     bases[i] = base;
     bufs[i].base = reinterpret_cast<char*>(base);
     bufs[i].len = env->GetArrayLength(data);
+    bytes += bufs[i].len;
   }
-  req_data = new ContextHolder(env, buffers, context);
   req_data->set_elements(buffers, elements, bases, bufcount); // ContextHolder destructor will release array elements
   req->data = req_data;
   r = uv_write(req, handle, bufs, bufcount, _write_cb);
-  delete bufs;
-  delete bases;
-  delete elements;
+  delete[] bufs;
+  delete[] bases;
+  delete[] elements;
   if (r) {
     delete req_data;
-    delete req;
+    freelist_delete(req);
     ThrowException(env, handle->loop, "uv_write");
   }
-  return r;
+  return cb->check_high_water_mark(handle, r, bytes);
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_StreamHandle
+ * Method:    _writev_direct
+ * Signature: (J[Ljava/nio/ByteBuffer;ILjava/lang/Object;)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_StreamHandle__1writev_1direct
+  (JNIEnv *env, jobject that, jlong stream, jobjectArray buffers, jint bufcount, jobject context) {
+
+  assert(stream);
+  assert(buffers);
+  assert(bufcount > 0);
+  assert(bufcount == env->GetArrayLength(buffers));
+
+  // uv_write copies the uv_buf_t array, small ones can live on the stack
+  static const int STACK_BUFS = 16;
+  uv_buf_t stack_bufs[STACK_BUFS];
+  uv_buf_t* bufs = bufcount <= STACK_BUFS ? stack_bufs : new uv_buf_t[bufcount];
+  size_t bytes = 0;
+  for (int i=0; i < bufcount; i++) {
+    jobject buffer = env->GetObjectArrayElement(buffers, i);
+    bufs[i].base = reinterpret_cast<char*>(env->GetDirectBufferAddress(buffer));
+    bufs[i].len = static_cast<size_t>(env->GetDirectBufferCapacity(buffer));
+    bytes += bufs[i].len;
+    env->DeleteLocalRef(buffer);
+  }
+
+  uv_stream_t* handle = reinterpret_cast<uv_stream_t*>(stream);
+  StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(handle->data);
+  if (cb->corked()) {
+    int r = cb->cork_write(bufs, bufcount, context);
+    if (bufs != stack_bufs) {
+      delete[] bufs;
+    }
+    if (r) {
+      ThrowException(env, handle->loop, "uv_write");
+    }
+    return cb->check_high_water_mark(handle, r, bytes);
+  }
+
+  uv_write_t* req = loop_new_req<uv_write_t>(handle->loop, LoopData::WRITE_REQ);
+  if (!req) {
+    if (bufs != stack_bufs) {
+      delete[] bufs;
+    }
+    OOME(env, req);
+  }
+  req->handle = handle;
+  // the global ref to the array keeps every buffer alive until _write_cb
+  ContextHolder* req_data = new (handle->loop) ContextHolder(env, buffers, context);
+  if (!req_data) {
+    if (bufs != stack_bufs) {
+      delete[] bufs;
+    }
+    freelist_delete(req);
+    OOME(env, req_data);
+  }
+  req->data = req_data;
+  int r = uv_write(req, handle, bufs, bufcount, _write_cb);
+  if (bufs != stack_bufs) {
+    delete[] bufs;
+  }
+  if (r) {
+    delete req_data;
+    freelist_delete(req);
+    ThrowException(env, handle->loop, "uv_write");
+  }
+  return cb->check_high_water_mark(handle, r, bytes);
 }
 
 /*
@@ -565,38 +1768,62 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_StreamHandle__1write2
 
   int r;
   uv_stream_t* handle = reinterpret_cast<uv_stream_t*>(stream);
-  uv_write_t* req = new uv_write_t();
-  ContextHolder* req_data = NULL;
+  StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(handle->data);
+  if (cb->sending_file()) {
+    // handles can not be held back in the cork like plain writes
+    ThrowException(env, UV_EBUSY, "uv_write2");
+    return -1;
+  }
+  // corked writes go first to keep the stream in order
+  r = cb->flush_cork(false);
+  if (r) {
+    ThrowException(env, handle->loop, "uv_write");
+    return cb->check_high_water_mark(handle, r, 0);
+  }
+  uv_write_t* req = loop_new_req<uv_write_t>(handle->loop, LoopData::WRITE_REQ);
+  OOME(env, req);
+  ContextHolder* req_data = data ?
+      new (handle->loop) ContextHolder(env, context) :
+      new (handle->loop) ContextHolder(env, buffer, context);
+  if (!req_data) {
+    freelist_delete(req);
+    OOME(env, req_data);
+  }
   req->handle = handle;
+  req->data = req_data;
   if (data) {
     jbyte* base = (jbyte*) env->GetPrimitiveArrayCritical(data, NULL);
-    OOME(env, base);
+    if (!base) {
+      delete req_data;
+      freelist_delete(req);
+      OOME(env, base);
+    }
     uv_buf_t buf;
     buf.base = reinterpret_cast<char*>(base + offset);
     buf.len = length - offset;
-    req_data = new ContextHolder(env, context);
-    req->data = req_data;
     uv_stream_t* send_handle = reinterpret_cast<uv_stream_t*>(send_stream);
     r = uv_write2(req, handle, &buf, 1, send_handle, _write_cb);
     env->ReleasePrimitiveArrayCritical(data, base, 0);
   } else {
     jbyte* base = (jbyte*) env->GetDirectBufferAddress(buffer);
-    OOME(env, base);
+    if (!base) {
+      delete req_data;
+      freelist_delete(req);
+      OOME(env, base);
+    }
     uv_buf_t buf;
     buf.base = reinterpret_cast<char*>(base + offset);
     buf.len = length - offset;
     assert(stream);
-    req_data = new ContextHolder(env, buffer, context);
-    req->data = req_data;
     uv_stream_t* send_handle = reinterpret_cast<uv_stream_t*>(send_stream);
     r = uv_write2(req, handle, &buf, 1, send_handle, _write_cb);
   }
   if (r) {
     delete req_data;
-    delete req;
+    freelist_delete(req);
     ThrowException(env, handle->loop, "uv_write2");
   }
-  return r;
+  return cb->check_high_water_mark(handle, r, length - offset);
 }
 
 /*
@@ -609,7 +1836,44 @@ JNIEXPORT jlong JNICALL Java_com_oracle_libuv_handles_StreamHandle__1write_1queu
 
   assert(stream);
   uv_stream_t* handle = reinterpret_cast<uv_stream_t*>(stream);
-  return handle->write_queue_size;
+  StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(handle->data);
+  size_t corked = cb->cork() ? cb->cork()->data.size() : 0;
+  return handle->write_queue_size + corked;
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_StreamHandle
+ * Method:    _set_water_marks
+ * Signature: (JJJ)V
+ */
+JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_StreamHandle__1set_1water_1marks
+  (JNIEnv *env, jobject that, jlong stream, jlong high, jlong low) {
+
+  assert(stream);
+  uv_stream_t* handle = reinterpret_cast<uv_stream_t*>(stream);
+  assert(handle->data);
+  StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(handle->data);
+  cb->set_water_marks(static_cast<size_t>(high), static_cast<size_t>(low));
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_StreamHandle
+ * Method:    _send_file
+ * Signature: (JIJJLjava/lang/Object;)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_StreamHandle__1send_1file
+  (JNIEnv *env, jobject that, jlong stream, jint fd, jlong offset, jlong length, jobject context) {
+
+  assert(stream);
+  uv_stream_t* handle = reinterpret_cast<uv_stream_t*>(stream);
+  assert(handle->data);
+  StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(handle->data);
+  int error = cb->send_file(handle, fd, offset, length, context);
+  if (error) {
+    ThrowException(env, error, "sendfile");
+    return -1;
+  }
+  return 0;
 }
 
 /*
@@ -622,14 +1886,30 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_StreamHandle__1close_1write
 
   assert(stream);
   uv_stream_t* handle = reinterpret_cast<uv_stream_t*>(stream);
-  uv_shutdown_t* req = new uv_shutdown_t();
-  ContextHolder* req_data = new ContextHolder(env, context);
+  StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(handle->data);
+  if (cb->sending_file()) {
+    // would cut the file short, shut down from the send file callback
+    ThrowException(env, UV_EBUSY, "uv_close_write");
+    return -1;
+  }
+  int r = cb->flush_cork(false);
+  if (r) {
+    ThrowException(env, handle->loop, "uv_write");
+    return r;
+  }
+  uv_shutdown_t* req = loop_new_req<uv_shutdown_t>(handle->loop, LoopData::SHUTDOWN_REQ);
+  OOME(env, req);
+  ContextHolder* req_data = new (handle->loop) ContextHolder(env, context);
+  if (!req_data) {
+    freelist_delete(req);
+    OOME(env, req_data);
+  }
   req->data = req_data;
   req->handle = handle;
-  int r = uv_shutdown(req, handle, _shutdown_cb);
+  r = uv_shutdown(req, handle, _shutdown_cb);
   if (r) {
     delete req_data;
-    delete req;
+    freelist_delete(req);
     ThrowException(env, handle->loop, "uv_close_write");
   }
   return r;
@@ -645,6 +1925,10 @@ JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_StreamHandle__1close
 
   assert(stream);
   uv_handle_t* handle = reinterpret_cast<uv_handle_t*>(stream);
+  StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(handle->data);
+  cb->close_send_file();
+  cb->close_cork();
+  cb->close_accept_batch();
   uv_close(handle, _close_cb);
 }
 
@@ -683,3 +1967,103 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_StreamHandle__1accept
   }
   return r;
 }
+
+/*
+ * Class:     com_oracle_libuv_handles_StreamHandle
+ * Method:    _set_read_pooling
+ * Signature: (JZ)V
+ */
+JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_StreamHandle__1set_1read_1pooling
+  (JNIEnv *env, jobject that, jlong stream, jboolean pooled) {
+
+  assert(stream);
+  uv_stream_t* handle = reinterpret_cast<uv_stream_t*>(stream);
+  assert(handle->data);
+  StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(handle->data);
+  cb->set_read_pool(pooled ? LoopData::get(handle->loop)->read_pool() : NULL);
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_StreamHandle
+ * Method:    _set_framing
+ * Signature: (JIIZ[BJ)V
+ */
+JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_StreamHandle__1set_1framing
+  (JNIEnv *env, jobject that, jlong stream, jint mode, jint prefix_bytes, jboolean big_endian, jbyteArray delimiter, jlong max_frame) {
+
+  assert(stream);
+  uv_stream_t* handle = reinterpret_cast<uv_stream_t*>(stream);
+  assert(handle->data);
+  StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(handle->data);
+  jsize length = delimiter ? env->GetArrayLength(delimiter) : 0;
+  std::vector<char> bytes(length);
+  if (length) {
+    env->GetByteArrayRegion(delimiter, 0, length, reinterpret_cast<jbyte*>(&bytes[0]));
+  }
+  cb->set_framing(handle, mode, prefix_bytes, big_endian == JNI_TRUE, length ? &bytes[0] : NULL, length, static_cast<size_t>(max_frame));
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_StreamHandle
+ * Method:    _cork
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_StreamHandle__1cork
+  (JNIEnv *env, jobject that, jlong stream) {
+
+  assert(stream);
+  uv_stream_t* handle = reinterpret_cast<uv_stream_t*>(stream);
+  assert(handle->data);
+  StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(handle->data);
+  cb->create_cork(handle)->corked = true;
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_StreamHandle
+ * Method:    _uncork
+ * Signature: (J)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_StreamHandle__1uncork
+  (JNIEnv *env, jobject that, jlong stream) {
+
+  assert(stream);
+  uv_stream_t* handle = reinterpret_cast<uv_stream_t*>(stream);
+  assert(handle->data);
+  StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(handle->data);
+  if (!cb->cork()) {
+    return 0;
+  }
+  cb->cork()->corked = false;
+  int r = cb->flush_cork(false);
+  if (r) {
+    ThrowException(env, handle->loop, "uv_write");
+  }
+  return r;
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_StreamHandle
+ * Method:    _set_auto_cork
+ * Signature: (JZ)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_StreamHandle__1set_1auto_1cork
+  (JNIEnv *env, jobject that, jlong stream, jboolean automatic) {
+
+  assert(stream);
+  uv_stream_t* handle = reinterpret_cast<uv_stream_t*>(stream);
+  assert(handle->data);
+  StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(handle->data);
+  if (!automatic && !cb->cork()) {
+    return 0;
+  }
+  cb->create_cork(handle);
+  cb->set_auto_cork(automatic == JNI_TRUE);
+  int r = 0;
+  if (!cb->corked()) {
+    r = cb->flush_cork(false);
+    if (r) {
+      ThrowException(env, handle->loop, "uv_write");
+    }
+  }
+  return r;
+}
@@ -27,8 +27,84 @@
 #define _libuv_java_stream_h_
 
 #include <jni.h>
+#include <vector>
 
 #include "uv.h"
+#include "buffer_pool.h"
+#include "handle.h"
+
+class ContextHolder;
+struct SendFile;
+
+// Writes issued while a stream is corked, copied into one contiguous
+// buffer and handed to a single uv_write when flushed. In automatic mode
+// a check handle flushes at the end of every loop iteration.
+class WriteCork {
+public:
+  // a flush is forced once this many bytes are pending
+  static const size_t FLUSH_THRESHOLD = 64 * 1024;
+
+  uv_stream_t* stream;
+  uv_check_t* check;
+  bool corked;
+  bool automatic;
+  // writes are held back while a sendFile owns the stream
+  bool sending;
+  std::vector<char> data;
+  std::vector<ContextHolder*> holders;
+
+  WriteCork(uv_stream_t* stream);
+  ~WriteCork();
+
+  inline bool active() const { return corked || automatic || sending; }
+  inline bool empty() const { return holders.empty(); }
+};
+
+// Connections accepted natively on a listening tcp handle, already set up
+// with the configured options, and handed to java as handle pointers in
+// batches of up to max, when full or at the end of the loop iteration.
+class AcceptBatch {
+public:
+  uv_stream_t* server;
+  uv_check_t* check;
+  jlongArray pointers;
+  jint max;
+  bool no_delay;
+  bool keep_alive;
+  unsigned int delay;
+  std::vector<jlong> pending;
+
+  AcceptBatch(uv_stream_t* server);
+  ~AcceptBatch();
+};
+
+// Splits the bytes read from a stream into frames, either prefixed by a
+// fixed width length or terminated by a delimiter. Bytes of an incomplete
+// frame are kept in partial until the rest of it arrives.
+class ReadFramer {
+public:
+  enum Mode {
+    NONE = 0,
+    LENGTH_PREFIX = 1,
+    DELIMITER = 2
+  };
+
+  uv_stream_t* stream;
+  int mode;
+  int prefix_bytes;
+  bool big_endian;
+  size_t max_frame;
+  std::vector<char> delimiter;
+  std::vector<char> partial;
+
+  ReadFramer(uv_stream_t* stream);
+
+  // looks for a complete frame in data, searching for the delimiter from
+  // scan. Returns 1 with the payload at offset of frame_length, and the
+  // bytes it takes up in consumed, 0 if more data is needed and -1 if the
+  // frame would be longer than max_frame.
+  int next(const char* data, size_t length, size_t scan, size_t* offset, size_t* frame_length, size_t* consumed) const;
+};
 
 class StreamCallbacks {
 private:
@@ -37,6 +113,8 @@ private:
 
   static jclass _address_cid;
   static jclass _stream_handle_cid;
+  static jclass _byte_buffer_cid;
+  static jmethodID _byte_buffer_wrap_mid;
 
   static jmethodID _address_init_mid;
   static jmethodID _call_read_callback_mid;
@@ -46,9 +124,37 @@ private:
   static jmethodID _call_connection_callback_mid;
   static jmethodID _call_close_callback_mid;
   static jmethodID _call_shutdown_callback_mid;
+  static jmethodID _call_drain_callback_mid;
+  static jmethodID _call_sendfile_callback_mid;
+  static jmethodID _call_connection_batch_callback_mid;
+  static jmethodID _dispatch_read_mid;
+  static jmethodID _dispatch_write_mid;
 
   JNIEnv* _env;
   jobject _instance;
+  // reads and writes go straight to the handle's callbacks, skipping the
+  // loop's callback handler, see LoopHandle.isFastDispatch
+  bool _direct_dispatch;
+  BufferPool* _read_pool;
+  WriteCork* _cork;
+  size_t _high_water_mark;
+  size_t _low_water_mark;
+  bool _throttled;
+  SendFile* _sendfile;
+  ContextHolder* _cancelled_send_file;
+  int64_t _cancelled_send_file_bytes;
+  AcceptBatch* _accept_batch;
+  ReadFramer* _framer;
+  IoCounters _counters;
+
+  // a copy on the java heap, reclaimed by the gc
+  jobject heap_buffer(const char* data, size_t length);
+  jobject read_buffer(uv_buf_t* buf, jsize nread, BufferPool* pool);
+  jobject frame_buffer(const char* data, size_t length, BufferPool* pool);
+  void on_framed_read(uv_buf_t* buf, jsize nread);
+  inline jmethodID read_mid() {
+    return _direct_dispatch ? _dispatch_read_mid : _call_read_callback_mid;
+  }
 
 public:
   static void static_initialize(JNIEnv *env, jclass cls);
@@ -58,16 +164,86 @@ public:
   StreamCallbacks();
   ~StreamCallbacks();
 
-  void initialize(JNIEnv *env, jobject instance);
+  void initialize(JNIEnv *env, jobject instance, bool direct_dispatch);
   void throw_exception(int code, const char* message);
 
+  // when set, read buffers come from the loop pool and are handed to java
+  // without a copy; java returns them with LoopHandle.recycle
+  inline BufferPool* read_pool() { return _read_pool; }
+  inline void set_read_pool(BufferPool* pool) { _read_pool = pool; }
+
+  // lazily created by cork() or setAutoCork()
+  inline WriteCork* cork() { return _cork; }
+  inline bool corked() { return _cork && _cork->active(); }
+  WriteCork* create_cork(uv_stream_t* stream);
+  void set_auto_cork(bool automatic);
+  // copies bufs into the cork, returns the result of a threshold flush
+  int cork_write(const uv_buf_t* bufs, int count, jobject context);
+  // cork_reserve makes room for size bytes to be filled in place,
+  // cork_commit then records the write like cork_write. On failure
+  // cork_commit drops the size bytes of the write again
+  char* cork_reserve(size_t size);
+  void cork_shrink(size_t unused);
+  int cork_commit(size_t size, jobject context);
+  // writes everything pending, on failure reports the error to the write
+  // callback of every corked write but the last one when the caller owns
+  // it and throws instead
+  int flush_cork(bool caller_owns_last);
+  void close_cork();
+
+  // bytes queued in libuv plus those held by the cork
+  size_t queued(uv_stream_t* stream);
+  // a high water mark of 0 disables backpressure
+  void set_water_marks(size_t high, size_t low);
+  inline IoCounters& counters() { return _counters; }
+
+  // counts a successful write of bytes, whose result becomes
+  // WRITE_THROTTLED once the queue reaches the high water mark
+  int check_high_water_mark(uv_stream_t* stream, int r, size_t bytes);
+  // called after write callbacks, drains once the queue is back down to
+  // the low water mark
+  void check_low_water_mark(uv_stream_t* stream);
+
+  // queues a sendfile behind the pending writes, holding back later
+  // writes in the cork until it completes. One at a time.
+  int send_file(uv_stream_t* stream, int fd, int64_t offset, int64_t length, jobject context);
+  // starts polling for the queued sendfile once every write before it is
+  // out, returns the error code when it cannot
+  int poll_send_file(uv_stream_t* stream);
+  // poll_send_file from a write callback, a failure completes the sendfile
+  void start_send_file(uv_stream_t* stream);
+  void send_file_done(SendFile* request);
+  // stops a pending or running sendfile when closing, it is reported as
+  // cancelled by report_cancelled_send_file from the close callback
+  void close_send_file();
+  void report_cancelled_send_file();
+  inline bool sending_file() { return _sendfile != NULL; }
+
+  // a max of 0 goes back to one connection callback per connection
+  void set_accept_batch(JNIEnv* env, uv_stream_t* server, jlongArray pointers, jint max, bool no_delay, bool keep_alive, unsigned int delay);
+  inline bool accept_batched() { return _accept_batch && _accept_batch->max > 0; }
+  // accepts the pending connection of the server into a new tcp handle
+  void accept_one(uv_stream_t* server);
+  void flush_accepted();
+  void close_accept_batch();
+
+  // frames the data passed to the read callback, a mode of NONE goes back
+  // to raw reads. Bytes already buffered are framed under the new settings.
+  void set_framing(uv_stream_t* stream, int mode, int prefix_bytes, bool big_endian, const char* delimiter, size_t delimiter_length, size_t max_frame);
+  inline bool framed() { return _framer && (_framer->mode != ReadFramer::NONE || !_framer->partial.empty()); }
+
+  static const int WRITE_THROTTLED = 1;
+
   void on_read(uv_buf_t* buf, jsize nread);
   void on_read2(uv_buf_t* buf, jsize nread, jlong ptr, uv_handle_type pending);
   void on_write(int status, int error_code, jobject buffer, jobject domain);
   void on_shutdown(int status, int error_code, jobject domain);
   void on_connect(int status, int error_code, jobject domain);
   void on_connection(int status, int error_code);
+  void on_connection_batch(jint count);
   void on_close();
+  void on_drain();
+  void on_send_file(int error_code, jlong bytes, jobject context);
 };
 
 #endif // _libuv_java_stream_h_
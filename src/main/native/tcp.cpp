@@ -24,22 +24,36 @@
  */
 
 #include <assert.h>
+#include <errno.h>
+#include <string.h>
 
 #include "uv.h"
 #include "exception.h"
 #include "stream.h"
 #include "context.h"
+#include "loop.h"
 #include "com_oracle_libuv_handles_TCPHandle.h"
 
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#endif
+
+#if defined(__linux__) && !defined(SO_BUSY_POLL)
+#define SO_BUSY_POLL 46
+#endif
+
 static void _tcp_connect_cb(uv_connect_t* req, int status) {
   assert(req);
   assert(req->data);
   assert(req->handle);
   assert(req->handle->data);
+  CallbackScope scope(req->handle->loop, req->handle->type);
   StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(req->handle->data);
   ContextHolder* req_data = reinterpret_cast<ContextHolder*>(req->data);
   cb->on_connect(status, status < 0 ? uv_last_error(req->handle->loop).code : 0, req_data->context());
-  delete req;
+  freelist_delete(req);
   delete req_data;
 }
 
@@ -130,6 +144,58 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_TCPHandle__1bind6
   return r;
 }
 
+/*
+ * Class:     com_oracle_libuv_handles_TCPHandle
+ * Method:    _bind_shared
+ * Signature: (JLjava/lang/String;IZ)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_TCPHandle__1bind_1shared
+  (JNIEnv *env, jobject that, jlong tcp, jstring host, jint port, jboolean ipv6) {
+
+  assert(tcp);
+  uv_tcp_t* handle = reinterpret_cast<uv_tcp_t*>(tcp);
+#if defined(_WIN32) || !defined(SO_REUSEPORT)
+  // SO_REUSEADDR on windows allows hijacking the port but does not balance connections
+  ThrowException(env, UV_ENOTSUP, "bind_shared", "SO_REUSEPORT");
+  return -1;
+#else
+  const char* h = env->GetStringUTFChars(host, 0);
+  sockaddr_storage addr;
+  socklen_t addrlen;
+  memset(&addr, 0, sizeof(addr));
+  if (ipv6) {
+    *reinterpret_cast<sockaddr_in6*>(&addr) = uv_ip6_addr(h, port);
+    addrlen = sizeof(sockaddr_in6);
+  } else {
+    *reinterpret_cast<sockaddr_in*>(&addr) = uv_ip4_addr(h, port);
+    addrlen = sizeof(sockaddr_in);
+  }
+
+  // libuv binds on its own socket, so set up the listener socket by hand and open it
+  int fd = socket(addr.ss_family, SOCK_STREAM, 0);
+  int on = 1;
+  int r = fd < 0 ||
+          setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) ||
+          setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) ||
+          bind(fd, reinterpret_cast<sockaddr*>(&addr), addrlen) ? -1 : 0;
+  if (r) {
+    int code = sys_error_code(errno);
+    if (fd >= 0) {
+      close(fd);
+    }
+    ThrowException(env, code, "bind_shared", h);
+  } else {
+    r = uv_tcp_open(handle, fd);
+    if (r) {
+      close(fd);
+      ThrowException(env, handle->loop, "uv_tcp_open", h);
+    }
+  }
+  env->ReleaseStringUTFChars(host, h);
+  return r;
+#endif
+}
+
 /*
  * Class:     com_oracle_libuv_handles_TCPHandle
  * Method:    _connect
@@ -142,14 +208,23 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_TCPHandle__1connect
   uv_tcp_t* handle = reinterpret_cast<uv_tcp_t*>(tcp);
   const char* h = env->GetStringUTFChars(host, 0);
   sockaddr_in addr = uv_ip4_addr(h, port);
-  uv_connect_t* req = new uv_connect_t();
+  uv_connect_t* req = loop_new_req<uv_connect_t>(handle->loop, LoopData::CONNECT_REQ);
+  if (!req) {
+    env->ReleaseStringUTFChars(host, h);
+    OOME(env, req);
+  }
   req->handle = reinterpret_cast<uv_stream_t*>(handle);
-  ContextHolder* req_data = new ContextHolder(env, context);
+  ContextHolder* req_data = new (handle->loop) ContextHolder(env, context);
+  if (!req_data) {
+    freelist_delete(req);
+    env->ReleaseStringUTFChars(host, h);
+    OOME(env, req_data);
+  }
   req->data = req_data;
   int r = uv_tcp_connect(req, handle, addr, _tcp_connect_cb);
   if (r) {
     delete req_data;
-    delete req;
+    freelist_delete(req);
     ThrowException(env, handle->loop, "uv_tcp_connect", h);
   }
   env->ReleaseStringUTFChars(host, h);
@@ -168,14 +243,23 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_TCPHandle__1connect6
   uv_tcp_t* handle = reinterpret_cast<uv_tcp_t*>(tcp);
   const char* h = env->GetStringUTFChars(host, 0);
   sockaddr_in6 addr = uv_ip6_addr(h, port);
-  uv_connect_t* req = new uv_connect_t();
+  uv_connect_t* req = loop_new_req<uv_connect_t>(handle->loop, LoopData::CONNECT_REQ);
+  if (!req) {
+    env->ReleaseStringUTFChars(host, h);
+    OOME(env, req);
+  }
   req->handle = reinterpret_cast<uv_stream_t*>(handle);
-  ContextHolder* req_data = new ContextHolder(env, context);
+  ContextHolder* req_data = new (handle->loop) ContextHolder(env, context);
+  if (!req_data) {
+    freelist_delete(req);
+    env->ReleaseStringUTFChars(host, h);
+    OOME(env, req_data);
+  }
   req->data = req_data;
   int r = uv_tcp_connect6(req, handle, addr, _tcp_connect_cb);
   if (r) {
     delete req_data;
-    delete req;
+    freelist_delete(req);
     ThrowException(env, handle->loop, "uv_tcp_connect6", h);
   }
   env->ReleaseStringUTFChars(host, h);
@@ -301,3 +385,77 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_TCPHandle__1simultaneous_1a
   }
   return r;
 }
+
+/*
+ * Class:     com_oracle_libuv_handles_TCPHandle
+ * Method:    _set_busy_poll
+ * Signature: (JI)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_TCPHandle__1set_1busy_1poll
+  (JNIEnv *env, jobject that, jlong tcp, jint micros) {
+
+  assert(tcp);
+  uv_tcp_t* handle = reinterpret_cast<uv_tcp_t*>(tcp);
+#if !defined(__linux__)
+  ThrowException(env, UV_ENOTSUP, "set_busy_poll", "SO_BUSY_POLL");
+  return -1;
+#else
+  // lets the kernel spin on the device queue for a blocking poll, needs
+  // CAP_NET_ADMIN to go beyond net.core.busy_read
+  int fd = handle->io_watcher.fd;
+  if (fd < 0) {
+    ThrowException(env, UV_EBADF, "set_busy_poll");
+    return -1;
+  }
+  int r = setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &micros, sizeof(micros));
+  if (r) {
+    ThrowException(env, sys_error_code(errno), "set_busy_poll", "SO_BUSY_POLL");
+  }
+  return r;
+#endif
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_TCPHandle
+ * Method:    _probe
+ * Signature: (J)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_oracle_libuv_handles_TCPHandle__1probe
+  (JNIEnv *env, jobject that, jlong tcp) {
+
+  assert(tcp);
+#ifdef _WIN32
+  // reads are not left to the kernel on windows, a peer close only shows
+  // up as a read error once reading again
+  return JNI_TRUE;
+#else
+  uv_tcp_t* handle = reinterpret_cast<uv_tcp_t*>(tcp);
+  int fd = handle->io_watcher.fd;
+  if (fd < 0) {
+    return JNI_FALSE;
+  }
+  char byte;
+  ssize_t n;
+  do {
+    n = recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+  } while (n == -1 && errno == EINTR);
+  // 0 is the peer shutting down, data nobody asked for is stale
+  return n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK) ? JNI_TRUE : JNI_FALSE;
+#endif
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_TCPHandle
+ * Method:    _set_accept_batch
+ * Signature: (J[JIZZI)V
+ */
+JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_TCPHandle__1set_1accept_1batch
+  (JNIEnv *env, jobject that, jlong tcp, jlongArray pointers, jint max, jboolean no_delay, jboolean keep_alive, jint delay) {
+
+  assert(tcp);
+  uv_stream_t* handle = reinterpret_cast<uv_stream_t*>(tcp);
+  assert(handle->data);
+  assert(!max || env->GetArrayLength(pointers) >= max);
+  StreamCallbacks* cb = reinterpret_cast<StreamCallbacks*>(handle->data);
+  cb->set_accept_batch(env, handle, pointers, max, no_delay == JNI_TRUE, keep_alive == JNI_TRUE, static_cast<unsigned int>(delay));
+}
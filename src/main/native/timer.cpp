@@ -31,6 +31,7 @@
 #include "uv.h"
 #include "exception.h"
 #include "stream.h"
+#include "loop.h"
 #include "com_oracle_libuv_handles_TimerHandle.h"
 
 class TimerCallbacks {
@@ -107,6 +108,7 @@ void TimerCallbacks::on_close() {
 static void _timer_cb(uv_timer_t* handle, int status) {
   assert(handle);
   assert(handle->data);
+  CallbackScope scope(handle->loop, UV_TIMER);
   TimerCallbacks* cb = reinterpret_cast<TimerCallbacks*>(handle->data);
   cb->on_timer(status);
 }
@@ -114,6 +116,7 @@ static void _timer_cb(uv_timer_t* handle, int status) {
 static void _close_cb(uv_handle_t* handle) {
   assert(handle);
   assert(handle->data);
+  CallbackScope scope(handle->loop, handle->type);
   TimerCallbacks* cb = reinterpret_cast<TimerCallbacks*>(handle->data);
   cb->on_close();
   delete cb;
@@ -0,0 +1,402 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+#include <assert.h>
+#include <vector>
+
+#include <jni.h>
+
+#include "uv.h"
+#include "exception.h"
+#include "loop.h"
+#include "com_oracle_libuv_handles_TimerWheel.h"
+
+// A hierarchical timing wheel run by a single uv_timer_t ticking at a
+// fixed resolution while timers are pending. Timers are slots of one
+// growable table linked into per bucket lists, so scheduling and
+// cancelling are O(1) and allocate nothing once the table has grown.
+// Expired tokens go up to Java in batches, one upcall per tick.
+class TimerWheel {
+public:
+  static const int SLOT_BITS = 8;
+  static const int SLOTS = 1 << SLOT_BITS;
+  static const int LEVELS = 4;
+
+private:
+  struct Entry {
+    jlong token;
+    uint64_t expiry;
+    int32_t prev;
+    int32_t next;
+    uint32_t generation;
+    int32_t bucket;   // -1 while free
+  };
+
+  static jclass _timer_wheel_cid;
+  static jmethodID _expired_mid;
+
+  JNIEnv* _env;
+  jobject _instance;
+  jlongArray _batch;
+  jsize _batch_size;
+
+  uv_timer_t* _timer;
+  uint64_t _resolution;
+  uint64_t _tick;
+  uint64_t _last;
+  size_t _count;
+  std::vector<Entry> _entries;
+  int32_t _free;
+  int32_t _heads[LEVELS * SLOTS];
+  std::vector<jlong> _expired;
+
+  void link(int32_t index);
+  void unlink(int32_t index);
+  void release(int32_t index);
+  void cascade(int bucket);
+  void advance();
+
+public:
+  static void static_initialize(JNIEnv* env, jclass cls);
+
+  TimerWheel(uv_timer_t* timer, uint64_t resolution);
+  ~TimerWheel();
+
+  void initialize(JNIEnv* env, jobject instance, jlongArray batch);
+
+  inline size_t count() const { return _count; }
+
+  // returns the timer id, never 0
+  jlong schedule(uint64_t delay, jlong token);
+  bool cancel(jlong id);
+  void on_tick();
+};
+
+jclass TimerWheel::_timer_wheel_cid = NULL;
+jmethodID TimerWheel::_expired_mid = NULL;
+
+static void _tick_cb(uv_timer_t* handle, int status) {
+  assert(handle);
+  assert(handle->data);
+  CallbackScope scope(handle->loop, UV_TIMER);
+  TimerWheel* wheel = reinterpret_cast<TimerWheel*>(handle->data);
+  wheel->on_tick();
+}
+
+static void _close_cb(uv_handle_t* handle) {
+  assert(handle);
+  assert(handle->data);
+  TimerWheel* wheel = reinterpret_cast<TimerWheel*>(handle->data);
+  delete wheel;
+  delete handle;
+}
+
+void TimerWheel::static_initialize(JNIEnv* env, jclass cls) {
+  _timer_wheel_cid = (jclass) env->NewGlobalRef(cls);
+  assert(_timer_wheel_cid);
+
+  _expired_mid = env->GetMethodID(_timer_wheel_cid, "callExpired", "(I)V");
+  assert(_expired_mid);
+}
+
+TimerWheel::TimerWheel(uv_timer_t* timer, uint64_t resolution) :
+  _env(NULL),
+  _instance(NULL),
+  _batch(NULL),
+  _batch_size(0),
+  _timer(timer),
+  _resolution(resolution),
+  _tick(0),
+  _last(0),
+  _count(0),
+  _free(-1) {
+
+  assert(resolution > 0);
+  for (int i = 0; i < LEVELS * SLOTS; i++) {
+    _heads[i] = -1;
+  }
+}
+
+TimerWheel::~TimerWheel() {
+  if (_env) {
+    _env->DeleteGlobalRef(_instance);
+    _env->DeleteGlobalRef(_batch);
+  }
+}
+
+void TimerWheel::initialize(JNIEnv* env, jobject instance, jlongArray batch) {
+  _env = env;
+  assert(_env);
+  assert(instance);
+  assert(batch);
+  _instance = _env->NewGlobalRef(instance);
+  _batch = reinterpret_cast<jlongArray>(_env->NewGlobalRef(batch));
+  _batch_size = _env->GetArrayLength(batch);
+  assert(_batch_size > 0);
+}
+
+void TimerWheel::link(int32_t index) {
+  Entry* entry = &_entries[index];
+  uint64_t delta = entry->expiry > _tick ? entry->expiry - _tick : 0;
+  int level = 0;
+  while (level < LEVELS - 1 && delta >= (static_cast<uint64_t>(1) << (SLOT_BITS * (level + 1)))) {
+    level++;
+  }
+  // timers beyond the top level range come around again on cascade
+  int bucket = level * SLOTS + static_cast<int>((entry->expiry >> (SLOT_BITS * level)) & (SLOTS - 1));
+  entry->bucket = bucket;
+  entry->prev = -1;
+  entry->next = _heads[bucket];
+  if (entry->next >= 0) {
+    _entries[entry->next].prev = index;
+  }
+  _heads[bucket] = index;
+}
+
+void TimerWheel::unlink(int32_t index) {
+  Entry* entry = &_entries[index];
+  assert(entry->bucket >= 0);
+  if (entry->prev >= 0) {
+    _entries[entry->prev].next = entry->next;
+  } else {
+    _heads[entry->bucket] = entry->next;
+  }
+  if (entry->next >= 0) {
+    _entries[entry->next].prev = entry->prev;
+  }
+}
+
+void TimerWheel::release(int32_t index) {
+  Entry* entry = &_entries[index];
+  entry->bucket = -1;
+  // stale ids of this slot no longer match
+  entry->generation++;
+  if (entry->generation == 0) {
+    entry->generation = 1;
+  }
+  entry->next = _free;
+  _free = index;
+  _count--;
+}
+
+jlong TimerWheel::schedule(uint64_t delay, jlong token) {
+  if (_count == 0) {
+    // restart ticking from the current loop time
+    _last = uv_now(_timer->loop);
+    uv_timer_start(_timer, _tick_cb, _resolution, _resolution);
+  }
+  int32_t index = _free;
+  if (index >= 0) {
+    _free = _entries[index].next;
+  } else {
+    Entry entry;
+    entry.generation = 1;
+    index = static_cast<int32_t>(_entries.size());
+    _entries.push_back(entry);
+  }
+  Entry* entry = &_entries[index];
+  // time passed since the last tick counts towards the delay
+  uint64_t elapsed = uv_now(_timer->loop) - _last;
+  uint64_t ticks = (delay + elapsed + _resolution - 1) / _resolution;
+  entry->token = token;
+  entry->expiry = _tick + (ticks ? ticks : 1);
+  link(index);
+  _count++;
+  return (static_cast<jlong>(entry->generation) << 32) | static_cast<jlong>(index);
+}
+
+bool TimerWheel::cancel(jlong id) {
+  int32_t index = static_cast<int32_t>(id & 0xffffffff);
+  uint32_t generation = static_cast<uint32_t>(static_cast<uint64_t>(id) >> 32);
+  if (index < 0 || static_cast<size_t>(index) >= _entries.size()) {
+    return false;
+  }
+  Entry* entry = &_entries[index];
+  if (entry->bucket < 0 || entry->generation != generation) {
+    return false;
+  }
+  unlink(index);
+  release(index);
+  return true;
+}
+
+void TimerWheel::cascade(int bucket) {
+  int32_t index = _heads[bucket];
+  _heads[bucket] = -1;
+  while (index >= 0) {
+    int32_t next = _entries[index].next;
+    link(index);
+    index = next;
+  }
+}
+
+void TimerWheel::advance() {
+  _tick++;
+  for (int level = 1; level < LEVELS; level++) {
+    if (_tick & ((static_cast<uint64_t>(1) << (SLOT_BITS * level)) - 1)) {
+      break;
+    }
+    cascade(level * SLOTS + static_cast<int>((_tick >> (SLOT_BITS * level)) & (SLOTS - 1)));
+  }
+  int bucket = static_cast<int>(_tick & (SLOTS - 1));
+  int32_t index = _heads[bucket];
+  _heads[bucket] = -1;
+  while (index >= 0) {
+    Entry* entry = &_entries[index];
+    int32_t next = entry->next;
+    if (entry->expiry <= _tick) {
+      _expired.push_back(entry->token);
+      release(index);
+    } else {
+      link(index);
+    }
+    index = next;
+  }
+}
+
+void TimerWheel::on_tick() {
+  assert(_env);
+  uint64_t ticks = (uv_now(_timer->loop) - _last) / _resolution;
+  _last += ticks * _resolution;
+  while (ticks--) {
+    advance();
+  }
+  if (_count == 0) {
+    uv_timer_stop(_timer);
+  }
+  // timers scheduled by the upcalls never expire in this tick
+  size_t total = _expired.size();
+  for (size_t offset = 0; offset < total; offset += _batch_size) {
+    size_t count = total - offset;
+    if (count > static_cast<size_t>(_batch_size)) {
+      count = _batch_size;
+    }
+    _env->SetLongArrayRegion(_batch, 0, static_cast<jsize>(count), &_expired[offset]);
+    _env->CallVoidMethod(_instance, _expired_mid, static_cast<jint>(count));
+  }
+  _expired.clear();
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_TimerWheel
+ * Method:    _static_initialize
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_TimerWheel__1static_1initialize
+  (JNIEnv *env, jclass cls) {
+
+  TimerWheel::static_initialize(env, cls);
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_TimerWheel
+ * Method:    _new
+ * Signature: (JJ)J
+ */
+JNIEXPORT jlong JNICALL Java_com_oracle_libuv_handles_TimerWheel__1new
+  (JNIEnv *env, jclass cls, jlong loop, jlong resolution) {
+
+  assert(loop);
+  assert(resolution > 0);
+  uv_loop_t* lp = reinterpret_cast<uv_loop_t*>(loop);
+  uv_timer_t* timer = new uv_timer_t();
+  int r = uv_timer_init(lp, timer);
+  if (r) {
+    ThrowException(env, timer->loop, "uv_timer_init");
+  } else {
+    timer->data = new TimerWheel(timer, static_cast<uint64_t>(resolution));
+  }
+  return reinterpret_cast<jlong>(timer);
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_TimerWheel
+ * Method:    _initialize
+ * Signature: (J[J)V
+ */
+JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_TimerWheel__1initialize
+  (JNIEnv *env, jobject that, jlong ptr, jlongArray batch) {
+
+  assert(ptr);
+  uv_timer_t* handle = reinterpret_cast<uv_timer_t*>(ptr);
+  assert(handle->data);
+  reinterpret_cast<TimerWheel*>(handle->data)->initialize(env, that, batch);
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_TimerWheel
+ * Method:    _schedule
+ * Signature: (JJJ)J
+ */
+JNIEXPORT jlong JNICALL Java_com_oracle_libuv_handles_TimerWheel__1schedule
+  (JNIEnv *env, jobject that, jlong ptr, jlong delay, jlong token) {
+
+  assert(ptr);
+  assert(delay >= 0);
+  uv_timer_t* handle = reinterpret_cast<uv_timer_t*>(ptr);
+  assert(handle->data);
+  return reinterpret_cast<TimerWheel*>(handle->data)->schedule(static_cast<uint64_t>(delay), token);
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_TimerWheel
+ * Method:    _cancel
+ * Signature: (JJ)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_oracle_libuv_handles_TimerWheel__1cancel
+  (JNIEnv *env, jobject that, jlong ptr, jlong id) {
+
+  assert(ptr);
+  uv_timer_t* handle = reinterpret_cast<uv_timer_t*>(ptr);
+  assert(handle->data);
+  return reinterpret_cast<TimerWheel*>(handle->data)->cancel(id) ? JNI_TRUE : JNI_FALSE;
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_TimerWheel
+ * Method:    _size
+ * Signature: (J)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_TimerWheel__1size
+  (JNIEnv *env, jobject that, jlong ptr) {
+
+  assert(ptr);
+  uv_timer_t* handle = reinterpret_cast<uv_timer_t*>(ptr);
+  assert(handle->data);
+  return static_cast<jint>(reinterpret_cast<TimerWheel*>(handle->data)->count());
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_TimerWheel
+ * Method:    _close
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_TimerWheel__1close
+  (JNIEnv *env, jobject that, jlong ptr) {
+
+  assert(ptr);
+  uv_handle_t* handle = reinterpret_cast<uv_handle_t*>(ptr);
+  uv_close(handle, _close_cb);
+}
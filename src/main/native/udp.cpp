@@ -30,6 +30,7 @@
 #include "uv.h"
 #include "exception.h"
 #include "context.h"
+#include "loop.h"
 #include "stream.h"
 #include "udp.h"
 #include "com_oracle_libuv_handles_UDPHandle.h"
@@ -40,9 +41,163 @@ uv_buf_t _alloc_cb(uv_handle_t* handle, size_t suggested_size) {
   return uv_buf_init(new char[suggested_size], static_cast<unsigned int>(suggested_size));
 }
 
+static uv_buf_t _ring_alloc_cb(uv_handle_t* handle, size_t suggested_size) {
+  assert(handle->data);
+  UDPCallbacks* cb = reinterpret_cast<UDPCallbacks*>(handle->data);
+  UDPRecvRing* ring = cb->ring();
+  assert(ring);
+  return uv_buf_init(ring->slot(ring->next()), static_cast<unsigned int>(ring->slot_size()));
+}
+
+UDPRecvRing::UDPRecvRing(JNIEnv* env, int slots, int slot_size) {
+  assert(slots > 0);
+  assert(slot_size > 0);
+  _env = env;
+  _slots = slots;
+  _slot_size = slot_size;
+  _next = 0;
+  _base = new char[static_cast<size_t>(slots) * slot_size];
+  jobject buffer = env->NewDirectByteBuffer(_base, static_cast<jlong>(slots) * slot_size);
+  _buffer = buffer ? env->NewGlobalRef(buffer) : NULL;
+  if (buffer) {
+    env->DeleteLocalRef(buffer);
+  }
+  memset(_addresses, 0, sizeof(_addresses));
+}
+
+UDPRecvRing::~UDPRecvRing() {
+  for (int i = 0; i < ADDRESS_CACHE_SIZE; i++) {
+    if (_addresses[i].address) {
+      _env->DeleteGlobalRef(_addresses[i].address);
+    }
+  }
+  if (_buffer) {
+    _env->DeleteGlobalRef(_buffer);
+  }
+  delete[] _base;
+}
+
+static unsigned int _hash_address(const sockaddr* addr, size_t* len) {
+  const unsigned char* p;
+  unsigned int h = 2166136261u;
+  if (addr->sa_family == AF_INET6) {
+    const sockaddr_in6* a6 = reinterpret_cast<const sockaddr_in6*>(addr);
+    p = reinterpret_cast<const unsigned char*>(&a6->sin6_addr);
+    for (size_t i = 0; i < sizeof(a6->sin6_addr); i++) h = (h ^ p[i]) * 16777619u;
+    h = (h ^ a6->sin6_port) * 16777619u;
+    *len = sizeof(sockaddr_in6);
+  } else {
+    const sockaddr_in* a4 = reinterpret_cast<const sockaddr_in*>(addr);
+    p = reinterpret_cast<const unsigned char*>(&a4->sin_addr);
+    for (size_t i = 0; i < sizeof(a4->sin_addr); i++) h = (h ^ p[i]) * 16777619u;
+    h = (h ^ a4->sin_port) * 16777619u;
+    *len = sizeof(sockaddr_in);
+  }
+  return h;
+}
+
+static bool _same_address(const sockaddr* a, const sockaddr* b) {
+  if (a->sa_family != b->sa_family) {
+    return false;
+  }
+  if (a->sa_family == AF_INET6) {
+    const sockaddr_in6* a6 = reinterpret_cast<const sockaddr_in6*>(a);
+    const sockaddr_in6* b6 = reinterpret_cast<const sockaddr_in6*>(b);
+    return a6->sin6_port == b6->sin6_port &&
+        memcmp(&a6->sin6_addr, &b6->sin6_addr, sizeof(a6->sin6_addr)) == 0;
+  }
+  const sockaddr_in* a4 = reinterpret_cast<const sockaddr_in*>(a);
+  const sockaddr_in* b4 = reinterpret_cast<const sockaddr_in*>(b);
+  return a4->sin_port == b4->sin_port && a4->sin_addr.s_addr == b4->sin_addr.s_addr;
+}
+
+jobject UDPRecvRing::address(const sockaddr* addr) {
+  size_t len;
+  CachedAddress* entry = &_addresses[_hash_address(addr, &len) % ADDRESS_CACHE_SIZE];
+  const sockaddr* cached = reinterpret_cast<const sockaddr*>(&entry->addr);
+  if (entry->address && _same_address(cached, addr)) {
+    return entry->address;
+  }
+  jobject address = StreamCallbacks::_address_to_js(_env, addr);
+  if (!address) {
+    return NULL;
+  }
+  if (entry->address) {
+    _env->DeleteGlobalRef(entry->address);
+  }
+  entry->address = _env->NewGlobalRef(address);
+  _env->DeleteLocalRef(address);
+  memcpy(&entry->addr, addr, len);
+  return entry->address;
+}
+
+static void _batch_check_cb(uv_check_t* handle, int status) {
+  assert(handle->data);
+  CallbackScope scope(handle->loop, UV_UDP);
+  UDPCallbacks* cb = reinterpret_cast<UDPCallbacks*>(handle->data);
+  cb->flush_batch();
+}
+
+static void _batch_check_close_cb(uv_handle_t* handle) {
+  delete reinterpret_cast<uv_check_t*>(handle);
+}
+
+UDPRecvBatch::UDPRecvBatch(JNIEnv* env, uv_loop_t* loop, void* data, jintArray offsets, jintArray lengths, jobjectArray addresses) {
+  _env = env;
+  _capacity = env->GetArrayLength(offsets);
+  assert(_capacity > 0);
+  assert(_capacity == env->GetArrayLength(lengths));
+  assert(_capacity == env->GetArrayLength(addresses));
+  _count = 0;
+  _offsets = new jint[_capacity];
+  _lengths = new jint[_capacity];
+  _offsets_array = (jintArray) env->NewGlobalRef(offsets);
+  _lengths_array = (jintArray) env->NewGlobalRef(lengths);
+  _addresses_array = (jobjectArray) env->NewGlobalRef(addresses);
+  check = new uv_check_t();
+  int r = uv_check_init(loop, check);
+  assert(r == 0);
+  check->data = data;
+  // flushing a batch must not keep the loop alive on its own
+  uv_unref(reinterpret_cast<uv_handle_t*>(check));
+}
+
+UDPRecvBatch::~UDPRecvBatch() {
+  // check is closed separately since its close callback may run after this
+  _env->DeleteGlobalRef(_offsets_array);
+  _env->DeleteGlobalRef(_lengths_array);
+  _env->DeleteGlobalRef(_addresses_array);
+  delete[] _offsets;
+  delete[] _lengths;
+}
+
+void UDPRecvBatch::add(jint offset, jint length, jobject address) {
+  assert(_count < _capacity);
+  _offsets[_count] = offset;
+  _lengths[_count] = length;
+  _env->SetObjectArrayElement(_addresses_array, _count, address);
+  _count++;
+  if (_count == 1) {
+    uv_check_start(check, _batch_check_cb);
+  }
+}
+
+int UDPRecvBatch::drain() {
+  int count = _count;
+  if (count > 0) {
+    _env->SetIntArrayRegion(_offsets_array, 0, count, _offsets);
+    _env->SetIntArrayRegion(_lengths_array, 0, count, _lengths);
+  }
+  _count = 0;
+  uv_check_stop(check);
+  return count;
+}
+
 jclass UDPCallbacks::_udp_handle_cid = NULL;
 
 jmethodID UDPCallbacks::_recv_callback_mid = NULL;
+jmethodID UDPCallbacks::_recv_ring_callback_mid = NULL;
+jmethodID UDPCallbacks::_recv_batch_callback_mid = NULL;
 jmethodID UDPCallbacks::_send_callback_mid = NULL;
 jmethodID UDPCallbacks::_close_callback_mid = NULL;
 
@@ -52,6 +207,10 @@ void UDPCallbacks::static_initialize(JNIEnv* env, jclass cls) {
 
   _recv_callback_mid = env->GetMethodID(_udp_handle_cid, "callRecv", "(ILjava/nio/ByteBuffer;Lcom/oracle/libuv/Address;)V");
   assert(_recv_callback_mid);
+  _recv_ring_callback_mid = env->GetMethodID(_udp_handle_cid, "callRecvRing", "(IILcom/oracle/libuv/Address;)V");
+  assert(_recv_ring_callback_mid);
+  _recv_batch_callback_mid = env->GetMethodID(_udp_handle_cid, "callRecvBatch", "(I)V");
+  assert(_recv_batch_callback_mid);
   _send_callback_mid = env->GetMethodID(_udp_handle_cid, "callSend", "(ILjava/lang/Exception;Ljava/lang/Object;)V");
   assert(_send_callback_mid);
   _close_callback_mid = env->GetMethodID(_udp_handle_cid, "callClose", "()V");
@@ -70,12 +229,26 @@ void UDPCallbacks::initialize(JNIEnv *env, jobject instance) {
 
 UDPCallbacks::UDPCallbacks() {
   _env = NULL;
+  _ring = NULL;
+  _batch = NULL;
 }
 
 UDPCallbacks::~UDPCallbacks() {
+  delete _batch;
+  delete _ring;
   _env->DeleteGlobalRef(_instance);
 }
 
+UDPRecvRing* UDPCallbacks::start_ring(int slots, int slot_size) {
+  assert(_env);
+  if (_ring) {
+    // java may still hold the buffer of the current ring, so it lives as long as the handle
+    return _ring->slots() == slots && _ring->slot_size() == slot_size ? _ring : NULL;
+  }
+  _ring = new UDPRecvRing(_env, slots, slot_size);
+  return _ring;
+}
+
 void UDPCallbacks::on_recv(ssize_t nread, uv_buf_t buf, struct sockaddr* addr, unsigned flags) {
   if (nread == 0) return;
   jobject buffer_arg = NULL;
@@ -98,6 +271,67 @@ void UDPCallbacks::on_recv(ssize_t nread, uv_buf_t buf, struct sockaddr* addr, u
   delete[] buf.base;
 }
 
+void UDPCallbacks::on_recv_ring(ssize_t nread, uv_buf_t buf, struct sockaddr* addr, unsigned flags) {
+  assert(_ring);
+  if (nread == 0 && addr == NULL) return; // nothing to read, the slot stays free
+  if (nread < 0) {
+    _env->CallVoidMethod(
+        _instance,
+        _recv_ring_callback_mid,
+        nread,
+        0,
+        NULL);
+    return;
+  }
+  jint offset = static_cast<jint>(static_cast<size_t>(_ring->next()) * _ring->slot_size());
+  _ring->advance();
+  jobject rinfo_arg = addr ? _ring->address(addr) : NULL;
+  _env->CallVoidMethod(
+      _instance,
+      _recv_ring_callback_mid,
+      nread,
+      offset,
+      rinfo_arg);
+}
+
+void UDPCallbacks::start_batch(uv_loop_t* loop, jintArray offsets, jintArray lengths, jobjectArray addresses) {
+  assert(_env);
+  if (_batch) {
+    flush_batch();
+    uv_close(reinterpret_cast<uv_handle_t*>(_batch->check), _batch_check_close_cb);
+    delete _batch;
+  }
+  _batch = new UDPRecvBatch(_env, loop, this, offsets, lengths, addresses);
+}
+
+void UDPCallbacks::flush_batch() {
+  assert(_batch);
+  int count = _batch->drain();
+  if (count > 0) {
+    _env->CallVoidMethod(
+        _instance,
+        _recv_batch_callback_mid,
+        count);
+  }
+}
+
+void UDPCallbacks::on_recv_batch(ssize_t nread, uv_buf_t buf, struct sockaddr* addr, unsigned flags) {
+  assert(_ring);
+  assert(_batch);
+  if (nread == 0 && addr == NULL) return; // nothing to read, the slot stays free
+  if (nread < 0) {
+    // errors are delivered in band with a length of -1
+    _batch->add(0, -1, NULL);
+  } else {
+    jint offset = static_cast<jint>(static_cast<size_t>(_ring->next()) * _ring->slot_size());
+    _ring->advance();
+    _batch->add(offset, static_cast<jint>(nread), addr ? _ring->address(addr) : NULL);
+  }
+  if (_batch->full()) {
+    flush_batch();
+  }
+}
+
 void UDPCallbacks::on_send(int status, int error_code, jobject buffer, jobject context) {
   assert(_env);
 
@@ -119,6 +353,7 @@ void UDPCallbacks::on_close() {
 static void _close_cb(uv_handle_t* handle) {
   assert(handle);
   assert(handle->data);
+  CallbackScope scope(handle->loop, handle->type);
   UDPCallbacks* cb = reinterpret_cast<UDPCallbacks*>(handle->data);
   cb->on_close();
   delete cb;
@@ -127,21 +362,78 @@ static void _close_cb(uv_handle_t* handle) {
 
 static void _recv_cb(uv_udp_t* udp, ssize_t nread, uv_buf_t buf, struct sockaddr* addr, unsigned flags) {
   assert(udp);
+  CallbackScope scope(udp->loop, UV_UDP);
   uv_udp_t* handle = reinterpret_cast<uv_udp_t*>(udp);
   assert(handle->data);
   UDPCallbacks* cb = reinterpret_cast<UDPCallbacks*>(handle->data);
+  if (nread > 0) {
+    cb->counters().count_read(udp->loop, static_cast<size_t>(nread));
+  }
   cb->on_recv(nread, buf, addr, flags);
 }
 
+static void _recv_ring_cb(uv_udp_t* udp, ssize_t nread, uv_buf_t buf, struct sockaddr* addr, unsigned flags) {
+  assert(udp);
+  assert(udp->data);
+  CallbackScope scope(udp->loop, UV_UDP);
+  UDPCallbacks* cb = reinterpret_cast<UDPCallbacks*>(udp->data);
+  if (nread > 0) {
+    cb->counters().count_read(udp->loop, static_cast<size_t>(nread));
+  }
+  cb->on_recv_ring(nread, buf, addr, flags);
+}
+
+static void _recv_batch_cb(uv_udp_t* udp, ssize_t nread, uv_buf_t buf, struct sockaddr* addr, unsigned flags) {
+  assert(udp);
+  assert(udp->data);
+  CallbackScope scope(udp->loop, UV_UDP);
+  UDPCallbacks* cb = reinterpret_cast<UDPCallbacks*>(udp->data);
+  if (nread > 0) {
+    cb->counters().count_read(udp->loop, static_cast<size_t>(nread));
+  }
+  cb->on_recv_batch(nread, buf, addr, flags);
+}
+
+// One allocation for all requests of a sendBatch call, completed with a
+// single upcall once the last datagram has been sent.
+struct UDPSendBatch {
+  uv_udp_send_t* reqs;
+  int pending;
+  int status;
+  int error_code;
+  ContextHolder* holder;
+};
+
+static void _batch_send_cb(uv_udp_send_t* req, int status) {
+  assert(req->handle);
+  assert(req->data);
+  assert(req->handle->data);
+  CallbackScope scope(req->handle->loop, UV_UDP);
+  UDPSendBatch* batch = reinterpret_cast<UDPSendBatch*>(req->data);
+  if (status < 0 && batch->status == 0) {
+    batch->status = status;
+    batch->error_code = uv_last_error(req->handle->loop).code;
+  }
+  if (--batch->pending > 0) {
+    return;
+  }
+  UDPCallbacks* cb = reinterpret_cast<UDPCallbacks*>(req->handle->data);
+  cb->on_send(batch->status, batch->error_code, batch->holder->data(), batch->holder->context());
+  delete batch->holder;
+  delete[] batch->reqs;
+  delete batch;
+}
+
 static void _send_cb(uv_udp_send_t* req, int status) {
   assert(req->handle);
   assert(req->data);
   assert(req->handle->data);
+  CallbackScope scope(req->handle->loop, UV_UDP);
   UDPCallbacks* cb = reinterpret_cast<UDPCallbacks*>(req->handle->data);
   ContextHolder* req_data = reinterpret_cast<ContextHolder*>(req->data);
   cb->on_send(status, status < 0 ? uv_last_error(req->handle->loop).code : 0, req_data->data(), req_data->context());
   delete req_data;
-  delete req;
+  freelist_delete(req);
 }
 
 /*
@@ -292,18 +584,33 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_UDPHandle__1send
   uv_udp_t* handle = reinterpret_cast<uv_udp_t*>(udp);
   const char* h = env->GetStringUTFChars(host, 0);
   sockaddr_in addr = uv_ip4_addr(h, port);
-  uv_udp_send_t* req = new uv_udp_send_t();
+  uv_udp_send_t* req = loop_new_req<uv_udp_send_t>(handle->loop, LoopData::UDP_SEND_REQ);
+  if (!req) {
+    env->ReleaseStringUTFChars(host, h);
+    OOME(env, req);
+  }
   req->handle = handle;
-  ContextHolder* req_data = NULL;
+  ContextHolder* req_data = data ?
+      new (handle->loop) ContextHolder(env, context) :
+      new (handle->loop) ContextHolder(env, buffer, context);
+  if (!req_data) {
+    freelist_delete(req);
+    env->ReleaseStringUTFChars(host, h);
+    OOME(env, req_data);
+  }
+  req->data = req_data;
   int r;
   if (data) {
     jbyte* base = (jbyte*) env->GetPrimitiveArrayCritical(data, NULL);
-    OOME(env, base);
+    if (!base) {
+      delete req_data;
+      freelist_delete(req);
+      env->ReleaseStringUTFChars(host, h);
+      OOME(env, base);
+    }
     uv_buf_t buf;
     buf.base = reinterpret_cast<char*>(base + offset);
     buf.len = length;
-    req_data = new ContextHolder(env, context);
-    req->data = req_data;
     r = uv_udp_send(req, handle, &buf, 1, addr, _send_cb);
     env->ReleasePrimitiveArrayCritical(data, base, 0);
   } else {
@@ -311,14 +618,14 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_UDPHandle__1send
     uv_buf_t buf;
     buf.base = reinterpret_cast<char*>(base + offset);
     buf.len = length;
-    req_data = new ContextHolder(env, buffer, context);
-    req->data = req_data;
     r = uv_udp_send(req, handle, &buf, 1, addr, _send_cb);
   }
   if (r) {
     delete req_data;
-    delete req;
+    freelist_delete(req);
     ThrowException(env, handle->loop, "uv_udp_send", h);
+  } else {
+    reinterpret_cast<UDPCallbacks*>(handle->data)->counters().count_write(handle->loop, length, 0);
   }
   env->ReleaseStringUTFChars(host, h);
   return r;
@@ -343,16 +650,29 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_UDPHandle__1send6
   buf.base = reinterpret_cast<char*>(base + offset);
   buf.len = length;
 
-  uv_udp_send_t* req = new uv_udp_send_t();
+  uv_udp_send_t* req = loop_new_req<uv_udp_send_t>(handle->loop, LoopData::UDP_SEND_REQ);
+  if (!req) {
+    env->ReleasePrimitiveArrayCritical(data, base, 0);
+    env->ReleaseStringUTFChars(host, h);
+    OOME(env, req);
+  }
   req->handle = handle;
-  ContextHolder* req_data = new ContextHolder(env, context);
+  ContextHolder* req_data = new (handle->loop) ContextHolder(env, context);
+  if (!req_data) {
+    env->ReleasePrimitiveArrayCritical(data, base, 0);
+    freelist_delete(req);
+    env->ReleaseStringUTFChars(host, h);
+    OOME(env, req_data);
+  }
   req->data = req_data;
   int r = uv_udp_send6(req, handle, &buf, 1, addr, _send_cb);
   env->ReleasePrimitiveArrayCritical(data, base, 0);
   if (r) {
     delete req_data;
-    delete req;
+    freelist_delete(req);
     ThrowException(env, handle->loop, "uv_udp_send6", h);
+  } else {
+    reinterpret_cast<UDPCallbacks*>(handle->data)->counters().count_write(handle->loop, length, 0);
   }
   env->ReleaseStringUTFChars(host, h);
   return r;
@@ -369,13 +689,132 @@ JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_UDPHandle__1recv_1start
   assert(udp);
   uv_udp_t* handle = reinterpret_cast<uv_udp_t*>(udp);
   int r = uv_udp_recv_start(handle, _alloc_cb, _recv_cb);
-  // UV_EALREADY means that the socket is already bound but that's okay
-  if (r && uv_last_error(handle->loop).code != UV_EALREADY) {
+  if (r) {
     ThrowException(env, handle->loop, "uv_udp_recv_start");
   }
   return r;
 }
 
+/*
+ * Class:     com_oracle_libuv_handles_UDPHandle
+ * Method:    _recv_ring_start
+ * Signature: (JII)Ljava/nio/ByteBuffer;
+ */
+JNIEXPORT jobject JNICALL Java_com_oracle_libuv_handles_UDPHandle__1recv_1ring_1start
+  (JNIEnv *env, jobject that, jlong udp, jint slots, jint slot_size) {
+
+  assert(udp);
+  uv_udp_t* handle = reinterpret_cast<uv_udp_t*>(udp);
+  assert(handle->data);
+  UDPCallbacks* cb = reinterpret_cast<UDPCallbacks*>(handle->data);
+  UDPRecvRing* ring = cb->start_ring(slots, slot_size);
+  if (!ring) {
+    ThrowException(env, UV_EINVAL, "uv_udp_recv_start", "receive ring already allocated with a different geometry");
+    return NULL;
+  }
+  OOMN(env, ring->buffer());
+  int r = uv_udp_recv_start(handle, _ring_alloc_cb, _recv_ring_cb);
+  if (r) {
+    ThrowException(env, handle->loop, "uv_udp_recv_start");
+    return NULL;
+  }
+  return ring->buffer();
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_UDPHandle
+ * Method:    _recv_batch_start
+ * Signature: (JII[I[I[Lcom/oracle/libuv/Address;)Ljava/nio/ByteBuffer;
+ */
+JNIEXPORT jobject JNICALL Java_com_oracle_libuv_handles_UDPHandle__1recv_1batch_1start
+  (JNIEnv *env, jobject that, jlong udp, jint slots, jint slot_size, jintArray offsets, jintArray lengths, jobjectArray addresses) {
+
+  assert(udp);
+  uv_udp_t* handle = reinterpret_cast<uv_udp_t*>(udp);
+  assert(handle->data);
+  UDPCallbacks* cb = reinterpret_cast<UDPCallbacks*>(handle->data);
+  UDPRecvRing* ring = cb->start_ring(slots, slot_size);
+  if (!ring) {
+    ThrowException(env, UV_EINVAL, "uv_udp_recv_start", "receive ring already allocated with a different geometry");
+    return NULL;
+  }
+  OOMN(env, ring->buffer());
+  cb->start_batch(handle->loop, offsets, lengths, addresses);
+  int r = uv_udp_recv_start(handle, _ring_alloc_cb, _recv_batch_cb);
+  if (r) {
+    ThrowException(env, handle->loop, "uv_udp_recv_start");
+    return NULL;
+  }
+  return ring->buffer();
+}
+
+/*
+ * Class:     com_oracle_libuv_handles_UDPHandle
+ * Method:    _send_batch
+ * Signature: (J[Ljava/nio/ByteBuffer;[I[Ljava/lang/String;ILjava/lang/Object;)I
+ */
+JNIEXPORT jint JNICALL Java_com_oracle_libuv_handles_UDPHandle__1send_1batch
+  (JNIEnv *env, jobject that, jlong udp, jobjectArray buffers, jintArray ports, jobjectArray hosts, jint count, jobject context) {
+
+  assert(udp);
+  assert(count > 0);
+  uv_udp_t* handle = reinterpret_cast<uv_udp_t*>(udp);
+
+  // buffers are all direct (checked by UDPHandle.sendBatch) and kept
+  // alive by the global ref to the array held in the batch
+  ContextHolder* holder = new (handle->loop) ContextHolder(env, buffers, context);
+  OOME(env, holder);
+  UDPSendBatch* batch = new UDPSendBatch();
+  batch->reqs = new uv_udp_send_t[count];
+  batch->pending = 0;
+  batch->status = 0;
+  batch->error_code = 0;
+  batch->holder = holder;
+
+  jint* port = env->GetIntArrayElements(ports, NULL);
+  int r = 0;
+  int i;
+  for (i = 0; i < count; i++) {
+    jobject buffer = env->GetObjectArrayElement(buffers, i);
+    jstring host = (jstring) env->GetObjectArrayElement(hosts, i);
+    uv_buf_t buf;
+    buf.base = reinterpret_cast<char*>(env->GetDirectBufferAddress(buffer));
+    buf.len = static_cast<size_t>(env->GetDirectBufferCapacity(buffer));
+    const char* h = env->GetStringUTFChars(host, 0);
+    uv_udp_send_t* req = &batch->reqs[i];
+    req->data = batch;
+    batch->pending++;
+    if (strchr(h, ':')) {
+      r = uv_udp_send6(req, handle, &buf, 1, uv_ip6_addr(h, port[i]), _batch_send_cb);
+    } else {
+      r = uv_udp_send(req, handle, &buf, 1, uv_ip4_addr(h, port[i]), _batch_send_cb);
+    }
+    env->ReleaseStringUTFChars(host, h);
+    env->DeleteLocalRef(host);
+    env->DeleteLocalRef(buffer);
+    if (r) {
+      batch->pending--;
+      break;
+    }
+    reinterpret_cast<UDPCallbacks*>(handle->data)->counters().count_write(handle->loop, buf.len, 0);
+  }
+  env->ReleaseIntArrayElements(ports, port, JNI_ABORT);
+  if (r) {
+    if (batch->pending == 0) {
+      ThrowException(env, handle->loop, "uv_udp_send");
+      delete batch->holder;
+      delete[] batch->reqs;
+      delete batch;
+      return r;
+    }
+    // the datagrams already queued still go out, the failure is reported
+    // once through the send callback when they complete
+    batch->status = r;
+    batch->error_code = uv_last_error(handle->loop).code;
+  }
+  return 0;
+}
+
 /*
  * Class:     com_oracle_libuv_handles_UDPHandle
  * Method:    _recv_stop
@@ -492,5 +931,13 @@ JNIEXPORT void JNICALL Java_com_oracle_libuv_handles_UDPHandle__1close
 
   assert(udp);
   uv_handle_t* handle = reinterpret_cast<uv_handle_t*>(udp);
+  assert(handle->data);
+  UDPCallbacks* cb = reinterpret_cast<UDPCallbacks*>(handle->data);
+  if (cb->batch()) {
+    uv_handle_t* check = reinterpret_cast<uv_handle_t*>(cb->batch()->check);
+    if (!uv_is_closing(check)) {
+      uv_close(check, _batch_check_close_cb);
+    }
+  }
   uv_close(handle, _close_cb);
 }
@@ -29,17 +29,86 @@
 #include <jni.h>
 
 #include "uv.h"
+#include "handle.h"
+
+// A fixed ring of datagram slots in one block of direct memory, shared
+// with java as a single ByteBuffer. A slot is overwritten once the ring
+// wraps around, i.e. after 'slots' more datagrams have been received.
+class UDPRecvRing {
+private:
+  static const int ADDRESS_CACHE_SIZE = 256;
+
+  struct CachedAddress {
+    sockaddr_storage addr;
+    jobject address;
+  };
+
+  JNIEnv* _env;
+  char* _base;
+  int _slots;
+  int _slot_size;
+  int _next;
+  jobject _buffer;
+  CachedAddress _addresses[ADDRESS_CACHE_SIZE];
+
+public:
+  UDPRecvRing(JNIEnv* env, int slots, int slot_size);
+  ~UDPRecvRing();
+
+  inline int slots() const { return _slots; }
+  inline int slot_size() const { return _slot_size; }
+  inline jobject buffer() const { return _buffer; }
+  inline char* slot(int index) const { return _base + static_cast<size_t>(index) * _slot_size; }
+  inline int next() const { return _next; }
+  inline void advance() { _next = (_next + 1) % _slots; }
+
+  // returns a global ref to an Address for addr, owned by the ring
+  jobject address(const sockaddr* addr);
+};
+
+// Accumulates ring datagrams received during one loop iteration and hands
+// them to java in one upcall, either when the batch is full or from a
+// check handle once the poll phase is over.
+class UDPRecvBatch {
+private:
+  JNIEnv* _env;
+  int _capacity;
+  int _count;
+  jint* _offsets;
+  jint* _lengths;
+  jintArray _offsets_array;
+  jintArray _lengths_array;
+  jobjectArray _addresses_array;
+
+public:
+  uv_check_t* check;
+
+  UDPRecvBatch(JNIEnv* env, uv_loop_t* loop, void* data, jintArray offsets, jintArray lengths, jobjectArray addresses);
+  ~UDPRecvBatch();
+
+  inline int count() const { return _count; }
+  inline bool full() const { return _count == _capacity; }
+
+  void add(jint offset, jint length, jobject address);
+  // copies the pending entries to the java arrays and returns the count
+  int drain();
+};
 
 class UDPCallbacks {
 private:
   static jclass _udp_handle_cid;
 
   static jmethodID _recv_callback_mid;
+  static jmethodID _recv_ring_callback_mid;
+  static jmethodID _recv_batch_callback_mid;
   static jmethodID _send_callback_mid;
   static jmethodID _close_callback_mid;
 
   JNIEnv* _env;
   jobject _instance;
+  UDPRecvRing* _ring;
+  UDPRecvBatch* _batch;
+  IoCounters _counters;
 
 public:
   static void static_initialize(JNIEnv* env, jclass cls);
@@ -49,7 +118,18 @@ public:
 
   void initialize(JNIEnv *env, jobject instance);
 
+  // udp has no write queue, so the queue peak stays 0
+  inline IoCounters& counters() { return _counters; }
+
+  inline UDPRecvRing* ring() { return _ring; }
+  UDPRecvRing* start_ring(int slots, int slot_size);
+  inline UDPRecvBatch* batch() { return _batch; }
+  void start_batch(uv_loop_t* loop, jintArray offsets, jintArray lengths, jobjectArray addresses);
+  void flush_batch();
+
   void on_recv(ssize_t nread, uv_buf_t buf, struct sockaddr* addr, unsigned flags);
+  void on_recv_ring(ssize_t nread, uv_buf_t buf, struct sockaddr* addr, unsigned flags);
+  void on_recv_batch(ssize_t nread, uv_buf_t buf, struct sockaddr* addr, unsigned flags);
   void on_send(int status, int error_code, jobject buffer, jobject domain);
   void on_close();
 };
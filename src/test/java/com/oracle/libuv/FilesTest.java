@@ -28,6 +28,8 @@ package com.oracle.libuv;
 import java.io.File;
 import java.lang.reflect.Method;
 import java.nio.ByteBuffer;
+import java.util.HashSet;
+import java.util.Set;
 import java.util.concurrent.atomic.AtomicBoolean;
 import java.util.concurrent.atomic.AtomicInteger;
 
@@ -37,11 +39,14 @@ import org.testng.annotations.BeforeMethod;
 import org.testng.annotations.Test;
 
 import com.oracle.libuv.Files.OpenedFile;
+import com.oracle.libuv.cb.FileBatchCallback;
 import com.oracle.libuv.cb.FileCallback;
 import com.oracle.libuv.cb.FileCloseCallback;
 import com.oracle.libuv.cb.FileOpenCallback;
 import com.oracle.libuv.cb.FileReadCallback;
 import com.oracle.libuv.cb.FileReadDirCallback;
+import com.oracle.libuv.cb.FileStatManyCallback;
+import com.oracle.libuv.cb.FileVectorCallback;
 import com.oracle.libuv.cb.FileWriteCallback;
 import com.oracle.libuv.handles.HandleFactory;
 import com.oracle.libuv.handles.LoopHandle;
@@ -275,6 +280,48 @@ public class FilesTest extends TestBase {
         Assert.assertTrue(readdirCallbackCalled.get());
     }
 
+    @Test
+    public void testDirectoryCursor() {
+        final String dirname = testName + ".dir";
+        final int files = 20;
+        final Files handle = handleFactory.newFiles();
+        handle.mkdir(dirname, Constants.S_IRWXU);
+        handle.mkdir(dirname + "/sub", Constants.S_IRWXU);
+        for (int i = 0; i < files; i++) {
+            handle.close(handle.open(dirname + "/entry-" + i, Constants.O_RDWR | Constants.O_CREAT, Constants.S_IRWXU));
+        }
+
+        final Set<String> seen = new HashSet<>();
+        int batches = 0;
+        // names are 7 or 8 bytes, so a 16 byte buffer forces many batches
+        try (final DirectoryCursor cursor = handle.opendir(dirname, 16, 8)) {
+            while (cursor.next() > 0) {
+                batches++;
+                Assert.assertTrue(cursor.size() <= 2);
+                for (int i = 0; i < cursor.size(); i++) {
+                    final String name = cursor.name(i);
+                    Assert.assertTrue(seen.add(name));
+                    final int type = cursor.type(i);
+                    if (type != DirectoryCursor.TYPE_UNKNOWN) {
+                        Assert.assertEquals(type, name.equals("sub") ? DirectoryCursor.TYPE_DIR : DirectoryCursor.TYPE_FILE);
+                    }
+                }
+            }
+            Assert.assertTrue(cursor.isDone());
+            Assert.assertEquals(cursor.next(), 0);
+        }
+        Assert.assertEquals(seen.size(), files + 1);
+        Assert.assertTrue(batches > 1);
+
+        final String[] paths = new String[files + 2];
+        for (int i = 0; i < files; i++) {
+            paths[i] = dirname + "/entry-" + i;
+        }
+        paths[files] = dirname + "/sub";
+        paths[files + 1] = dirname;
+        cleanupFiles(handle, paths);
+    }
+
     @Test
     public void testRenameSync() {
         final String filename = testName + ".txt";
@@ -397,6 +444,190 @@ public class FilesTest extends TestBase {
         Assert.assertTrue(linkCallbackCalled.get());
     }
 
+    @Test
+    public void testWritevReadvSync() {
+        final String filename = testName + ".txt";
+        final Files handle = handleFactory.newFiles();
+        final ByteBuffer[] out = {direct("some "), direct("vectored "), direct("data")};
+        final ByteBuffer[] in = {ByteBuffer.allocateDirect(5), ByteBuffer.allocateDirect(13)};
+
+        final int fd = handle.open(filename, Constants.O_RDWR | Constants.O_CREAT, Constants.S_IRWXU | Constants.S_IRWXG | Constants.S_IRWXO);
+        Assert.assertEquals(handle.writev(fd, out, 0), 18);
+        Assert.assertEquals(handle.readv(fd, in, 0), 18);
+        handle.close(fd);
+        Assert.assertEquals(in[0], direct("some "));
+        Assert.assertEquals(in[1], direct("vectored data"));
+        cleanupFiles(handle, filename);
+    }
+
+    @Test
+    public void testReadvAsync() throws Throwable {
+        final String filename = testName + ".txt";
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final Files handle = handleFactory.newFiles();
+        final ByteBuffer[] in = {ByteBuffer.allocateDirect(4), ByteBuffer.allocateDirect(16)};
+        final AtomicBoolean readvCallbackCalled = new AtomicBoolean(false);
+
+        handle.setReadvCallback(new FileVectorCallback() {
+            @Override
+            public void onComplete(final Object context, final long bytes, final ByteBuffer[] buffers, final Exception error) throws Exception {
+                Assert.assertEquals(context, FilesTest.this);
+                readvCallbackCalled.set(true);
+                checkException(error);
+                Assert.assertEquals(bytes, 9);
+                Assert.assertSame(buffers, in);
+            }
+        });
+
+        final int fd = handle.open(filename, Constants.O_RDWR | Constants.O_CREAT, Constants.S_IRWXU | Constants.S_IRWXG | Constants.S_IRWXO);
+        final ByteBuffer b = direct("some data");
+        handle.write(fd, b, 0, b.limit(), 0);
+        handle.readv(fd, in, 0, FilesTest.this);
+        loop.run();
+        handle.close(fd);
+        Assert.assertTrue(readvCallbackCalled.get());
+        cleanupFiles(handle, filename);
+    }
+
+    @Test
+    public void testBatchAsync() throws Throwable {
+        final String filename = testName + ".txt";
+        final int segments = 64;
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final Files handle = handleFactory.newFiles();
+        final AtomicInteger batches = new AtomicInteger(0);
+
+        final int fd = handle.open(filename, Constants.O_RDWR | Constants.O_CREAT, Constants.S_IRWXU | Constants.S_IRWXG | Constants.S_IRWXO);
+        final FileBatch writes = new FileBatch(4);
+        for (int i = 0; i < segments; i++) {
+            writes.write(fd, direct(String.format("%08d", i)), i * 8);
+        }
+        handle.submit(writes);
+        for (int i = 0; i < segments; i++) {
+            Assert.assertEquals(writes.result(i), 8);
+        }
+
+        final FileBatch reads = new FileBatch();
+        for (int i = 0; i < segments; i++) {
+            reads.read(fd, ByteBuffer.allocateDirect(8), i * 8);
+        }
+        // past the end of the file
+        reads.read(fd, ByteBuffer.allocateDirect(8), segments * 8);
+
+        handle.setBatchCallback(new FileBatchCallback() {
+            @Override
+            public void onComplete(final Object context, final FileBatch batch) throws Exception {
+                Assert.assertEquals(context, FilesTest.this);
+                Assert.assertSame(batch, reads);
+                batches.incrementAndGet();
+                for (int i = 0; i < segments; i++) {
+                    Assert.assertEquals(batch.result(i), 8);
+                    Assert.assertNull(batch.error(i));
+                    Assert.assertEquals(batch.buffer(i), direct(String.format("%08d", i)));
+                }
+                Assert.assertEquals(batch.result(segments), 0);
+            }
+        });
+
+        handle.submit(reads, FilesTest.this);
+        loop.run();
+        handle.close(fd);
+        Assert.assertEquals(batches.get(), 1);
+        cleanupFiles(handle, filename);
+    }
+
+    @Test
+    public void testStatReuse() throws Throwable {
+        final String filename = testName + ".txt";
+        final String missing = testName + ".missing";
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final Files handle = handleFactory.newFiles();
+        final AtomicInteger statManyCalls = new AtomicInteger(0);
+        final ByteBuffer b = direct("some data");
+
+        final int fd = handle.open(filename, Constants.O_RDWR | Constants.O_CREAT, Constants.S_IRWXU | Constants.S_IRWXG | Constants.S_IRWXO);
+        handle.write(fd, b, 0, b.limit(), 0);
+
+        final Stats reuse = new Stats();
+        Assert.assertSame(handle.fstatInto(fd, reuse), reuse);
+        Assert.assertEquals(reuse.getSize(), b.limit());
+        Assert.assertSame(handle.statInto(filename, reuse), reuse);
+        Assert.assertEquals(reuse.getSize(), b.limit());
+        Assert.assertEquals(reuse.getIno(), handle.stat(filename).getIno());
+
+        final String[] paths = {filename, missing, filename};
+        final long[] out = new long[paths.length * Files.STAT_ROW];
+        Assert.assertEquals(handle.statMany(paths, out), 2);
+        Assert.assertEquals(Files.statError(out, 0), 0);
+        Assert.assertTrue(Files.statError(out, 1) != 0);
+        Assert.assertNull(Files.statAt(out, 1, reuse));
+        Assert.assertEquals(Files.statAt(out, 2, reuse).getSize(), b.limit());
+
+        final long[] async = new long[out.length];
+        handle.setStatManyCallback(new FileStatManyCallback() {
+            @Override
+            public void onStats(final Object context, final int count, final long[] values) throws Exception {
+                Assert.assertEquals(context, FilesTest.this);
+                Assert.assertEquals(count, paths.length);
+                Assert.assertSame(values, async);
+                Assert.assertEquals(values, out);
+                statManyCalls.incrementAndGet();
+            }
+        });
+        Assert.assertEquals(handle.statMany(paths, async, FilesTest.this), 0);
+        loop.run();
+        handle.close(fd);
+        Assert.assertEquals(statManyCalls.get(), 1);
+        cleanupFiles(handle, filename);
+    }
+
+    @Test
+    public void testMmapSync() {
+        final String filename = testName + ".txt";
+        final Files handle = handleFactory.newFiles();
+        final ByteBuffer b = direct("some mapped data");
+
+        final int fd = handle.open(filename, Constants.O_RDWR | Constants.O_CREAT, Constants.S_IRWXU | Constants.S_IRWXG | Constants.S_IRWXO);
+        handle.write(fd, b, 0, b.limit(), 0);
+
+        final ByteBuffer mapping = handle.mmap(fd, 0, b.limit(), Files.PROT_READ);
+        Assert.assertTrue(mapping.isDirect());
+        Assert.assertEquals(mapping, b);
+        Assert.assertEquals(handle.madvise(mapping, Files.MADV_WILLNEED), 0);
+        Assert.assertEquals(handle.munmap(mapping), 0);
+
+        // unaligned offset, written through the mapping
+        final ByteBuffer writable = handle.mmap(fd, 5, 6, Files.PROT_READ | Files.PROT_WRITE);
+        Assert.assertEquals(writable, direct("mapped"));
+        writable.put(direct("MAPPED"));
+        Assert.assertEquals(handle.msync(writable, true), 0);
+        Assert.assertEquals(handle.munmap(writable), 0);
+
+        // only live mappings from mmap may be unmapped
+        for (final ByteBuffer unmapped : new ByteBuffer[] {writable, b}) {
+            try {
+                handle.munmap(unmapped);
+                Assert.fail("munmap of a buffer that is not mapped");
+            } catch (final NativeException ex) {
+                Assert.assertEquals(ex.errnoString(), "EINVAL");
+            }
+        }
+
+        final ByteBuffer bb = ByteBuffer.allocateDirect(b.limit());
+        handle.read(fd, bb, 0, bb.limit(), 0);
+        handle.close(fd);
+        Assert.assertEquals(bb, direct("some MAPPED data"));
+        cleanupFiles(handle, filename);
+    }
+
+    private static ByteBuffer direct(final String str) {
+        final byte[] bytes = str.getBytes();
+        final ByteBuffer buffer = ByteBuffer.allocateDirect(bytes.length);
+        buffer.put(bytes);
+        buffer.flip();
+        return buffer;
+    }
+
     private void cleanupFiles(final Files handle, final String... files) {
         for (int i = 0; i < files.length; i++) {
             try {
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+package com.oracle.libuv;
+
+import org.testng.Assert;
+import org.testng.annotations.Test;
+
+import com.oracle.libuv.handles.HandleFactory;
+import com.oracle.libuv.handles.LoopHandle;
+
+import static com.oracle.libuv.handles.DefaultHandleFactory.newFactory;
+
+public class NativeExceptionTest extends TestBase {
+
+    private static final String MISSING = "native-exception-test-missing-file";
+
+    private static NativeException openMissing(final Files files) {
+        try {
+            files.open(MISSING, Constants.O_RDONLY, 0);
+        } catch (final NativeException ex) {
+            return ex;
+        }
+        Assert.fail("opened " + MISSING);
+        return null;
+    }
+
+    @Test
+    public void testLazyMessage() {
+        final HandleFactory handleFactory = newFactory();
+        final NativeException ex = openMissing(handleFactory.newFiles());
+        Assert.assertEquals(ex.errnoString(), "ENOENT");
+        Assert.assertNotNull(ex.getErrnoMessage());
+        Assert.assertEquals(ex.path(), MISSING);
+        Assert.assertEquals(ex.getMessage(), "ENOENT, " + ex.getErrnoMessage() + " '" + MISSING + "'");
+        Assert.assertTrue(ex.getStackTrace().length > 0);
+    }
+
+    @Test
+    public void testLightweight() {
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final int code = openMissing(handleFactory.newFiles()).errno();
+        NativeException.setLightweight(true);
+        try {
+            final NativeException ex = openMissing(handleFactory.newFiles());
+            Assert.assertEquals(ex.errnoString(), "ENOENT");
+            Assert.assertEquals(ex.getStackTrace().length, 0);
+
+            // code only errors share one instance per code
+            loop.setLastError(code);
+            final NativeException first = loop.getLastError();
+            final NativeException second = loop.getLastError();
+            Assert.assertSame(first, second);
+            Assert.assertEquals(first.errno(), code);
+            Assert.assertEquals(first.getMessage(), "ENOENT, " + first.getErrnoMessage());
+        } finally {
+            NativeException.setLightweight(false);
+        }
+        loop.setLastError(code);
+        Assert.assertNotSame(loop.getLastError(), loop.getLastError());
+    }
+
+    public static void main(final String[] args) throws Throwable {
+        final NativeExceptionTest test = new NativeExceptionTest();
+        test.testLazyMessage();
+        test.testLightweight();
+    }
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+package com.oracle.libuv.benchmark;
+
+import com.oracle.libuv.cb.AsyncCallback;
+import com.oracle.libuv.handles.AsyncHandle;
+
+/**
+ * Latency of waking the loop from another thread. The sender waits for
+ * each wakeup to be seen before sending the next, so no sends coalesce.
+ */
+final class AsyncWakeupBenchmark extends Benchmark {
+
+    private AsyncHandle async;
+    private Thread sender;
+    private volatile boolean stopped;
+    private volatile long sentAt;
+    private volatile long sent;
+    private volatile long seen;
+
+    AsyncWakeupBenchmark() {
+        super("async-wakeup");
+    }
+
+    @Override
+    protected void start() throws Throwable {
+        stopped = false;
+        sent = 0;
+        seen = 0;
+        async = factory.newAsyncHandle();
+        async.setAsyncCallback(new AsyncCallback() {
+            @Override
+            public void onSend(final int status) throws Exception {
+                final long s = sent;
+                if (s != seen) {
+                    completed(0, sentAt);
+                    seen = s;
+                }
+            }
+        });
+        sender = new Thread(new Runnable() {
+            @Override
+            public void run() {
+                while (!stopped) {
+                    sentAt = System.nanoTime();
+                    sent++;
+                    async.send();
+                    while (seen != sent && !stopped) {
+                        Thread.yield();
+                    }
+                }
+            }
+        }, "AsyncWakeupBenchmark");
+        sender.setDaemon(true);
+        sender.start();
+    }
+
+    @Override
+    protected void stop() throws Throwable {
+        stopped = true;
+        sender.join();
+        async.close();
+    }
+
+}
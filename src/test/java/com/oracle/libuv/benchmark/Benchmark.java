@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+package com.oracle.libuv.benchmark;
+
+import com.oracle.libuv.TestBase;
+import com.oracle.libuv.handles.HandleFactory;
+import com.oracle.libuv.handles.LoopHandle;
+
+/**
+ * A benchmark drives a workload on its own loop until {@link #running()}
+ * turns false. Operations completed while {@link BenchmarkRunner} is
+ * measuring are counted, those completed during warmup are not.
+ */
+public abstract class Benchmark extends TestBase {
+
+    protected static final String ADDRESS = "127.0.0.1";
+
+    private final String name;
+    private final Histogram latency = new Histogram();
+    private long ops;
+    private long bytes;
+    private boolean measuring;
+    private boolean running;
+
+    protected HandleFactory factory;
+    protected LoopHandle loop;
+
+    protected Benchmark(final String name) {
+        this.name = name;
+    }
+
+    public String getName() {
+        return name;
+    }
+
+    /**
+     * Sets up the handles and issues the first operations, the loop is not
+     * running yet.
+     */
+    protected abstract void start() throws Throwable;
+
+    /**
+     * Closes the handles once running is false, the loop is then run until
+     * it has no more work.
+     */
+    protected abstract void stop() throws Throwable;
+
+    protected final boolean running() {
+        return running;
+    }
+
+    protected final void completed(final long bytes) {
+        if (measuring) {
+            ops++;
+            this.bytes += bytes;
+        }
+    }
+
+    protected final void completed(final long bytes, final long startNanos) {
+        if (measuring) {
+            ops++;
+            this.bytes += bytes;
+            latency.record(System.nanoTime() - startNanos);
+        }
+    }
+
+    final void setUp(final HandleFactory factory) {
+        this.factory = factory;
+        this.loop = factory.getLoopHandle();
+        ops = 0;
+        bytes = 0;
+        latency.reset();
+        measuring = false;
+        running = true;
+    }
+
+    final void setMeasuring(final boolean measuring) {
+        this.measuring = measuring;
+    }
+
+    final void setRunning(final boolean running) {
+        this.running = running;
+    }
+
+    final long ops() {
+        return ops;
+    }
+
+    final long bytes() {
+        return bytes;
+    }
+
+    final Histogram latency() {
+        return latency;
+    }
+
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+package com.oracle.libuv.benchmark;
+
+import java.lang.management.ManagementFactory;
+import java.util.ArrayList;
+import java.util.List;
+
+import com.oracle.libuv.cb.TimerCallback;
+import com.oracle.libuv.handles.TimerHandle;
+
+import static com.oracle.libuv.handles.DefaultHandleFactory.newFactory;
+
+/**
+ * Runs each benchmark for a warmup period followed by a measured period
+ * and prints one line per benchmark. Use {@code -Dbenchmark=tcp,fs} to
+ * select benchmarks whose name contains any of the given strings, and
+ * {@code -Dbenchmark.duration} and {@code -Dbenchmark.warmup} to change
+ * the periods in milliseconds.
+ */
+public final class BenchmarkRunner {
+
+    private static final long DURATION = Long.getLong("benchmark.duration", 5000);
+    private static final long WARMUP = Long.getLong("benchmark.warmup", 1000);
+
+    private static final String HEADER = "%-24s %12s %12s %10s %10s %10s %10s %12s %12s%n";
+    private static final String ROW = "%-24s %12d %12.0f %10.1f %10.1f %10.1f %10.1f %12s %12.2f%n";
+
+    private static final com.sun.management.ThreadMXBean THREADS =
+            ManagementFactory.getThreadMXBean() instanceof com.sun.management.ThreadMXBean ?
+                    (com.sun.management.ThreadMXBean) ManagementFactory.getThreadMXBean() : null;
+
+    private static List<Benchmark> benchmarks() {
+        final List<Benchmark> all = new ArrayList<>();
+        all.add(new TcpEchoBenchmark());
+        all.add(new TcpPingPongBenchmark());
+        all.add(new UdpBenchmark());
+        all.add(new PipeBenchmark());
+        all.add(new WriteBenchmark(false));
+        all.add(new WriteBenchmark(true));
+        for (final int size : new int[] {4 * 1024, 64 * 1024, 1024 * 1024}) {
+            all.add(new FileBenchmark(false, size));
+            all.add(new FileBenchmark(true, size));
+        }
+        all.add(new TimerChurnBenchmark());
+        all.add(new AsyncWakeupBenchmark());
+        return all;
+    }
+
+    private static boolean selected(final Benchmark benchmark) {
+        final String filter = System.getProperty("benchmark");
+        if (filter == null || filter.isEmpty()) {
+            return true;
+        }
+        for (final String part : filter.split(",")) {
+            if (!part.isEmpty() && benchmark.getName().contains(part.trim())) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    private static long allocatedBytes() {
+        if (THREADS == null || !THREADS.isThreadAllocatedMemorySupported()) {
+            return -1;
+        }
+        return THREADS.getThreadAllocatedBytes(Thread.currentThread().getId());
+    }
+
+    private long startNanos;
+    private long endNanos;
+    private long startAllocated;
+    private long endAllocated;
+    private long startCallbacks;
+    private long endCallbacks;
+
+    private void run(final Benchmark benchmark) throws Throwable {
+        benchmark.setUp(newFactory());
+        final TimerHandle phase = benchmark.factory.newTimerHandle();
+        phase.setTimerFiredCallback(new TimerCallback() {
+            @Override
+            public void onTimer(final int status) throws Exception {
+                if (startNanos == 0) {
+                    benchmark.setMeasuring(true);
+                    startAllocated = allocatedBytes();
+                    startCallbacks = benchmark.loop.getCallbackCount();
+                    startNanos = System.nanoTime();
+                    phase.start(DURATION, 0);
+                } else {
+                    endNanos = System.nanoTime();
+                    endCallbacks = benchmark.loop.getCallbackCount();
+                    endAllocated = allocatedBytes();
+                    benchmark.setMeasuring(false);
+                    benchmark.loop.stop();
+                }
+            }
+        });
+        startNanos = 0;
+        endNanos = 0;
+        benchmark.start();
+        phase.start(WARMUP, 0);
+        benchmark.loop.run();
+        benchmark.setRunning(false);
+        benchmark.stop();
+        phase.close();
+        benchmark.loop.run();
+        report(benchmark);
+    }
+
+    private void report(final Benchmark benchmark) {
+        final long ops = benchmark.ops();
+        final double seconds = (endNanos - startNanos) / 1e9;
+        final Histogram latency = benchmark.latency();
+        final String allocated = startAllocated < 0 || ops == 0 ?
+                "n/a" : String.format("%.1f", (double) (endAllocated - startAllocated) / ops);
+        System.out.printf(ROW,
+                benchmark.getName(),
+                ops,
+                ops / seconds,
+                benchmark.bytes() / seconds / (1024 * 1024),
+                latency.percentile(0.50) / 1e3,
+                latency.percentile(0.99) / 1e3,
+                latency.percentile(0.999) / 1e3,
+                allocated,
+                ops == 0 ? 0.0 : (double) (endCallbacks - startCallbacks) / ops);
+    }
+
+    public static void main(final String[] args) throws Throwable {
+        final BenchmarkRunner runner = new BenchmarkRunner();
+        System.out.printf(HEADER, "benchmark", "ops", "ops/s", "MB/s", "p50 us", "p99 us", "p999 us", "alloc B/op", "upcalls/op");
+        for (final Benchmark benchmark : benchmarks()) {
+            if (selected(benchmark)) {
+                runner.run(benchmark);
+            }
+        }
+    }
+
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+package com.oracle.libuv.benchmark;
+
+import java.io.File;
+import java.nio.ByteBuffer;
+
+import com.oracle.libuv.Constants;
+import com.oracle.libuv.Files;
+import com.oracle.libuv.cb.FileReadCallback;
+import com.oracle.libuv.cb.FileWriteCallback;
+
+/**
+ * Sequential asynchronous reads or writes of a fixed buffer size, one at a
+ * time, cycling through a 64MB file. Reads are mostly served from the page
+ * cache, this measures the thread pool round trip more than the disk.
+ */
+final class FileBenchmark extends Benchmark {
+
+    private static final long FILE_SIZE = 64 * 1024 * 1024;
+    private static final int FILL_SIZE = 1024 * 1024;
+
+    private final boolean write;
+    private final int size;
+    private final String filename;
+    private final ByteBuffer buffer;
+    private Files files;
+    private int fd = -1;
+    private long position;
+    private long startedAt;
+    private boolean inFlight;
+
+    FileBenchmark(final boolean write, final int size) {
+        super((write ? "fs-write-" : "fs-read-") + (size >= 1024 * 1024 ? size / (1024 * 1024) + "m" : size / 1024 + "k"));
+        this.write = write;
+        this.size = size;
+        this.filename = (TMPDIR.endsWith(File.separator) ? TMPDIR : TMPDIR + File.separator) + "FileBenchmark.dat";
+        this.buffer = ByteBuffer.allocateDirect(size);
+    }
+
+    @Override
+    protected void start() throws Throwable {
+        files = factory.newFiles();
+        files.setReadCallback(new FileReadCallback() {
+            @Override
+            public void onRead(final Object context, final int bytesRead, final ByteBuffer data, final Exception error) throws Exception {
+                done(bytesRead, error);
+            }
+        });
+        files.setWriteCallback(new FileWriteCallback() {
+            @Override
+            public void onWrite(final Object context, final int bytesWritten, final Exception error) throws Exception {
+                done(bytesWritten, error);
+            }
+        });
+
+        fd = files.open(filename, Constants.O_RDWR | Constants.O_CREAT | Constants.O_TRUNC, Constants.S_IRWXU);
+        if (!write) {
+            final ByteBuffer fill = ByteBuffer.allocateDirect(FILL_SIZE);
+            for (long offset = 0; offset < FILE_SIZE; offset += FILL_SIZE) {
+                files.write(fd, fill, 0, FILL_SIZE, offset);
+            }
+        }
+        next();
+    }
+
+    @Override
+    protected void stop() throws Throwable {
+        // an operation still running on the thread pool closes the file when done
+        if (!inFlight) {
+            closeFile();
+        }
+    }
+
+    private void closeFile() {
+        if (fd >= 0) {
+            files.close(fd);
+            fd = -1;
+            files.unlink(filename);
+        }
+    }
+
+    private void done(final int bytes, final Exception error) throws Exception {
+        inFlight = false;
+        if (!running()) {
+            closeFile();
+            return;
+        }
+        if (error != null) {
+            throw error;
+        }
+        completed(bytes, startedAt);
+        position += size;
+        if (position + size > FILE_SIZE) {
+            position = 0;
+        }
+        next();
+    }
+
+    private void next() {
+        inFlight = true;
+        startedAt = System.nanoTime();
+        if (write) {
+            files.write(fd, buffer, 0, size, position, this);
+        } else {
+            files.read(fd, buffer, 0, size, position, this);
+        }
+    }
+
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+package com.oracle.libuv.benchmark;
+
+import java.util.Arrays;
+
+/**
+ * Fixed size log-linear latency histogram, values within 1/32 of their
+ * magnitude share a bucket. Recording never allocates, so it can sit on
+ * the measured path of a benchmark.
+ */
+final class Histogram {
+
+    private static final int SUB_BITS = 5;
+    private static final int SUB = 1 << SUB_BITS;
+    private static final int BUCKETS = SUB + (64 - SUB_BITS) * SUB;
+
+    private final long[] counts = new long[BUCKETS];
+    private long total;
+    private long max;
+
+    void record(final long value) {
+        final long v = value < 0 ? 0 : value;
+        counts[index(v)]++;
+        total++;
+        if (v > max) {
+            max = v;
+        }
+    }
+
+    long count() {
+        return total;
+    }
+
+    long max() {
+        return max;
+    }
+
+    /**
+     * Smallest bucket bound at or below which {@code fraction} of the
+     * recorded values fall, or 0 if nothing was recorded.
+     */
+    long percentile(final double fraction) {
+        if (total == 0) {
+            return 0;
+        }
+        final long rank = Math.max(1, (long) Math.ceil(fraction * total));
+        long seen = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return Math.min(upper(i), max);
+            }
+        }
+        return max;
+    }
+
+    void reset() {
+        Arrays.fill(counts, 0);
+        total = 0;
+        max = 0;
+    }
+
+    private static int index(final long v) {
+        if (v < SUB) {
+            return (int) v;
+        }
+        final int shift = 63 - Long.numberOfLeadingZeros(v) - SUB_BITS;
+        return SUB + shift * SUB + (int) ((v >>> shift) & (SUB - 1));
+    }
+
+    private static long upper(final int index) {
+        if (index < SUB) {
+            return index;
+        }
+        final int shift = (index - SUB) / SUB;
+        final long sub = (index - SUB) % SUB;
+        return ((SUB + sub + 1) << shift) - 1;
+    }
+
+}
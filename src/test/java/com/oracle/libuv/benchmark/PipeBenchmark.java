@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+package com.oracle.libuv.benchmark;
+
+import java.nio.ByteBuffer;
+
+import com.oracle.libuv.cb.StreamWriteCallback;
+
+/**
+ * One way throughput of 64KB writes over a pipe, with at most four writes
+ * queued at a time.
+ */
+final class PipeBenchmark extends StreamBenchmark {
+
+    private static final int CHUNK_SIZE = 64 * 1024;
+    private static final int MAX_QUEUED = 4;
+
+    private final ByteBuffer chunk = ByteBuffer.allocateDirect(CHUNK_SIZE);
+    private int queued;
+
+    PipeBenchmark() {
+        super("pipe", "libuv-java-benchmark.sock", false);
+    }
+
+    @Override
+    protected void connected() throws Exception {
+        client.setWriteCallback(new StreamWriteCallback() {
+            @Override
+            public void onWrite(final int status, final Exception error) throws Exception {
+                queued--;
+                if (error != null && running()) {
+                    throw error;
+                }
+                fill();
+            }
+        });
+        fill();
+    }
+
+    @Override
+    protected void peerRead(final int length) throws Exception {
+        completed(length);
+    }
+
+    private void fill() {
+        while (running() && queued < MAX_QUEUED) {
+            client.write(chunk);
+            queued++;
+        }
+    }
+
+}
@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+package com.oracle.libuv.benchmark;
+
+import java.io.File;
+import java.nio.ByteBuffer;
+
+import com.oracle.libuv.cb.StreamConnectCallback;
+import com.oracle.libuv.cb.StreamConnectionCallback;
+import com.oracle.libuv.cb.StreamReadCallback;
+import com.oracle.libuv.handles.PipeHandle;
+import com.oracle.libuv.handles.StreamHandle;
+import com.oracle.libuv.handles.TCPHandle;
+
+/**
+ * Connects a client to a peer over TCP or a pipe. Both ends read into
+ * pooled buffers, the peer either echoes what it reads or discards it.
+ */
+abstract class StreamBenchmark extends Benchmark {
+
+    private static final int REPLY_SIZE = 64 * 1024;
+
+    private final boolean pipe;
+    private final int port;
+    private final boolean echo;
+    private final String pipeName;
+    private final ByteBuffer reply = ByteBuffer.allocateDirect(REPLY_SIZE);
+
+    private StreamHandle server;
+    private StreamHandle peer;
+    protected StreamHandle client;
+
+    protected StreamBenchmark(final String name, final int port, final boolean echo) {
+        super(name);
+        this.pipe = false;
+        this.port = port;
+        this.echo = echo;
+        this.pipeName = null;
+    }
+
+    protected StreamBenchmark(final String name, final String pipeName, final boolean echo) {
+        super(name);
+        this.pipe = true;
+        this.port = 0;
+        this.echo = echo;
+        this.pipeName = IS_WINDOWS ?
+                "\\\\.\\pipe\\" + pipeName :
+                (TMPDIR.endsWith(File.separator) ? TMPDIR : TMPDIR + File.separator) + pipeName;
+    }
+
+    /**
+     * Called once the client is connected and reading.
+     */
+    protected abstract void connected() throws Exception;
+
+    /**
+     * Called with the number of bytes the client read.
+     */
+    protected void clientRead(final int length) throws Exception {
+    }
+
+    /**
+     * Called with the number of bytes a discarding peer read.
+     */
+    protected void peerRead(final int length) throws Exception {
+    }
+
+    @Override
+    protected void start() throws Throwable {
+        server = newHandle();
+        client = newHandle();
+
+        server.setConnectionCallback(new StreamConnectionCallback() {
+            @Override
+            public void onConnection(final int status, final Exception error) throws Exception {
+                if (error != null) {
+                    throw error;
+                }
+                peer = newHandle();
+                server.accept(peer);
+                peer.setReadBufferPooling(true);
+                peer.setReadCallback(new StreamReadCallback() {
+                    @Override
+                    public void onRead(final ByteBuffer data) throws Exception {
+                        if (data == null) {
+                            peer.close();
+                            return;
+                        }
+                        final int length = data.remaining();
+                        peer.recycle(data);
+                        if (echo) {
+                            for (int left = length; left > 0; left -= REPLY_SIZE) {
+                                peer.write(reply, 0, Math.min(left, REPLY_SIZE));
+                            }
+                        } else {
+                            peerRead(length);
+                        }
+                    }
+                });
+                peer.readStart();
+            }
+        });
+
+        client.setConnectCallback(new StreamConnectCallback() {
+            @Override
+            public void onConnect(final int status, final Exception error) throws Exception {
+                if (error != null) {
+                    throw error;
+                }
+                client.setReadBufferPooling(true);
+                client.setReadCallback(new StreamReadCallback() {
+                    @Override
+                    public void onRead(final ByteBuffer data) throws Exception {
+                        if (data == null) {
+                            return;
+                        }
+                        final int length = data.remaining();
+                        client.recycle(data);
+                        clientRead(length);
+                    }
+                });
+                client.readStart();
+                connected();
+            }
+        });
+
+        if (pipe) {
+            if (!IS_WINDOWS) {
+                new File(pipeName).delete();
+            }
+            ((PipeHandle) server).bind(pipeName);
+            server.listen(1);
+            ((PipeHandle) client).connect(pipeName);
+        } else {
+            ((TCPHandle) server).bind(ADDRESS, port);
+            server.listen(1);
+            ((TCPHandle) client).connect(ADDRESS, port);
+        }
+    }
+
+    @Override
+    protected void stop() throws Throwable {
+        client.close();
+        if (peer != null) {
+            peer.close();
+            peer = null;
+        }
+        server.close();
+    }
+
+    private StreamHandle newHandle() {
+        if (pipe) {
+            return factory.newPipeHandle(false);
+        }
+        final TCPHandle tcp = factory.newTCPHandle();
+        tcp.setNoDelay(true);
+        return tcp;
+    }
+
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+package com.oracle.libuv.benchmark;
+
+import java.nio.ByteBuffer;
+
+/**
+ * Throughput of 16KB messages echoed over loopback TCP, with up to 256KB
+ * written but not yet echoed back.
+ */
+final class TcpEchoBenchmark extends StreamBenchmark {
+
+    private static final int MESSAGE_SIZE = 16 * 1024;
+    private static final int WINDOW = 256 * 1024;
+
+    private final ByteBuffer message = ByteBuffer.allocateDirect(MESSAGE_SIZE);
+    private long sent;
+    private long received;
+    private int pending;
+
+    TcpEchoBenchmark() {
+        super("tcp-echo", 23470, true);
+    }
+
+    @Override
+    protected void connected() throws Exception {
+        fill();
+    }
+
+    @Override
+    protected void clientRead(final int length) throws Exception {
+        received += length;
+        pending += length;
+        while (pending >= MESSAGE_SIZE) {
+            pending -= MESSAGE_SIZE;
+            completed(MESSAGE_SIZE);
+        }
+        fill();
+    }
+
+    private void fill() {
+        while (running() && sent - received < WINDOW) {
+            client.write(message);
+            sent += MESSAGE_SIZE;
+        }
+    }
+
+}
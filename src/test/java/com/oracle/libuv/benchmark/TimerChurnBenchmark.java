@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+package com.oracle.libuv.benchmark;
+
+import com.oracle.libuv.cb.TimerCallback;
+import com.oracle.libuv.handles.TimerHandle;
+
+/**
+ * 1024 one shot timers with timeouts of 1 to 8ms, each restarted when it
+ * fires. Every fire also reschedules another timer before it is due, the
+ * way request timeouts are pushed back on activity.
+ */
+final class TimerChurnBenchmark extends Benchmark {
+
+    private static final int TIMERS = 1024;
+    private static final int MAX_TIMEOUT = 8;
+
+    private final TimerHandle[] timers = new TimerHandle[TIMERS];
+    private long seed = 0x9E3779B97F4A7C15L;
+
+    TimerChurnBenchmark() {
+        super("timer-churn");
+    }
+
+    @Override
+    protected void start() throws Throwable {
+        for (int i = 0; i < TIMERS; i++) {
+            final TimerHandle timer = factory.newTimerHandle();
+            timer.setTimerFiredCallback(new TimerCallback() {
+                @Override
+                public void onTimer(final int status) throws Exception {
+                    completed(0);
+                    if (running()) {
+                        final TimerHandle victim = timers[(int) (next() & (TIMERS - 1))];
+                        victim.stop();
+                        victim.start(timeout(), 0);
+                        if (victim != timer) {
+                            timer.start(timeout(), 0);
+                        }
+                    }
+                }
+            });
+            timers[i] = timer;
+            timer.start(timeout(), 0);
+        }
+    }
+
+    @Override
+    protected void stop() throws Throwable {
+        for (final TimerHandle timer : timers) {
+            timer.close();
+        }
+    }
+
+    private long timeout() {
+        return 1 + (next() & (MAX_TIMEOUT - 1));
+    }
+
+    private long next() {
+        // xorshift, keeps the random choices off the allocation count
+        seed ^= seed << 13;
+        seed ^= seed >>> 7;
+        seed ^= seed << 17;
+        return seed >>> 1;
+    }
+
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+package com.oracle.libuv.benchmark;
+
+import java.nio.ByteBuffer;
+
+import com.oracle.libuv.Address;
+import com.oracle.libuv.cb.UDPRecvRingCallback;
+import com.oracle.libuv.cb.UDPSendCallback;
+import com.oracle.libuv.handles.UDPHandle;
+
+/**
+ * Datagrams received per second over loopback, the sender keeps up to 64
+ * sends in flight. Datagrams dropped by the kernel are not counted.
+ */
+final class UdpBenchmark extends Benchmark {
+
+    private static final int PORT = 23472;
+    private static final int DATAGRAM_SIZE = 512;
+    private static final int MAX_IN_FLIGHT = 64;
+    private static final int SLOTS = 256;
+    private static final int SLOT_SIZE = 2048;
+
+    private final ByteBuffer datagram = ByteBuffer.allocateDirect(DATAGRAM_SIZE);
+    private UDPHandle receiver;
+    private UDPHandle sender;
+    private int inFlight;
+
+    UdpBenchmark() {
+        super("udp");
+    }
+
+    @Override
+    protected void start() throws Throwable {
+        receiver = factory.newUDPHandle();
+        sender = factory.newUDPHandle();
+
+        receiver.setRecvRingCallback(new UDPRecvRingCallback() {
+            @Override
+            public void onRecv(final int nread, final ByteBuffer ring, final int offset, final Address address) throws Exception {
+                if (nread > 0) {
+                    completed(nread);
+                }
+            }
+        });
+        sender.setSendCallback(new UDPSendCallback() {
+            @Override
+            public void onSend(final int status, final Exception error) throws Exception {
+                inFlight--;
+                if (error != null && running()) {
+                    throw error;
+                }
+                fill();
+            }
+        });
+
+        receiver.bind(PORT, ADDRESS);
+        receiver.recvStart(SLOTS, SLOT_SIZE);
+        fill();
+    }
+
+    @Override
+    protected void stop() throws Throwable {
+        sender.close();
+        receiver.close();
+    }
+
+    private void fill() {
+        while (running() && inFlight < MAX_IN_FLIGHT) {
+            sender.send(datagram, PORT, ADDRESS);
+            inFlight++;
+        }
+    }
+
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+package com.oracle.libuv.benchmark;
+
+import java.nio.ByteBuffer;
+
+import com.oracle.libuv.cb.StreamWriteCallback;
+
+/**
+ * Sends 16 small direct buffers over loopback TCP per operation, either as
+ * 16 separate writes or as one vectored write.
+ */
+final class WriteBenchmark extends StreamBenchmark {
+
+    private static final int BUFFERS = 16;
+    private static final int BUFFER_SIZE = 256;
+    private static final int MAX_QUEUED = 8;
+
+    private final boolean vectored;
+    private final ByteBuffer[] buffers = new ByteBuffer[BUFFERS];
+    private final long[] startedAt = new long[MAX_QUEUED];
+    private int head;
+    private int queued;
+    private int written;
+
+    WriteBenchmark(final boolean vectored) {
+        super(vectored ? "tcp-writev" : "tcp-write", vectored ? 23474 : 23473, false);
+        this.vectored = vectored;
+        for (int i = 0; i < BUFFERS; i++) {
+            buffers[i] = ByteBuffer.allocateDirect(BUFFER_SIZE);
+        }
+    }
+
+    @Override
+    protected void connected() throws Exception {
+        client.setWriteCallback(new StreamWriteCallback() {
+            @Override
+            public void onWrite(final int status, final Exception error) throws Exception {
+                if (error != null) {
+                    if (running()) {
+                        throw error;
+                    }
+                    return;
+                }
+                if (vectored || ++written == BUFFERS) {
+                    written = 0;
+                    queued--;
+                    completed(BUFFERS * BUFFER_SIZE, startedAt[(head - queued - 1) & (MAX_QUEUED - 1)]);
+                    fill();
+                }
+            }
+        });
+        fill();
+    }
+
+    private void fill() {
+        while (running() && queued < MAX_QUEUED) {
+            startedAt[head] = System.nanoTime();
+            head = (head + 1) & (MAX_QUEUED - 1);
+            queued++;
+            if (vectored) {
+                client.write(buffers);
+            } else {
+                for (final ByteBuffer buffer : buffers) {
+                    client.write(buffer);
+                }
+            }
+        }
+    }
+
+}
@@ -25,6 +25,7 @@
 
 package com.oracle.libuv.handles;
 
+import java.nio.ByteBuffer;
 import java.util.concurrent.ScheduledExecutorService;
 import java.util.concurrent.ScheduledThreadPoolExecutor;
 import java.util.concurrent.TimeUnit;
@@ -36,6 +37,7 @@ import org.testng.annotations.Test;
 
 import com.oracle.libuv.TestBase;
 import com.oracle.libuv.cb.AsyncCallback;
+import com.oracle.libuv.cb.AsyncQueueCallback;
 
 import static com.oracle.libuv.handles.DefaultHandleFactory.newFactory;
 
@@ -146,10 +148,83 @@ public class AsyncHandleTest extends TestBase {
         }
     }
 
+    @Test
+    public void testQueue() throws Throwable {
+        final int PRODUCERS = 4;
+        final int TIMES = 1000;
+        final AtomicInteger received = new AtomicInteger(0);
+        final AtomicInteger drains = new AtomicInteger(0);
+        final AtomicInteger mismatches = new AtomicInteger(0);
+
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final AsyncHandle asyncHandle = handleFactory.newAsyncHandle();
+        asyncHandle.enableQueue(64, 8);
+
+        asyncHandle.setQueueCallback(new AsyncQueueCallback() {
+            @Override
+            public void onDrain(final int count, final long[] values, final int[] offsets,
+                                final int[] lengths, final ByteBuffer payload) throws Exception {
+                drains.incrementAndGet();
+                for (int i = 0; i < count; i++) {
+                    if (lengths[i] != 8 || payload.getLong(offsets[i]) != values[i]) {
+                        mismatches.incrementAndGet();
+                    }
+                }
+                if (received.addAndGet(count) == PRODUCERS * TIMES) {
+                    asyncHandle.close();
+                }
+            }
+        });
+
+        final Thread[] producers = new Thread[PRODUCERS];
+        for (int p = 0; p < PRODUCERS; p++) {
+            final long id = p;
+            producers[p] = new Thread() {
+                @Override
+                public void run() {
+                    final ByteBuffer slice = ByteBuffer.allocateDirect(8);
+                    for (int i = 0; i < TIMES; i++) {
+                        final long value = (id << 32) | i;
+                        slice.putLong(0, value);
+                        while (!asyncHandle.offer(value, slice)) {
+                            Thread.yield();
+                        }
+                    }
+                }
+            };
+            producers[p].start();
+        }
+
+        loop.run();
+        for (final Thread producer : producers) {
+            producer.join();
+        }
+
+        Assert.assertEquals(received.get(), PRODUCERS * TIMES);
+        Assert.assertEquals(mismatches.get(), 0);
+        Assert.assertTrue(drains.get() <= received.get());
+    }
+
+    @Test
+    public void testQueueTooLarge() throws Throwable {
+        final HandleFactory handleFactory = newFactory();
+        final AsyncHandle asyncHandle = handleFactory.newAsyncHandle();
+        try {
+            // 2^20 slots of 2048 bytes are one byte too many for a ByteBuffer
+            asyncHandle.enableQueue(1 << 20, 2048);
+            Assert.fail("expected IllegalArgumentException");
+        } catch (final IllegalArgumentException expected) {
+        }
+        asyncHandle.close();
+    }
+
     public static void main(final String[] args) throws Throwable {
         final AsyncHandleTest test = new AsyncHandleTest();
         test.testAsync();
         test.testAsyncMulti();
+        test.testQueue();
+        test.testQueueTooLarge();
     }
 
 }
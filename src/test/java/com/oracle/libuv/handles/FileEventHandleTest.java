@@ -37,6 +37,7 @@ import org.testng.annotations.Test;
 import com.oracle.libuv.Constants;
 import com.oracle.libuv.Files;
 import com.oracle.libuv.TestBase;
+import com.oracle.libuv.cb.FileEventBatchCallback;
 import com.oracle.libuv.cb.FileEventCallback;
 
 import static com.oracle.libuv.handles.DefaultHandleFactory.newFactory;
@@ -164,12 +165,76 @@ public class FileEventHandleTest extends TestBase {
         Assert.assertEquals(times.get(), 1);
     }
 
+    @Test
+    public void testCoalescedEvents() throws Throwable {
+        if (shouldSkip()) return;
+
+        final AtomicBoolean gotClose = new AtomicBoolean(false);
+        final AtomicInteger batches = new AtomicInteger(0);
+        final AtomicInteger singles = new AtomicInteger(0);
+        final AtomicInteger seen = new AtomicInteger(0);
+
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final Files handle = handleFactory.newFiles();
+        final FileEventHandle eventHandle = new FileEventHandle(loop);
+
+        eventHandle.setCloseCallback(new FileEventCallback() {
+            @Override
+            public void onEvent(final int status, final String event, final String filename) throws Exception {
+                handle.unlink(testName);
+                gotClose.set(true);
+            }
+        });
+
+        eventHandle.setFileEventCallback(new FileEventCallback() {
+            @Override
+            public void onEvent(final int status, final String event, final String filename) throws Exception {
+                singles.incrementAndGet();
+            }
+        });
+
+        eventHandle.setFileEventBatchCallback(new FileEventBatchCallback() {
+            @Override
+            public void onEvents(final int count, final String[] filenames, final int[] events) throws Exception {
+                // every write lands in the same window, so one entry carries them all
+                Assert.assertEquals(count, 1);
+                Assert.assertTrue(testName.endsWith(filenames[0]));
+                Assert.assertTrue((events[0] & FileEventHandle.CHANGE) != 0);
+                seen.set(events[0]);
+                batches.incrementAndGet();
+                eventHandle.close();
+            }
+        });
+
+        final int fd = handle.open(testName, Constants.O_WRONLY | Constants.O_CREAT, Constants.S_IRWXU);
+        eventHandle.setCoalescing(500, 16);
+        eventHandle.start(testName, true);
+        for (int i = 1; i <= 10; i++) {
+            handle.ftruncate(fd, i * 100);
+        }
+
+        final long start = System.currentTimeMillis();
+        while (!gotClose.get()) {
+            if (System.currentTimeMillis() - start > TestBase.TIMEOUT) {
+                Assert.fail("timeout waiting for coalesced file events");
+            }
+            loop.runNoWait();
+        }
+
+        Assert.assertEquals(batches.get(), 1);
+        Assert.assertEquals(singles.get(), 0);
+        Assert.assertTrue((seen.get() & FileEventHandle.CHANGE) != 0);
+    }
+
     public static void main(final String[] args) throws Throwable {
         final FileEventHandleTest test = new FileEventHandleTest();
         test.startSession(test.getClass().getMethod("testFileChangeEvent"));
         test.testFileChangeEvent();
         test.startSession(test.getClass().getMethod("testFileRenameEvent"));
         test.testFileRenameEvent();
+        test.startSession(test.getClass().getMethod("testCoalescedEvents"));
+        test.testCoalescedEvents();
     }
 
 }
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+package com.oracle.libuv.handles;
+
+import java.io.File;
+import java.lang.reflect.Method;
+import java.util.HashMap;
+import java.util.Map;
+import java.util.concurrent.atomic.AtomicBoolean;
+import java.util.concurrent.atomic.AtomicInteger;
+
+import org.testng.Assert;
+import org.testng.annotations.BeforeMethod;
+import org.testng.annotations.Test;
+
+import com.oracle.libuv.Constants;
+import com.oracle.libuv.Files;
+import com.oracle.libuv.TestBase;
+import com.oracle.libuv.cb.FilePollGroupCallback;
+
+import static com.oracle.libuv.handles.DefaultHandleFactory.newFactory;
+
+public class FilePollGroupTest extends TestBase {
+
+    private String testName;
+
+    @BeforeMethod
+    public void startSession(final Method method) throws Exception {
+        testName = (TestBase.TMPDIR.endsWith(File.separator) ? TestBase.TMPDIR : TestBase.TMPDIR + File.separator) + method.getName();
+    }
+
+    @Test
+    public void testChanges() throws Throwable {
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final Files files = handleFactory.newFiles();
+
+        final String unchanged = testName + "-unchanged";
+        final String truncated = testName + "-truncated";
+        final String deleted = testName + "-deleted";
+        final String missing = testName + "-missing";
+        for (final String path : new String[] {unchanged, truncated, deleted}) {
+            final int fd = files.open(path, Constants.O_WRONLY | Constants.O_CREAT, Constants.S_IRWXU);
+            files.close(fd);
+        }
+
+        // two paths per thread pool job, so a round takes several jobs
+        final FilePollGroup group = handleFactory.newFilePollGroup(10, 2);
+        final Map<String, Integer> changes = new HashMap<>();
+        final AtomicInteger rounds = new AtomicInteger(0);
+        final AtomicBoolean done = new AtomicBoolean(false);
+        group.setChangesCallback(new FilePollGroupCallback() {
+            @Override
+            public void onChanges(final int count, final String[] paths, final int[] statuses) throws Exception {
+                for (int i = 0; i < count; i++) {
+                    Assert.assertNotNull(paths[i]);
+                    changes.put(paths[i], statuses[i]);
+                }
+                if (rounds.incrementAndGet() == 1) {
+                    // only the failed first stat is reported
+                    Assert.assertEquals(changes.size(), 1);
+                    Assert.assertTrue(changes.get(missing) != 0);
+                    changes.clear();
+                    final int fd = files.open(truncated, Constants.O_WRONLY, Constants.S_IRWXU);
+                    files.ftruncate(fd, 1000);
+                    files.close(fd);
+                    files.unlink(deleted);
+                } else if (changes.containsKey(truncated) && changes.containsKey(deleted)) {
+                    group.close();
+                    done.set(true);
+                }
+            }
+        });
+        final int id = group.add(unchanged);
+        Assert.assertEquals(group.add(unchanged), id);
+        Assert.assertEquals(group.getPath(id), unchanged);
+        group.add(truncated);
+        group.add(deleted);
+        group.add(missing);
+        Assert.assertEquals(group.size(), 4);
+        group.start();
+
+        final long start = System.currentTimeMillis();
+        while (!done.get()) {
+            if (System.currentTimeMillis() - start > TIMEOUT) {
+                Assert.fail("timeout waiting for file poll group");
+            }
+            loop.runNoWait();
+        }
+
+        Assert.assertFalse(changes.containsKey(unchanged));
+        Assert.assertFalse(changes.containsKey(missing));
+        Assert.assertEquals(changes.get(truncated).intValue(), 0);
+        Assert.assertTrue(changes.get(deleted) != 0);
+        files.unlink(unchanged);
+        files.unlink(truncated);
+    }
+
+    public static void main(final String[] args) throws Throwable {
+        final FilePollGroupTest test = new FilePollGroupTest();
+        test.testChanges();
+    }
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+package com.oracle.libuv.handles;
+
+import java.util.concurrent.CountDownLatch;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicInteger;
+
+import org.testng.Assert;
+import org.testng.annotations.Test;
+
+import com.oracle.libuv.TestBase;
+import com.oracle.libuv.cb.StreamConnectCallback;
+
+import static com.oracle.libuv.handles.DefaultHandleFactory.newFactory;
+
+public class LoopGroupTest extends TestBase {
+
+    private static final String ADDRESS = "127.0.0.1";
+    private static final int PORT = 23461;
+    private static final int LOOPS = 2;
+    private static final int TIMES = 8;
+
+    @Test
+    public void testExecute() throws Throwable {
+        final LoopGroup group = new LoopGroup(LOOPS);
+        final CountDownLatch latch = new CountDownLatch(LOOPS * TIMES);
+        final AtomicInteger misplaced = new AtomicInteger(0);
+        Assert.assertEquals(group.current(), -1);
+
+        for (int i = 0; i < LOOPS * TIMES; i++) {
+            final int index = i % LOOPS;
+            group.execute(index, new Runnable() {
+                @Override
+                public void run() {
+                    if (group.current() != index) {
+                        misplaced.incrementAndGet();
+                    }
+                    latch.countDown();
+                }
+            });
+        }
+
+        Assert.assertTrue(latch.await(TIMEOUT, TimeUnit.MILLISECONDS));
+        Assert.assertEquals(misplaced.get(), 0);
+        group.close();
+        Assert.assertNull(group.takePendingException());
+
+        try {
+            group.execute(0, new Runnable() {
+                @Override
+                public void run() {
+                }
+            });
+            Assert.fail("closed group accepted a task");
+        } catch (final IllegalStateException expected) {
+        }
+    }
+
+    @Test
+    public void testListen() throws Throwable {
+        if (IS_WINDOWS) {
+            return; // no SO_REUSEPORT
+        }
+        final LoopGroup group = new LoopGroup(LOOPS);
+        final AtomicInteger accepted = new AtomicInteger(0);
+        final AtomicInteger connected = new AtomicInteger(0);
+
+        group.listen(ADDRESS, PORT, 16, new LoopGroup.ConnectionHandler() {
+            @Override
+            public void onConnection(final HandleFactory factory, final TCPHandle server,
+                                     final int status, final Exception error) throws Exception {
+                final TCPHandle peer = factory.newTCPHandle();
+                server.accept(peer);
+                accepted.incrementAndGet();
+                peer.close();
+            }
+        });
+
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        for (int i = 0; i < TIMES; i++) {
+            final TCPHandle client = handleFactory.newTCPHandle();
+            client.setConnectCallback(new StreamConnectCallback() {
+                @Override
+                public void onConnect(final int status, final Exception error) throws Exception {
+                    connected.incrementAndGet();
+                    client.close();
+                }
+            });
+            client.connect(ADDRESS, PORT);
+        }
+
+        final long start = System.currentTimeMillis();
+        while (connected.get() < TIMES || accepted.get() < TIMES) {
+            if (System.currentTimeMillis() - start > TIMEOUT) {
+                Assert.fail("timeout waiting for connections");
+            }
+            loop.runNoWait();
+        }
+
+        group.close();
+        Assert.assertNull(group.takePendingException());
+        Assert.assertEquals(accepted.get(), TIMES);
+    }
+
+    public static void main(final String[] args) throws Throwable {
+        final LoopGroupTest test = new LoopGroupTest();
+        test.testExecute();
+        test.testListen();
+    }
+}
@@ -25,19 +25,38 @@
 
 package com.oracle.libuv.handles;
 
+import java.nio.ByteBuffer;
+import java.nio.file.FileSystems;
+import java.nio.file.Files;
+import java.util.ArrayList;
 import java.util.HashSet;
+import java.util.List;
 import java.util.Set;
+import java.util.concurrent.atomic.AtomicInteger;
 
 import org.testng.Assert;
 import org.testng.annotations.Test;
 
+import com.oracle.libuv.Address;
 import com.oracle.libuv.TestBase;
+import com.oracle.libuv.cb.CallbackExceptionHandler;
+import com.oracle.libuv.cb.CallbackHandler;
+import com.oracle.libuv.cb.CallbackHandlerFactory;
+import com.oracle.libuv.cb.ContextProvider;
+import com.oracle.libuv.cb.StreamConnectCallback;
+import com.oracle.libuv.cb.StreamConnectionCallback;
+import com.oracle.libuv.cb.StreamReadCallback;
+import com.oracle.libuv.cb.StreamWriteCallback;
+import com.oracle.libuv.cb.TimerCallback;
+import com.oracle.libuv.cb.UDPRecvCallback;
 
 import static com.oracle.libuv.handles.DefaultHandleFactory.newFactory;
 
 public class LoopHandleTest extends TestBase {
 
     private static final String DOT_SPLIT_REGEX = "\\.";
+    private static final String HOST = "127.0.0.1";
+    private static final int CENSUS_PORT = 23468;
 
     @Test
     public void testList() throws Throwable {
@@ -84,9 +103,328 @@ public class LoopHandleTest extends TestBase {
         Assert.assertTrue(pointers.isEmpty());
     }
 
+    @Test
+    public void testFreeListStats() throws Throwable {
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final long[] stats = new long[LoopHandle.FREELIST_STATS_LENGTH];
+
+        for (final LoopHandle.RequestType type : LoopHandle.RequestType.values()) {
+            loop.getFreeListStats(type, stats);
+            Assert.assertEquals(stats[LoopHandle.FREELIST_IN_USE], 0);
+            Assert.assertEquals(stats[LoopHandle.FREELIST_CACHED], 0);
+            Assert.assertEquals(stats[LoopHandle.FREELIST_HIGH_WATER], 0);
+            Assert.assertTrue(stats[LoopHandle.FREELIST_LIMIT] > 0);
+        }
+
+        loop.setFreeListLimit(LoopHandle.RequestType.WRITE, 7);
+        loop.getFreeListStats(LoopHandle.RequestType.WRITE, stats);
+        Assert.assertEquals(stats[LoopHandle.FREELIST_LIMIT], 7);
+
+        try {
+            loop.setFreeListLimit(LoopHandle.RequestType.WRITE, -1);
+            Assert.fail("negative limit accepted");
+        } catch (final IllegalArgumentException expected) {
+        }
+    }
+
+    @Test
+    public void testMetrics() throws Throwable {
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final LoopMetrics metrics = new LoopMetrics();
+
+        loop.getMetrics(metrics);
+        Assert.assertFalse(metrics.isEnabled());
+        Assert.assertEquals(metrics.iterations(), 0);
+
+        loop.setMetricsEnabled(true);
+        // the phase handles are internal to the loop
+        Assert.assertEquals(loop.list().length, 0);
+
+        final AtomicInteger fired = new AtomicInteger(0);
+        final TimerHandle timer = handleFactory.newTimerHandle();
+        timer.setTimerFiredCallback(new TimerCallback() {
+            @Override
+            public void onTimer(final int status) throws Exception {
+                if (fired.incrementAndGet() == 3) {
+                    timer.close();
+                }
+            }
+        });
+        timer.start(10, 10);
+        loop.run();
+
+        loop.getMetrics(metrics);
+        Assert.assertTrue(metrics.isEnabled());
+        Assert.assertEquals(fired.get(), 3);
+        Assert.assertTrue(metrics.iterations() >= 3);
+        Assert.assertTrue(metrics.pollTime() > 0);
+        Assert.assertEquals(metrics.callbacks(LoopMetrics.HandleType.TIMER), 3);
+        Assert.assertTrue(metrics.callbacks() >= 3);
+        Assert.assertTrue(metrics.elapsedTime() >= metrics.pollTime());
+        long total = 0;
+        for (int i = 0; i < LoopMetrics.BUCKETS; i++) {
+            total += metrics.histogram(LoopMetrics.HandleType.TIMER, i);
+        }
+        Assert.assertEquals(total, 3);
+        Assert.assertTrue(metrics.percentile(LoopMetrics.HandleType.TIMER, 99) > 0);
+        for (final LoopHandle.RequestType type : LoopHandle.RequestType.values()) {
+            Assert.assertEquals(metrics.pendingRequests(type), 0);
+        }
+
+        loop.setMetricsEnabled(false);
+        loop.getMetrics(metrics);
+        Assert.assertFalse(metrics.isEnabled());
+        Assert.assertEquals(metrics.callbacks(), 0);
+    }
+
+    @Test
+    public void testFastDispatch() throws Throwable {
+        final LoopHandle defaultLoop = new LoopHandle();
+        Assert.assertTrue(defaultLoop.isFastDispatch());
+        Assert.assertNull(defaultLoop.getContext());
+        Assert.assertSame(defaultLoop.getCallbackHandler(), defaultLoop.getCallbackHandler("context"));
+
+        final CallbackExceptionHandler exceptionHandler = new CallbackExceptionHandler() {
+            @Override
+            public void handle(final Throwable ex) {
+                Assert.fail("unexpected exception", ex);
+            }
+        };
+        final AtomicInteger created = new AtomicInteger(0);
+        final CallbackHandler handler = new LoopCallbackHandler(exceptionHandler);
+        final LoopHandle loop = new LoopHandle(exceptionHandler, new CallbackHandlerFactory() {
+            @Override
+            public CallbackHandler newCallbackHandler(final Object context) {
+                created.incrementAndGet();
+                return handler;
+            }
+
+            @Override
+            public CallbackHandler newCallbackHandler() {
+                created.incrementAndGet();
+                return handler;
+            }
+        }, new ContextProvider() {
+            @Override
+            public Object getContext() {
+                return "context";
+            }
+        });
+        Assert.assertFalse(loop.isFastDispatch());
+        Assert.assertEquals(loop.getContext(), "context");
+
+        final AtomicInteger fired = new AtomicInteger(0);
+        final TimerHandle timer = new DefaultHandleFactory().initialize(loop).newTimerHandle();
+        timer.setTimerFiredCallback(new TimerCallback() {
+            @Override
+            public void onTimer(final int status) throws Exception {
+                fired.incrementAndGet();
+                timer.close();
+            }
+        });
+        timer.start(1, 0);
+        loop.run();
+
+        Assert.assertEquals(fired.get(), 1);
+        // custom factories are still asked for every callback
+        Assert.assertTrue(created.get() > 0);
+    }
+
+    @Test
+    public void testDirectDispatch() throws Throwable {
+        final String pipeName = "/tmp/libuv-java-loop-handle-test-pipe";
+        Files.deleteIfExists(FileSystems.getDefault().getPath(pipeName));
+
+        // reads and writes skip the handler, their exceptions still arrive here
+        final List<String> handled = new ArrayList<>();
+        final CallbackExceptionHandler exceptionHandler = new CallbackExceptionHandler() {
+            @Override
+            public void handle(final Throwable ex) {
+                handled.add(ex.getMessage());
+            }
+        };
+        final LoopHandle loop = new LoopHandle(exceptionHandler,
+                                               new LoopCallbackHandlerFactory(exceptionHandler),
+                                               null);
+        Assert.assertTrue(loop.isFastDispatch());
+        final HandleFactory handleFactory = new DefaultHandleFactory().initialize(loop);
+        final PipeHandle server = handleFactory.newPipeHandle(false);
+        final PipeHandle peer = handleFactory.newPipeHandle(false);
+        final PipeHandle client = handleFactory.newPipeHandle(false);
+
+        peer.setWriteCallback(new StreamWriteCallback() {
+            @Override
+            public void onWrite(final int status, final Exception error) throws Exception {
+                Assert.assertNull(error);
+                throw new Exception("write");
+            }
+        });
+        server.setConnectionCallback(new StreamConnectionCallback() {
+            @Override
+            public void onConnection(final int status, final Exception error) throws Exception {
+                server.accept(peer);
+                peer.write("PING");
+                server.close();
+            }
+        });
+        client.setConnectCallback(new StreamConnectCallback() {
+            @Override
+            public void onConnect(final int status, final Exception error) throws Exception {
+                client.readStart();
+            }
+        });
+        client.setReadCallback(new StreamReadCallback() {
+            @Override
+            public void onRead(final ByteBuffer data) throws Exception {
+                client.close();
+                peer.close();
+                throw new Exception("read");
+            }
+        });
+
+        server.bind(pipeName);
+        server.listen(0);
+        client.connect(pipeName);
+        loop.run();
+
+        Assert.assertTrue(handled.contains("write"));
+        Assert.assertTrue(handled.contains("read"));
+    }
+
+    @Test
+    public void testBusyPoll() throws Throwable {
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+
+        final AtomicInteger fired = new AtomicInteger(0);
+        final TimerHandle timer = handleFactory.newTimerHandle();
+        timer.setTimerFiredCallback(new TimerCallback() {
+            @Override
+            public void onTimer(final int status) throws Exception {
+                if (fired.incrementAndGet() == 5) {
+                    timer.close();
+                }
+            }
+        });
+        timer.start(1, 20);
+        // the timer interval exceeds the spin window, so the loop also blocks
+        Assert.assertFalse(loop.runBusyPoll(5000));
+        Assert.assertEquals(fired.get(), 5);
+
+        final TimerHandle stopper = handleFactory.newTimerHandle();
+        stopper.setTimerFiredCallback(new TimerCallback() {
+            @Override
+            public void onTimer(final int status) throws Exception {
+                loop.stop();
+            }
+        });
+        stopper.start(1, 0);
+        final TimerHandle keepAlive = handleFactory.newTimerHandle();
+        keepAlive.start(TIMEOUT, 0);
+        Assert.assertTrue(loop.runBusyPoll(100));
+        keepAlive.close();
+        stopper.close();
+        loop.run();
+
+        final TimerHandle failing = handleFactory.newTimerHandle();
+        failing.setTimerFiredCallback(new TimerCallback() {
+            @Override
+            public void onTimer(final int status) throws Exception {
+                throw new IllegalStateException("busy poll");
+            }
+        });
+        failing.start(1, 1);
+        try {
+            loop.runBusyPoll(100);
+            loop.runNoWait();
+            Assert.fail("expected the callback exception");
+        } catch (final IllegalStateException ex) {
+            Assert.assertEquals(ex.getMessage(), "busy poll");
+        }
+        failing.close();
+        loop.run();
+    }
+
+    @Test
+    public void testCensus() throws Throwable {
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final ByteBuffer census = ByteBuffer.allocateDirect(4 * LoopHandle.CENSUS_RECORD_SIZE);
+        Assert.assertEquals(loop.census(census), 0);
+
+        final TimerHandle timer = handleFactory.newTimerHandle();
+        final UDPHandle udp = handleFactory.newUDPHandle();
+        final AtomicInteger received = new AtomicInteger(0);
+        udp.setRecvCallback(new UDPRecvCallback() {
+            @Override
+            public void onRecv(final int nread, final ByteBuffer data, final Address address) throws Exception {
+                if (nread > 0) {
+                    received.addAndGet(nread);
+                }
+            }
+        });
+        udp.bind(CENSUS_PORT, HOST);
+        udp.recvStart();
+        udp.send(ByteBuffer.wrap("PING".getBytes()), CENSUS_PORT, HOST);
+
+        final long start = System.currentTimeMillis();
+        while (received.get() < 4) {
+            if (System.currentTimeMillis() - start > TIMEOUT) {
+                Assert.fail("timeout waiting for the datagram");
+            }
+            loop.runNoWait();
+        }
+
+        Assert.assertEquals(loop.census(census), 2);
+        boolean sawTimer = false;
+        boolean sawUdp = false;
+        for (int i = 0; i < 2; i++) {
+            final int record = i * LoopHandle.CENSUS_RECORD_SIZE;
+            final long type = census.getLong(record + LoopHandle.CENSUS_TYPE);
+            final long flags = census.getLong(record + LoopHandle.CENSUS_FLAGS);
+            Assert.assertTrue((flags & LoopHandle.CENSUS_REFED) != 0);
+            Assert.assertEquals(flags & LoopHandle.CENSUS_CLOSING, 0);
+            if (type == LoopMetrics.HandleType.TIMER.ordinal()) {
+                sawTimer = true;
+                Assert.assertEquals(census.getLong(record + LoopHandle.CENSUS_POINTER), timer.pointer);
+                Assert.assertEquals(flags & (LoopHandle.CENSUS_ACTIVE | LoopHandle.CENSUS_COUNTED), 0);
+                Assert.assertEquals(census.getLong(record + LoopHandle.CENSUS_IDLE_TIME), -1);
+            } else {
+                Assert.assertEquals(type, LoopMetrics.HandleType.UDP.ordinal());
+                sawUdp = true;
+                Assert.assertEquals(census.getLong(record + LoopHandle.CENSUS_POINTER), udp.pointer);
+                Assert.assertTrue((flags & LoopHandle.CENSUS_ACTIVE) != 0);
+                Assert.assertTrue((flags & LoopHandle.CENSUS_COUNTED) != 0);
+                Assert.assertEquals(census.getLong(record + LoopHandle.CENSUS_BYTES_READ), 4);
+                Assert.assertEquals(census.getLong(record + LoopHandle.CENSUS_READS), 1);
+                Assert.assertEquals(census.getLong(record + LoopHandle.CENSUS_BYTES_WRITTEN), 4);
+                Assert.assertEquals(census.getLong(record + LoopHandle.CENSUS_WRITES), 1);
+                Assert.assertTrue(census.getLong(record + LoopHandle.CENSUS_IDLE_TIME) >= 0);
+            }
+        }
+        Assert.assertTrue(sawTimer);
+        Assert.assertTrue(sawUdp);
+
+        // handles beyond the buffer are counted but not written
+        final ByteBuffer small = ByteBuffer.allocateDirect(LoopHandle.CENSUS_RECORD_SIZE);
+        Assert.assertEquals(loop.census(small), 2);
+
+        timer.close();
+        udp.close();
+        loop.run();
+    }
+
     public static void main(final String[] args) throws Throwable {
         final LoopHandleTest test = new LoopHandleTest();
         test.testList();
+        test.testFreeListStats();
+        test.testMetrics();
+        test.testFastDispatch();
+        test.testDirectDispatch();
+        test.testBusyPoll();
+        test.testCensus();
     }
 
 }
@@ -30,6 +30,7 @@ import java.nio.file.FileSystems;
 import java.nio.file.Files;
 import java.util.EnumSet;
 import java.util.concurrent.atomic.AtomicBoolean;
+import java.util.concurrent.atomic.AtomicInteger;
 
 import org.testng.Assert;
 import org.testng.annotations.Test;
@@ -40,6 +41,7 @@ import com.oracle.libuv.TestBase;
 import com.oracle.libuv.cb.StreamConnectCallback;
 import com.oracle.libuv.cb.StreamConnectionCallback;
 import com.oracle.libuv.cb.StreamReadCallback;
+import com.oracle.libuv.cb.StreamWriteCallback;
 
 import static com.oracle.libuv.handles.DefaultHandleFactory.newFactory;
 
@@ -133,8 +135,113 @@ public class ProcessHandleTest extends TestBase {
         }
     }
 
+    @Test
+    public void testSpawnTemplate() throws Throwable {
+        if (OS.startsWith("Windows")) return;
+
+        final AtomicInteger exits = new AtomicInteger(0);
+        final AtomicInteger statusSum = new AtomicInteger(0);
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+
+        final StdioOptions[] stdio = new StdioOptions[3];
+        stdio[0] = new StdioOptions(StdioOptions.StdioType.IGNORE, null, -1);
+        stdio[1] = new StdioOptions(StdioOptions.StdioType.INHERIT_FD, null, 1);
+        stdio[2] = new StdioOptions(StdioOptions.StdioType.INHERIT_FD, null, 2);
+
+        // the appended argument becomes $0 and the exit status
+        try (final SpawnTemplate template = new SpawnTemplate(new String[] {"/bin/sh", "-c", "exit $0"},
+                new String[] {"PATH=/bin:/usr/bin"}, ".",
+                EnumSet.noneOf(ProcessHandle.ProcessFlags.class), stdio, -1, -1)) {
+            for (int i = 1; i <= 3; i++) {
+                final ProcessHandle process = handleFactory.newProcessHandle();
+                process.setExitCallback(new ProcessExitCallback() {
+                    @Override
+                    public void onExit(final int status, final int signal, final Exception error) throws Exception {
+                        statusSum.addAndGet(status);
+                        exits.incrementAndGet();
+                        process.close();
+                    }
+                });
+                Assert.assertTrue(process.spawn(template, new String[] {Integer.toString(i)}, null) > 0);
+            }
+
+            while (exits.get() < 3) {
+                loop.run();
+            }
+        }
+
+        Assert.assertEquals(statusSum.get(), 1 + 2 + 3);
+    }
+
+    @Test
+    public void testProcessPool() throws Throwable {
+        if (OS.startsWith("Windows")) return;
+
+        final StringBuilder echoed = new StringBuilder();
+        final AtomicBoolean exited = new AtomicBoolean(false);
+        final AtomicBoolean eof = new AtomicBoolean(false);
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+
+        final StdioOptions[] stdio = new StdioOptions[3];
+        stdio[0] = new StdioOptions(StdioOptions.StdioType.CREATE_PIPE, null, -1);
+        stdio[1] = new StdioOptions(StdioOptions.StdioType.CREATE_PIPE, null, -1);
+        stdio[2] = new StdioOptions(StdioOptions.StdioType.INHERIT_FD, null, 2);
+        final SpawnTemplate template = new SpawnTemplate(new String[] {"/bin/cat"}, null, null,
+                EnumSet.noneOf(ProcessHandle.ProcessFlags.class), stdio, -1, -1);
+
+        final ProcessPool pool = new ProcessPool(handleFactory, template, 2);
+        Assert.assertEquals(pool.idleCount(), 2);
+
+        final ProcessPool.Worker worker = pool.acquire();
+        Assert.assertEquals(pool.idleCount(), 1);
+
+        worker.process().setExitCallback(new ProcessExitCallback() {
+            @Override
+            public void onExit(final int status, final int signal, final Exception error) throws Exception {
+                Assert.assertEquals(status, 0);
+                worker.process().close();
+                exited.set(true);
+                pool.close();
+            }
+        });
+        worker.stdout().setReadCallback(new StreamReadCallback() {
+            @Override
+            public void onRead(final ByteBuffer data) throws Exception {
+                if (data == null) {
+                    worker.stdout().close();
+                    eof.set(true);
+                    return;
+                }
+                final byte[] bytes = new byte[data.remaining()];
+                data.get(bytes);
+                echoed.append(new String(bytes, "US-ASCII"));
+            }
+        });
+        worker.stdin().setWriteCallback(new StreamWriteCallback() {
+            @Override
+            public void onWrite(final int status, final Exception error) throws Exception {
+                // cat exits on end of input
+                worker.stdin().close();
+            }
+        });
+        worker.stdout().readStart();
+        worker.stdin().write("ping");
+
+        while (!exited.get() || !eof.get()) {
+            loop.run();
+        }
+
+        Assert.assertEquals(echoed.toString(), "ping");
+        Assert.assertEquals(pool.idleCount(), 0);
+        template.close();
+    }
+
     public static void main(final String[] args) throws Throwable {
         final ProcessHandleTest test = new ProcessHandleTest();
         test.testExitCode();
+        test.testSpawnTemplate();
+        test.testProcessPool();
     }
 }
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+package com.oracle.libuv.handles;
+
+import java.util.concurrent.atomic.AtomicBoolean;
+import java.util.concurrent.atomic.AtomicInteger;
+
+import org.testng.Assert;
+import org.testng.annotations.Test;
+
+import com.oracle.libuv.TestBase;
+import com.oracle.libuv.cb.ResolveCallback;
+import com.oracle.libuv.cb.StreamCloseCallback;
+import com.oracle.libuv.cb.StreamConnectCallback;
+import com.oracle.libuv.cb.StreamConnectionCallback;
+
+import static com.oracle.libuv.handles.DefaultHandleFactory.newFactory;
+
+public class ResolverTest extends TestBase {
+
+    private static final int PORT = 23466;
+
+    @Test
+    public void testResolveCached() throws Throwable {
+        final AtomicInteger resolved = new AtomicInteger(0);
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final Resolver resolver = loop.getResolver();
+        Assert.assertSame(loop.getResolver(), resolver);
+
+        final ResolveCallback callback = new ResolveCallback() {
+            @Override
+            public void onResolve(final String[] addresses, final Exception error) throws Exception {
+                Assert.assertNull(error);
+                Assert.assertTrue(addresses.length > 0);
+                resolved.incrementAndGet();
+            }
+        };
+
+        // both lookups are merged into one request
+        resolver.resolve("localhost", callback);
+        resolver.resolve("localhost", callback);
+        Assert.assertNull(resolver.lookup("localhost"));
+        loop.run();
+
+        Assert.assertEquals(resolved.get(), 2);
+        Assert.assertEquals(resolver.getLookups(), 1);
+        Assert.assertNotNull(resolver.lookup("localhost"));
+
+        resolver.resolve("localhost", callback);
+        Assert.assertEquals(resolved.get(), 3);
+        Assert.assertEquals(resolver.getLookups(), 1);
+
+        Assert.assertEquals(resolver.lookup("127.0.0.1"), new String[] {"127.0.0.1"});
+        resolver.clear();
+        Assert.assertNull(resolver.lookup("localhost"));
+    }
+
+    @Test
+    public void testNegativeCache() throws Throwable {
+        final AtomicInteger failed = new AtomicInteger(0);
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final Resolver resolver = loop.getResolver();
+
+        final ResolveCallback callback = new ResolveCallback() {
+            @Override
+            public void onResolve(final String[] addresses, final Exception error) throws Exception {
+                Assert.assertNull(addresses);
+                Assert.assertNotNull(error);
+                failed.incrementAndGet();
+            }
+        };
+
+        resolver.resolve("no-such-host.invalid", callback);
+        loop.run();
+        resolver.resolve("no-such-host.invalid", callback);
+
+        Assert.assertEquals(failed.get(), 2);
+        Assert.assertEquals(resolver.getLookups(), 1);
+        Assert.assertNull(resolver.lookup("no-such-host.invalid"));
+    }
+
+    @Test
+    public void testConnectHost() throws Throwable {
+        final AtomicBoolean connected = new AtomicBoolean(false);
+        final AtomicBoolean serverDone = new AtomicBoolean(false);
+        final AtomicBoolean clientDone = new AtomicBoolean(false);
+
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final TCPHandle server = handleFactory.newTCPHandle();
+        final TCPHandle peer = handleFactory.newTCPHandle();
+        final TCPHandle client = handleFactory.newTCPHandle();
+
+        server.setConnectionCallback(new StreamConnectionCallback() {
+            @Override
+            public void onConnection(final int status, final Exception error) throws Exception {
+                server.accept(peer);
+                peer.close();
+                server.close();
+            }
+        });
+
+        server.setCloseCallback(new StreamCloseCallback() {
+            @Override
+            public void onClose() throws Exception {
+                serverDone.set(true);
+            }
+        });
+
+        client.setConnectCallback(new StreamConnectCallback() {
+            @Override
+            public void onConnect(final int status, final Exception error) throws Exception {
+                Assert.assertEquals(status, 0);
+                connected.set(true);
+                client.close();
+            }
+        });
+
+        client.setCloseCallback(new StreamCloseCallback() {
+            @Override
+            public void onClose() throws Exception {
+                clientDone.set(true);
+            }
+        });
+
+        server.bind("127.0.0.1", PORT);
+        server.listen(1);
+        // localhost may resolve to ::1 first, a numeric host skips the lookup
+        Assert.assertEquals(client.connectHost("127.0.0.1", PORT), 0);
+
+        while (!serverDone.get() || !clientDone.get()) {
+            loop.run();
+        }
+
+        Assert.assertTrue(connected.get());
+        Assert.assertEquals(loop.getResolver().getLookups(), 0);
+    }
+
+    public static void main(final String[] args) throws Throwable {
+        final ResolverTest test = new ResolverTest();
+        test.testResolveCached();
+        test.testNegativeCache();
+        test.testConnectHost();
+    }
+
+}
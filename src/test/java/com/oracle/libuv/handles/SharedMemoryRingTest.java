@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+package com.oracle.libuv.handles;
+
+import java.io.File;
+import java.nio.ByteBuffer;
+import java.util.concurrent.atomic.AtomicBoolean;
+import java.util.concurrent.atomic.AtomicInteger;
+
+import org.testng.Assert;
+import org.testng.annotations.Test;
+
+import com.oracle.libuv.TestBase;
+import com.oracle.libuv.cb.SharedMemoryRingCallback;
+import com.oracle.libuv.cb.StreamCloseCallback;
+import com.oracle.libuv.cb.StreamConnectCallback;
+import com.oracle.libuv.cb.StreamConnectionCallback;
+
+import static com.oracle.libuv.handles.DefaultHandleFactory.newFactory;
+
+public class SharedMemoryRingTest extends TestBase {
+
+    private static final String ADDRESS = "127.0.0.1";
+    private static final int PORT = 23467;
+    private static final int ROUNDS = 20;
+    private static final int BATCH = 10;
+
+    private static void sendBatch(final SharedMemoryRing ring, final StreamHandle wakeup, final int round) {
+        for (int i = 0; i < BATCH; i++) {
+            // sizes vary so records wrap around the small ring
+            final ByteBuffer message = ByteBuffer.allocate(4 + (round * BATCH + i) % 37);
+            message.putInt(0, round * BATCH + i);
+            Assert.assertTrue(ring.send(message, wakeup));
+        }
+    }
+
+    @Test
+    public void testSendReceive() throws Throwable {
+        if (IS_WINDOWS) return;
+
+        final String path = TestBase.TMPDIR + File.separator + "libuv-java-shared-ring";
+        final AtomicInteger received = new AtomicInteger(0);
+        final AtomicBoolean serverDone = new AtomicBoolean(false);
+        final AtomicBoolean clientDone = new AtomicBoolean(false);
+
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final TCPHandle server = handleFactory.newTCPHandle();
+        final TCPHandle peer = handleFactory.newTCPHandle();
+        final TCPHandle client = handleFactory.newTCPHandle();
+
+        // both ends of the ring live in this process for the test
+        final SharedMemoryRing producer = SharedMemoryRing.create(path, 1000);
+        final SharedMemoryRing consumer = SharedMemoryRing.open(path);
+        Assert.assertEquals(consumer.capacity(), 1024);
+        Assert.assertEquals(consumer.maxMessageSize(), 508);
+        new File(path).delete();
+
+        server.setConnectionCallback(new StreamConnectionCallback() {
+            @Override
+            public void onConnection(final int status, final Exception error) throws Exception {
+                server.accept(peer);
+                server.close();
+                consumer.receive(peer, new SharedMemoryRingCallback() {
+                    @Override
+                    public void onMessage(final ByteBuffer message) throws Exception {
+                        Assert.assertTrue(message.isDirect());
+                        final int n = received.getAndIncrement();
+                        Assert.assertEquals(message.getInt(0), n);
+                        Assert.assertEquals(message.remaining(), 4 + n % 37);
+                        if (received.get() == ROUNDS * BATCH) {
+                            client.close();
+                        } else if (received.get() % BATCH == 0) {
+                            sendBatch(producer, client, received.get() / BATCH);
+                        }
+                    }
+                });
+            }
+        });
+
+        peer.setCloseCallback(new StreamCloseCallback() {
+            @Override
+            public void onClose() throws Exception {
+                serverDone.set(true);
+            }
+        });
+
+        client.setConnectCallback(new StreamConnectCallback() {
+            @Override
+            public void onConnect(final int status, final Exception error) throws Exception {
+                Assert.assertEquals(status, 0);
+                sendBatch(producer, client, 0);
+            }
+        });
+
+        client.setCloseCallback(new StreamCloseCallback() {
+            @Override
+            public void onClose() throws Exception {
+                clientDone.set(true);
+            }
+        });
+
+        server.bind(ADDRESS, PORT);
+        server.listen(1);
+        client.connect(ADDRESS, PORT);
+
+        while (!serverDone.get() || !clientDone.get()) {
+            loop.run();
+        }
+
+        Assert.assertEquals(received.get(), ROUNDS * BATCH);
+        producer.close();
+        consumer.close();
+    }
+
+    public static void main(final String[] args) throws Throwable {
+        final SharedMemoryRingTest test = new SharedMemoryRingTest();
+        test.testSendReceive();
+    }
+
+}
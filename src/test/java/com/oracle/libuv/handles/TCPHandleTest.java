@@ -25,7 +25,11 @@
 
 package com.oracle.libuv.handles;
 
+import java.io.ByteArrayOutputStream;
 import java.nio.ByteBuffer;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
 import java.util.Random;
 import java.util.concurrent.atomic.AtomicBoolean;
 import java.util.concurrent.atomic.AtomicInteger;
@@ -33,12 +37,20 @@ import java.util.concurrent.atomic.AtomicInteger;
 import org.testng.Assert;
 import org.testng.annotations.Test;
 
+import com.oracle.libuv.Constants;
+import com.oracle.libuv.Files;
 import com.oracle.libuv.Logger;
 import com.oracle.libuv.TestBase;
 import com.oracle.libuv.cb.StreamCloseCallback;
+import com.oracle.libuv.cb.StreamConnectionBatchCallback;
 import com.oracle.libuv.cb.StreamConnectCallback;
 import com.oracle.libuv.cb.StreamConnectionCallback;
+import com.oracle.libuv.cb.StreamDrainCallback;
 import com.oracle.libuv.cb.StreamReadCallback;
+import com.oracle.libuv.cb.StreamSendFileCallback;
+import com.oracle.libuv.cb.StreamShutdownCallback;
+import com.oracle.libuv.cb.StreamWriteCallback;
+import com.oracle.libuv.cb.TimerCallback;
 
 import static com.oracle.libuv.handles.DefaultHandleFactory.newFactory;
 
@@ -48,6 +60,15 @@ public class TCPHandleTest extends TestBase {
     private static final String ADDRESS6 = "::1";
     private static final int PORT = 23456;
     private static final int PORT6 = 34567;
+    private static final int POOLED_PORT = 23457;
+    private static final int WRITEV_PORT = 23458;
+    private static final int CORK_PORT = 23459;
+    private static final int STRING_PORT = 23460;
+    private static final int WATER_MARK_PORT = 23462;
+    private static final int SEND_FILE_PORT = 23463;
+    private static final int ACCEPT_BATCH_PORT = 23464;
+    private static final int FRAMING_PORT = 23465;
+    private static final int CONNECTION_POOL_PORT = 23469;
     private static final int TIMES = 10;
 
     @Test
@@ -273,10 +294,831 @@ public class TCPHandleTest extends TestBase {
         Assert.assertEquals(clientRecvCount.get(), TIMES);
     }
 
+    @Test
+    public void testPooledReads() throws Throwable {
+        final String message = "pooled message";
+        final AtomicInteger bytesRead = new AtomicInteger(0);
+        final AtomicInteger recycled = new AtomicInteger(0);
+        final AtomicInteger writes = new AtomicInteger(0);
+        final AtomicBoolean serverDone = new AtomicBoolean(false);
+        final AtomicBoolean clientDone = new AtomicBoolean(false);
+
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final TCPHandle server = handleFactory.newTCPHandle();
+        final TCPHandle peer = handleFactory.newTCPHandle();
+        final TCPHandle client = handleFactory.newTCPHandle();
+
+        server.setConnectionCallback(new StreamConnectionCallback() {
+            @Override
+            public void onConnection(int status, Exception error) throws Exception {
+                server.accept(peer);
+                peer.setReadBufferPooling(true);
+                peer.readStart();
+                server.close();
+            }
+        });
+
+        peer.setReadCallback(new StreamReadCallback() {
+            @Override
+            public void onRead(final ByteBuffer data) throws Exception {
+                if (data == null) {
+                    peer.close();
+                    return;
+                }
+                Assert.assertTrue(data.isDirect());
+                bytesRead.addAndGet(data.remaining());
+                if (peer.recycle(data)) {
+                    recycled.incrementAndGet();
+                }
+                Assert.assertFalse(loop.recycle(data)); // already recycled
+                if (bytesRead.get() == message.length() * TIMES) {
+                    peer.close();
+                }
+            }
+        });
+
+        peer.setCloseCallback(new StreamCloseCallback() {
+            @Override
+            public void onClose() throws Exception {
+                serverDone.set(true);
+            }
+        });
+
+        client.setConnectCallback(new StreamConnectCallback() {
+            @Override
+            public void onConnect(int status, Exception error) throws Exception {
+                for (int i = 0; i < TIMES; i++) {
+                    client.write(message);
+                }
+            }
+        });
+
+        client.setWriteCallback(new StreamWriteCallback() {
+            @Override
+            public void onWrite(int status, Exception error) throws Exception {
+                if (writes.incrementAndGet() == TIMES) {
+                    client.close();
+                }
+            }
+        });
+
+        client.setCloseCallback(new StreamCloseCallback() {
+            @Override
+            public void onClose() throws Exception {
+                clientDone.set(true);
+            }
+        });
+
+        server.bind(ADDRESS, POOLED_PORT);
+        server.listen(1);
+        client.connect(ADDRESS, POOLED_PORT);
+
+        while (!serverDone.get() || !clientDone.get()) {
+            loop.run();
+        }
+
+        Assert.assertEquals(bytesRead.get(), message.length() * TIMES);
+        Assert.assertTrue(recycled.get() > 0);
+        Assert.assertFalse(loop.recycle(ByteBuffer.allocateDirect(16)));
+    }
+
+    @Test
+    public void testWritevDirect() throws Throwable {
+        final String header = "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\n";
+        final String body = "hello";
+        final StringBuilder received = new StringBuilder();
+        final AtomicInteger writes = new AtomicInteger(0);
+        final AtomicBoolean serverDone = new AtomicBoolean(false);
+        final AtomicBoolean clientDone = new AtomicBoolean(false);
+
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final TCPHandle server = handleFactory.newTCPHandle();
+        final TCPHandle peer = handleFactory.newTCPHandle();
+        final TCPHandle client = handleFactory.newTCPHandle();
+
+        server.setConnectionCallback(new StreamConnectionCallback() {
+            @Override
+            public void onConnection(int status, Exception error) throws Exception {
+                server.accept(peer);
+                peer.readStart();
+                server.close();
+            }
+        });
+
+        peer.setReadCallback(new StreamReadCallback() {
+            @Override
+            public void onRead(final ByteBuffer data) throws Exception {
+                if (data == null) {
+                    peer.close();
+                    return;
+                }
+                final byte[] bytes = new byte[data.remaining()];
+                data.get(bytes);
+                received.append(new String(bytes, "utf-8"));
+                if (received.length() == header.length() + body.length()) {
+                    peer.close();
+                }
+            }
+        });
+
+        peer.setCloseCallback(new StreamCloseCallback() {
+            @Override
+            public void onClose() throws Exception {
+                serverDone.set(true);
+            }
+        });
+
+        client.setConnectCallback(new StreamConnectCallback() {
+            @Override
+            public void onConnect(int status, Exception error) throws Exception {
+                final ByteBuffer[] buffers = {
+                    ByteBuffer.allocateDirect(header.length()),
+                    ByteBuffer.allocateDirect(body.length())
+                };
+                buffers[0].put(header.getBytes("utf-8"));
+                buffers[1].put(body.getBytes("utf-8"));
+                client.write(buffers);
+            }
+        });
+
+        client.setWriteCallback(new StreamWriteCallback() {
+            @Override
+            public void onWrite(int status, Exception error) throws Exception {
+                writes.incrementAndGet();
+                client.close();
+            }
+        });
+
+        client.setCloseCallback(new StreamCloseCallback() {
+            @Override
+            public void onClose() throws Exception {
+                clientDone.set(true);
+            }
+        });
+
+        server.bind(ADDRESS, WRITEV_PORT);
+        server.listen(1);
+        client.connect(ADDRESS, WRITEV_PORT);
+
+        while (!serverDone.get() || !clientDone.get()) {
+            loop.run();
+        }
+
+        Assert.assertEquals(writes.get(), 1);
+        Assert.assertEquals(received.toString(), header + body);
+    }
+
+    @Test
+    public void testCork() throws Throwable {
+        final int count = 10;
+        final String message = "PING\r\n";
+        final StringBuilder received = new StringBuilder();
+        final AtomicInteger writes = new AtomicInteger(0);
+        final AtomicInteger reads = new AtomicInteger(0);
+        final AtomicBoolean serverDone = new AtomicBoolean(false);
+        final AtomicBoolean clientDone = new AtomicBoolean(false);
+
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final TCPHandle server = handleFactory.newTCPHandle();
+        final TCPHandle peer = handleFactory.newTCPHandle();
+        final TCPHandle client = handleFactory.newTCPHandle();
+
+        server.setConnectionCallback(new StreamConnectionCallback() {
+            @Override
+            public void onConnection(int status, Exception error) throws Exception {
+                server.accept(peer);
+                peer.readStart();
+                server.close();
+            }
+        });
+
+        peer.setReadCallback(new StreamReadCallback() {
+            @Override
+            public void onRead(final ByteBuffer data) throws Exception {
+                if (data == null) {
+                    peer.close();
+                    return;
+                }
+                reads.incrementAndGet();
+                final byte[] bytes = new byte[data.remaining()];
+                data.get(bytes);
+                received.append(new String(bytes, "utf-8"));
+                if (received.length() == count * message.length()) {
+                    peer.close();
+                }
+            }
+        });
+
+        peer.setCloseCallback(new StreamCloseCallback() {
+            @Override
+            public void onClose() throws Exception {
+                serverDone.set(true);
+            }
+        });
+
+        client.setConnectCallback(new StreamConnectCallback() {
+            @Override
+            public void onConnect(int status, Exception error) throws Exception {
+                client.cork();
+                for (int i = 0; i < count; i++) {
+                    client.write(message);
+                }
+                Assert.assertEquals(client.writeQueueSize(), count * message.length());
+                client.uncork();
+            }
+        });
+
+        client.setWriteCallback(new StreamWriteCallback() {
+            @Override
+            public void onWrite(int status, Exception error) throws Exception {
+                Assert.assertEquals(status, 0);
+                if (writes.incrementAndGet() == count) {
+                    client.close();
+                }
+            }
+        });
+
+        client.setCloseCallback(new StreamCloseCallback() {
+            @Override
+            public void onClose() throws Exception {
+                clientDone.set(true);
+            }
+        });
+
+        server.bind(ADDRESS, CORK_PORT);
+        server.listen(1);
+        client.connect(ADDRESS, CORK_PORT);
+
+        while (!serverDone.get() || !clientDone.get()) {
+            loop.run();
+        }
+
+        Assert.assertEquals(writes.get(), count);
+        Assert.assertEquals(received.length(), count * message.length());
+        Assert.assertTrue(reads.get() < count);
+    }
+
+    @Test
+    public void testWriteString() throws Throwable {
+        // ascii runs, two and three byte chars, a surrogate pair and an unpaired surrogate
+        final String[] messages = {
+            "{\"key\":\"value\"}",
+            "caf\u00e9 \u20ac \ud83d\ude00 \ud800.",
+            "\u00ff latin"
+        };
+        final String[] encodings = {"utf-8", "utf-8", "iso-8859-1"};
+        final ByteArrayOutputStream expected = new ByteArrayOutputStream();
+        for (int i = 0; i < messages.length; i++) {
+            expected.write(messages[i].getBytes(encodings[i]));
+        }
+        final ByteArrayOutputStream received = new ByteArrayOutputStream();
+        final AtomicInteger writes = new AtomicInteger(0);
+        final AtomicBoolean serverDone = new AtomicBoolean(false);
+        final AtomicBoolean clientDone = new AtomicBoolean(false);
+
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final TCPHandle server = handleFactory.newTCPHandle();
+        final TCPHandle peer = handleFactory.newTCPHandle();
+        final TCPHandle client = handleFactory.newTCPHandle();
+
+        server.setConnectionCallback(new StreamConnectionCallback() {
+            @Override
+            public void onConnection(int status, Exception error) throws Exception {
+                server.accept(peer);
+                peer.readStart();
+                server.close();
+            }
+        });
+
+        peer.setReadCallback(new StreamReadCallback() {
+            @Override
+            public void onRead(final ByteBuffer data) throws Exception {
+                if (data == null) {
+                    peer.close();
+                    return;
+                }
+                final byte[] bytes = new byte[data.remaining()];
+                data.get(bytes);
+                received.write(bytes);
+                if (received.size() == expected.size()) {
+                    peer.close();
+                }
+            }
+        });
+
+        peer.setCloseCallback(new StreamCloseCallback() {
+            @Override
+            public void onClose() throws Exception {
+                serverDone.set(true);
+            }
+        });
+
+        client.setConnectCallback(new StreamConnectCallback() {
+            @Override
+            public void onConnect(int status, Exception error) throws Exception {
+                for (int i = 0; i < messages.length; i++) {
+                    client.write(messages[i], encodings[i]);
+                }
+            }
+        });
+
+        client.setWriteCallback(new StreamWriteCallback() {
+            @Override
+            public void onWrite(int status, Exception error) throws Exception {
+                if (writes.incrementAndGet() == messages.length) {
+                    client.close();
+                }
+            }
+        });
+
+        client.setCloseCallback(new StreamCloseCallback() {
+            @Override
+            public void onClose() throws Exception {
+                clientDone.set(true);
+            }
+        });
+
+        server.bind(ADDRESS, STRING_PORT);
+        server.listen(1);
+        client.connect(ADDRESS, STRING_PORT);
+
+        while (!serverDone.get() || !clientDone.get()) {
+            loop.run();
+        }
+
+        Assert.assertEquals(writes.get(), messages.length);
+        Assert.assertEquals(received.toByteArray(), expected.toByteArray());
+    }
+
+    @Test
+    public void testWaterMarks() throws Throwable {
+        final int count = 10;
+        final int high = 4;
+        final String message = "PING\r\n";
+        final StringBuilder received = new StringBuilder();
+        final AtomicInteger writes = new AtomicInteger(0);
+        final AtomicInteger throttled = new AtomicInteger(0);
+        final AtomicInteger drains = new AtomicInteger(0);
+        final AtomicBoolean serverDone = new AtomicBoolean(false);
+        final AtomicBoolean clientDone = new AtomicBoolean(false);
+
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final TCPHandle server = handleFactory.newTCPHandle();
+        final TCPHandle peer = handleFactory.newTCPHandle();
+        final TCPHandle client = handleFactory.newTCPHandle();
+
+        server.setConnectionCallback(new StreamConnectionCallback() {
+            @Override
+            public void onConnection(int status, Exception error) throws Exception {
+                server.accept(peer);
+                peer.readStart();
+                server.close();
+            }
+        });
+
+        peer.setReadCallback(new StreamReadCallback() {
+            @Override
+            public void onRead(final ByteBuffer data) throws Exception {
+                if (data == null) {
+                    peer.close();
+                    return;
+                }
+                final byte[] bytes = new byte[data.remaining()];
+                data.get(bytes);
+                received.append(new String(bytes, "utf-8"));
+            }
+        });
+
+        peer.setCloseCallback(new StreamCloseCallback() {
+            @Override
+            public void onClose() throws Exception {
+                serverDone.set(true);
+            }
+        });
+
+        client.setConnectCallback(new StreamConnectCallback() {
+            @Override
+            public void onConnect(int status, Exception error) throws Exception {
+                client.setWaterMarks(high * message.length(), 0);
+                // corked bytes count toward the marks, which makes crossing them deterministic
+                client.cork();
+                for (int i = 0; i < count; i++) {
+                    if (client.write(message) == TCPHandle.WRITE_THROTTLED) {
+                        throttled.incrementAndGet();
+                    }
+                }
+                client.uncork();
+            }
+        });
+
+        client.setWriteCallback(new StreamWriteCallback() {
+            @Override
+            public void onWrite(int status, Exception error) throws Exception {
+                Assert.assertEquals(status, 0);
+                writes.incrementAndGet();
+            }
+        });
+
+        client.setDrainCallback(new StreamDrainCallback() {
+            @Override
+            public void onDrain() throws Exception {
+                drains.incrementAndGet();
+                Assert.assertEquals(writes.get(), count);
+                Assert.assertEquals(client.writeQueueSize(), 0);
+                client.close();
+            }
+        });
+
+        client.setCloseCallback(new StreamCloseCallback() {
+            @Override
+            public void onClose() throws Exception {
+                clientDone.set(true);
+            }
+        });
+
+        server.bind(ADDRESS, WATER_MARK_PORT);
+        server.listen(1);
+        client.connect(ADDRESS, WATER_MARK_PORT);
+
+        while (!serverDone.get() || !clientDone.get()) {
+            loop.run();
+        }
+
+        Assert.assertEquals(throttled.get(), count - high + 1);
+        Assert.assertEquals(drains.get(), 1);
+        Assert.assertEquals(received.length(), count * message.length());
+    }
+
+    @Test
+    public void testSendFile() throws Throwable {
+        if (IS_WINDOWS) {
+            return;
+        }
+        final String filename = "TCPHandleTest-testSendFile.txt";
+        final byte[] contents = new byte[256 * 1024];
+        new Random(7).nextBytes(contents);
+        final ByteArrayOutputStream expected = new ByteArrayOutputStream();
+        expected.write("header".getBytes("utf-8"));
+        expected.write(contents, 1024, contents.length - 1024);
+        expected.write("trailer".getBytes("utf-8"));
+        final ByteArrayOutputStream received = new ByteArrayOutputStream();
+        final AtomicInteger sent = new AtomicInteger(0);
+        final AtomicBoolean serverDone = new AtomicBoolean(false);
+        final AtomicBoolean clientDone = new AtomicBoolean(false);
+
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final Files files = handleFactory.newFiles();
+        final TCPHandle server = handleFactory.newTCPHandle();
+        final TCPHandle peer = handleFactory.newTCPHandle();
+        final TCPHandle client = handleFactory.newTCPHandle();
+
+        final int fd = files.open(filename, Constants.O_RDWR | Constants.O_CREAT, Constants.S_IRWXU);
+        files.write(fd, ByteBuffer.wrap(contents), 0, contents.length, 0);
+
+        server.setConnectionCallback(new StreamConnectionCallback() {
+            @Override
+            public void onConnection(int status, Exception error) throws Exception {
+                server.accept(peer);
+                peer.readStart();
+                server.close();
+            }
+        });
+
+        peer.setReadCallback(new StreamReadCallback() {
+            @Override
+            public void onRead(final ByteBuffer data) throws Exception {
+                if (data == null) {
+                    peer.close();
+                    return;
+                }
+                final byte[] bytes = new byte[data.remaining()];
+                data.get(bytes);
+                received.write(bytes);
+            }
+        });
+
+        peer.setCloseCallback(new StreamCloseCallback() {
+            @Override
+            public void onClose() throws Exception {
+                serverDone.set(true);
+            }
+        });
+
+        client.setConnectCallback(new StreamConnectCallback() {
+            @Override
+            public void onConnect(int status, Exception error) throws Exception {
+                client.write("header");
+                client.sendFile(fd, 1024, contents.length);
+                // held back until the file is out
+                client.write("trailer");
+            }
+        });
+
+        client.setSendFileCallback(new StreamSendFileCallback() {
+            @Override
+            public void onSendFile(final long bytesSent, final Exception error) throws Exception {
+                Assert.assertNull(error);
+                // asked for more than the file holds
+                Assert.assertEquals(bytesSent, contents.length - 1024);
+                sent.incrementAndGet();
+                client.closeWrite();
+            }
+        });
+
+        client.setShutdownCallback(new StreamShutdownCallback() {
+            @Override
+            public void onShutdown(int status, Exception error) throws Exception {
+                client.close();
+            }
+        });
+
+        client.setCloseCallback(new StreamCloseCallback() {
+            @Override
+            public void onClose() throws Exception {
+                clientDone.set(true);
+            }
+        });
+
+        server.bind(ADDRESS, SEND_FILE_PORT);
+        server.listen(1);
+        client.connect(ADDRESS, SEND_FILE_PORT);
+
+        while (!serverDone.get() || !clientDone.get()) {
+            loop.run();
+        }
+
+        files.close(fd);
+        files.unlink(filename);
+        Assert.assertEquals(sent.get(), 1);
+        Assert.assertEquals(received.toByteArray(), expected.toByteArray());
+    }
+
+    @Test
+    public void testAcceptBatch() throws Throwable {
+        final int clients = 5;
+        final AtomicInteger accepted = new AtomicInteger(0);
+        final AtomicInteger batches = new AtomicInteger(0);
+        final AtomicInteger closed = new AtomicInteger(0);
+        final AtomicBoolean serverDone = new AtomicBoolean(false);
+
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final TCPHandle server = handleFactory.newTCPHandle();
+
+        server.setConnectionCallback(new StreamConnectionCallback() {
+            @Override
+            public void onConnection(int status, Exception error) throws Exception {
+                Assert.fail("batched server got a connection callback: " + error);
+            }
+        });
+
+        server.setConnectionBatchCallback(new StreamConnectionBatchCallback() {
+            @Override
+            public void onConnections(final int count, final long[] pointers) throws Exception {
+                Assert.assertTrue(count > 0 && count <= clients);
+                batches.incrementAndGet();
+                for (int i = 0; i < count; i++) {
+                    final TCPHandle peer = handleFactory.newTCPHandle(pointers[i]);
+                    Assert.assertNotNull(peer.getPeerName());
+                    peer.close();
+                }
+                if (accepted.addAndGet(count) == clients) {
+                    server.close();
+                }
+            }
+        });
+
+        server.setCloseCallback(new StreamCloseCallback() {
+            @Override
+            public void onClose() throws Exception {
+                serverDone.set(true);
+            }
+        });
+
+        server.bind(ADDRESS, ACCEPT_BATCH_PORT);
+        server.setAcceptBatch(clients, true, true, 60);
+        server.listen(clients);
+
+        for (int i = 0; i < clients; i++) {
+            final TCPHandle client = handleFactory.newTCPHandle();
+            client.setConnectCallback(new StreamConnectCallback() {
+                @Override
+                public void onConnect(int status, Exception error) throws Exception {
+                    Assert.assertEquals(status, 0);
+                    client.close();
+                }
+            });
+            client.setCloseCallback(new StreamCloseCallback() {
+                @Override
+                public void onClose() throws Exception {
+                    closed.incrementAndGet();
+                }
+            });
+            client.connect(ADDRESS, ACCEPT_BATCH_PORT);
+        }
+
+        while (!serverDone.get() || closed.get() < clients) {
+            loop.run();
+        }
+
+        Assert.assertEquals(accepted.get(), clients);
+        Assert.assertTrue(batches.get() <= clients);
+    }
+
+    @Test
+    public void testFraming() throws Throwable {
+        final List<String> expected = Arrays.asList("HELLO", "abc", "de", "", "fghij");
+        final List<String> frames = new ArrayList<>();
+        final AtomicInteger writes = new AtomicInteger(0);
+        final AtomicBoolean serverDone = new AtomicBoolean(false);
+        final AtomicBoolean clientDone = new AtomicBoolean(false);
+
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final TCPHandle server = handleFactory.newTCPHandle();
+        final TCPHandle peer = handleFactory.newTCPHandle();
+        final TCPHandle client = handleFactory.newTCPHandle();
+
+        server.setConnectionCallback(new StreamConnectionCallback() {
+            @Override
+            public void onConnection(int status, Exception error) throws Exception {
+                server.accept(peer);
+                peer.setReadBufferPooling(true);
+                peer.setDelimiterFraming(new byte[] {'\r', '\n'}, 64);
+                peer.readStart();
+                server.close();
+            }
+        });
+
+        peer.setReadCallback(new StreamReadCallback() {
+            @Override
+            public void onRead(final ByteBuffer data) throws Exception {
+                if (data == null) {
+                    peer.close();
+                    return;
+                }
+                final byte[] bytes = new byte[data.remaining()];
+                data.get(bytes);
+                peer.recycle(data);
+                frames.add(new String(bytes, "US-ASCII"));
+                if (frames.size() == 1) {
+                    // the rest of the bytes already read are framed this way
+                    peer.setLengthPrefixFraming(2, true, 64);
+                }
+                if (frames.size() == expected.size()) {
+                    peer.close();
+                }
+            }
+        });
+
+        peer.setCloseCallback(new StreamCloseCallback() {
+            @Override
+            public void onClose() throws Exception {
+                serverDone.set(true);
+            }
+        });
+
+        client.setConnectCallback(new StreamConnectCallback() {
+            @Override
+            public void onConnect(int status, Exception error) throws Exception {
+                final byte[] first = {'H', 'E', 'L', 'L', 'O', '\r', '\n', 0, 3, 'a', 'b', 'c', 0, 2, 'd'};
+                final byte[] second = {'e', 0, 0, 0, 5, 'f', 'g', 'h', 'i', 'j'};
+                client.write(ByteBuffer.wrap(first));
+                client.write(ByteBuffer.wrap(second));
+            }
+        });
+
+        client.setWriteCallback(new StreamWriteCallback() {
+            @Override
+            public void onWrite(int status, Exception error) throws Exception {
+                if (writes.incrementAndGet() == 2) {
+                    client.close();
+                }
+            }
+        });
+
+        client.setCloseCallback(new StreamCloseCallback() {
+            @Override
+            public void onClose() throws Exception {
+                clientDone.set(true);
+            }
+        });
+
+        server.bind(ADDRESS, FRAMING_PORT);
+        server.listen(1);
+        client.connect(ADDRESS, FRAMING_PORT);
+
+        while (!serverDone.get() || !clientDone.get()) {
+            loop.run();
+        }
+
+        Assert.assertEquals(frames, expected);
+    }
+
+    @Test
+    public void testConnectionPool() throws Throwable {
+        final List<TCPHandle> peers = new ArrayList<>();
+        final AtomicBoolean done = new AtomicBoolean(false);
+
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final TCPHandle server = handleFactory.newTCPHandle();
+        final TCPConnectionPool pool = new TCPConnectionPool(handleFactory, 2, 200);
+        final TimerHandle timer = handleFactory.newTimerHandle();
+
+        server.setConnectionCallback(new StreamConnectionCallback() {
+            @Override
+            public void onConnection(int status, Exception error) throws Exception {
+                final TCPHandle peer = handleFactory.newTCPHandle();
+                server.accept(peer);
+                peers.add(peer);
+            }
+        });
+
+        final TCPHandle[] client = new TCPHandle[1];
+        client[0] = pool.open(ADDRESS, CONNECTION_POOL_PORT, new StreamConnectCallback() {
+            @Override
+            public void onConnect(int status, Exception error) throws Exception {
+                Assert.assertEquals(status, 0);
+                pool.release(client[0], ADDRESS, CONNECTION_POOL_PORT);
+                Assert.assertEquals(pool.idleCount(), 1);
+                Assert.assertNull(pool.checkout(ADDRESS, CONNECTION_POOL_PORT + 1));
+                Assert.assertSame(pool.checkout(ADDRESS, CONNECTION_POOL_PORT), client[0]);
+                Assert.assertEquals(pool.getHits(), 1);
+                Assert.assertEquals(pool.idleCount(), 0);
+                pool.release(client[0], ADDRESS, CONNECTION_POOL_PORT);
+                // the peer closing the idle connection fails it on checkout
+                timer.start(20, 0);
+            }
+        });
+
+        timer.setTimerFiredCallback(new TimerCallback() {
+            @Override
+            public void onTimer(final int status) throws Exception {
+                if (!peers.isEmpty()) {
+                    Assert.assertEquals(peers.size(), 1);
+                    peers.remove(0).close();
+                    timer.start(20, 0);
+                    return;
+                }
+                Assert.assertNull(pool.checkout(ADDRESS, CONNECTION_POOL_PORT));
+                Assert.assertEquals(pool.getInvalid(), 1);
+                Assert.assertEquals(pool.getMisses(), 2);
+
+                // an idle connection left alone is evicted
+                final TCPHandle[] other = new TCPHandle[1];
+                other[0] = pool.open(ADDRESS, CONNECTION_POOL_PORT, new StreamConnectCallback() {
+                    @Override
+                    public void onConnect(int status, Exception error) throws Exception {
+                        Assert.assertEquals(status, 0);
+                        pool.release(other[0], ADDRESS, CONNECTION_POOL_PORT);
+                        done.set(true);
+                    }
+                });
+            }
+        });
+
+        server.bind(ADDRESS, CONNECTION_POOL_PORT);
+        server.listen(2);
+
+        final long start = System.currentTimeMillis();
+        while (!done.get() || pool.getEvictions() == 0) {
+            if (System.currentTimeMillis() - start > TIMEOUT) {
+                Assert.fail("timeout waiting for the connection pool");
+            }
+            loop.runNoWait();
+        }
+
+        Assert.assertEquals(pool.idleCount(), 0);
+        Assert.assertEquals(pool.getEvictions(), 1);
+        pool.close();
+        for (final TCPHandle peer : peers) {
+            peer.close();
+        }
+        timer.close();
+        server.close();
+        loop.run();
+    }
+
     public static void main(final String[] args) throws Throwable {
         final TCPHandleTest test = new TCPHandleTest();
         test.testConnection();
         test.testConnection6();
+        test.testPooledReads();
+        test.testWritevDirect();
+        test.testCork();
+        test.testWriteString();
+        test.testWaterMarks();
+        test.testSendFile();
+        test.testAcceptBatch();
+        test.testFraming();
+        test.testConnectionPool();
     }
 
 }
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2013, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+
+package com.oracle.libuv.handles;
+
+import java.util.BitSet;
+import java.util.concurrent.atomic.AtomicInteger;
+
+import org.testng.Assert;
+import org.testng.annotations.Test;
+
+import com.oracle.libuv.TestBase;
+import com.oracle.libuv.cb.TimerWheelCallback;
+
+import static com.oracle.libuv.handles.DefaultHandleFactory.newFactory;
+
+public class TimerWheelTest extends TestBase {
+
+    private static final int TIMES = 1000;
+    private static final long RESOLUTION = 5;
+
+    @Test
+    public void testExpiry() throws Throwable {
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final TimerWheel wheel = handleFactory.newTimerWheel(RESOLUTION);
+        final long[] due = new long[TIMES];
+        final BitSet fired = new BitSet(TIMES);
+        final AtomicInteger wrong = new AtomicInteger(0);
+        final AtomicInteger batches = new AtomicInteger(0);
+
+        wheel.setExpiredCallback(new TimerWheelCallback() {
+            @Override
+            public void onExpired(final int count, final long[] tokens) throws Exception {
+                batches.incrementAndGet();
+                final long now = TimerHandle.now(loop);
+                for (int i = 0; i < count; i++) {
+                    final int token = (int) tokens[i];
+                    if (fired.get(token) || now < due[token]) {
+                        wrong.incrementAndGet();
+                    }
+                    fired.set(token);
+                }
+            }
+        });
+
+        final long start = TimerHandle.now(loop);
+        final long[] ids = new long[TIMES];
+        for (int i = 0; i < TIMES; i++) {
+            final long delay = 10 + (i % 100);
+            due[i] = start + delay;
+            ids[i] = wheel.schedule(delay, i);
+        }
+        Assert.assertEquals(wheel.size(), TIMES);
+
+        int cancelled = 0;
+        for (int i = 0; i < TIMES; i += 10) {
+            Assert.assertTrue(wheel.cancel(ids[i]));
+            Assert.assertFalse(wheel.cancel(ids[i]));
+            cancelled++;
+        }
+        Assert.assertEquals(wheel.size(), TIMES - cancelled);
+
+        // the wheel stops ticking once empty, which ends the run
+        loop.run();
+
+        Assert.assertEquals(wheel.size(), 0);
+        Assert.assertEquals(fired.cardinality(), TIMES - cancelled);
+        for (int i = 0; i < TIMES; i += 10) {
+            Assert.assertFalse(fired.get(i));
+        }
+        Assert.assertEquals(wrong.get(), 0);
+        Assert.assertTrue(batches.get() < TIMES - cancelled);
+        Assert.assertFalse(wheel.cancel(ids[1]));
+        wheel.close();
+    }
+
+    public static void main(final String[] args) throws Throwable {
+        final TimerWheelTest test = new TimerWheelTest();
+        test.testExpiry();
+    }
+}
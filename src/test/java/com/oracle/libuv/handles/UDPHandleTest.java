@@ -34,7 +34,9 @@ import org.testng.annotations.Test;
 
 import com.oracle.libuv.Address;
 import com.oracle.libuv.TestBase;
+import com.oracle.libuv.cb.UDPRecvBatchCallback;
 import com.oracle.libuv.cb.UDPRecvCallback;
+import com.oracle.libuv.cb.UDPRecvRingCallback;
 import com.oracle.libuv.cb.UDPSendCallback;
 
 import static com.oracle.libuv.handles.DefaultHandleFactory.newFactory;
@@ -45,6 +47,8 @@ public class UDPHandleTest extends TestBase {
     private static final String HOST6 = "::1";
     private static final int PORT = 34567;
     private static final int PORT6 = 45678;
+    private static final int RING_PORT = 34568;
+    private static final int BATCH_PORT = 34569;
     private static final int TIMES = 10;
 
     @Test
@@ -159,10 +163,133 @@ public class UDPHandleTest extends TestBase {
         Assert.assertEquals(serverRecvCount.get(), TIMES);
     }
 
+    @Test
+    public void testRecvRing() throws Throwable {
+        final int slots = 4;
+        final int slotSize = 64;
+        final AtomicInteger serverRecvCount = new AtomicInteger(0);
+        final AtomicBoolean serverDone = new AtomicBoolean(false);
+        final Address[] peers = new Address[TIMES];
+
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final UDPHandle server = handleFactory.newUDPHandle();
+        final UDPHandle client = handleFactory.newUDPHandle();
+
+        server.setRecvRingCallback(new UDPRecvRingCallback() {
+            @Override
+            public void onRecv(int nread, ByteBuffer ring, int offset, Address address) throws Exception {
+                final int count = serverRecvCount.getAndIncrement();
+                Assert.assertSame(ring, server.recvRing());
+                Assert.assertEquals(offset, (count % slots) * slotSize);
+                final byte[] data = new byte[nread];
+                for (int i = 0; i < nread; i++) {
+                    data[i] = ring.get(offset + i);
+                }
+                Assert.assertEquals(new String(data, "utf-8"), "PING." + count);
+                peers[count] = address;
+                if (count + 1 == TIMES) {
+                    server.close();
+                    client.close();
+                    serverDone.set(true);
+                }
+            }
+        });
+
+        server.bind(RING_PORT, HOST);
+        server.recvStart(slots, slotSize);
+        Assert.assertEquals(server.recvRing().capacity(), slots * slotSize);
+
+        for (int i = 0; i < TIMES; i++) {
+            client.send("PING." + i, RING_PORT, HOST);
+        }
+
+        final long start = System.currentTimeMillis();
+        while (!serverDone.get()) {
+            if (System.currentTimeMillis() - start > TestBase.TIMEOUT) {
+                Assert.fail("timeout");
+            }
+            loop.runNoWait();
+        }
+
+        Assert.assertEquals(serverRecvCount.get(), TIMES);
+        for (int i = 1; i < TIMES; i++) {
+            // all datagrams came from the same peer
+            Assert.assertSame(peers[i], peers[0]);
+        }
+    }
+
+    @Test
+    public void testBatch() throws Throwable {
+        final AtomicInteger serverRecvCount = new AtomicInteger(0);
+        final AtomicInteger batches = new AtomicInteger(0);
+        final AtomicInteger sendCallbacks = new AtomicInteger(0);
+        final AtomicBoolean serverDone = new AtomicBoolean(false);
+
+        final HandleFactory handleFactory = newFactory();
+        final LoopHandle loop = handleFactory.getLoopHandle();
+        final UDPHandle server = handleFactory.newUDPHandle();
+        final UDPHandle client = handleFactory.newUDPHandle();
+
+        server.setRecvBatchCallback(new UDPRecvBatchCallback() {
+            @Override
+            public void onRecv(int count, ByteBuffer ring, int[] offsets, int[] lengths, Address[] addresses) throws Exception {
+                Assert.assertTrue(count > 0 && count <= offsets.length);
+                batches.incrementAndGet();
+                for (int i = 0; i < count; i++) {
+                    Assert.assertEquals(lengths[i], 8);
+                    Assert.assertEquals(ring.get(offsets[i]), (byte) 'B');
+                    Assert.assertEquals(addresses[i].getIp(), HOST);
+                }
+                if (serverRecvCount.addAndGet(count) == TIMES) {
+                    server.close();
+                    serverDone.set(true);
+                }
+            }
+        });
+
+        client.setSendCallback(new UDPSendCallback() {
+            @Override
+            public void onSend(int status, Exception error) throws Exception {
+                Assert.assertEquals(status, 0);
+                sendCallbacks.incrementAndGet();
+                client.close();
+            }
+        });
+
+        server.bind(BATCH_PORT, HOST);
+        server.recvBatchStart(16, 64, 8);
+
+        final ByteBuffer[] buffers = new ByteBuffer[TIMES];
+        final int[] ports = new int[TIMES];
+        final String[] hosts = new String[TIMES];
+        for (int i = 0; i < TIMES; i++) {
+            buffers[i] = ByteBuffer.allocateDirect(8);
+            buffers[i].put(0, (byte) 'B');
+            ports[i] = BATCH_PORT;
+            hosts[i] = HOST;
+        }
+        client.sendBatch(buffers, ports, hosts);
+
+        final long start = System.currentTimeMillis();
+        while (!serverDone.get() || sendCallbacks.get() == 0) {
+            if (System.currentTimeMillis() - start > TestBase.TIMEOUT) {
+                Assert.fail("timeout");
+            }
+            loop.runNoWait();
+        }
+
+        Assert.assertEquals(serverRecvCount.get(), TIMES);
+        Assert.assertTrue(batches.get() <= TIMES);
+        Assert.assertEquals(sendCallbacks.get(), 1);
+    }
+
     public static void main(final String[] args) throws Throwable {
         final UDPHandleTest test = new UDPHandleTest();
         test.testConnection();
         test.testConnection6();
+        test.testRecvRing();
+        test.testBatch();
     }
 
     public static boolean isIPv6Enabled(final LoopHandle loop) {